@@ -1,17 +1,39 @@
 #include "aled_rmt.h"
 
 #include "driver/rmt_tx.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include <stdlib.h>
+
 #define ALED_RMT_MAX_CHANNELS 8
-#define SYMBOL_CHUNK          512
+#define RESET_US              280   // WS2812B rev5 latch; SK6812 needs 80
+#define TX_WAIT_MS            50
 
 static const char *TAG = "ALED_RMT";
 
-static rmt_channel_handle_t s_channels[ALED_RMT_MAX_CHANNELS];
-static gpio_num_t           s_channel_gpio[ALED_RMT_MAX_CHANNELS];
+// Bytes encoder for the pixel payload followed by a copy encoder for the
+// latch/reset low period, so a whole frame is one rmt_transmit() call.
+typedef struct {
+  rmt_encoder_t        base;
+  rmt_encoder_handle_t bytes;
+  rmt_encoder_handle_t copy;
+  int                  state;
+  rmt_symbol_word_t    reset;
+} aled_encoder_t;
+
+typedef struct {
+  rmt_channel_handle_t chan;
+  aled_encoder_t      *enc;
+  gpio_num_t           gpio;
+  uint8_t             *wire;      // packed bytes in strip order; owned by the in-flight transfer
+  size_t               wire_cap;
+  bool                 in_flight;
+} aled_tx_t;
+
+static aled_tx_t s_tx[ALED_RMT_MAX_CHANNELS];
 
 typedef struct {
   uint16_t t1h, t1l, t0h, t0l;
@@ -31,13 +53,92 @@ static inline rmt_symbol_word_t sym(uint16_t high, uint16_t low){
   };
 }
 
+static size_t aled_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan,
+                          const void *data, size_t data_size, rmt_encode_state_t *ret_state){
+  aled_encoder_t *enc = __containerof(encoder, aled_encoder_t, base);
+  rmt_encode_state_t session = RMT_ENCODING_RESET;
+  rmt_encode_state_t state = RMT_ENCODING_RESET;
+  size_t encoded = 0;
+
+  if (enc->state == 0){
+    encoded += enc->bytes->encode(enc->bytes, chan, data, data_size, &session);
+    if (session & RMT_ENCODING_COMPLETE){
+      enc->state = 1;
+    }
+    if (session & RMT_ENCODING_MEM_FULL){
+      *ret_state = (rmt_encode_state_t)(state | RMT_ENCODING_MEM_FULL);
+      return encoded;
+    }
+  }
+  if (enc->state == 1){
+    encoded += enc->copy->encode(enc->copy, chan, &enc->reset, sizeof(enc->reset), &session);
+    if (session & RMT_ENCODING_COMPLETE){
+      enc->state = RMT_ENCODING_RESET;
+      state = (rmt_encode_state_t)(state | RMT_ENCODING_COMPLETE);
+    }
+    if (session & RMT_ENCODING_MEM_FULL){
+      state = (rmt_encode_state_t)(state | RMT_ENCODING_MEM_FULL);
+    }
+  }
+  *ret_state = state;
+  return encoded;
+}
+
+static esp_err_t aled_encoder_reset(rmt_encoder_t *encoder){
+  aled_encoder_t *enc = __containerof(encoder, aled_encoder_t, base);
+  rmt_encoder_reset(enc->bytes);
+  rmt_encoder_reset(enc->copy);
+  enc->state = RMT_ENCODING_RESET;
+  return ESP_OK;
+}
+
+static esp_err_t aled_encoder_del(rmt_encoder_t *encoder){
+  aled_encoder_t *enc = __containerof(encoder, aled_encoder_t, base);
+  if (enc->bytes) rmt_del_encoder(enc->bytes);
+  if (enc->copy) rmt_del_encoder(enc->copy);
+  free(enc);
+  return ESP_OK;
+}
+
+static esp_err_t aled_encoder_new(aled_encoder_t **out){
+  aled_encoder_t *enc = calloc(1, sizeof(*enc));
+  if (!enc){
+    return ESP_ERR_NO_MEM;
+  }
+  enc->base.encode = aled_encode;
+  enc->base.reset = aled_encoder_reset;
+  enc->base.del = aled_encoder_del;
+
+  const ws_timing_t T = ws2812_t();
+  rmt_bytes_encoder_config_t bcfg = {
+    .bit0 = sym(T.t0h, T.t0l),
+    .bit1 = sym(T.t1h, T.t1l),
+    .flags.msb_first = 1
+  };
+  rmt_copy_encoder_config_t ccfg = {0};
+  esp_err_t err = rmt_new_bytes_encoder(&bcfg, &enc->bytes);
+  if (err == ESP_OK){
+    err = rmt_new_copy_encoder(&ccfg, &enc->copy);
+  }
+  if (err != ESP_OK){
+    aled_encoder_del(&enc->base);
+    return err;
+  }
+  // 10 ticks/us; split the low period across both halves of the symbol
+  uint16_t half = (RESET_US * 10) / 2;
+  enc->reset = (rmt_symbol_word_t){ .duration0 = half, .level0 = 0, .duration1 = half, .level1 = 0 };
+  *out = enc;
+  return ESP_OK;
+}
+
 esp_err_t aled_rmt_init_chan(int idx, gpio_num_t pin){
   if (idx < 0 || idx >= ALED_RMT_MAX_CHANNELS){
     return ESP_ERR_INVALID_ARG;
   }
 
-  if (s_channels[idx]){
-    ESP_LOGW(TAG, "Channel %d already initialised on GPIO %d", idx, s_channel_gpio[idx]);
+  aled_tx_t *tx = &s_tx[idx];
+  if (tx->chan){
+    ESP_LOGW(TAG, "Channel %d already initialised on GPIO %d", idx, tx->gpio);
     return ESP_OK;
   }
 
@@ -45,113 +146,109 @@ esp_err_t aled_rmt_init_chan(int idx, gpio_num_t pin){
     .gpio_num = pin,
     .clk_src = RMT_CLK_SRC_DEFAULT,
     .resolution_hz = 10 * 1000 * 1000, // 10 MHz -> 100 ns ticks
-    .mem_block_symbols = 96,
-    .trans_queue_depth = 4
+    .mem_block_symbols = 64,
+    .trans_queue_depth = 2
   };
 
-  esp_err_t err = rmt_new_tx_channel(&cfg, &s_channels[idx]);
+  esp_err_t err = rmt_new_tx_channel(&cfg, &tx->chan);
   if (err != ESP_OK){
     ESP_LOGE(TAG, "rmt_new_tx_channel failed: %s", esp_err_to_name(err));
     return err;
   }
 
-  err = rmt_enable(s_channels[idx]);
+  err = aled_encoder_new(&tx->enc);
+  if (err != ESP_OK){
+    ESP_LOGE(TAG, "encoder alloc failed: %s", esp_err_to_name(err));
+    rmt_del_channel(tx->chan);
+    tx->chan = NULL;
+    return err;
+  }
+
+  err = rmt_enable(tx->chan);
   if (err != ESP_OK){
     ESP_LOGE(TAG, "rmt_enable failed: %s", esp_err_to_name(err));
-    rmt_del_channel(s_channels[idx]);
-    s_channels[idx] = NULL;
+    tx->enc->base.del(&tx->enc->base);
+    tx->enc = NULL;
+    rmt_del_channel(tx->chan);
+    tx->chan = NULL;
     return err;
   }
 
-  s_channel_gpio[idx] = pin;
+  tx->gpio = pin;
   ESP_LOGI(TAG, "RMT channel %d initialised on GPIO %d", idx, pin);
   return ESP_OK;
 }
 
-static inline uint8_t pixel_component(const px_rgba_t* px, int component_idx, color_order_t order, bool rgbw){
+// Byte offsets of r,g,b,w inside one packed pixel for each wire order.
+static inline void order_offsets(color_order_t order, uint8_t off[4]){
   switch(order){
     case ORDER_RGB:
-      if (component_idx == 0) return px->r;
-      if (component_idx == 1) return px->g;
-      if (component_idx == 2) return px->b;
-      break;
+    case ORDER_RGBW: off[0] = 0; off[1] = 1; off[2] = 2; off[3] = 3; break;
     case ORDER_GRB:
-      if (component_idx == 0) return px->g;
-      if (component_idx == 1) return px->r;
-      if (component_idx == 2) return px->b;
-      break;
-    case ORDER_RGBW:
-      if (component_idx == 0) return px->r;
-      if (component_idx == 1) return px->g;
-      if (component_idx == 2) return px->b;
-      if (component_idx == 3) return px->w;
-      break;
     case ORDER_GRBW:
-      if (component_idx == 0) return px->g;
-      if (component_idx == 1) return px->r;
-      if (component_idx == 2) return px->b;
-      if (component_idx == 3) return px->w;
-      break;
-    default:
-      break;
-  }
-  if (rgbw && component_idx == 3){
-    return px->w;
-  }
-  return 0;
+    default:         off[0] = 1; off[1] = 0; off[2] = 2; off[3] = 3; break;
+  }
+}
+
+static esp_err_t wait_idle(aled_tx_t *tx, int idx){
+  if (!tx->in_flight){
+    return ESP_OK;
+  }
+  esp_err_t err = rmt_tx_wait_all_done(tx->chan, TX_WAIT_MS);
+  if (err != ESP_OK){
+    ESP_LOGW(TAG, "ch%d previous frame still in flight: %s", idx, esp_err_to_name(err));
+    return err;
+  }
+  tx->in_flight = false;
+  return ESP_OK;
 }
 
 esp_err_t aled_rmt_write(int idx, const px_rgba_t* fb, int npx, led_type_t type, color_order_t order){
-  if (idx < 0 || idx >= ALED_RMT_MAX_CHANNELS || !s_channels[idx] || !fb || npx <= 0){
+  if (idx < 0 || idx >= ALED_RMT_MAX_CHANNELS || !s_tx[idx].chan || !fb || npx <= 0){
     return ESP_ERR_INVALID_ARG;
   }
+  aled_tx_t *tx = &s_tx[idx];
 
-  const ws_timing_t T = ws2812_t();
-  const int stride = (type == LED_SK6812_RGBW) ? 4 : 3;
-  const int total_bits = npx * stride * 8;
-
-  static rmt_symbol_word_t symbols[SYMBOL_CHUNK];
-  rmt_transmit_config_t tc = {
-    .loop_count = 0
-  };
-
-  int bit_index = 0;
-  while (bit_index < total_bits){
-    int take = total_bits - bit_index;
-    if (take > SYMBOL_CHUNK){
-      take = SYMBOL_CHUNK;
-    }
+  // The wire buffer belongs to the previous transfer until it completes. At
+  // the frame intervals the engine uses this normally returns immediately.
+  esp_err_t err = wait_idle(tx, idx);
+  if (err != ESP_OK){
+    return err;
+  }
 
-    for (int k = 0; k < take; ++k){
-      int global_bit = bit_index + k;
-      int pixel = global_bit / (stride * 8);
-      int within_pixel = global_bit % (stride * 8);
-      int component = within_pixel / 8;
-      int bit_pos = 7 - (within_pixel % 8);
-
-      uint8_t value = 0;
-      if (pixel < npx){
-        value = pixel_component(&fb[pixel], component, order, stride == 4);
-      }
-
-      if (value & (1 << bit_pos)){
-        symbols[k] = sym(T.t1h, T.t1l);
-      } else {
-        symbols[k] = sym(T.t0h, T.t0l);
-      }
+  const int stride = (type == LED_SK6812_RGBW) ? 4 : 3;
+  const size_t bytes = (size_t)npx * stride;
+  if (bytes > tx->wire_cap){
+    uint8_t *grown = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!grown){
+      return ESP_ERR_NO_MEM;
     }
+    heap_caps_free(tx->wire);
+    tx->wire = grown;
+    tx->wire_cap = bytes;
+  }
 
-    esp_err_t err = rmt_transmit(s_channels[idx], NULL, symbols, take * sizeof(rmt_symbol_word_t), &tc);
-    if (err != ESP_OK){
-      ESP_LOGE(TAG, "rmt_transmit failed ch%d: %s", idx, esp_err_to_name(err));
-      return err;
+  uint8_t off[4];
+  order_offsets(order, off);
+  uint8_t *out = tx->wire;
+  for (int i = 0; i < npx; ++i, out += stride){
+    out[off[0]] = fb[i].r;
+    out[off[1]] = fb[i].g;
+    out[off[2]] = fb[i].b;
+    if (stride == 4){
+      out[off[3]] = fb[i].w;
     }
-
-    bit_index += take;
   }
 
-  // Reset pulse (60 us); 1 ms delay is safe.
-  vTaskDelay(pdMS_TO_TICKS(1));
+  rmt_transmit_config_t tc = {
+    .loop_count = 0
+  };
+  err = rmt_transmit(tx->chan, &tx->enc->base, tx->wire, bytes, &tc);
+  if (err != ESP_OK){
+    ESP_LOGE(TAG, "rmt_transmit failed ch%d: %s", idx, esp_err_to_name(err));
+    return err;
+  }
+  tx->in_flight = true;
   return ESP_OK;
 }
 
@@ -159,9 +256,19 @@ void aled_rmt_deinit(int idx){
   if (idx < 0 || idx >= ALED_RMT_MAX_CHANNELS){
     return;
   }
-  if (s_channels[idx]){
-    rmt_disable(s_channels[idx]);
-    rmt_del_channel(s_channels[idx]);
-    s_channels[idx] = NULL;
+  aled_tx_t *tx = &s_tx[idx];
+  if (tx->chan){
+    wait_idle(tx, idx);
+    rmt_disable(tx->chan);
+    rmt_del_channel(tx->chan);
+    tx->chan = NULL;
+  }
+  if (tx->enc){
+    tx->enc->base.del(&tx->enc->base);
+    tx->enc = NULL;
   }
+  heap_caps_free(tx->wire);
+  tx->wire = NULL;
+  tx->wire_cap = 0;
+  tx->in_flight = false;
 }
@@ -0,0 +1,167 @@
+#include "audio_feed.h"
+
+#include "esp_log.h"
+#include "net_io.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "AUDIO_FEED";
+
+// Sequence jumps beyond these mean the sender restarted (as sync_packet.c).
+#define SEQ_MAX_DROPOUT   3000
+#define SEQ_MAX_MISORDER  100
+#define READ_TRIES        4
+
+typedef struct {
+    bool          heard;
+    int64_t       rx_us;                      // newest packet
+    audio_frame_t frame;
+    int64_t       onset_us[FX_AUDIO_ONSETS];  // newest onset of each kind
+    audio_pll_t   pll;
+} feed_state_t;
+
+// s_work belongs to the writer. Publishing copies it into s_pub under a
+// sequence count, odd while the copy is in progress (a seqlock): readers
+// copy s_pub and retry if the count moved, so neither side ever waits. A
+// reader that preempts the writer mid-copy on the same core would spin
+// for nothing, hence the bounded retries. The stats are written by the
+// writer only (read_retries by readers), so a reader may see a packet
+// half counted.
+static feed_state_t       s_work;
+static feed_state_t       s_pub;
+static atomic_uint        s_seq;
+static audio_feed_stats_t s_stats;
+static int                s_net = -1;
+
+static void publish(void) {
+    unsigned seq = atomic_load_explicit(&s_seq, memory_order_relaxed);
+    atomic_store_explicit(&s_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&s_pub, &s_work, sizeof(s_pub));
+    atomic_store_explicit(&s_seq, seq + 2, memory_order_release);
+}
+
+void audio_feed_reset(void) {
+    memset(&s_work, 0, sizeof(s_work));
+    memset(&s_stats, 0, sizeof(s_stats));
+    publish();
+}
+
+static bool note_onsets(uint8_t onsets, int64_t rx_us) {
+    for (int k = 0; k < FX_AUDIO_ONSETS; k++) {
+        if (onsets & (1u << k)) s_work.onset_us[k] = rx_us;
+    }
+    return (onsets & ((1u << FX_AUDIO_ONSETS) - 1)) != 0;
+}
+
+void audio_feed_handle(const uint8_t *buf, size_t len, int64_t rx_us) {
+    s_stats.packets++;
+    audio_frame_t f;
+    if (!audio_packet_decode(buf, len, &f)) {
+        s_stats.malformed++;
+        return;
+    }
+    if (s_work.heard) {
+        int32_t gap = (int32_t)(f.seq - s_work.frame.seq);
+        if (gap <= 0 && gap > -SEQ_MAX_MISORDER) {
+            // Overtaken: its levels and beat are old news, its onsets
+            // still happened.
+            s_stats.stale++;
+            if (note_onsets(f.onsets, rx_us)) publish();
+            return;
+        }
+        if (gap > 1 && gap < SEQ_MAX_DROPOUT) {
+            s_stats.lost += (uint32_t)gap - 1;
+        } else if (gap != 1) {
+            s_stats.restarts++;
+        }
+    }
+    s_work.heard = true;
+    s_work.rx_us = rx_us;
+    s_work.frame = f;
+    note_onsets(f.onsets, rx_us);
+    audio_pll_update(&s_work.pll, f.beat_phase, f.tempo_bpm, rx_us);
+    s_stats.beat_outliers = s_work.pll.outliers;
+    s_stats.beat_snaps = s_work.pll.snaps;
+    s_stats.beat_err = s_work.pll.err;
+    publish();
+}
+
+static float fade(int64_t since_us, int64_t hold_us, int64_t fall_us) {
+    if (since_us <= hold_us) return 1.0f;
+    if (since_us >= hold_us + fall_us) return 0.0f;
+    return 1.0f - (float)(since_us - hold_us) / (float)fall_us;
+}
+
+bool audio_feed_read(int64_t now_us, fx_audio_t *out) {
+    feed_state_t st;
+    bool ok = false;
+    for (int i = 0; i < READ_TRIES && !ok; i++) {
+        unsigned seq = atomic_load_explicit(&s_seq, memory_order_acquire);
+        if (seq & 1) {
+            s_stats.read_retries++;
+            continue;
+        }
+        memcpy(&st, &s_pub, sizeof(st));
+        atomic_thread_fence(memory_order_acquire);
+        ok = atomic_load_explicit(&s_seq, memory_order_relaxed) == seq;
+        if (!ok) s_stats.read_retries++;
+    }
+    if (!ok) return false;
+
+    memset(out, 0, sizeof(*out));
+    // A packet may land between the caller's clock read and the copy.
+    int64_t since = now_us > st.rx_us ? now_us - st.rx_us : 0;
+    if (!st.heard || since >= AUDIO_FEED_TIMEOUT_MS * 1000LL) return true;
+
+    out->live = true;
+    float level = fade(since, AUDIO_FEED_HOLD_MS * 1000LL, AUDIO_FEED_RELEASE_MS * 1000LL);
+    out->n_bands = st.frame.n_bands;
+    for (int i = 0; i < st.frame.n_bands; i++) {
+        out->bands[i] = st.frame.bands[i] * level;
+    }
+    out->level = st.frame.level * level;
+    out->peak = st.frame.peak * level;
+    for (int k = 0; k < FX_AUDIO_ONSETS; k++) {
+        if (!st.onset_us[k]) continue;
+        int64_t age = now_us > st.onset_us[k] ? now_us - st.onset_us[k] : 0;
+        out->onset[k] = fade(age, 0, AUDIO_FEED_ONSET_MS * 1000LL);
+    }
+    if (audio_pll_phase(&st.pll, now_us, &out->beat_phase)) {
+        out->tempo_bpm = audio_pll_bpm(&st.pll);
+    }
+    return true;
+}
+
+static void audio_feed_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                          int64_t rx_us, void *ctx) {
+    audio_feed_handle(buf, len, rx_us);
+}
+
+esp_err_t audio_feed_start(uint16_t port) {
+    audio_feed_stop();
+    net_io_proto_t rx = { .name = "audio_feed", .port = port, .rx = audio_feed_rx };
+    s_net = net_io_register(&rx);
+    if (s_net < 0) {
+        ESP_LOGE(TAG, "No socket for port %u", port);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Listening on port %u", net_io_port(s_net));
+    return ESP_OK;
+}
+
+void audio_feed_stop(void) {
+    net_io_unregister(s_net);
+    s_net = -1;
+}
+
+uint16_t audio_feed_port(void) {
+    return s_net >= 0 ? net_io_port(s_net) : 0;
+}
+
+void audio_feed_get_stats(audio_feed_stats_t *out) {
+    if (out) {
+        *out = s_stats;
+    }
+}
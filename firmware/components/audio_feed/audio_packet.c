@@ -0,0 +1,58 @@
+#include "audio_packet.h"
+#include <string.h>
+
+static uint16_t to_q16(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 0xFFFF;
+    return (uint16_t)(v * 65535.0f + 0.5f);
+}
+
+size_t audio_packet_encode(uint8_t *buf, size_t cap, const audio_frame_t *frame) {
+    if (frame->n_bands < 1 || frame->n_bands > AUDIO_BANDS_MAX) return 0;
+    size_t len = sizeof(audio_header_t) + 2u * frame->n_bands;
+    if (cap < len) return 0;
+
+    audio_header_t hdr = {
+        .magic = AUDIO_MAGIC,
+        .version = AUDIO_VERSION,
+        .n_bands = frame->n_bands,
+        .seq = frame->seq,
+        .host_us = frame->host_us,
+        .tempo_mbpm = frame->tempo_bpm > 0.0f ? (uint32_t)(frame->tempo_bpm * 1000.0f + 0.5f) : 0,
+        .onsets = frame->onsets,
+        .level_q16 = to_q16(frame->level),
+        .peak_q16 = to_q16(frame->peak)
+    };
+    uint32_t q = (uint32_t)(frame->beat_phase * 65536.0f + 0.5f);
+    hdr.beat_phase_q16 = (uint16_t)(q > 0xFFFF ? 0 : q);
+    memcpy(buf, &hdr, sizeof(hdr));
+    for (int i = 0; i < frame->n_bands; i++) {
+        uint16_t v = to_q16(frame->bands[i]);
+        memcpy(buf + sizeof(hdr) + 2 * i, &v, 2);
+    }
+    return len;
+}
+
+bool audio_packet_decode(const uint8_t *buf, size_t len, audio_frame_t *out) {
+    audio_header_t hdr;
+    if (!buf || len < sizeof(hdr)) return false;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != AUDIO_MAGIC || hdr.version != AUDIO_VERSION) return false;
+    if (hdr.n_bands < 1 || hdr.n_bands > AUDIO_BANDS_MAX) return false;
+    if (len < sizeof(hdr) + 2u * hdr.n_bands) return false;
+
+    out->seq = hdr.seq;
+    out->host_us = hdr.host_us;
+    out->tempo_bpm = hdr.tempo_mbpm / 1000.0f;
+    out->beat_phase = hdr.beat_phase_q16 / 65536.0f;
+    out->onsets = hdr.onsets;
+    out->level = hdr.level_q16 / 65535.0f;
+    out->peak = hdr.peak_q16 / 65535.0f;
+    out->n_bands = hdr.n_bands;
+    for (int i = 0; i < hdr.n_bands; i++) {
+        uint16_t v;
+        memcpy(&v, buf + sizeof(hdr) + 2 * i, 2);
+        out->bands[i] = v / 65535.0f;
+    }
+    return true;
+}
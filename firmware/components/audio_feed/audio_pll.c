@@ -0,0 +1,83 @@
+#include "audio_pll.h"
+#include <math.h>
+#include <string.h>
+
+#define KP        0.1f
+#define KI        0.05f      // skew per beat of error
+#define SKEW_MAX  0.02f
+#define GATE_JITTERS  4.0f
+#define SETTLE        16         // updates after a snap with the gate open
+
+// Beats at t_us, not wrapped; double for the same reason as sync_show_phase.
+static double advance(const audio_pll_t *p, int64_t t_us) {
+    return p->phase + (double)(t_us - p->ref_us) * p->tempo_hz * (1.0 + p->skew) / 1e6;
+}
+
+static float wrap_half(double x) {
+    return (float)(x - floor(x + 0.5));
+}
+
+void audio_pll_reset(audio_pll_t *p) {
+    memset(p, 0, sizeof(*p));
+}
+
+void audio_pll_update(audio_pll_t *p, float phase01, float bpm, int64_t t_us) {
+    if (bpm <= 0.0f) {
+        p->locked = false;
+        return;
+    }
+    float hz = bpm / 60.0f;
+    p->updates++;
+    if (p->locked) {
+        double pred = advance(p, t_us);
+        float err = wrap_half(phase01 - pred);
+        bool held = fabsf(hz - p->tempo_hz) <= AUDIO_PLL_RETEMPO * p->tempo_hz &&
+                    fabsf(err) <= AUDIO_PLL_SNAP;
+        // Settling after a snap, the gate stays open: the snap may have
+        // been onto a late packet, and is pulled back rather than redone.
+        float gate = p->settling ? AUDIO_PLL_SNAP : fmaxf(AUDIO_PLL_GATE_MIN, GATE_JITTERS * p->jitter);
+        if (held && fabsf(err) > gate && ++p->run_outliers < AUDIO_PLL_OUTLIER_RUN) {
+            p->outliers++;
+            return;
+        }
+        if (held && p->run_outliers < AUDIO_PLL_OUTLIER_RUN) {
+            p->run_outliers = 0;
+            p->jitter += (fabsf(err) - p->jitter) / 16.0f;
+            p->err = err;
+            if (p->settling) {
+                p->settling--;
+            } else {
+                p->skew += KI * err;
+                if (p->skew > SKEW_MAX) p->skew = SKEW_MAX;
+                if (p->skew < -SKEW_MAX) p->skew = -SKEW_MAX;
+            }
+            pred += KP * err;
+            p->phase = pred - floor(pred);
+            p->tempo_hz = hz;
+            p->ref_us = t_us;
+            return;
+        }
+        p->snaps++;
+    }
+    // The skew is the clocks' drift, not the music's: it survives a snap.
+    p->ref_us = t_us;
+    p->phase = phase01;
+    p->tempo_hz = hz;
+    p->err = 0.0f;
+    p->jitter = AUDIO_PLL_GATE_MIN;
+    p->run_outliers = 0;
+    p->settling = SETTLE;
+    p->locked = true;
+}
+
+bool audio_pll_phase(const audio_pll_t *p, int64_t t_us, float *phase01) {
+    if (!p->locked) return false;
+    double beats = advance(p, t_us);
+    float phase = (float)(beats - floor(beats));
+    *phase01 = phase >= 1.0f ? 0.0f : phase;
+    return true;
+}
+
+float audio_pll_bpm(const audio_pll_t *p) {
+    return p->locked ? p->tempo_hz * (1.0f + p->skew) * 60.0f : 0.0f;
+}
@@ -0,0 +1,38 @@
+#include "audio_replay.h"
+#include "audio_feed.h"
+#include <string.h>
+
+#define RECORD_HDR_LEN  6
+
+bool audio_replay_record(uint8_t *buf, size_t cap, size_t *used, uint32_t t_us,
+                         const uint8_t *pkt, size_t len) {
+    if (len > UINT16_MAX || *used + RECORD_HDR_LEN + len > cap) return false;
+    uint8_t *b = buf + *used;
+    uint16_t n = (uint16_t)len;
+    memcpy(b, &t_us, 4);
+    memcpy(b + 4, &n, 2);
+    memcpy(b + RECORD_HDR_LEN, pkt, len);
+    *used += RECORD_HDR_LEN + len;
+    return true;
+}
+
+void audio_replay_start(audio_replay_t *r, const uint8_t *data, size_t len, int64_t start_us) {
+    *r = (audio_replay_t){ .data = data, .len = len, .start_us = start_us };
+}
+
+int64_t audio_replay_run(audio_replay_t *r, int64_t now_us) {
+    while (r->pos + RECORD_HDR_LEN <= r->len) {
+        uint32_t t_us;
+        uint16_t n;
+        memcpy(&t_us, r->data + r->pos, 4);
+        memcpy(&n, r->data + r->pos + 4, 2);
+        if (r->pos + RECORD_HDR_LEN + n > r->len) break;
+        int64_t due = r->start_us + t_us;
+        if (due > now_us) return due;
+        audio_feed_handle(r->data + r->pos + RECORD_HDR_LEN, n, due);
+        r->pos += RECORD_HDR_LEN + n;
+        r->packets++;
+    }
+    r->pos = r->len;
+    return INT64_MAX;
+}
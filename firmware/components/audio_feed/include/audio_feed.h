@@ -0,0 +1,60 @@
+#pragma once
+
+#include "audio_packet.h"
+#include "audio_pll.h"
+#include "esp_err.h"
+#include "fx_audio.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Audio feature input for audio-reactive effects. An analysis host sends
+// audio_packet.h frames to AUDIO_FEED_PORT (unicast, or broadcast so every
+// node takes the same feed). The net_io task decodes each packet, runs the
+// beat PLL and publishes the result to a latest-value buffer; readers (the
+// effect engine, once per pass) copy it without a lock and get the newest
+// complete frame. Nothing queues: a frame replaces the previous one
+// whether or not it was read, and one older than the newest is dropped,
+// except for onsets, which are kept as times so a short one still shows.
+//
+// A read at now_us ages the frame: levels and bands hold for
+// AUDIO_FEED_HOLD_MS after the last packet and then fall to 0 over
+// AUDIO_FEED_RELEASE_MS, onsets fade over AUDIO_FEED_ONSET_MS, and the
+// beat runs on the PLL. After AUDIO_FEED_TIMEOUT_MS without a packet the
+// feed is no longer live.
+
+#define AUDIO_FEED_PORT         45456
+#define AUDIO_FEED_HOLD_MS      100
+#define AUDIO_FEED_RELEASE_MS   400
+#define AUDIO_FEED_ONSET_MS     150
+#define AUDIO_FEED_TIMEOUT_MS   2000
+
+typedef struct {
+    uint32_t packets;
+    uint32_t malformed;
+    uint32_t lost;           // sequence gaps
+    uint32_t stale;          // older than the newest, dropped
+    uint32_t restarts;       // sequence jumped: the sender restarted
+    uint32_t beat_outliers;  // held up too long for the PLL
+    uint32_t beat_snaps;     // the PLL snapped to the host's beat
+    uint32_t read_retries;   // a read overlapped a write
+    float    beat_err;       // last PLL phase error, beats
+} audio_feed_stats_t;
+
+// Listens on port (0 = ephemeral); one listener, a new start replaces it.
+esp_err_t audio_feed_start(uint16_t port);
+void      audio_feed_stop(void);
+uint16_t  audio_feed_port(void);    // 0 = off
+// Forgets the feed, the beat and the stats.
+void      audio_feed_reset(void);
+
+// One datagram received at rx_us (esp_timer time), as the net_io task
+// hands it on. Single writer: only that task, or a test or replay with the
+// listener stopped, may call it.
+void      audio_feed_handle(const uint8_t *buf, size_t len, int64_t rx_us);
+
+// The features at now_us (same clock), from any task; never waits. False,
+// with out untouched, if writes kept overlapping the copy: keep the last.
+bool      audio_feed_read(int64_t now_us, fx_audio_t *out);
+
+void      audio_feed_get_stats(audio_feed_stats_t *out);
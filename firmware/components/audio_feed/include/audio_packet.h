@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Audio feature packet, sent by an analysis host per analysis frame
+// (typically 40-100 per second): band energies, RMS and peak level, onset
+// flags and the host's beat tracker. Little-endian and packed; receivers
+// drop other magics and versions, as with sync packets.
+//
+//   4C 41 01 n | seq u32 | host_us i64 | tempo_mbpm u32 | beat_phase_q16 u16 |
+//   onsets u8 | flags u8 | level_q16 u16 | peak_q16 u16 | bands u16[n]   (28 + 2n B)
+//
+// Levels and bands are 0..1 as 0..65535, the beat phase 0..1 as 0..65536.
+
+#define AUDIO_MAGIC          0x414C   // "LA"
+#define AUDIO_VERSION        1
+#define AUDIO_BANDS_MAX      16
+
+// Onsets detected since the previous packet.
+#define AUDIO_ONSET_LOW      0x01     // kick
+#define AUDIO_ONSET_MID      0x02     // snare
+#define AUDIO_ONSET_HIGH     0x04     // hats
+#define AUDIO_ONSET_FULL     0x08     // broadband
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  n_bands;        // 1..AUDIO_BANDS_MAX
+    uint32_t seq;            // +1 per packet
+    int64_t  host_us;        // sender's clock at the analysis frame
+    uint32_t tempo_mbpm;     // milli-BPM, 0 = no beat
+    uint16_t beat_phase_q16; // beat phase at host_us
+    uint8_t  onsets;         // AUDIO_ONSET_*
+    uint8_t  flags;          // reserved, 0
+    uint16_t level_q16;      // RMS
+    uint16_t peak_q16;
+} audio_header_t;
+
+typedef struct {
+    uint32_t seq;
+    int64_t  host_us;
+    float    tempo_bpm;
+    float    beat_phase;
+    uint8_t  onsets;
+    float    level;
+    float    peak;
+    uint8_t  n_bands;
+    float    bands[AUDIO_BANDS_MAX];
+} audio_frame_t;
+
+// Writes a packet into buf; returns its length, 0 if it doesn't fit or
+// the band count is out of range.
+size_t audio_packet_encode(uint8_t *buf, size_t cap, const audio_frame_t *frame);
+// Validates magic, version, band count and length.
+bool   audio_packet_decode(const uint8_t *buf, size_t len, audio_frame_t *out);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Beat PLL: a local beat oscillator locked to the analysis host's beat
+// tracker, so the phase runs on between packets and through dropouts.
+// Each packet's phase, taken at its arrival, is compared with the
+// oscillator; a PI loop pulls the phase a tenth of the way and trims the
+// rate for drift between the host's clock and ours. Arrival jitter moves
+// the phase by thousandths of a beat, never a visible jump; packets held
+// up further than four times the running jitter (at least
+// AUDIO_PLL_GATE_MIN) are left out, as the sync clock does with ticks. A
+// tempo change beyond AUDIO_PLL_RETEMPO, an error beyond AUDIO_PLL_SNAP
+// (the tracker found the downbeat elsewhere), or AUDIO_PLL_OUTLIER_RUN
+// outliers in a row snap the oscillator to the packet. For a few updates
+// after a snap the gate stays open and the rate trim waits, so a snap onto
+// a late packet is pulled back smoothly.
+
+#define AUDIO_PLL_SNAP         0.15f    // beats
+#define AUDIO_PLL_RETEMPO      0.02f    // relative
+#define AUDIO_PLL_GATE_MIN     0.01f    // beats, 5 ms at 120 BPM
+#define AUDIO_PLL_OUTLIER_RUN  8
+
+typedef struct {
+    int64_t  ref_us;         // local time of phase
+    double   phase;          // beats at ref_us, 0..1
+    float    tempo_hz;       // beats per second, as sent
+    float    skew;           // rate trim, relative
+    float    err;            // last phase error, beats
+    float    jitter;         // mean phase error, beats
+    uint32_t updates;
+    uint32_t outliers;
+    uint32_t snaps;
+    uint8_t  run_outliers;
+    uint8_t  settling;       // updates left with the gate open
+    bool     locked;
+} audio_pll_t;
+
+void  audio_pll_reset(audio_pll_t *p);
+// The host's beat phase (0..1) and tempo as of local time t_us; bpm 0
+// (no beat) unlocks.
+void  audio_pll_update(audio_pll_t *p, float phase01, float bpm, int64_t t_us);
+// Phase at t_us, wrapped to 0..1; false while unlocked.
+bool  audio_pll_phase(const audio_pll_t *p, int64_t t_us, float *phase01);
+float audio_pll_bpm(const audio_pll_t *p);
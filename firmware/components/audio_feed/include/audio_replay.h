@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Recorded feature streams, for rerunning a show's audio on the bench or
+// in host tests without the analysis host. A recording is a run of
+// records, little-endian:
+//
+//   t_us u32 | len u16 | packet (len B)
+//
+// with t_us the arrival time from the start of the recording. A replay
+// hands each packet to audio_feed_handle when its time comes, as the
+// net_io task would, so everything behind it (PLL, aging, effects) runs
+// as it did live. Stop the listener while replaying: the feed takes one
+// writer.
+
+typedef struct {
+    const uint8_t *data;
+    size_t         len;
+    size_t         pos;
+    int64_t        start_us;     // local time of t_us 0
+    uint32_t       packets;      // handed on so far
+} audio_replay_t;
+
+// Appends one record at buf + *used; false if it doesn't fit.
+bool    audio_replay_record(uint8_t *buf, size_t cap, size_t *used, uint32_t t_us,
+                            const uint8_t *pkt, size_t len);
+
+void    audio_replay_start(audio_replay_t *r, const uint8_t *data, size_t len, int64_t start_us);
+// Hands on every record due by now_us; returns when the next one is due,
+// INT64_MAX once the recording is over (a truncated record ends it).
+int64_t audio_replay_run(audio_replay_t *r, int64_t now_us);
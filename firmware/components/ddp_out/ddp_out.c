@@ -0,0 +1,213 @@
+#include "ddp_out.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include "net_io.h"
+
+#include <string.h>
+
+static const char *TAG = "DDP_OUT";
+
+#define DDP_VERSION_1    0x40
+#define DDP_FLAG_PUSH    0x01
+#define DDP_TYPE_RGB8    0x0B     // RGB, 8 bits per component
+#define DDP_TYPE_RGBW8   0x1B
+#define DDP_ID_DISPLAY   1
+
+typedef struct {
+    ddp_out_target_t target;
+    const uint8_t   *data;        // frame going out; NULL = idle
+    uint32_t         len;
+    uint32_t         sent;
+    uint8_t          type;
+    uint8_t          seq;         // 1..15, one per frame
+    int64_t          next_us;
+    int64_t          gap_us;
+    ddp_out_stats_t  st;
+} out_ch_t;
+
+// s_lock guards the table: the engine holds it to submit, the net_io poll to
+// pick the next packet. Frame bytes are read without it; the submitter
+// leaves them alone until data is NULL again.
+static SemaphoreHandle_t s_lock = NULL;
+static out_ch_t          s_ch[DDP_OUT_CHANNELS];
+static int               s_net = -1;
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// Sends ch's next packet if it is due; returns when it next needs to run.
+static int64_t send_due(out_ch_t *c, int64_t now_us) {
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return NET_IO_NEVER;
+    if (!c->data || c->next_us > now_us) {
+        int64_t next = c->data ? c->next_us : NET_IO_NEVER;
+        xSemaphoreGive(s_lock);
+        return next;
+    }
+    const uint8_t *data = c->data + c->sent;
+    uint32_t n = c->len - c->sent < DDP_OUT_MAX_DATA ? c->len - c->sent : DDP_OUT_MAX_DATA;
+    bool last = c->sent + n >= c->len;
+    uint32_t off = c->target.offset + c->sent;
+    uint8_t hdr[DDP_OUT_HDR_LEN] = {
+        (uint8_t)(DDP_VERSION_1 | (last ? DDP_FLAG_PUSH : 0)), c->seq, c->type, DDP_ID_DISPLAY,
+        (uint8_t)(off >> 24), (uint8_t)(off >> 16), (uint8_t)(off >> 8), (uint8_t)off,
+        (uint8_t)(n >> 8), (uint8_t)n
+    };
+    struct sockaddr_in dst = {0};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(c->target.port ? c->target.port : DDP_OUT_PORT);
+    dst.sin_addr.s_addr = c->target.addr;
+    int sock = net_io_socket(s_net);
+    xSemaphoreGive(s_lock);
+
+    struct iovec iov[2] = {
+        { .iov_base = hdr, .iov_len = sizeof(hdr) },
+        { .iov_base = (void *)data, .iov_len = n }
+    };
+    struct msghdr msg = {
+        .msg_name = &dst,
+        .msg_namelen = sizeof(dst),
+        .msg_iov = iov,
+        .msg_iovlen = 2
+    };
+    bool ok = sock >= 0 && sendmsg(sock, &msg, 0) == (int)(sizeof(hdr) + n);
+
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return NET_IO_NEVER;
+    // A new target or a stop while we were sending ends the frame.
+    if (!c->data || c->data + c->sent != data) {
+        xSemaphoreGive(s_lock);
+        return NET_IO_NEVER;
+    }
+    if (ok) {
+        c->st.packets++;
+        c->st.bytes += n;
+    } else {
+        c->st.errors++;
+    }
+    c->sent += n;
+    int64_t next = NET_IO_NEVER;
+    if (c->sent >= c->len) {
+        c->data = NULL;
+        c->st.frames++;
+    } else {
+        // Behind schedule: still keep half a gap between packets.
+        c->next_us += c->gap_us;
+        if (c->next_us < now_us + c->gap_us / 2) c->next_us = now_us + c->gap_us / 2;
+        next = c->next_us;
+    }
+    xSemaphoreGive(s_lock);
+    return next;
+}
+
+static int64_t ddp_out_poll(int64_t now_us, void *ctx) {
+    (void)ctx;
+    int64_t next = NET_IO_NEVER;
+    for (int i = 0; i < DDP_OUT_CHANNELS; i++) {
+        int64_t due = send_due(&s_ch[i], now_us);
+        if (due < next) next = due;
+    }
+    return next;
+}
+
+esp_err_t ddp_out_set_target(int ch, const ddp_out_target_t *target) {
+    if (ch < 0 || ch >= DDP_OUT_CHANNELS) return ESP_ERR_INVALID_ARG;
+    ensure_lock();
+    if (target && target->addr && s_net < 0) {
+        static const net_io_proto_t TX = { .name = "ddp_out", .port = 0, .poll = ddp_out_poll };
+        int h = net_io_register(&TX);
+        if (h < 0) return ESP_FAIL;
+        s_net = h;
+    }
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return ESP_ERR_TIMEOUT;
+    out_ch_t *c = &s_ch[ch];
+    c->data = NULL;
+    if (target && target->addr) {
+        c->target = *target;
+    } else {
+        memset(&c->target, 0, sizeof(c->target));
+    }
+    xSemaphoreGive(s_lock);
+    if (target && target->addr) {
+        struct in_addr a = { .s_addr = target->addr };
+        ESP_LOGI(TAG, "Channel %d -> %s:%u offset %lu", ch + 1, inet_ntoa(a),
+                 target->port ? target->port : DDP_OUT_PORT, (unsigned long)target->offset);
+    }
+    return ESP_OK;
+}
+
+bool ddp_out_get_target(int ch, ddp_out_target_t *out) {
+    if (ch < 0 || ch >= DDP_OUT_CHANNELS || !out) return false;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+    *out = s_ch[ch].target;
+    xSemaphoreGive(s_lock);
+    return true;
+}
+
+// Packs RGBA to RGB front to back: each write lands at or before the
+// pixel just read.
+static void pack_rgb(px_rgba_t *px, uint16_t n) {
+    uint8_t *b = (uint8_t *)px;
+    for (uint32_t i = 0; i < n; i++) {
+        px_rgba_t p = px[i];
+        b[3 * i] = p.r;
+        b[3 * i + 1] = p.g;
+        b[3 * i + 2] = p.b;
+    }
+}
+
+bool ddp_out_submit(int ch, px_rgba_t *px, uint16_t n, bool rgbw, uint32_t window_us) {
+    if (ch < 0 || ch >= DDP_OUT_CHANNELS || !px || !n || n > DDP_OUT_MAX_PIXELS) return false;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+    out_ch_t *c = &s_ch[ch];
+    if (!c->target.addr || s_net < 0) {
+        xSemaphoreGive(s_lock);
+        return false;
+    }
+    if (c->data) {
+        c->st.busy++;
+        xSemaphoreGive(s_lock);
+        return false;
+    }
+    if (!rgbw) pack_rgb(px, n);
+    c->data = (const uint8_t *)px;
+    c->len = (uint32_t)n * (rgbw ? 4 : 3);
+    c->sent = 0;
+    c->type = rgbw ? DDP_TYPE_RGBW8 : DDP_TYPE_RGB8;
+    c->seq = (uint8_t)(c->seq % 15 + 1);
+    uint32_t packets = (c->len + DDP_OUT_MAX_DATA - 1) / DDP_OUT_MAX_DATA;
+    c->gap_us = window_us / packets;
+    c->next_us = esp_timer_get_time();
+    xSemaphoreGive(s_lock);
+    net_io_wake();
+    return true;
+}
+
+bool ddp_out_busy(int ch) {
+    if (ch < 0 || ch >= DDP_OUT_CHANNELS || !s_lock) return false;
+    bool busy = false;
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        busy = s_ch[ch].data != NULL;
+        xSemaphoreGive(s_lock);
+    }
+    return busy;
+}
+
+void ddp_out_get_stats(int ch, ddp_out_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (ch < 0 || ch >= DDP_OUT_CHANNELS) return;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        *out = s_ch[ch].st;
+        xSemaphoreGive(s_lock);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "effects.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// DDP output for channels that have no local strip: the engine renders them
+// like any other channel and hands each finished frame here, and the frame
+// goes to a remote pixel receiver as DDP over UDP.
+//
+// No staging copy: each packet is a 10-byte header plus an iovec into the
+// submitted buffer, which the caller must leave alone until the channel is
+// no longer busy (the engine ping-pongs two buffers). RGB frames are packed
+// to 3 bytes per pixel in place. Packets are paced evenly over the window
+// given with the frame by the net_io task, the last one with PUSH, so a
+// frame never leaves as one burst.
+
+#define DDP_OUT_CHANNELS    8
+#define DDP_OUT_PORT        4048
+#define DDP_OUT_HDR_LEN     10
+#define DDP_OUT_MAX_DATA    1440     // per packet: 480 RGB or 360 RGBW pixels
+#define DDP_OUT_MAX_PIXELS  1024
+
+typedef struct {
+    uint32_t addr;           // receiver IPv4, network order; 0 = off
+    uint16_t port;           // 0 = DDP_OUT_PORT
+    uint32_t offset;         // first byte in the receiver's DDP address space
+} ddp_out_target_t;
+
+typedef struct {
+    uint32_t frames;         // fully sent
+    uint32_t packets;
+    uint32_t bytes;          // pixel bytes
+    uint32_t busy;           // frames refused while the previous one was still going out
+    uint32_t errors;         // failed sends
+} ddp_out_stats_t;
+
+esp_err_t ddp_out_set_target(int ch, const ddp_out_target_t *target);   // NULL = off
+bool      ddp_out_get_target(int ch, ddp_out_target_t *out);
+
+// Queues px[0..n) for ch, spread over window_us. False (and counted as
+// busy) while the previous frame is still being sent, or with no target.
+bool      ddp_out_submit(int ch, px_rgba_t *px, uint16_t n, bool rgbw, uint32_t window_us);
+bool      ddp_out_busy(int ch);
+
+void      ddp_out_get_stats(int ch, ddp_out_stats_t *out);
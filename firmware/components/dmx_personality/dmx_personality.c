@@ -0,0 +1,247 @@
+#include "dmx_personality.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "DMX_PERSONALITY";
+
+#define FX_CHANNELS   8
+
+typedef struct {
+    dmx_slot_map_t map;
+    uint8_t        last[4];
+    bool           valid;     // last[] holds applied values
+} dmx_entry_t;
+
+static const char *const FIELD_NAMES[DMX_FIELDS] = {
+    "level8", "level16", "rgb", "rgbw", "effect", "speed", "intensity",
+    "palette", "color1", "color2", "color3", "opacity"
+};
+
+static const uint8_t FIELD_WIDTH[DMX_FIELDS] = { 1, 2, 3, 4, 1, 1, 1, 1, 3, 3, 3, 1 };
+
+static const uint32_t EFFECTS[] = {
+    FX_SOLID, FX_GRADIENT, FX_CHASE, FX_TWINKLE, FX_RAINBOW, FX_NOISE, FX_FIRE, FX_WAVES,
+    FX_SPECTRUM, FX_VU
+};
+
+// s_lock guards the table and the per-channel effect state: apply runs in
+// the net_io task, set/get from REST.
+static SemaphoreHandle_t       s_lock = NULL;
+static dmx_entry_t             s_table[DMX_PERSONALITY_MAX];
+static int                     s_count = 0;
+static effect_params_t         s_fx[FX_CHANNELS];
+static dmx_personality_ops_t   s_ops = {0};
+static dmx_personality_stats_t s_stats;
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+static bool is_fx_field(dmx_field_t f) {
+    return f >= DMX_FIELD_EFFECT && f <= DMX_FIELD_OPACITY;
+}
+
+// Without an engine to read from.
+static void fx_defaults(effect_params_t *p, int ch) {
+    memset(p, 0, sizeof(*p));
+    p->effect_id = FX_SOLID;
+    p->speed = 1.0f;
+    p->intensity = 1.0f;
+    p->color1 = (px_rgba_t){ 255, 255, 255, 0 };
+    p->seed = 0xD000u + (uint32_t)ch;
+    p->blend = BLEND_NORMAL;
+    p->opacity = 255;
+}
+
+const char *dmx_field_name(dmx_field_t field) {
+    return field < DMX_FIELDS ? FIELD_NAMES[field] : "?";
+}
+
+bool dmx_field_parse(const char *name, dmx_field_t *out) {
+    if (!name || !out) return false;
+    for (int i = 0; i < DMX_FIELDS; i++) {
+        if (strcasecmp(name, FIELD_NAMES[i]) == 0) {
+            *out = (dmx_field_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t dmx_field_width(dmx_field_t field) {
+    return field < DMX_FIELDS ? FIELD_WIDTH[field] : 0;
+}
+
+void dmx_personality_set_ops(const dmx_personality_ops_t *ops) {
+    if (ops) {
+        s_ops = *ops;
+    } else {
+        memset(&s_ops, 0, sizeof(s_ops));
+    }
+}
+
+esp_err_t dmx_personality_set(const dmx_slot_map_t *table, int n) {
+    if (n < 0 || n > DMX_PERSONALITY_MAX || (n && !table)) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < n; i++) {
+        const dmx_slot_map_t *m = &table[i];
+        uint8_t w = dmx_field_width(m->field);
+        if (!w || m->slot < 1 || m->slot + w - 1 > DMX_UNIVERSE_SLOTS ||
+            (is_fx_field(m->field) && m->ch >= FX_CHANNELS) ||
+            ((m->field == DMX_FIELD_RGB || m->field == DMX_FIELD_RGBW) && !m->group[0])) {
+            ESP_LOGW(TAG, "Entry %d: bad %s at slot %u", i, dmx_field_name(m->field), m->slot);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    // Seed mapped channels from the engine before taking s_lock, so a
+    // desk that maps only intensity leaves the running effect alone.
+    effect_params_t fx[FX_CHANNELS];
+    for (int ch = 0; ch < FX_CHANNELS; ch++) fx_defaults(&fx[ch], ch);
+    uint32_t seeded = 0;
+    for (int i = 0; i < n; i++) {
+        uint8_t ch = table[i].ch;
+        if (!is_fx_field(table[i].field) || (seeded & (1u << ch))) continue;
+        seeded |= 1u << ch;
+        if (s_ops.get_effect) s_ops.get_effect(ch, &fx[ch]);   // defaults if it fails
+    }
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return ESP_FAIL;
+    memset(s_table, 0, sizeof(s_table));
+    for (int i = 0; i < n; i++) {
+        s_table[i].map = table[i];
+        s_table[i].map.group[sizeof(s_table[i].map.group) - 1] = '\0';
+    }
+    s_count = n;
+    memcpy(s_fx, fx, sizeof(s_fx));
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "%d slot mappings", n);
+    return ESP_OK;
+}
+
+int dmx_personality_get(dmx_slot_map_t *out, int max) {
+    if (!out || max <= 0) return 0;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return 0;
+    int n = s_count < max ? s_count : max;
+    for (int i = 0; i < n; i++) out[i] = s_table[i].map;
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+bool dmx_personality_universes(uint16_t *first, uint16_t *count) {
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+    uint16_t lo = 0xFFFF, hi = 0;
+    for (int i = 0; i < s_count; i++) {
+        if (s_table[i].map.universe < lo) lo = s_table[i].map.universe;
+        if (s_table[i].map.universe > hi) hi = s_table[i].map.universe;
+    }
+    bool any = s_count > 0;
+    xSemaphoreGive(s_lock);
+    if (any) {
+        if (first) *first = lo;
+        if (count) *count = (uint16_t)(hi - lo + 1);
+    }
+    return any;
+}
+
+// Writes one changed entry into its target. FX fields only update s_fx;
+// the caller sends each touched channel once. Call with s_lock held.
+static void apply_entry(const dmx_entry_t *e, uint32_t *fx_dirty) {
+    const uint8_t *v = e->last;
+    effect_params_t *p = is_fx_field(e->map.field) ? &s_fx[e->map.ch] : NULL;
+    switch (e->map.field) {
+        case DMX_FIELD_LEVEL8:
+        case DMX_FIELD_LEVEL16: {
+            // 8-bit levels spread over the full range: 255 -> 65535.
+            uint16_t level = e->map.field == DMX_FIELD_LEVEL16 ? (uint16_t)((v[0] << 8) | v[1])
+                                                                : (uint16_t)(v[0] * 257u);
+            if (s_ops.pwm_level) s_ops.pwm_level(e->map.ch, level);
+            s_stats.pwm_writes++;
+            return;
+        }
+        case DMX_FIELD_RGB:
+        case DMX_FIELD_RGBW: {
+            uint16_t level[4] = { v[0] * 257u, v[1] * 257u, v[2] * 257u,
+                                  e->map.field == DMX_FIELD_RGBW ? v[3] * 257u : 0 };
+            if (s_ops.group_level) s_ops.group_level(e->map.group, level);
+            s_stats.group_writes++;
+            return;
+        }
+        case DMX_FIELD_EFFECT: {
+            uint32_t k = v[0] / 10u;
+            if (k >= sizeof(EFFECTS) / sizeof(EFFECTS[0])) k = sizeof(EFFECTS) / sizeof(EFFECTS[0]) - 1;
+            p->effect_id = EFFECTS[k];
+            break;
+        }
+        case DMX_FIELD_SPEED:     p->speed = v[0] * (DMX_SPEED_MAX / 255.0f); break;
+        case DMX_FIELD_INTENSITY: p->intensity = v[0] / 255.0f; break;
+        case DMX_FIELD_PALETTE:   p->palette_id = v[0]; break;
+        case DMX_FIELD_COLOR1:    p->color1 = (px_rgba_t){ v[0], v[1], v[2], 0 }; break;
+        case DMX_FIELD_COLOR2:    p->color2 = (px_rgba_t){ v[0], v[1], v[2], 0 }; break;
+        case DMX_FIELD_COLOR3:    p->color3 = (px_rgba_t){ v[0], v[1], v[2], 0 }; break;
+        case DMX_FIELD_OPACITY:   p->opacity = v[0]; break;
+        default: return;
+    }
+    *fx_dirty |= 1u << e->map.ch;
+}
+
+// A refused parameter set: the channel's entries in this universe count as
+// never applied, so the desk's next resend retries them. Call with s_lock
+// held.
+static void forget_fx(uint16_t universe, int ch) {
+    for (int i = 0; i < s_count; i++) {
+        dmx_entry_t *e = &s_table[i];
+        if (e->map.universe == universe && is_fx_field(e->map.field) && e->map.ch == ch) {
+            e->valid = false;
+        }
+    }
+}
+
+void dmx_personality_apply(uint16_t universe, const uint8_t *slots, uint16_t n) {
+    if (!slots || !s_lock) return;
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return;
+
+    bool hit = false;
+    uint32_t fx_dirty = 0;
+    for (int i = 0; i < s_count; i++) {
+        dmx_entry_t *e = &s_table[i];
+        uint8_t w = dmx_field_width(e->map.field);
+        // Short universes leave entries past their end alone.
+        if (e->map.universe != universe || e->map.slot - 1u + w > n) continue;
+        hit = true;
+        const uint8_t *v = slots + e->map.slot - 1;
+        if (e->valid && memcmp(e->last, v, w) == 0) {
+            s_stats.unchanged++;
+            continue;
+        }
+        memcpy(e->last, v, w);
+        e->valid = true;
+        apply_entry(e, &fx_dirty);
+    }
+    for (int ch = 0; fx_dirty; ch++, fx_dirty >>= 1) {
+        if (!(fx_dirty & 1u)) continue;
+        if (s_ops.set_effect && !s_ops.set_effect(ch, &s_fx[ch])) {
+            forget_fx(universe, ch);
+            continue;
+        }
+        s_stats.effect_updates++;
+    }
+    if (hit) s_stats.universes++;
+    xSemaphoreGive(s_lock);
+}
+
+void dmx_personality_get_stats(dmx_personality_stats_t *out) {
+    if (!out) return;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        *out = s_stats;
+        xSemaphoreGive(s_lock);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "effects.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// DMX personality: plain desk slots from E1.31/Art-Net universes mapped onto
+// PWM channel levels, PWM group colours and effect parameters of ALED
+// channels. Each table entry remembers the slot values it last applied, so a
+// universe resent unchanged (desks send continuously) touches nothing; only
+// entries whose slots moved reach the PWM driver or the effect engine, and
+// an ALED channel gets at most one new parameter set per universe. When the
+// table is bound, each ALED channel it maps starts from the effect the
+// engine runs (get_effect), so the desk only changes the fields it maps.
+//
+// Value mapping:
+//   level8 / level16    PWM logical level, 1 or 2 slots (coarse, fine)
+//   rgb / rgbw          PWM group, 3 or 4 slots, 8-bit each
+//   effect              slot / 10 picks from solid, gradient, chase, twinkle,
+//                       rainbow, noise, fire, waves, spectrum, vu
+//                       (waves 70..79, spectrum 80..89, vu 90..255).
+//                       Breaking change with the audio effects: 70..255
+//                       used to be waves, so patches sending 80 or more
+//                       for waves must send 70..79.
+//   speed               0..255 -> 0..DMX_SPEED_MAX
+//   intensity           0..255 -> 0..1
+//   palette             palette id
+//   color1..3           3 slots, R G B
+//   opacity             0..255
+
+#define DMX_UNIVERSE_SLOTS    512
+#define DMX_PERSONALITY_MAX   64
+#define DMX_SPEED_MAX         10.0f
+
+typedef enum {
+    DMX_FIELD_LEVEL8 = 0,
+    DMX_FIELD_LEVEL16,
+    DMX_FIELD_RGB,
+    DMX_FIELD_RGBW,
+    DMX_FIELD_EFFECT,
+    DMX_FIELD_SPEED,
+    DMX_FIELD_INTENSITY,
+    DMX_FIELD_PALETTE,
+    DMX_FIELD_COLOR1,
+    DMX_FIELD_COLOR2,
+    DMX_FIELD_COLOR3,
+    DMX_FIELD_OPACITY,
+    DMX_FIELDS
+} dmx_field_t;
+
+typedef struct {
+    uint16_t    universe;
+    uint16_t    slot;         // first slot, 1-based
+    dmx_field_t field;
+    uint8_t     ch;           // PWM LEDch or ALED channel, 0-based
+    char        group[24];    // rgb / rgbw
+} dmx_slot_map_t;
+
+typedef struct {
+    void (*pwm_level)(uint8_t ch, uint16_t level);
+    void (*group_level)(const char *group, const uint16_t level[4]);
+    // Must not block (net_io). False if refused: the channel's fields are
+    // applied again with the next universe.
+    bool (*set_effect)(int ch, const effect_params_t *params);
+    bool (*get_effect)(int ch, effect_params_t *out);
+} dmx_personality_ops_t;
+
+typedef struct {
+    uint32_t universes;       // applied
+    uint32_t unchanged;       // entries skipped by change detection
+    uint32_t pwm_writes;
+    uint32_t group_writes;
+    uint32_t effect_updates;
+} dmx_personality_stats_t;
+
+void        dmx_personality_set_ops(const dmx_personality_ops_t *ops);
+
+// Replaces the table; the next universe applies every entry once. Call
+// from a task that may block (get_effect reads the engine).
+esp_err_t   dmx_personality_set(const dmx_slot_map_t *table, int n);
+int         dmx_personality_get(dmx_slot_map_t *out, int max);
+// Universes the table listens on, as a range. False if the table is empty.
+bool        dmx_personality_universes(uint16_t *first, uint16_t *count);
+
+// Applies one universe of slot values (start code stripped).
+void        dmx_personality_apply(uint16_t universe, const uint8_t *slots, uint16_t n);
+
+void        dmx_personality_get_stats(dmx_personality_stats_t *out);
+
+const char *dmx_field_name(dmx_field_t field);
+bool        dmx_field_parse(const char *name, dmx_field_t *out);
+uint8_t     dmx_field_width(dmx_field_t field);
@@ -0,0 +1,350 @@
+#include "frame_cast.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/semphr.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include "net_io.h"
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "FRAME_CAST";
+
+// A sender that restarts (reboot or mode change) counts from 0 again under
+// a new epoch. Should a reboot draw the epoch it had, a keyframe this far
+// behind the last frame (as sync_packet.c), or any keyframe behind it once
+// the channel was quiet for FRAME_CAST_HOLD_MS, means a restart too.
+#define FRAME_MAX_MISORDER  100
+
+typedef struct {
+    px_rgba_t *prev;          // last frame sent: the next delta codes against it
+    uint16_t   n;
+    uint8_t    bpp;
+    uint32_t   frame;
+    uint32_t   since_key;
+} tx_ch_t;
+
+typedef struct {
+    px_rgba_t *ref;           // last completed frame
+    px_rgba_t *work;          // frame being assembled
+    uint16_t   cap;
+    uint16_t   n;
+    uint8_t    bpp;
+    uint32_t   ref_frame;
+    uint32_t   frame;
+    uint8_t    epoch;         // of the sender session ref and work belong to
+    uint8_t    next_part;
+    uint16_t   next_px;
+    bool       assembling;
+    bool       synced;        // ref is the frame the sender codes against
+    bool       fresh;         // ref not taken yet
+    bool       shown;
+    uint32_t   last_ms;
+} rx_ch_t;
+
+static const char *const MODE_NAMES[] = { "off", "send", "receive" };
+
+// s_lock guards both channel tables and the stats: the engine holds it per
+// frame sent, the net_io task per packet received, the engine per take.
+static SemaphoreHandle_t  s_lock = NULL;
+static frame_cast_mode_t  s_mode = FRAME_CAST_OFF;
+static int                s_net = -1;
+static struct sockaddr_in s_dest;
+static tx_ch_t            s_tx[FRAME_CAST_CHANNELS];
+static rx_ch_t            s_rx[FRAME_CAST_CHANNELS];
+static frame_cast_stats_t s_stats;
+static TaskHandle_t       s_consumer = NULL;
+static uint8_t            s_epoch = 0;
+static uint8_t            s_pkt[FRAME_CAST_PACKET_MAX];
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+const char *frame_cast_mode_name(frame_cast_mode_t mode) {
+    return mode <= FRAME_CAST_RECEIVE ? MODE_NAMES[mode] : "?";
+}
+
+bool frame_cast_mode_parse(const char *name, frame_cast_mode_t *out) {
+    if (!name || !out) return false;
+    for (int i = 0; i <= FRAME_CAST_RECEIVE; i++) {
+        if (strcasecmp(name, MODE_NAMES[i]) == 0) {
+            *out = (frame_cast_mode_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+frame_cast_mode_t frame_cast_get_mode(void) {
+    return s_mode;
+}
+
+// Call with s_lock held.
+static void release_channels(void) {
+    for (int ch = 0; ch < FRAME_CAST_CHANNELS; ch++) {
+        heap_caps_free(s_tx[ch].prev);
+        heap_caps_free(s_rx[ch].ref);
+        heap_caps_free(s_rx[ch].work);
+    }
+    memset(s_tx, 0, sizeof(s_tx));
+    memset(s_rx, 0, sizeof(s_rx));
+}
+
+static void frame_cast_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                          int64_t rx_us, void *ctx) {
+    frame_cast_handle(buf, len, (uint32_t)(rx_us / 1000));
+}
+
+esp_err_t frame_cast_set_mode(frame_cast_mode_t mode) {
+    if (mode > FRAME_CAST_RECEIVE) return ESP_ERR_INVALID_ARG;
+    if (mode == s_mode) return ESP_OK;
+    ensure_lock();
+
+    net_io_unregister(s_net);
+    s_net = -1;
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return ESP_FAIL;
+    release_channels();
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_mode = FRAME_CAST_OFF;
+    xSemaphoreGive(s_lock);
+    if (mode == FRAME_CAST_OFF) {
+        ESP_LOGI(TAG, "Off");
+        return ESP_OK;
+    }
+
+    struct in_addr grp;
+    inet_aton(FRAME_CAST_GROUP, &grp);
+    if (mode == FRAME_CAST_SEND) {
+        // Frame counts restart from 0: tell receivers it is a new session.
+        uint8_t epoch;
+        do {
+            epoch = (uint8_t)esp_random();
+        } while (epoch == s_epoch);
+        s_epoch = epoch;
+        static const net_io_proto_t TX = { .name = "frame_cast_tx", .port = 0 };
+        s_net = net_io_register(&TX);
+        if (s_net >= 0) {
+            uint8_t ttl = 1;
+            setsockopt(net_io_socket(s_net), IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+            memset(&s_dest, 0, sizeof(s_dest));
+            s_dest.sin_family = AF_INET;
+            s_dest.sin_port = htons(FRAME_CAST_PORT);
+            s_dest.sin_addr = grp;
+        }
+    } else {
+        static const net_io_proto_t RX = { .name = "frame_cast", .port = FRAME_CAST_PORT, .rx = frame_cast_rx };
+        s_net = net_io_register(&RX);
+        if (s_net >= 0 && net_io_join(s_net, grp.s_addr, true) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to join %s", FRAME_CAST_GROUP);
+        }
+    }
+    if (s_net < 0) {
+        ESP_LOGE(TAG, "No socket for %s", frame_cast_mode_name(mode));
+        return ESP_FAIL;
+    }
+    s_mode = mode;
+    ESP_LOGI(TAG, "%s on %s:%d", mode == FRAME_CAST_SEND ? "Sending" : "Receiving",
+             FRAME_CAST_GROUP, FRAME_CAST_PORT);
+    return ESP_OK;
+}
+
+static void send_part(const uint8_t *pkt, size_t len, void *ctx) {
+    int sock = *(const int *)ctx;
+    if (sendto(sock, pkt, len, 0, (const struct sockaddr *)&s_dest, sizeof(s_dest)) < 0) {
+        ESP_LOGD(TAG, "TX error: %d", errno);
+        return;
+    }
+    s_stats.wire_bytes += (uint32_t)(len - sizeof(frame_cast_header_t));
+}
+
+void frame_cast_send(int ch, const px_rgba_t *px, uint16_t n, bool rgbw) {
+    if (s_mode != FRAME_CAST_SEND || ch < 0 || ch >= FRAME_CAST_CHANNELS || !px ||
+        !n || n > FRAME_CAST_MAX_PIXELS) {
+        return;
+    }
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return;
+    int sock = net_io_socket(s_net);
+    tx_ch_t *t = &s_tx[ch];
+    uint8_t bpp = rgbw ? 4 : 3;
+    if (sock < 0) {
+        xSemaphoreGive(s_lock);
+        return;
+    }
+    bool key = !t->prev || t->n != n || t->bpp != bpp || t->since_key >= FRAME_CAST_KEY_FRAMES;
+    if (!t->prev || t->n != n) {
+        heap_caps_free(t->prev);
+        t->prev = heap_caps_malloc(n * sizeof(px_rgba_t), MALLOC_CAP_8BIT);
+        t->n = t->prev ? n : 0;
+    }
+    if (t->prev) {
+        int parts = frame_cast_packetize((uint8_t)ch, s_epoch, t->frame++, px, key ? NULL : t->prev,
+                                         n, bpp, s_pkt, send_part, &sock);
+        memcpy(t->prev, px, n * sizeof(px_rgba_t));
+        t->bpp = bpp;
+        t->since_key = key ? 1 : t->since_key + 1;
+        s_stats.frames++;
+        s_stats.keyframes += key;
+        s_stats.packets += (uint32_t)parts;
+        s_stats.raw_bytes += (uint32_t)n * bpp;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static bool ensure_rx_bufs(rx_ch_t *r, uint16_t n) {
+    if (r->cap >= n) return true;
+    heap_caps_free(r->ref);
+    heap_caps_free(r->work);
+    r->ref = heap_caps_malloc(n * sizeof(px_rgba_t), MALLOC_CAP_8BIT);
+    r->work = heap_caps_malloc(n * sizeof(px_rgba_t), MALLOC_CAP_8BIT);
+    if (!r->ref || !r->work) {
+        heap_caps_free(r->ref);
+        heap_caps_free(r->work);
+        memset(r, 0, sizeof(*r));
+        ESP_LOGE(TAG, "No memory for %u px", n);
+        return false;
+    }
+    r->cap = n;
+    r->fresh = false;
+    r->shown = false;
+    return true;
+}
+
+// Call with s_lock held. The channel waits for the next keyframe.
+static void lose_sync(rx_ch_t *r) {
+    r->assembling = false;
+    r->synced = false;
+    s_stats.dropped++;
+}
+
+// Call with s_lock held. Returns true when the part completed a frame.
+static bool accept_part(rx_ch_t *r, const frame_cast_header_t *h, const uint8_t *ops, uint32_t now_ms) {
+    bool key = h->flags & FRAME_CAST_FLAG_KEY;
+    int32_t behind = (int32_t)(h->frame - r->ref_frame);
+    if (r->synced && key && h->part == 0 &&
+        (h->epoch != r->epoch || behind < -FRAME_MAX_MISORDER ||
+         (behind <= 0 && now_ms - r->last_ms >= FRAME_CAST_HOLD_MS))) {
+        r->assembling = false;
+        r->synced = false;
+        s_stats.restarts++;
+    }
+    // Parts of another session code against frames this channel never had.
+    if ((r->synced || r->assembling) && !(key && h->part == 0) && h->epoch != r->epoch) return false;
+    // Duplicates and stragglers of frames already handled change nothing.
+    if (r->synced && behind <= 0) return false;
+    if (r->assembling && (int32_t)(h->frame - r->frame) < 0) return false;
+    if (h->part == 0) {
+        // A frame left half-built means a part went missing.
+        if (r->assembling) lose_sync(r);
+        if (key) {
+            if (!ensure_rx_bufs(r, h->n_pixels)) return false;
+            r->n = h->n_pixels;
+            r->bpp = h->bpp;
+            r->epoch = h->epoch;
+        } else if (!r->synced || h->frame != r->ref_frame + 1 || h->n_pixels != r->n || h->bpp != r->bpp) {
+            if (r->synced) {
+                lose_sync(r);
+            } else {
+                s_stats.dropped++;
+            }
+            return false;
+        } else {
+            memcpy(r->work, r->ref, r->n * sizeof(px_rgba_t));
+        }
+        r->assembling = true;
+        r->frame = h->frame;
+        r->next_part = 0;
+        r->next_px = 0;
+    }
+    if (!r->assembling) return false;
+    if (h->frame != r->frame || h->part != r->next_part || h->start != r->next_px ||
+        h->n_pixels != r->n || h->bpp != r->bpp) {
+        lose_sync(r);
+        return false;
+    }
+    if (!frame_cast_decode(ops, h->len, r->work + h->start, h->count, h->bpp)) {
+        s_stats.malformed++;
+        lose_sync(r);
+        return false;
+    }
+    r->next_part++;
+    r->next_px += h->count;
+    s_stats.packets++;
+    s_stats.wire_bytes += h->len;
+    if (!(h->flags & FRAME_CAST_FLAG_FINAL)) return false;
+    if (r->next_px != r->n) {
+        s_stats.malformed++;
+        lose_sync(r);
+        return false;
+    }
+
+    px_rgba_t *done = r->work;
+    r->work = r->ref;
+    r->ref = done;
+    r->ref_frame = r->frame;
+    r->assembling = false;
+    r->synced = true;
+    r->fresh = true;
+    r->shown = true;
+    r->last_ms = now_ms;
+    s_stats.frames++;
+    s_stats.keyframes += key;
+    s_stats.raw_bytes += (uint32_t)r->n * r->bpp;
+    return true;
+}
+
+void frame_cast_handle(const uint8_t *buf, size_t len, uint32_t now_ms) {
+    frame_cast_header_t h;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return;
+    bool done = false;
+    if (!frame_cast_parse(buf, len, &h) || h.ch >= FRAME_CAST_CHANNELS || !h.n_pixels ||
+        h.n_pixels > FRAME_CAST_MAX_PIXELS) {
+        s_stats.malformed++;
+    } else {
+        done = accept_part(&s_rx[h.ch], &h, buf + sizeof(h), now_ms);
+    }
+    TaskHandle_t notify = done ? s_consumer : NULL;
+    xSemaphoreGive(s_lock);
+    if (notify) xTaskNotifyGive(notify);
+}
+
+void frame_cast_set_consumer(TaskHandle_t task) {
+    s_consumer = task;
+}
+
+bool frame_cast_active(int ch, uint32_t now_ms) {
+    if (s_mode != FRAME_CAST_RECEIVE || ch < 0 || ch >= FRAME_CAST_CHANNELS) return false;
+    const rx_ch_t *r = &s_rx[ch];
+    return r->shown && now_ms - r->last_ms < FRAME_CAST_HOLD_MS;
+}
+
+bool frame_cast_take(int ch, px_rgba_t *dst, uint16_t n) {
+    if (ch < 0 || ch >= FRAME_CAST_CHANNELS || !dst || !s_lock) return false;
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+    rx_ch_t *r = &s_rx[ch];
+    bool fresh = r->fresh;
+    if (fresh) {
+        uint16_t k = r->n < n ? r->n : n;
+        memcpy(dst, r->ref, k * sizeof(px_rgba_t));
+        memset(dst + k, 0, (n - k) * sizeof(px_rgba_t));
+        r->fresh = false;
+    }
+    xSemaphoreGive(s_lock);
+    return fresh;
+}
+
+void frame_cast_get_stats(frame_cast_stats_t *out) {
+    if (!out) return;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        *out = s_stats;
+        xSemaphoreGive(s_lock);
+    }
+}
@@ -0,0 +1,149 @@
+#include "frame_cast_codec.h"
+#include <string.h>
+
+#define OP_SHORT_MAX  32
+
+static inline bool same(const px_rgba_t *a, const px_rgba_t *b, uint8_t bpp) {
+    return a->r == b->r && a->g == b->g && a->b == b->b && (bpp == 3 || a->w == b->w);
+}
+
+static inline size_t op_len(uint32_t count) {
+    return count > OP_SHORT_MAX ? 2 : 1;
+}
+
+static size_t put_op(uint8_t *out, frame_cast_op_t kind, uint32_t count) {
+    uint32_t c = count - 1;
+    if (count <= OP_SHORT_MAX) {
+        out[0] = (uint8_t)((kind << 6) | c);
+        return 1;
+    }
+    out[0] = (uint8_t)((kind << 6) | 0x20 | (c >> 8));
+    out[1] = (uint8_t)c;
+    return 2;
+}
+
+static inline void put_px(uint8_t *out, const px_rgba_t *p, uint8_t bpp) {
+    out[0] = p->r;
+    out[1] = p->g;
+    out[2] = p->b;
+    if (bpp == 4) out[3] = p->w;
+}
+
+static inline px_rgba_t get_px(const uint8_t *in, uint8_t bpp) {
+    return (px_rgba_t){ in[0], in[1], in[2], bpp == 4 ? in[3] : 0 };
+}
+
+// Longest literal that fits in room bytes, header included.
+static uint32_t literal_fit(size_t room, uint8_t bpp) {
+    if (room >= (size_t)(2 + (OP_SHORT_MAX + 1) * bpp)) return (uint32_t)((room - 2) / bpp);
+    uint32_t k = room >= 1 ? (uint32_t)((room - 1) / bpp) : 0;
+    return k < OP_SHORT_MAX ? k : OP_SHORT_MAX;
+}
+
+size_t frame_cast_encode(const px_rgba_t *cur, const px_rgba_t *prev, uint16_t n, uint8_t bpp,
+                         uint16_t *pos, uint8_t *out, size_t cap) {
+    size_t o = 0;
+    uint32_t i = *pos;
+    while (i < n) {
+        uint32_t limit = n - i < FRAME_CAST_OP_MAX ? n - i : FRAME_CAST_OP_MAX;
+        uint32_t k = 1;
+        if (prev && same(&cur[i], &prev[i], bpp)) {
+            while (k < limit && same(&cur[i + k], &prev[i + k], bpp)) k++;
+            if (o + op_len(k) > cap) break;
+            o += put_op(out + o, FRAME_CAST_OP_SKIP, k);
+        } else if (limit > 1 && same(&cur[i], &cur[i + 1], bpp)) {
+            k = 2;
+            while (k < limit && same(&cur[i + k], &cur[i], bpp)) k++;
+            if (o + op_len(k) + bpp > cap) break;
+            o += put_op(out + o, FRAME_CAST_OP_RUN, k);
+            put_px(out + o, &cur[i], bpp);
+            o += bpp;
+        } else {
+            // Literal up to the next unchanged pixel or the next run.
+            while (k < limit && !(prev && same(&cur[i + k], &prev[i + k], bpp)) &&
+                   !(k + 1 < limit && same(&cur[i + k], &cur[i + k + 1], bpp))) {
+                k++;
+            }
+            if (o + op_len(k) + k * bpp > cap) {
+                uint32_t fit = literal_fit(cap - o, bpp);
+                if (!fit) break;
+                k = fit;
+            }
+            o += put_op(out + o, FRAME_CAST_OP_LITERAL, k);
+            for (uint32_t j = 0; j < k; j++, o += bpp) put_px(out + o, &cur[i + j], bpp);
+        }
+        i += k;
+    }
+    *pos = (uint16_t)i;
+    return o;
+}
+
+bool frame_cast_decode(const uint8_t *ops, size_t len, px_rgba_t *dst, uint16_t count, uint8_t bpp) {
+    size_t o = 0;
+    uint32_t i = 0;
+    while (o < len) {
+        uint8_t b = ops[o++];
+        uint32_t c = b & 0x1F;
+        if (b & 0x20) {
+            if (o >= len) return false;
+            c = (c << 8) | ops[o++];
+        }
+        c += 1;
+        if (i + c > count) return false;
+        switch (b >> 6) {
+            case FRAME_CAST_OP_SKIP:
+                break;
+            case FRAME_CAST_OP_RUN: {
+                if (o + bpp > len) return false;
+                px_rgba_t p = get_px(ops + o, bpp);
+                o += bpp;
+                for (uint32_t j = 0; j < c; j++) dst[i + j] = p;
+                break;
+            }
+            case FRAME_CAST_OP_LITERAL:
+                if (o + c * bpp > len) return false;
+                for (uint32_t j = 0; j < c; j++, o += bpp) dst[i + j] = get_px(ops + o, bpp);
+                break;
+            default:
+                return false;
+        }
+        i += c;
+    }
+    return i == count;
+}
+
+int frame_cast_packetize(uint8_t ch, uint8_t epoch, uint32_t frame, const px_rgba_t *cur,
+                         const px_rgba_t *prev, uint16_t n, uint8_t bpp, uint8_t *pkt,
+                         frame_cast_emit_fn emit, void *ctx) {
+    frame_cast_header_t hdr = {
+        .magic = FRAME_CAST_MAGIC,
+        .version = FRAME_CAST_VERSION,
+        .flags = prev ? 0 : FRAME_CAST_FLAG_KEY,
+        .frame = frame,
+        .ch = ch,
+        .bpp = bpp,
+        .epoch = epoch,
+        .n_pixels = n
+    };
+    uint16_t pos = 0;
+    int parts = 0;
+    do {
+        hdr.start = pos;
+        size_t len = frame_cast_encode(cur, prev, n, bpp, &pos, pkt + sizeof(hdr), FRAME_CAST_PAYLOAD);
+        hdr.count = (uint16_t)(pos - hdr.start);
+        hdr.len = (uint16_t)len;
+        hdr.part = (uint8_t)parts++;
+        if (pos >= n) hdr.flags |= FRAME_CAST_FLAG_FINAL;
+        memcpy(pkt, &hdr, sizeof(hdr));
+        if (emit) emit(pkt, sizeof(hdr) + len, ctx);
+    } while (pos < n && parts < 256);
+    return parts;
+}
+
+bool frame_cast_parse(const uint8_t *buf, size_t len, frame_cast_header_t *hdr) {
+    if (!buf || len < sizeof(*hdr)) return false;
+    memcpy(hdr, buf, sizeof(*hdr));
+    return hdr->magic == FRAME_CAST_MAGIC && hdr->version == FRAME_CAST_VERSION &&
+           (hdr->bpp == 3 || hdr->bpp == 4) && len == sizeof(*hdr) + hdr->len &&
+           (uint32_t)hdr->start + hdr->count <= hdr->n_pixels;
+}
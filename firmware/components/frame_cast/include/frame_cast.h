@@ -0,0 +1,67 @@
+#pragma once
+
+#include "effects.h"
+#include "esp_err.h"
+#include "frame_cast_codec.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Rendered-frame broadcast. A sending node multicasts every output frame of
+// its strips, delta- and RLE-coded against the channel's previous frame
+// (frame_cast_codec.h), with a keyframe at least every FRAME_CAST_KEY_FRAMES
+// frames. Receiving nodes show the frames through their stream output
+// stage instead of rendering, so the fleet shows identical pixels. Frames
+// are the sender's final output codes (calibrated and power-limited there);
+// receivers only apply their own power limit.
+//
+// A receiver applies a delta only on top of the frame it codes against: a
+// lost part leaves the channel on its last frame until the next keyframe.
+// A channel with no frame for FRAME_CAST_HOLD_MS goes back to rendering
+// locally.
+
+#define FRAME_CAST_GROUP       "239.10.7.42"  // the sync group
+#define FRAME_CAST_PORT        45455          // sync port + 1
+#define FRAME_CAST_CHANNELS    8
+#define FRAME_CAST_MAX_PIXELS  1024
+#define FRAME_CAST_KEY_FRAMES  30
+#define FRAME_CAST_HOLD_MS     1000
+
+typedef enum {
+    FRAME_CAST_OFF = 0,
+    FRAME_CAST_SEND,
+    FRAME_CAST_RECEIVE
+} frame_cast_mode_t;
+
+typedef struct {
+    uint32_t frames;         // sent, or completed on a receiver
+    uint32_t keyframes;
+    uint32_t packets;
+    uint32_t raw_bytes;      // pixel bytes before coding
+    uint32_t wire_bytes;     // op bytes after coding
+    uint32_t dropped;        // receiver: frames lost or skipped until a keyframe
+    uint32_t malformed;
+    uint32_t restarts;       // receiver: the sender's frame count started over
+} frame_cast_stats_t;
+
+esp_err_t         frame_cast_set_mode(frame_cast_mode_t mode);
+frame_cast_mode_t frame_cast_get_mode(void);
+const char       *frame_cast_mode_name(frame_cast_mode_t mode);
+bool              frame_cast_mode_parse(const char *name, frame_cast_mode_t *out);
+
+// Sender: one call per output frame of a strip; nothing unless sending.
+void      frame_cast_send(int ch, const px_rgba_t *px, uint16_t n, bool rgbw);
+
+// Receiver. Datagrams arrive on the net_io task; tests feed them directly.
+// The consumer is woken when a channel completes a frame.
+void      frame_cast_handle(const uint8_t *buf, size_t len, uint32_t now_ms);
+void      frame_cast_set_consumer(TaskHandle_t task);
+// True while ch has completed a frame within FRAME_CAST_HOLD_MS.
+bool      frame_cast_active(int ch, uint32_t now_ms);
+// Copies ch's newest frame into dst (zero-padded or cut to n) if it has
+// not been taken yet.
+bool      frame_cast_take(int ch, px_rgba_t *dst, uint16_t n);
+
+void      frame_cast_get_stats(frame_cast_stats_t *out);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "effects.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format of rendered-frame broadcast, little-endian and packed. A frame
+// of one channel goes out as one or more parts; each part covers a pixel
+// range and holds an op stream coded against the channel's previous frame
+// (a keyframe codes against nothing, so it never skips).
+//
+// Op stream: a 1- or 2-byte op header, then its pixels (bpp bytes each,
+// R G B [W]).
+//   bits 7-6  kind: 0 skip (unchanged since the previous frame),
+//             1 run (one pixel, repeated), 2 literal (count pixels follow)
+//   bit 5     long: count-1 continues in the next byte (13 bits)
+//   bits 4-0  count-1, high bits when long
+
+#define FRAME_CAST_MAGIC       0x464C   // "LF"
+#define FRAME_CAST_VERSION     1
+#define FRAME_CAST_PAYLOAD     1400     // op bytes per part, fits one Wi-Fi MTU
+#define FRAME_CAST_OP_MAX      8192     // pixels per op
+
+#define FRAME_CAST_FLAG_KEY    0x01
+#define FRAME_CAST_FLAG_FINAL  0x02     // last part of the frame
+
+typedef enum {
+    FRAME_CAST_OP_SKIP = 0,
+    FRAME_CAST_OP_RUN = 1,
+    FRAME_CAST_OP_LITERAL = 2
+} frame_cast_op_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint32_t frame;          // per channel, +1 per frame
+    uint8_t  ch;
+    uint8_t  bpp;            // 3 RGB, 4 RGBW
+    uint8_t  part;           // 0, 1, ... within the frame
+    uint8_t  epoch;          // sender session: new whenever its frame count restarts
+    uint16_t n_pixels;       // channel length
+    uint16_t start;          // first pixel this part covers
+    uint16_t count;          // pixels covered
+    uint16_t len;            // op bytes after the header
+} frame_cast_header_t;
+
+#define FRAME_CAST_PACKET_MAX  (sizeof(frame_cast_header_t) + FRAME_CAST_PAYLOAD)
+
+// Codes cur from *pos on, against prev (NULL: keyframe), into at most cap
+// bytes. Stops at n or when the next op does not fit; *pos moves past the
+// pixels coded. Returns bytes written.
+size_t frame_cast_encode(const px_rgba_t *cur, const px_rgba_t *prev, uint16_t n, uint8_t bpp,
+                         uint16_t *pos, uint8_t *out, size_t cap);
+
+// Applies one part's ops to dst (the part's first pixel). Skipped pixels are
+// left as they are. False if the ops overrun len or do not cover count.
+bool   frame_cast_decode(const uint8_t *ops, size_t len, px_rgba_t *dst, uint16_t count, uint8_t bpp);
+
+// Splits a frame into parts and hands each finished packet (header + ops)
+// to emit; pkt is scratch of FRAME_CAST_PACKET_MAX bytes. Returns the
+// number of parts.
+typedef void (*frame_cast_emit_fn)(const uint8_t *pkt, size_t len, void *ctx);
+int    frame_cast_packetize(uint8_t ch, uint8_t epoch, uint32_t frame, const px_rgba_t *cur,
+                            const px_rgba_t *prev, uint16_t n, uint8_t bpp, uint8_t *pkt,
+                            frame_cast_emit_fn emit, void *ctx);
+
+// Validates magic, version and lengths.
+bool   frame_cast_parse(const uint8_t *buf, size_t len, frame_cast_header_t *hdr);
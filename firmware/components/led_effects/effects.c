@@ -2,6 +2,7 @@
 #include "fx_util.h"
 #include "fx_palette.h"
 #include "fx_segments.h"
+#include "fx_audio.h"
 #include <math.h>
 #include <string.h>
 
@@ -9,8 +10,12 @@
 static inline uint8_t clamp8(int v){ return (v<0)?0:((v>255)?255:v); }
 static inline float fracf(float x){ return x - floorf(x); }
 static inline uint8_t lerp8(uint8_t a, uint8_t b, float t){ return (uint8_t)(a + (b-a)*t); }
+static inline uint16_t to16(float v8){ float v = v8*257.f + .5f; return v<=0.f?0:(v>=65535.f?65535:(uint16_t)v); }
+static inline px_rgba16_t scale16(px_rgba_t c, float a){ return (px_rgba16_t){ to16(c.r*a), to16(c.g*a), to16(c.b*a), to16(c.w*a) }; }
+static inline uint32_t sum16(px_rgba16_t c){ return ((uint32_t)c.r + c.g + c.b + c.w) >> 8; }
 
 extern volatile float g_beat_phase;
+fx_audio_t g_fx_audio; // written by the engine before each pass
 
 // --- Basic Effects (Original) ---
 static bool fx_solid_init(aled_channel_t *ch, const effect_params_t *p){ (void)ch;(void)p; return true; }
@@ -25,13 +30,21 @@ static uint32_t fx_solid_render(aled_channel_t *ch, const effect_params_t *p, ui
   return ma;
 }
 
+static uint32_t fx_solid_render16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  segment_t s = seg_from_params(ch, p);
+  px_rgba16_t c = scale16(p->color1, 1.f);
+  for (int i=0;i<s.len;i++) ch->framebuf16[s.start+i] = c;
+  return sum16(c) * s.len;
+}
+
 static bool fx_gradient_init(aled_channel_t *ch, const effect_params_t *p){ (void)ch;(void)p; return true; }
 static uint32_t fx_gradient_render(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
   (void)t_ms;(void)t_end_ms;
   segment_t s = seg_from_params(ch, p);
   uint32_t ma = 0;
   for (int i=0;i<s.len;i++){
-    float t = s.len > 1 ? (float)i/(float)(s.len-1) : 0.0f;
+    float t = s.span > 1 ? (float)(s.pos+i)/(float)(s.span-1) : 0.0f;
     px_rgba_t c = {
       .r = lerp8(p->color1.r, p->color2.r, t),
       .g = lerp8(p->color1.g, p->color2.g, t),
@@ -44,15 +57,33 @@ static uint32_t fx_gradient_render(aled_channel_t *ch, const effect_params_t *p,
   return ma;
 }
 
+static uint32_t fx_gradient_render16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  segment_t s = seg_from_params(ch, p);
+  uint32_t ma = 0;
+  for (int i=0;i<s.len;i++){
+    float t = s.span > 1 ? (float)(s.pos+i)/(float)(s.span-1) : 0.0f;
+    px_rgba16_t c = {
+      .r = to16(p->color1.r + (p->color2.r - p->color1.r)*t),
+      .g = to16(p->color1.g + (p->color2.g - p->color1.g)*t),
+      .b = to16(p->color1.b + (p->color2.b - p->color1.b)*t),
+      .w = to16(p->color1.w + (p->color2.w - p->color1.w)*t)
+    };
+    ch->framebuf16[s.start+i] = c;
+    ma += sum16(c);
+  }
+  return ma;
+}
+
 static bool fx_chase_init(aled_channel_t *ch, const effect_params_t *p){ (void)ch;(void)p; return true; }
 static uint32_t fx_chase_render(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
   (void)t_end_ms;
   segment_t s = seg_from_params(ch, p);
   float speed = (p->speed<=0?60:p->speed);
-  float head = fmodf((t_ms/1000.0f)*speed, (float)s.len);
+  float head = fmodf((t_ms/1000.0f)*speed, (float)s.span);
   uint32_t ma = 0;
   for (int i=0;i<s.len;i++){
-    float d = fabsf(i - head);
+    float d = fabsf((float)(s.pos+i) - head);
     float a = fmaxf(0.0f, 1.0f - d/10.0f);
     ch->framebuf[s.start+i].r = (uint8_t)(p->color1.r * a);
     ch->framebuf[s.start+i].g = (uint8_t)(p->color1.g * a);
@@ -63,14 +94,30 @@ static uint32_t fx_chase_render(aled_channel_t *ch, const effect_params_t *p, ui
   return ma;
 }
 
+static uint32_t fx_chase_render16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_end_ms;
+  segment_t s = seg_from_params(ch, p);
+  float speed = (p->speed<=0?60:p->speed);
+  float head = fmodf((t_ms/1000.0f)*speed, (float)s.span);
+  uint32_t ma = 0;
+  for (int i=0;i<s.len;i++){
+    float d = fabsf((float)(s.pos+i) - head);
+    float a = fmaxf(0.0f, 1.0f - d/10.0f);
+    px_rgba16_t c = scale16(p->color1, a);
+    ch->framebuf16[s.start+i] = c;
+    ma += sum16(c);
+  }
+  return ma;
+}
+
 static bool fx_twinkle_init(aled_channel_t *ch, const effect_params_t *p){ (void)p; (void)ch; return true; }
 static uint32_t fx_twinkle_render(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
   (void)t_end_ms;
   segment_t s = seg_from_params(ch, p);
-  uint32_t t = t_ms + p->seed*977u;
+  uint32_t t = t_ms + seg_seed(ch, p)*977u;
   uint32_t ma = 0;
   for (int i=0;i<s.len;i++){
-    uint32_t x = (t*1664525u + (i*1013904223u));
+    uint32_t x = (t*1664525u + ((s.pos+i)*1013904223u));
     float v = ((x>>8)&0xFFFF)/65535.0f;
     float a = v*v * p->intensity;
     ch->framebuf[s.start+i].r = (uint8_t)(p->color1.r * a);
@@ -82,6 +129,21 @@ static uint32_t fx_twinkle_render(aled_channel_t *ch, const effect_params_t *p,
   return ma;
 }
 
+static uint32_t fx_twinkle_render16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_end_ms;
+  segment_t s = seg_from_params(ch, p);
+  uint32_t t = t_ms + seg_seed(ch, p)*977u;
+  uint32_t ma = 0;
+  for (int i=0;i<s.len;i++){
+    uint32_t x = (t*1664525u + ((s.pos+i)*1013904223u));
+    float v = ((x>>8)&0xFFFF)/65535.0f;
+    px_rgba16_t c = scale16(p->color1, v*v * p->intensity);
+    ch->framebuf16[s.start+i] = c;
+    ma += sum16(c);
+  }
+  return ma;
+}
+
 // --- Advanced Effects (New) ---
 
 // Rainbow with palette support
@@ -93,12 +155,9 @@ static uint32_t fx_rainbow(aled_channel_t *ch, const effect_params_t *p, uint32_
   float t = (t_ms/1000.0f) * spd;
   uint32_t ma=0;
   for(int i=0;i<s.len;i++){
-    float u = fmodf((i/(float)s.len) + t, 1.0f);
+    float u = fmodf(((s.pos+i)/(float)s.span) + t, 1.0f);
     rgb8_t c = palette_sample(pal, u);
     px_rgba_t px = {c.r, c.g, c.b, 0};
-    px.r = util_gamma_u8(dither_ordered(px.r, i, ch->ch, t_ms));
-    px.g = util_gamma_u8(dither_ordered(px.g, i, ch->ch, t_ms));
-    px.b = util_gamma_u8(dither_ordered(px.b, i, ch->ch, t_ms));
     ch->framebuf[s.start+i] = px;
     ma += px.r + px.g + px.b;
   }
@@ -113,11 +172,11 @@ static uint32_t fx_noise(aled_channel_t *ch, const effect_params_t *p, uint32_t
   (void)t_end_ms;
   segment_t s = seg_from_params(ch,p);
   float spd = p->speed>0?p->speed:1.2f;
-  float t = (t_ms/1000.0f)*spd + p->seed*0.1f;
+  float t = (t_ms/1000.0f)*spd + seg_seed(ch, p)*0.1f;
   float inten = (p->intensity>0.f)?p->intensity:1.f;
   uint32_t ma=0;
   for(int i=0;i<s.len;i++){
-    float n = noise1(i*0.08f + t);
+    float n = noise1((s.pos+i)*0.08f + t);
     float v = powf(n, 1.5f) * inten;
     px_rgba_t px = { (uint8_t)(p->color1.r*v), (uint8_t)(p->color1.g*v), (uint8_t)(p->color1.b*v), 0};
     ch->framebuf[s.start+i] = px;
@@ -126,6 +185,23 @@ static uint32_t fx_noise(aled_channel_t *ch, const effect_params_t *p, uint32_t
   return ma;
 }
 
+static uint32_t fx_noise16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_end_ms;
+  segment_t s = seg_from_params(ch,p);
+  float spd = p->speed>0?p->speed:1.2f;
+  float t = (t_ms/1000.0f)*spd + seg_seed(ch, p)*0.1f;
+  float inten = (p->intensity>0.f)?p->intensity:1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float n = noise1((s.pos+i)*0.08f + t);
+    px_rgba16_t px = scale16(p->color1, powf(n, 1.5f) * inten);
+    px.w = 0;
+    ch->framebuf16[s.start+i] = px;
+    ma += sum16(px);
+  }
+  return ma;
+}
+
 // Fire effect
 static uint32_t fx_fire(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
   (void)t_end_ms;
@@ -133,10 +209,10 @@ static uint32_t fx_fire(aled_channel_t *ch, const effect_params_t *p, uint32_t t
   float inten = (p->intensity>0.f)?p->intensity:1.f;
   uint32_t ma=0;
   for(int i=0;i<s.len;i++){
-    float y = (float)i/s.len;
-    float flick = noise1((i*0.15f) + (t_ms*0.006f) + p->seed)*0.7f + 0.3f;
+    float y = (float)(s.pos+i)/s.span;
+    float flick = noise1(((s.pos+i)*0.15f) + (t_ms*0.006f) + seg_seed(ch, p))*0.7f + 0.3f;
     float heat = powf(1.0f - y, 2.0f) * flick * inten;
-    px_rgba_t px = hsv_to_rgbw(0.08f + 0.05f*(1.0f-heat), 1.0f, heat, (ch->type==LED_SK6812_RGBW));
+    px_rgba_t px = hsv_to_rgbw(0.08f + 0.05f*(1.0f-heat), 1.0f, heat, 0); // W extracted at output
     ch->framebuf[s.start+i] = px;
     ma += px.r+px.g+px.b+px.w;
   }
@@ -151,7 +227,7 @@ static uint32_t fx_waves(aled_channel_t *ch, const effect_params_t *p, uint32_t
   float inten = (p->intensity>0.f)?p->intensity:1.f;
   uint32_t ma=0;
   for(int i=0;i<s.len;i++){
-    float x = (float)i/s.len;
+    float x = (float)(s.pos+i)/s.span;
     float w = 0.5f + 0.5f*sinf( (x*6.283f*(1.5f+inten*2.f)) + (t*2.0f) + g_beat_phase*3.1415f );
     px_rgba_t a=p->color1, b=p->color2;
     px_rgba_t px = { (uint8_t)(a.r + (b.r-a.r)*w),
@@ -163,15 +239,131 @@ static uint32_t fx_waves(aled_channel_t *ch, const effect_params_t *p, uint32_t
   return ma;
 }
 
+static uint32_t fx_waves16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_end_ms;
+  segment_t s = seg_from_params(ch,p);
+  float t = t_ms/1000.0f;
+  float inten = (p->intensity>0.f)?p->intensity:1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float x = (float)(s.pos+i)/s.span;
+    float w = 0.5f + 0.5f*sinf( (x*6.283f*(1.5f+inten*2.f)) + (t*2.0f) + g_beat_phase*3.1415f );
+    px_rgba_t a=p->color1, b=p->color2;
+    px_rgba16_t px = { to16(a.r + (b.r-a.r)*w), to16(a.g + (b.g-a.g)*w), to16(a.b + (b.b-a.b)*w), 0 };
+    ch->framebuf16[s.start+i] = px;
+    ma += sum16(px);
+  }
+  return ma;
+}
+
+// --- Audio-reactive Effects (g_fx_audio) ---
+
+// Band energy at u (0..1 along the segment), interpolated between bands.
+static float audio_band_at(float u){
+  int n = g_fx_audio.live ? g_fx_audio.n_bands : 0;
+  if (n <= 0) return 0.f;
+  float x = u * (float)(n - 1);
+  int b = (int)x;
+  if (b >= n - 1) return g_fx_audio.bands[n - 1];
+  return g_fx_audio.bands[b] + (g_fx_audio.bands[b+1] - g_fx_audio.bands[b])*(x - b);
+}
+
+// Spectrum: lowest band at the segment start, palette colour by position,
+// brightness by band energy (intensity is the gain).
+static uint32_t fx_spectrum(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  const palette_t* pal = palette_by_id(p->palette_id);
+  segment_t s = seg_from_params(ch,p);
+  float gain = (p->intensity>0.f)?p->intensity:1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float u = s.span > 1 ? (float)(s.pos+i)/(float)(s.span-1) : 0.0f;
+    float v = fminf(audio_band_at(u) * gain, 1.f);
+    rgb8_t c = palette_sample(pal, u);
+    px_rgba_t px = { (uint8_t)(c.r*v), (uint8_t)(c.g*v), (uint8_t)(c.b*v), 0 };
+    ch->framebuf[s.start+i] = px;
+    ma += px.r + px.g + px.b;
+  }
+  return ma;
+}
+
+static uint32_t fx_spectrum16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  const palette_t* pal = palette_by_id(p->palette_id);
+  segment_t s = seg_from_params(ch,p);
+  float gain = (p->intensity>0.f)?p->intensity:1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float u = s.span > 1 ? (float)(s.pos+i)/(float)(s.span-1) : 0.0f;
+    float v = fminf(audio_band_at(u) * gain, 1.f);
+    rgb8_t c = palette_sample(pal, u);
+    px_rgba16_t px = { to16(c.r*v), to16(c.g*v), to16(c.b*v), 0 };
+    ch->framebuf16[s.start+i] = px;
+    ma += sum16(px);
+  }
+  return ma;
+}
+
+// VU meter: the level fills the segment from its start, color1 at the
+// bottom to color2 at the top, with the peak held as a color3 dot.
+static px_rgba_t vu_color(const effect_params_t *p, segment_t s, float x, float lit, float peak_px, float *a){
+  if (peak_px >= 0.f && fabsf(x - peak_px) < 0.5f){
+    *a = 1.f;
+    return p->color3;
+  }
+  *a = fminf(fmaxf(lit - x, 0.f), 1.f);
+  float t = s.span > 1 ? x / (float)(s.span-1) : 0.0f;
+  return (px_rgba_t){ lerp8(p->color1.r, p->color2.r, t), lerp8(p->color1.g, p->color2.g, t),
+                      lerp8(p->color1.b, p->color2.b, t), lerp8(p->color1.w, p->color2.w, t) };
+}
+
+static uint32_t fx_vu(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  segment_t s = seg_from_params(ch,p);
+  float gain = (p->intensity>0.f)?p->intensity:1.f;
+  float lit = g_fx_audio.live ? fminf(g_fx_audio.level * gain, 1.f) * s.span : 0.f;
+  float peak_px = g_fx_audio.live && g_fx_audio.peak > 0.f ?
+                  floorf(fminf(g_fx_audio.peak * gain, 1.f) * (s.span - 1)) : -1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float a;
+    px_rgba_t c = vu_color(p, s, (float)(s.pos+i), lit, peak_px, &a);
+    px_rgba_t px = { (uint8_t)(c.r*a), (uint8_t)(c.g*a), (uint8_t)(c.b*a), (uint8_t)(c.w*a) };
+    ch->framebuf[s.start+i] = px;
+    ma += px.r + px.g + px.b + px.w;
+  }
+  return ma;
+}
+
+static uint32_t fx_vu16(aled_channel_t *ch, const effect_params_t *p, uint32_t t_ms, uint32_t t_end_ms){
+  (void)t_ms;(void)t_end_ms;
+  segment_t s = seg_from_params(ch,p);
+  float gain = (p->intensity>0.f)?p->intensity:1.f;
+  float lit = g_fx_audio.live ? fminf(g_fx_audio.level * gain, 1.f) * s.span : 0.f;
+  float peak_px = g_fx_audio.live && g_fx_audio.peak > 0.f ?
+                  floorf(fminf(g_fx_audio.peak * gain, 1.f) * (s.span - 1)) : -1.f;
+  uint32_t ma=0;
+  for(int i=0;i<s.len;i++){
+    float a;
+    px_rgba_t c = vu_color(p, s, (float)(s.pos+i), lit, peak_px, &a);
+    px_rgba16_t px = scale16(c, a);
+    ch->framebuf16[s.start+i] = px;
+    ma += sum16(px);
+  }
+  return ma;
+}
+
 static const effect_vtable_t EFFECTS[] = {
-  {FX_SOLID,    "solid",    fx_solid_init,    fx_solid_render},
-  {FX_GRADIENT, "gradient", fx_gradient_init, fx_gradient_render},
-  {FX_CHASE,    "chase",    fx_chase_init,    fx_chase_render},
-  {FX_TWINKLE,  "twinkle",  fx_twinkle_init,  fx_twinkle_render},
-  {FX_RAINBOW,  "rainbow",  NULL,             fx_rainbow},
-  {FX_NOISE,    "noise",    NULL,             fx_noise},
-  {FX_FIRE,     "fire",     NULL,             fx_fire},
-  {FX_WAVES,    "waves",    NULL,             fx_waves},
+  {FX_SOLID,    "solid",    fx_solid_init,    fx_solid_render,    fx_solid_render16},
+  {FX_GRADIENT, "gradient", fx_gradient_init, fx_gradient_render, fx_gradient_render16},
+  {FX_CHASE,    "chase",    fx_chase_init,    fx_chase_render,    fx_chase_render16},
+  {FX_TWINKLE,  "twinkle",  fx_twinkle_init,  fx_twinkle_render,  fx_twinkle_render16},
+  {FX_RAINBOW,  "rainbow",  NULL,             fx_rainbow,         NULL},
+  {FX_NOISE,    "noise",    NULL,             fx_noise,           fx_noise16},
+  {FX_FIRE,     "fire",     NULL,             fx_fire,            NULL},
+  {FX_WAVES,    "waves",    NULL,             fx_waves,           fx_waves16},
+  {FX_SPECTRUM, "spectrum", NULL,             fx_spectrum,        fx_spectrum16},
+  {FX_VU,       "vu",       NULL,             fx_vu,              fx_vu16},
 };
 
 const effect_vtable_t* fx_lookup(uint32_t id){
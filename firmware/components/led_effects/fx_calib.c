@@ -0,0 +1,101 @@
+#include "fx_calib.h"
+#include <math.h>
+
+static inline float pick(float v, float dflt){ return v > 0.f ? v : dflt; }
+static inline float clamp01(float v){ return v < 0.f ? 0.f : (v > 1.f ? 1.f : v); }
+static inline uint16_t to_u16(float v){ v = v*65535.f + .5f; return v >= 65535.f ? 65535 : (uint16_t)v; }
+static inline uint8_t u16_to_u8(uint32_t v){ return (uint8_t)((v + 128u - (v >> 8)) >> 8); }
+
+// 16-bit input against a 256-entry table: Q8 position, linear interpolation.
+static inline uint16_t lut16(const uint16_t *lut, uint16_t v){
+  uint32_t pos = ((uint32_t)v * 65281u) >> 16;   // 0..65279
+  uint32_t i = pos >> 8, f = pos & 0xFFu;
+  return (uint16_t)(lut[i] + (((int32_t)lut[i+1] - (int32_t)lut[i]) * (int32_t)f) / 256);
+}
+
+static inline uint16_t min3_16(uint16_t a, uint16_t b, uint16_t c){ uint16_t m = a < b ? a : b; return m < c ? m : c; }
+static inline uint8_t  min3_8(uint8_t a, uint8_t b, uint8_t c){ uint8_t m = a < b ? a : b; return m < c ? m : c; }
+
+void fx_calib_default(fx_calib_cfg_t *cfg, float gamma){
+  for (int k = 0; k < 4; ++k){
+    cfg->gamma[k] = gamma;
+    cfg->white_point[k] = 1.f;
+  }
+  cfg->white_mix = 1.f;
+  cfg->white_gain = 1.f;
+}
+
+void fx_calib_build(fx_calib_t *c, const fx_calib_cfg_t *cfg, bool rgbw){
+  for (int k = 0; k < 4; ++k){
+    float g = pick(cfg->gamma[k], 2.2f);
+    float wp = clamp01(pick(cfg->white_point[k], 1.f));
+    for (int i = 0; i < 256; ++i){
+      c->lut[k][i] = to_u16(powf(i / 255.f, g) * wp);
+    }
+  }
+  float mix = clamp01(cfg->white_mix);
+  float gain = pick(cfg->white_gain, 1.f);
+  for (int i = 0; i < 256; ++i){
+    float sub = (i / 255.f) * mix;
+    c->wsub[i] = to_u16(sub);
+    c->wadd[i] = to_u16(fminf(1.f, sub / gain));
+  }
+  c->rgbw = rgbw;
+}
+
+// Both passes fold in the power limiter: corrected values are scaled by
+// scale_q16 (65536 = unity) on the way out. sums[] receives the corrected,
+// *unscaled* r,g,b,w totals in 8-bit units, i.e. what the frame would draw
+// without limiting, so the current model gets it without another pass.
+void fx_calib_apply8(const fx_calib_t *c, px_rgba_t *fb, int n, uint32_t scale_q16, uint32_t sums[4]){
+  uint32_t sr = 0, sg = 0, sb = 0, sw = 0;
+  for (int i = 0; i < n; ++i){
+    px_rgba_t p = fb[i];
+    if (c->rgbw){
+      uint8_t m = min3_8(p.r, p.g, p.b);
+      uint8_t sub = u16_to_u8(c->wsub[m]);
+      if (sub > m) sub = m;
+      uint32_t w = p.w + u16_to_u8(c->wadd[m]);
+      p.r -= sub; p.g -= sub; p.b -= sub;
+      p.w = w > 255 ? 255 : (uint8_t)w;
+    } else {
+      p.w = 0;
+    }
+    uint32_t r = c->lut[0][p.r], g = c->lut[1][p.g], b = c->lut[2][p.b], w = c->lut[3][p.w];
+    sr += r; sg += g; sb += b; sw += w;
+    fb[i].r = u16_to_u8((r * scale_q16) >> 16);
+    fb[i].g = u16_to_u8((g * scale_q16) >> 16);
+    fb[i].b = u16_to_u8((b * scale_q16) >> 16);
+    fb[i].w = u16_to_u8((w * scale_q16) >> 16);
+  }
+  if (sums){
+    sums[0] = sr / 257u; sums[1] = sg / 257u; sums[2] = sb / 257u; sums[3] = sw / 257u;
+  }
+}
+
+void fx_calib_apply16(const fx_calib_t *c, px_rgba16_t *fb, int n, uint32_t scale_q16, uint32_t sums[4]){
+  uint32_t sr = 0, sg = 0, sb = 0, sw = 0;
+  for (int i = 0; i < n; ++i){
+    px_rgba16_t p = fb[i];
+    if (c->rgbw){
+      uint16_t m = min3_16(p.r, p.g, p.b);
+      uint16_t sub = lut16(c->wsub, m);
+      if (sub > m) sub = m;
+      uint32_t w = p.w + lut16(c->wadd, m);
+      p.r -= sub; p.g -= sub; p.b -= sub;
+      p.w = w > 65535 ? 65535 : (uint16_t)w;
+    } else {
+      p.w = 0;
+    }
+    uint32_t r = lut16(c->lut[0], p.r), g = lut16(c->lut[1], p.g);
+    uint32_t b = lut16(c->lut[2], p.b), w = lut16(c->lut[3], p.w);
+    sr += r; sg += g; sb += b; sw += w;
+    fb[i].r = (uint16_t)((r * scale_q16) >> 16);
+    fb[i].g = (uint16_t)((g * scale_q16) >> 16);
+    fb[i].b = (uint16_t)((b * scale_q16) >> 16);
+    fb[i].w = (uint16_t)((w * scale_q16) >> 16);
+  }
+  if (sums){
+    sums[0] = sr / 257u; sums[1] = sg / 257u; sums[2] = sb / 257u; sums[3] = sw / 257u;
+  }
+}
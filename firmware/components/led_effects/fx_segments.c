@@ -15,16 +15,27 @@ segment_t seg_from_params(const aled_channel_t* ch, const effect_params_t* p){
   if (s.start >= ch->n_pixels){
     s.start = 0;
     s.len = ch->n_pixels;
-    return s;
-  }
-
-  if (s.start + s.len > ch->n_pixels){
+  } else if (s.start + s.len > ch->n_pixels){
     s.len = ch->n_pixels - s.start;
   }
 
+  if (ch->canvas.size){
+    s.pos = ch->canvas.offset + s.start;
+    s.span = ch->canvas.size;
+  } else {
+    s.pos = 0;
+    s.span = s.len;
+  }
   return s;
 }
 
+uint32_t seg_seed(const aled_channel_t* ch, const effect_params_t* p){
+  if (ch && ch->canvas.size){
+    return ch->canvas.seed;
+  }
+  return p ? p->seed : 0u;
+}
+
 bool seg_is_full(const aled_channel_t* ch, segment_t s){
   if (!ch){
     return false;
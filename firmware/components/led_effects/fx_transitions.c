@@ -3,9 +3,35 @@
 
 void xfade_begin(xfade_t* x, uint32_t now, uint32_t ms){ x->t0=now; x->t1=now+ms; x->active=ms>0; }
 float xfade_mix(const xfade_t* x, uint32_t now){
-  if(!x->active || now>=x->t1) return 1.f;
-  if(now<=x->t0) return 0.f;
+  if(!x->active || (int32_t)(now-x->t1)>=0) return 1.f;   // wrap-safe, like the frame deadlines
+  if((int32_t)(now-x->t0)<=0) return 0.f;
   float u=(now-x->t0)/(float)(x->t1-x->t0); // 0..1
   // smootherstep
   return u*u*(3-2*u);
-}
\ No newline at end of file
+}
+
+void xfade_shift(xfade_t* x, int32_t ms){ if(x->active){ x->t0+=(uint32_t)ms; x->t1+=(uint32_t)ms; } }
+
+// cur = cur*(1-mix) + next*mix, fixed point so the per-pixel loop stays integer.
+void xfade_apply(px_rgba_t* cur, const px_rgba_t* next, int n, float mix){
+  uint32_t m = (uint32_t)(mix*256.f + .5f); if(m>256) m=256;
+  uint32_t inv = 256-m;
+  for(int i=0;i<n;i++){
+    cur[i].r=(uint8_t)((cur[i].r*inv + next[i].r*m)>>8);
+    cur[i].g=(uint8_t)((cur[i].g*inv + next[i].g*m)>>8);
+    cur[i].b=(uint8_t)((cur[i].b*inv + next[i].b*m)>>8);
+    cur[i].w=(uint8_t)((cur[i].w*inv + next[i].w*m)>>8);
+  }
+}
+
+void xfade_apply16(px_rgba16_t* cur, const px_rgba16_t* next, int n, float mix){
+  // weights sum to 65536, so 65535*65536 is the largest intermediate and fits 32 bits
+  uint32_t m = (uint32_t)(mix*65536.f + .5f); if(m>65536) m=65536;
+  uint32_t inv = 65536-m;
+  for(int i=0;i<n;i++){
+    cur[i].r=(uint16_t)((cur[i].r*inv + next[i].r*m)>>16);
+    cur[i].g=(uint16_t)((cur[i].g*inv + next[i].g*m)>>16);
+    cur[i].b=(uint16_t)((cur[i].b*inv + next[i].b*m)>>16);
+    cur[i].w=(uint16_t)((cur[i].w*inv + next[i].w*m)>>16);
+  }
+}
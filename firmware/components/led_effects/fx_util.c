@@ -10,6 +10,29 @@ uint8_t dither_ordered(uint8_t v, uint16_t x, uint16_t y, uint32_t t){
   uint8_t b=B4[y&3][x&3], j=(t>>4)&3; int out=v+((b+j)>8); return out<0?0:(out>255?255:out);
 }
 
+void px_promote16(const px_rgba_t *src, px_rgba16_t *dst, int n){
+  for(int i=0;i<n;i++){ dst[i]=(px_rgba16_t){src[i].r*257u, src[i].g*257u, src[i].b*257u, src[i].w*257u}; }
+}
+
+// First-order sigma-delta per component: the low byte that does not fit in the
+// 8-bit output is carried to the same pixel's next frame, so the time-average
+// of the emitted codes converges on the 16-bit value.
+static inline uint8_t sd8(uint16_t v, uint8_t *res){
+  if (v >= 0xFF00u){ *res = 0; return 255; }
+  uint32_t acc = (uint32_t)v + *res;
+  *res = (uint8_t)acc;
+  return (uint8_t)(acc >> 8);
+}
+
+void dither_temporal16(const px_rgba16_t *src, px_rgba_t *dst, px_rgba_t *residual, int n){
+  for(int i=0;i<n;i++){
+    dst[i].r = sd8(src[i].r, &residual[i].r);
+    dst[i].g = sd8(src[i].g, &residual[i].g);
+    dst[i].b = sd8(src[i].b, &residual[i].b);
+    dst[i].w = sd8(src[i].w, &residual[i].w);
+  }
+}
+
 px_rgba_t hsv_to_rgbw(float h,float s,float v,int rgbw){
   h=fmodf(h,1.f); if(h<0) h+=1.f;
   float r,g,b; float i=floorf(h*6), f=h*6-i;
@@ -17,7 +40,7 @@ px_rgba_t hsv_to_rgbw(float h,float s,float v,int rgbw){
   switch((int)i%6){case 0:r=v;g=t;b=p;break;case 1:r=q;g=v;b=p;break;case 2:r=p;g=v;b=t;break;
   case 3:r=p;g=q;b=v;break;case 4:r=t;g=p;b=v;break;default:r=v;g=p;b=q;break;}
   px_rgba_t c={(uint8_t)(r*255),(uint8_t)(g*255),(uint8_t)(b*255),0};
-  if(rgbw){ uint8_t w=(uint8_t)fminf(fminf(c.r,c.g),c.b); c.r-=w; c.g-=w; c.b-=w; c.w=w; }
+  if(rgbw){ uint8_t w=c.r<c.g?c.r:c.g; if(c.b<w) w=c.b; c.r-=w; c.g-=w; c.b-=w; c.w=w; }
   return c;
 }
 
@@ -29,8 +52,9 @@ px_rgba_t rgb_to_rgbw(px_rgba_t in, float wmix){
   if (wmix > 1.f){
     wmix = 1.f;
   }
-  uint8_t base_w = (uint8_t)fminf(fminf(in.r, in.g), in.b);
-  uint8_t w = (uint8_t)(base_w * wmix);
+  uint8_t base_w = in.r < in.g ? in.r : in.g;
+  if (in.b < base_w) base_w = in.b;
+  uint8_t w = (uint8_t)((base_w * (uint32_t)(wmix * 256.f)) >> 8);
   in.r -= w;
   in.g -= w;
   in.b -= w;
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 
 typedef struct { uint8_t r,g,b,w; } px_rgba_t;
+typedef struct { uint16_t r,g,b,w; } px_rgba16_t; // 0..65535 linear, HDR pipeline
 
 typedef enum {
   LED_WS2812B = 0,
@@ -24,6 +25,15 @@ typedef enum {
   BLEND_LIGHTEN
 } blend_mode_t;
 
+// Slice of a canvas shared by several nodes: effects render in canvas
+// coordinates (offset + pixel index over size) with the canvas seed, so
+// slices rendered on different nodes at the same sync time line up.
+typedef struct {
+  uint32_t offset;        // canvas position of pixel 0
+  uint32_t size;          // canvas length in pixels; 0 = channel renders alone
+  uint32_t seed;          // replaces the effect seed on the canvas
+} fx_canvas_t;
+
 typedef struct {
   int ch;                 // 0..7
   led_type_t type;
@@ -32,6 +42,8 @@ typedef struct {
   float gamma;
   uint8_t max_brightness; // 0..255
   px_rgba_t *framebuf;
+  px_rgba16_t *framebuf16; // render16 target (NULL on 8-bit channels)
+  fx_canvas_t canvas;
 } aled_channel_t;
 
 typedef struct {
@@ -56,6 +68,7 @@ typedef struct {
   const char *name;
   fx_init_fn init;
   fx_render_fn render;
+  fx_render_fn render16;  // optional: writes ch->framebuf16, returns sum in 8-bit units
 } effect_vtable_t;
 
 // Effect IDs
@@ -67,7 +80,9 @@ enum {
   FX_RAINBOW = 1001,
   FX_NOISE = 1002,
   FX_FIRE = 1003,
-  FX_WAVES = 1004
+  FX_WAVES = 1004,
+  FX_SPECTRUM = 1005,   // audio feed band energies
+  FX_VU = 1006          // audio feed level meter
 };
 
 const effect_vtable_t* fx_lookup(uint32_t id);
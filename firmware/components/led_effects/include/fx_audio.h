@@ -0,0 +1,24 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Audio features for audio-reactive effects, as the node last heard them
+// from an analysis host (audio_feed). The engine refreshes g_fx_audio once
+// per pass before rendering, so every effect in a frame sees the same
+// values; levels fall to 0 when the feed stops.
+
+#define FX_AUDIO_BANDS   16
+#define FX_AUDIO_ONSETS  4      // low (kick), mid (snare), high (hats), broadband
+
+typedef struct {
+  bool    live;                   // a feed is running
+  uint8_t n_bands;
+  float   bands[FX_AUDIO_BANDS];  // 0..1, lowest band first
+  float   level;                  // 0..1 RMS
+  float   peak;                   // 0..1
+  float   onset[FX_AUDIO_ONSETS]; // 1 on an onset, decaying to 0
+  float   beat_phase;             // 0..1, from the beat PLL
+  float   tempo_bpm;              // 0 = no beat
+} fx_audio_t;
+
+extern fx_audio_t g_fx_audio;
@@ -15,3 +15,20 @@ static inline px_rgba_t blend_apply(blend_mode_t m, px_rgba_t base, px_rgba_t ov
     default:             o=over; break;
   } return o;
 }
+
+static inline uint16_t clamp16i(int32_t v){ return v<0?0:(v>65535?65535:v); }
+
+static inline px_rgba16_t blend_apply16(blend_mode_t m, px_rgba16_t base, px_rgba16_t over){
+  px_rgba16_t o=base;
+  switch(m){
+    case BLEND_ADD:      o.r=clamp16i(base.r+over.r); o.g=clamp16i(base.g+over.g); o.b=clamp16i(base.b+over.b); o.w=clamp16i(base.w+over.w); break;
+    case BLEND_SCREEN:   o.r=65535-(uint16_t)(((65535u-base.r)*(65535u-over.r))/65535u);
+                         o.g=65535-(uint16_t)(((65535u-base.g)*(65535u-over.g))/65535u);
+                         o.b=65535-(uint16_t)(((65535u-base.b)*(65535u-over.b))/65535u);
+                         o.w=clamp16i(base.w+over.w); break;
+    case BLEND_MULTIPLY: o.r=(uint16_t)(((uint32_t)base.r*over.r)/65535u); o.g=(uint16_t)(((uint32_t)base.g*over.g)/65535u);
+                         o.b=(uint16_t)(((uint32_t)base.b*over.b)/65535u); o.w=clamp16i(base.w+over.w); break;
+    case BLEND_LIGHTEN:  o.r=base.r>over.r?base.r:over.r; o.g=base.g>over.g?base.g:over.g; o.b=base.b>over.b?base.b:over.b; o.w=clamp16i(base.w+over.w); break;
+    default:             o=over; break;
+  } return o;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "effects.h"
+#include <stdbool.h>
+
+// Per-channel output calibration. Built once from config; the output stage
+// applies it so effects only ever produce linear, uncorrected color.
+typedef struct {
+  float gamma[4];        // r,g,b,w transfer exponent (<=0 -> 2.2)
+  float white_point[4];  // r,g,b,w scale 0..1 (<=0 -> 1.0)
+  float white_mix;       // RGBW: share of common RGB moved to W, 0..1
+  float white_gain;      // RGBW: W LED output relative to full RGB white (<=0 -> 1.0)
+} fx_calib_cfg_t;
+
+typedef struct {
+  uint16_t lut[4][256];  // linear 8-bit -> corrected 16-bit (gamma * white point)
+  uint16_t wsub[256];    // min(r,g,b) -> amount removed from each of r,g,b (16-bit)
+  uint16_t wadd[256];    // min(r,g,b) -> amount added to w (16-bit, linear)
+  bool     rgbw;
+} fx_calib_t;
+
+void fx_calib_default(fx_calib_cfg_t *cfg, float gamma);
+void fx_calib_build(fx_calib_t *c, const fx_calib_cfg_t *cfg, bool rgbw);
+// In place; scale_q16 is the power limiter factor (65536 = unity). sums[]
+// (may be NULL) gets the corrected r,g,b,w totals before scaling, in 8-bit
+// units.
+void fx_calib_apply8(const fx_calib_t *c, px_rgba_t *fb, int n, uint32_t scale_q16, uint32_t sums[4]);
+void fx_calib_apply16(const fx_calib_t *c, px_rgba16_t *fb, int n, uint32_t scale_q16, uint32_t sums[4]);
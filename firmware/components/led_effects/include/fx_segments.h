@@ -3,10 +3,15 @@
 #include "effects.h"
 #include <stdbool.h>
 
+// Effects render pixel start + i at coordinate pos + i out of span: the
+// segment itself when the channel renders alone, the canvas otherwise.
 typedef struct {
   uint16_t start;
   uint16_t len;
+  uint32_t pos;
+  uint32_t span;
 } segment_t;
 
 segment_t seg_from_params(const aled_channel_t* ch, const effect_params_t* p);
 bool      seg_is_full(const aled_channel_t* ch, segment_t s);
+uint32_t  seg_seed(const aled_channel_t* ch, const effect_params_t* p);
@@ -2,4 +2,8 @@
 #include "effects.h"
 typedef struct { uint32_t t0,t1; uint8_t active; } xfade_t;
 void xfade_begin(xfade_t* x, uint32_t now, uint32_t ms);
-float xfade_mix(const xfade_t* x, uint32_t now);
\ No newline at end of file
+float xfade_mix(const xfade_t* x, uint32_t now);
+// Moves a running crossfade with its clock, so a clock step neither freezes nor skips it.
+void xfade_shift(xfade_t* x, int32_t ms);
+void xfade_apply(px_rgba_t* cur, const px_rgba_t* next, int n, float mix);
+void xfade_apply16(px_rgba16_t* cur, const px_rgba16_t* next, int n, float mix);
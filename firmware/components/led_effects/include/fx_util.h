@@ -5,3 +5,7 @@ uint8_t  util_gamma_u8(uint8_t v);
 px_rgba_t hsv_to_rgbw(float h, float s, float v, int rgbw);
 px_rgba_t rgb_to_rgbw(px_rgba_t in, float wmix);
 uint8_t  dither_ordered(uint8_t v8, uint16_t x, uint16_t y, uint32_t t_ms);
+
+// 16-bit pipeline helpers
+void     px_promote16(const px_rgba_t *src, px_rgba16_t *dst, int n);
+void     dither_temporal16(const px_rgba16_t *src, px_rgba_t *dst, px_rgba_t *residual, int n);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp_err.h"
+#include "lwip/sockets.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One task for all UDP protocols (sync, pixel ingest and output, DMX, OSC).
+// Each protocol registers a socket with a receive callback and/or a poll
+// callback (neither: a send-only socket that net_io just owns); the task
+// waits in select() on every socket at once, reads into one preallocated
+// buffer and dispatches by socket. Poll callbacks run every round and
+// return when they next need to run, which bounds the select timeout, so
+// periodic senders need no task of their own.
+//
+// Callbacks run in the I/O task: they must not block, and the buffer is
+// only valid during the call. net_io_wake() ends the current wait early
+// (e.g. when a sender has something new). net_io_stop() returns once the
+// task has exited and every socket is closed.
+
+#define NET_IO_MAX_PROTOS   12
+#define NET_IO_RX_BUF       1500
+#define NET_IO_IDLE_MS      1000     // longest wait with nothing scheduled
+#define NET_IO_NEVER        INT64_MAX
+
+typedef void    (*net_io_rx_fn)(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                                int64_t rx_us, void *ctx);
+typedef int64_t (*net_io_poll_fn)(int64_t now_us, void *ctx);   // next run, or NET_IO_NEVER
+
+typedef struct {
+    const char     *name;
+    uint16_t        port;     // 0 = ephemeral (send-only protocols)
+    net_io_rx_fn    rx;
+    net_io_poll_fn  poll;
+    void           *ctx;
+} net_io_proto_t;
+
+typedef struct {
+    const char *name;
+    uint16_t    port;
+    uint32_t    rx_packets;
+    uint32_t    rx_bytes;
+    uint32_t    rx_errors;
+} net_io_stats_t;
+
+// Opens and binds the socket now; returns a handle >= 0 or -1.
+int       net_io_register(const net_io_proto_t *proto);
+// The socket is closed by the I/O task before its next wait (at once if
+// the task is not running); no callback runs for it after that.
+void      net_io_unregister(int handle);
+int       net_io_socket(int handle);
+uint16_t  net_io_port(int handle);
+esp_err_t net_io_join(int handle, uint32_t group_addr, bool join);   // network order
+
+void      net_io_wake(void);
+
+// One select round: dispatches ready sockets (a few datagrams each) and
+// due polls, waiting at most timeout_ms. The task loops on this; it may be
+// called directly when the task is not started. Returns datagrams handled.
+int       net_io_service(uint32_t timeout_ms);
+
+int       net_io_get_stats(net_io_stats_t *out, int max);
+
+esp_err_t net_io_start(void);
+void      net_io_stop(void);
@@ -0,0 +1,314 @@
+#include "net_io.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/inet.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const char *TAG = "NET_IO";
+
+#define RX_BURST        8        // datagrams per socket per round
+#define STOP_WAIT_MS    1000
+
+typedef struct {
+    net_io_proto_t proto;
+    int            sock;
+    uint16_t       port;
+    bool           used;
+    bool           closing;
+    net_io_stats_t st;
+} net_io_slot_t;
+
+// s_lock guards the slot table. The I/O task snapshots it once per round
+// and is the only one to close sockets while it runs, so a descriptor is
+// never closed under a select() that is waiting on it.
+static SemaphoreHandle_t s_lock = NULL;
+static net_io_slot_t     s_slots[NET_IO_MAX_PROTOS];
+static uint8_t           s_buf[NET_IO_RX_BUF];
+
+// Loopback socket that sends to itself: one byte ends the wait.
+static int                s_wake = -1;
+static struct sockaddr_in s_wake_addr;
+
+static volatile bool     s_running = false;
+static TaskHandle_t      s_task = NULL;
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+static int open_udp(uint32_t addr, uint16_t port) {
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (s < 0) return -1;
+    // A protocol restarted on the same port binds before the task has
+    // closed its old socket.
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sa = {0};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = addr;
+    if (bind(s, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+static uint16_t bound_port(int s) {
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    if (getsockname(s, (struct sockaddr *)&sa, &len) < 0) return 0;
+    return ntohs(sa.sin_port);
+}
+
+static bool ensure_wake(void) {
+    if (s_wake >= 0) return true;
+    int s = open_udp(htonl(INADDR_LOOPBACK), 0);
+    if (s < 0) return false;
+    memset(&s_wake_addr, 0, sizeof(s_wake_addr));
+    s_wake_addr.sin_family = AF_INET;
+    s_wake_addr.sin_port = htons(bound_port(s));
+    s_wake_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    s_wake = s;
+    return true;
+}
+
+static bool valid(int h) {
+    return h >= 0 && h < NET_IO_MAX_PROTOS && s_slots[h].used && !s_slots[h].closing;
+}
+
+int net_io_register(const net_io_proto_t *proto) {
+    if (!proto) return -1;
+    ensure_lock();
+    int s = open_udp(htonl(INADDR_ANY), proto->port);
+    if (s < 0) {
+        ESP_LOGE(TAG, "%s: bind to port %u failed", proto->name ? proto->name : "?", proto->port);
+        return -1;
+    }
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) {
+        close(s);
+        return -1;
+    }
+    int h = -1;
+    for (int i = 0; i < NET_IO_MAX_PROTOS; i++) {
+        if (!s_slots[i].used) {
+            h = i;
+            break;
+        }
+    }
+    if (h >= 0) {
+        net_io_slot_t *slot = &s_slots[h];
+        memset(slot, 0, sizeof(*slot));
+        slot->proto = *proto;
+        slot->sock = s;
+        slot->port = bound_port(s);
+        slot->used = true;
+        slot->st.name = proto->name;
+        slot->st.port = slot->port;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (h < 0) {
+        ESP_LOGE(TAG, "No free slot for %s", proto->name ? proto->name : "?");
+        close(s);
+        return -1;
+    }
+    ESP_LOGI(TAG, "%s on port %u", proto->name ? proto->name : "?", s_slots[h].port);
+    // The running wait does not include the new socket yet.
+    net_io_wake();
+    return h;
+}
+
+void net_io_unregister(int h) {
+    if (h < 0 || h >= NET_IO_MAX_PROTOS || !s_lock) return;
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return;
+    net_io_slot_t *slot = &s_slots[h];
+    if (slot->used && !slot->closing) {
+        slot->closing = true;
+        if (!s_task) {
+            close(slot->sock);
+            memset(slot, 0, sizeof(*slot));
+        }
+    }
+    xSemaphoreGive(s_lock);
+    net_io_wake();
+}
+
+int net_io_socket(int h) {
+    return valid(h) ? s_slots[h].sock : -1;
+}
+
+uint16_t net_io_port(int h) {
+    return valid(h) ? s_slots[h].port : 0;
+}
+
+esp_err_t net_io_join(int h, uint32_t group_addr, bool join) {
+    int s = net_io_socket(h);
+    if (s < 0) return ESP_ERR_INVALID_ARG;
+    struct ip_mreq mreq = {0};
+    mreq.imr_multiaddr.s_addr = group_addr;
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(s, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                   &mreq, sizeof(mreq)) < 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void net_io_wake(void) {
+    if (s_wake < 0) return;
+    uint8_t b = 0;
+    sendto(s_wake, &b, 1, 0, (const struct sockaddr *)&s_wake_addr, sizeof(s_wake_addr));
+}
+
+int net_io_service(uint32_t timeout_ms) {
+    ensure_lock();
+    ensure_wake();
+
+    // Snapshot the table, closing what was unregistered since last round.
+    net_io_proto_t protos[NET_IO_MAX_PROTOS];
+    int socks[NET_IO_MAX_PROTOS];
+    int n = 0;
+    int idx[NET_IO_MAX_PROTOS];
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return 0;
+    for (int i = 0; i < NET_IO_MAX_PROTOS; i++) {
+        net_io_slot_t *slot = &s_slots[i];
+        if (slot->closing) {
+            close(slot->sock);
+            memset(slot, 0, sizeof(*slot));
+        }
+        if (!slot->used) continue;
+        protos[n] = slot->proto;
+        socks[n] = slot->sock;
+        idx[n++] = i;
+    }
+    xSemaphoreGive(s_lock);
+
+    // Polls run every round; the earliest deadline bounds the wait.
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_us = (int64_t)timeout_ms * 1000;
+    for (int i = 0; i < n; i++) {
+        if (!protos[i].poll) continue;
+        int64_t next = protos[i].poll(now_us, protos[i].ctx);
+        if (next != NET_IO_NEVER && next - now_us < wait_us) wait_us = next - now_us;
+    }
+    if (wait_us < 0) wait_us = 0;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    int max_fd = -1;
+    if (s_wake >= 0) {
+        FD_SET(s_wake, &fds);
+        max_fd = s_wake;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!protos[i].rx) continue;
+        FD_SET(socks[i], &fds);
+        if (socks[i] > max_fd) max_fd = socks[i];
+    }
+    struct timeval tv = { .tv_sec = (long)(wait_us / 1000000), .tv_usec = (long)(wait_us % 1000000) };
+    if (max_fd < 0) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+        return 0;
+    }
+    if (select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0) return 0;
+
+    if (s_wake >= 0 && FD_ISSET(s_wake, &fds)) {
+        while (recv(s_wake, s_buf, sizeof(s_buf), MSG_DONTWAIT) > 0) {
+        }
+    }
+
+    int handled = 0;
+    for (int i = 0; i < n; i++) {
+        if (!protos[i].rx || !FD_ISSET(socks[i], &fds)) continue;
+        // A burst (one frame over several universes) drains in one round.
+        uint32_t packets = 0, bytes = 0, errors = 0;
+        for (int k = 0; k < RX_BURST; k++) {
+            struct sockaddr_in src;
+            socklen_t src_len = sizeof(src);
+            int len = recvfrom(socks[i], s_buf, sizeof(s_buf), MSG_DONTWAIT,
+                               (struct sockaddr *)&src, &src_len);
+            if (len < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) errors++;
+                break;
+            }
+            protos[i].rx(s_buf, (size_t)len, &src, esp_timer_get_time(), protos[i].ctx);
+            packets++;
+            bytes += (uint32_t)len;
+        }
+        handled += (int)packets;
+        if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+            net_io_stats_t *st = &s_slots[idx[i]].st;
+            st->rx_packets += packets;
+            st->rx_bytes += bytes;
+            st->rx_errors += errors;
+            xSemaphoreGive(s_lock);
+        }
+    }
+    return handled;
+}
+
+int net_io_get_stats(net_io_stats_t *out, int max) {
+    if (!out || max <= 0) return 0;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return 0;
+    int n = 0;
+    for (int i = 0; i < NET_IO_MAX_PROTOS && n < max; i++) {
+        if (s_slots[i].used && !s_slots[i].closing) out[n++] = s_slots[i].st;
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+static void net_io_task(void *arg) {
+    ESP_LOGI(TAG, "I/O task started");
+    while (s_running) {
+        net_io_service(NET_IO_IDLE_MS);
+    }
+
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        for (int i = 0; i < NET_IO_MAX_PROTOS; i++) {
+            if (s_slots[i].used) close(s_slots[i].sock);
+        }
+        memset(s_slots, 0, sizeof(s_slots));
+        xSemaphoreGive(s_lock);
+    }
+    ESP_LOGI(TAG, "I/O task stopped");
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t net_io_start(void) {
+    if (s_running) return ESP_OK;
+    ensure_lock();
+    if (!ensure_wake()) {
+        ESP_LOGE(TAG, "Wake socket failed");
+        return ESP_FAIL;
+    }
+    s_running = true;
+    if (xTaskCreate(net_io_task, "net_io", 4096, NULL, 5, &s_task) != pdPASS) {
+        s_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Every socket is closed once this returns; protocols register again
+// after a restart.
+void net_io_stop(void) {
+    if (!s_running) return;
+    s_running = false;
+    net_io_wake();
+    for (int i = 0; s_task && i < STOP_WAIT_MS / 10; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_task) ESP_LOGW(TAG, "I/O task did not stop");
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "esp_err.h"
+#include "osc_msg.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// OSC control over UDP, for live desks: tempo taps, faders and colour
+// pads, without HTTP and JSON on the way. Each datagram is parsed in place
+// in the net_io receive buffer (osc_msg.h), routed by address and handed
+// to the ops, which must not block: the engine takes its changes through a
+// queue, never its state lock on this path. Addresses, N counting from 1,
+// "*" in place of N for every channel:
+//
+//   /ch/N/effect      i     effect id
+//   /ch/N/intensity   f     0..1
+//   /beat             [f]   downbeat now; with a tempo (bpm), set it first
+//   /strobe           [i]   flash for ms, OSC_STROBE_MS without
+//   /pwm/N            f     0..1
+//   /group/NAME/rgb   fff[f] 0..1, white optional
+//   /timecode         s[f]  "hh:mm:ss:ff" (';' before ff: drop-frame), fps
+//                     iiii[f] the same as h m s f
+//
+// Ints and floats are taken for each other. Bundles are unpacked and their
+// time tags ignored: everything applies on arrival.
+
+#define OSC_PORT        8000
+#define OSC_STROBE_MS   50
+#define OSC_NAME_MAX    24       // group names, as pwm_group_t
+
+typedef struct {
+    // ch < 0: every channel. False if the change was refused (no such
+    // channel or effect, engine queue full).
+    bool (*effect)(int ch, uint32_t effect_id);
+    bool (*intensity)(int ch, float level);
+    bool (*pwm)(int ch, float level);
+    bool (*group_rgb)(const char *group, const float rgbw[4], bool has_w);
+    void (*beat)(float bpm);     // 0 = keep the tempo
+    void (*strobe)(uint32_t ms);
+    // Show timecode label h m s f; fps 0 when the sender didn't say.
+    bool (*timecode)(const uint8_t hmsf[4], float fps, bool drop);
+} osc_ops_t;
+
+typedef struct {
+    uint32_t packets;
+    uint32_t malformed;      // packets
+    uint32_t messages;       // applied
+    uint32_t unknown;        // no route for the address
+    uint32_t bad_args;
+    uint32_t refused;        // by the ops
+} osc_stats_t;
+
+void      osc_set_ops(const osc_ops_t *ops);
+
+// Listens on port (0 = ephemeral); one listener, a new start replaces it.
+esp_err_t osc_start(uint16_t port);
+void      osc_stop(void);
+uint16_t  osc_port(void);    // 0 = off
+
+// One datagram, as the net_io task delivers it; tests feed it directly.
+void      osc_handle(const uint8_t *buf, size_t len);
+
+void      osc_get_stats(osc_stats_t *out);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// OSC 1.0 packets, parsed in place. A message is a NUL-padded address, a
+// type tag string (",ifs...") and big-endian arguments, each padded to 4
+// bytes; a bundle is "#bundle", a time tag and size-prefixed elements
+// (messages or bundles). Nothing is copied or allocated: addresses, tags
+// and string arguments point into the packet, which must outlive the
+// messages handed out.
+
+#define OSC_MAX_DEPTH   4     // nested bundles
+
+typedef struct {
+    const char    *addr;
+    const char    *types;     // tags after the ','; "" without any
+    const uint8_t *args;
+    size_t         args_len;
+} osc_msg_t;
+
+typedef void (*osc_msg_fn)(const osc_msg_t *msg, void *ctx);
+
+// Calls fn for every message in the packet, in order. The whole packet is
+// checked first: a malformed one delivers nothing and returns false.
+bool osc_parse(const uint8_t *buf, size_t len, osc_msg_fn fn, void *ctx);
+
+int  osc_arg_count(const osc_msg_t *msg);
+// Numeric arguments convert: i and f either way, T as 1 and F as 0.
+bool osc_arg_float(const osc_msg_t *msg, int idx, float *out);
+bool osc_arg_int(const osc_msg_t *msg, int idx, int32_t *out);
+bool osc_arg_string(const osc_msg_t *msg, int idx, const char **out);
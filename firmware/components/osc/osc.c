@@ -0,0 +1,239 @@
+#include "osc.h"
+
+#include "esp_log.h"
+#include "net_io.h"
+
+#include <string.h>
+
+static const char *TAG = "OSC";
+
+typedef struct {
+    int  ch;                     // "#": from 0, -1 for "*"
+    char name[OSC_NAME_MAX];     // "$"
+} route_args_t;
+
+typedef enum {
+    ROUTE_OK = 0,
+    ROUTE_BAD_ARGS,
+    ROUTE_REFUSED
+} route_result_t;
+
+typedef route_result_t (*route_fn)(const osc_msg_t *msg, const route_args_t *a);
+
+typedef struct {
+    const char *pattern;         // literal segments, "#" a channel, "$" a name
+    route_fn    fn;
+} route_t;
+
+// No lock anywhere on the receive path: ops are set before the listener
+// starts, and the stats are written by the receiving task only, so a
+// reader may see a packet half counted.
+static osc_ops_t   s_ops;
+static osc_stats_t s_stats;
+static int         s_net = -1;
+
+void osc_set_ops(const osc_ops_t *ops) {
+    if (ops) {
+        s_ops = *ops;
+    } else {
+        memset(&s_ops, 0, sizeof(s_ops));
+    }
+}
+
+static float unit(float v) {
+    return v > 0.f ? (v < 1.f ? v : 1.f) : 0.f;     // NaN -> 0
+}
+
+static route_result_t applied(bool ok) {
+    return ok ? ROUTE_OK : ROUTE_REFUSED;
+}
+
+static route_result_t route_effect(const osc_msg_t *msg, const route_args_t *a) {
+    int32_t id;
+    if (!osc_arg_int(msg, 0, &id) || id <= 0) return ROUTE_BAD_ARGS;
+    return applied(s_ops.effect && s_ops.effect(a->ch, (uint32_t)id));
+}
+
+static route_result_t route_intensity(const osc_msg_t *msg, const route_args_t *a) {
+    float v;
+    if (!osc_arg_float(msg, 0, &v)) return ROUTE_BAD_ARGS;
+    return applied(s_ops.intensity && s_ops.intensity(a->ch, unit(v)));
+}
+
+static route_result_t route_pwm(const osc_msg_t *msg, const route_args_t *a) {
+    float v;
+    if (!osc_arg_float(msg, 0, &v)) return ROUTE_BAD_ARGS;
+    return applied(s_ops.pwm && s_ops.pwm(a->ch, unit(v)));
+}
+
+static route_result_t route_group_rgb(const osc_msg_t *msg, const route_args_t *a) {
+    int n = osc_arg_count(msg);
+    float rgbw[4] = {0};
+    if (n != 3 && n != 4) return ROUTE_BAD_ARGS;
+    for (int i = 0; i < n; i++) {
+        if (!osc_arg_float(msg, i, &rgbw[i])) return ROUTE_BAD_ARGS;
+        rgbw[i] = unit(rgbw[i]);
+    }
+    return applied(s_ops.group_rgb && s_ops.group_rgb(a->name, rgbw, n == 4));
+}
+
+static route_result_t route_beat(const osc_msg_t *msg, const route_args_t *a) {
+    float bpm = 0.f;
+    if (osc_arg_count(msg) && (!osc_arg_float(msg, 0, &bpm) || !(bpm >= 0.f))) return ROUTE_BAD_ARGS;
+    if (!s_ops.beat) return ROUTE_REFUSED;
+    s_ops.beat(bpm);
+    return ROUTE_OK;
+}
+
+static route_result_t route_strobe(const osc_msg_t *msg, const route_args_t *a) {
+    int32_t ms = OSC_STROBE_MS;
+    if (osc_arg_count(msg) && (!osc_arg_int(msg, 0, &ms) || ms < 0)) return ROUTE_BAD_ARGS;
+    if (!s_ops.strobe) return ROUTE_REFUSED;
+    s_ops.strobe((uint32_t)ms);
+    return ROUTE_OK;
+}
+
+// "hh:mm:ss:ff" (';' or '.' before the frames: drop-frame).
+static bool parse_label(const char *s, uint8_t hmsf[4], bool *drop) {
+    for (int i = 0; i < 4; i++, s++) {
+        if (s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') return false;
+        hmsf[i] = (uint8_t)((s[0] - '0') * 10 + (s[1] - '0'));
+        s += 2;
+        if (i == 3) return *s == '\0';
+        if (i == 2 && (*s == ';' || *s == '.')) {
+            *drop = true;
+        } else if (*s != ':') {
+            return false;
+        }
+    }
+    return false;
+}
+
+static route_result_t route_timecode(const osc_msg_t *msg, const route_args_t *a) {
+    uint8_t hmsf[4];
+    bool drop = false;
+    float fps = 0.f;
+    const char *label;
+    int n = osc_arg_count(msg), rate_at = 4;
+    if (osc_arg_string(msg, 0, &label)) {
+        if (!parse_label(label, hmsf, &drop)) return ROUTE_BAD_ARGS;
+        rate_at = 1;
+    } else {
+        for (int i = 0; i < 4; i++) {
+            int32_t v;
+            if (!osc_arg_int(msg, i, &v) || v < 0 || v > 99) return ROUTE_BAD_ARGS;
+            hmsf[i] = (uint8_t)v;
+        }
+    }
+    if (n > rate_at + 1) return ROUTE_BAD_ARGS;
+    if (n == rate_at + 1 && (!osc_arg_float(msg, rate_at, &fps) || !(fps >= 0.f))) return ROUTE_BAD_ARGS;
+    return applied(s_ops.timecode && s_ops.timecode(hmsf, fps, drop));
+}
+
+static const route_t ROUTES[] = {
+    { "/ch/#/effect",    route_effect },
+    { "/ch/#/intensity", route_intensity },
+    { "/beat",           route_beat },
+    { "/strobe",         route_strobe },
+    { "/pwm/#",          route_pwm },
+    { "/group/$/rgb",    route_group_rgb },
+    { "/timecode",       route_timecode },
+};
+
+// Steps *p over its next "/segment"; false at the end.
+static bool next_seg(const char **p, const char **seg, size_t *len) {
+    if (**p != '/') return false;
+    *seg = ++*p;
+    while (**p && **p != '/') ++*p;
+    *len = (size_t)(*p - *seg);
+    return true;
+}
+
+// "*" or a channel number 1..255.
+static bool parse_ch(const char *s, size_t len, int *ch) {
+    if (len == 1 && s[0] == '*') {
+        *ch = -1;
+        return true;
+    }
+    if (!len || len > 3) return false;
+    int v = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    if (v < 1 || v > 255) return false;
+    *ch = v - 1;
+    return true;
+}
+
+static bool match(const char *pat, const char *addr, route_args_t *a) {
+    const char *ps, *as;
+    size_t pl, al;
+    while (next_seg(&pat, &ps, &pl)) {
+        if (!next_seg(&addr, &as, &al)) return false;
+        if (pl == 1 && ps[0] == '#') {
+            if (!parse_ch(as, al, &a->ch)) return false;
+        } else if (pl == 1 && ps[0] == '$') {
+            if (!al || al >= sizeof(a->name)) return false;
+            memcpy(a->name, as, al);
+            a->name[al] = '\0';
+        } else if (pl != al || memcmp(ps, as, pl) != 0) {
+            return false;
+        }
+    }
+    return *addr == '\0';
+}
+
+static void dispatch(const osc_msg_t *msg, void *ctx) {
+    (void)ctx;
+    route_args_t a;
+    for (size_t i = 0; i < sizeof(ROUTES) / sizeof(ROUTES[0]); i++) {
+        if (!match(ROUTES[i].pattern, msg->addr, &a)) continue;
+        switch (ROUTES[i].fn(msg, &a)) {
+        case ROUTE_OK:       s_stats.messages++; break;
+        case ROUTE_BAD_ARGS: s_stats.bad_args++; break;
+        case ROUTE_REFUSED:  s_stats.refused++; break;
+        }
+        return;
+    }
+    s_stats.unknown++;
+}
+
+void osc_handle(const uint8_t *buf, size_t len) {
+    s_stats.packets++;
+    if (!osc_parse(buf, len, dispatch, NULL)) {
+        s_stats.malformed++;
+    }
+}
+
+static void osc_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                   int64_t rx_us, void *ctx) {
+    osc_handle(buf, len);
+}
+
+esp_err_t osc_start(uint16_t port) {
+    osc_stop();
+    net_io_proto_t rx = { .name = "osc", .port = port, .rx = osc_rx };
+    s_net = net_io_register(&rx);
+    if (s_net < 0) {
+        ESP_LOGE(TAG, "No socket for port %u", port);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Listening on port %u", net_io_port(s_net));
+    return ESP_OK;
+}
+
+void osc_stop(void) {
+    net_io_unregister(s_net);
+    s_net = -1;
+}
+
+uint16_t osc_port(void) {
+    return s_net >= 0 ? net_io_port(s_net) : 0;
+}
+
+void osc_get_stats(osc_stats_t *out) {
+    if (out) {
+        *out = s_stats;
+    }
+}
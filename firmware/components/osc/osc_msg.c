@@ -0,0 +1,178 @@
+#include "osc_msg.h"
+
+#include <math.h>
+#include <string.h>
+
+#define ARG_BAD ((size_t)-1)
+
+static uint32_t rd_be32(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint64_t rd_be64(const uint8_t *b) {
+    return ((uint64_t)rd_be32(b) << 32) | rd_be32(b + 4);
+}
+
+// Bytes taken by the NUL-terminated, 4-byte padded string at p; 0 if it
+// does not end inside len.
+static size_t padded_str(const uint8_t *p, size_t len) {
+    const uint8_t *nul = memchr(p, 0, len);
+    if (!nul) return 0;
+    size_t n = ((size_t)(nul - p) + 4) & ~(size_t)3;
+    return n <= len ? n : 0;
+}
+
+static size_t arg_size(char tag, const uint8_t *p, size_t len) {
+    switch (tag) {
+    case 'i': case 'f': case 'c': case 'r': case 'm':
+        return len >= 4 ? 4 : ARG_BAD;
+    case 'h': case 't': case 'd':
+        return len >= 8 ? 8 : ARG_BAD;
+    case 's': case 'S': {
+        size_t n = padded_str(p, len);
+        return n ? n : ARG_BAD;
+    }
+    case 'b': {
+        if (len < 4) return ARG_BAD;
+        uint32_t n = rd_be32(p);
+        if (n > len - 4) return ARG_BAD;
+        size_t total = 4 + (((size_t)n + 3) & ~(size_t)3);
+        return total <= len ? total : ARG_BAD;
+    }
+    case 'T': case 'F': case 'N': case 'I': case '[': case ']':
+        return 0;
+    default:
+        return ARG_BAD;
+    }
+}
+
+static bool read_msg(const uint8_t *p, size_t len, osc_msg_t *m) {
+    if (!len || p[0] != '/') return false;
+    size_t n = padded_str(p, len);
+    if (!n) return false;
+    m->addr = (const char *)p;
+    p += n;
+    len -= n;
+
+    // Senders that predate type tags send none; data without them can't
+    // be read.
+    m->types = "";
+    if (len) {
+        if (p[0] != ',' || !(n = padded_str(p, len))) return false;
+        m->types = (const char *)p + 1;
+        p += n;
+        len -= n;
+    }
+    m->args = p;
+    size_t used = 0;
+    for (const char *t = m->types; *t; t++) {
+        size_t s = arg_size(*t, p + used, len - used);
+        if (s == ARG_BAD) return false;
+        used += s;
+    }
+    m->args_len = used;
+    return true;
+}
+
+// fn NULL: check only.
+static bool walk(const uint8_t *p, size_t len, int depth, osc_msg_fn fn, void *ctx) {
+    if (len % 4) return false;
+    if (len >= 8 && memcmp(p, "#bundle", 8) == 0) {
+        // The time tag is ignored: everything applies on arrival.
+        if (depth >= OSC_MAX_DEPTH || len < 16) return false;
+        p += 16;
+        len -= 16;
+        while (len) {
+            if (len < 4) return false;
+            uint32_t n = rd_be32(p);
+            if (!n || n > len - 4) return false;
+            if (!walk(p + 4, n, depth + 1, fn, ctx)) return false;
+            p += 4 + n;
+            len -= 4 + n;
+        }
+        return true;
+    }
+    osc_msg_t m;
+    if (!read_msg(p, len, &m)) return false;
+    if (fn) fn(&m, ctx);
+    return true;
+}
+
+bool osc_parse(const uint8_t *buf, size_t len, osc_msg_fn fn, void *ctx) {
+    if (!buf || !walk(buf, len, 0, NULL, NULL)) return false;
+    if (fn) walk(buf, len, 0, fn, ctx);
+    return true;
+}
+
+// Array brackets are not arguments: array members count as plain ones.
+static const uint8_t *arg_at(const osc_msg_t *msg, int idx, char *tag) {
+    if (!msg || idx < 0) return NULL;
+    const uint8_t *p = msg->args;
+    size_t left = msg->args_len;
+    for (const char *t = msg->types; *t; t++) {
+        if (*t == '[' || *t == ']') continue;
+        if (idx-- == 0) {
+            *tag = *t;
+            return p;
+        }
+        size_t s = arg_size(*t, p, left);
+        p += s;
+        left -= s;
+    }
+    return NULL;
+}
+
+int osc_arg_count(const osc_msg_t *msg) {
+    int n = 0;
+    for (const char *t = msg ? msg->types : ""; *t; t++) {
+        if (*t != '[' && *t != ']') n++;
+    }
+    return n;
+}
+
+bool osc_arg_float(const osc_msg_t *msg, int idx, float *out) {
+    char tag;
+    const uint8_t *p = arg_at(msg, idx, &tag);
+    if (!p) return false;
+    switch (tag) {
+    case 'f': {
+        uint32_t bits = rd_be32(p);
+        memcpy(out, &bits, sizeof(*out));
+        return true;
+    }
+    case 'd': {
+        uint64_t bits = rd_be64(p);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        *out = (float)d;
+        return true;
+    }
+    case 'i': *out = (float)(int32_t)rd_be32(p); return true;
+    case 'h': *out = (float)(int64_t)rd_be64(p); return true;
+    case 'T': *out = 1.f; return true;
+    case 'F': *out = 0.f; return true;
+    default:  return false;
+    }
+}
+
+bool osc_arg_int(const osc_msg_t *msg, int idx, int32_t *out) {
+    char tag;
+    const uint8_t *p = arg_at(msg, idx, &tag);
+    if (!p) return false;
+    if (tag == 'i') {
+        *out = (int32_t)rd_be32(p);
+        return true;
+    }
+    float f;
+    if (!osc_arg_float(msg, idx, &f) || !(fabsf(f) < 2147483520.f)) return false;
+    *out = (int32_t)lrintf(f);
+    return true;
+}
+
+bool osc_arg_string(const osc_msg_t *msg, int idx, const char **out) {
+    char tag;
+    const uint8_t *p = arg_at(msg, idx, &tag);
+    if (!p || (tag != 's' && tag != 'S')) return false;
+    *out = (const char *)p;
+    return true;
+}
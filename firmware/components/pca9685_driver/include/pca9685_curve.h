@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PCA9685_CURVE_SEGMENTS    256
+#define PCA9685_CURVE_MAX_POINTS  17
+
+typedef enum {
+    PCA9685_CURVE_LINEAR = 0,
+    PCA9685_CURVE_LOG,
+    PCA9685_CURVE_SQUARE,
+    PCA9685_CURVE_CIE1931,
+    PCA9685_CURVE_CUSTOM
+} pca9685_curve_kind_t;
+
+// Per-channel output curve from config. Custom curves are n_points output
+// levels (0..1) spaced evenly over the input range.
+typedef struct {
+    pca9685_curve_kind_t kind;
+    float max_duty;                              // top of the curve, 0..1 (<=0 -> 1.0)
+    uint8_t n_points;
+    float points[PCA9685_CURVE_MAX_POINTS];
+} pca9685_curve_cfg_t;
+
+// 16-bit logical level -> 12-bit counts in Q8, sampled every 256 levels.
+// The fraction below one count is kept for temporal dithering. Built once
+// when config is applied; lookups are integer only.
+typedef struct {
+    uint32_t lut[PCA9685_CURVE_SEGMENTS + 1];
+} pca9685_curve_t;
+
+void pca9685_curve_default(pca9685_curve_cfg_t *cfg);
+void pca9685_curve_build(pca9685_curve_t *c, const pca9685_curve_cfg_t *cfg);
+bool pca9685_curve_parse_kind(const char *name, pca9685_curve_kind_t *out);
+const char *pca9685_curve_kind_name(pca9685_curve_kind_t kind);
+
+// Counts in Q8 (0..4096 << 8).
+static inline uint32_t pca9685_curve_map_q8(const pca9685_curve_t *c, uint16_t level) {
+    // Stretch 0..65535 onto 0..65536 so full scale lands exactly on the last entry.
+    uint32_t x = (uint32_t)level + (level >> 15);
+    uint32_t i = x >> 8;
+    if (i >= PCA9685_CURVE_SEGMENTS) return c->lut[PCA9685_CURVE_SEGMENTS];
+    uint32_t f = x & 0xFF;
+    int32_t a = (int32_t)c->lut[i];
+    int32_t b = (int32_t)c->lut[i + 1];
+    return (uint32_t)(a + (((b - a) * (int32_t)f + 128) >> 8));
+}
+
+static inline uint16_t pca9685_curve_map(const pca9685_curve_t *c, uint16_t level) {
+    return (uint16_t)((pca9685_curve_map_q8(c, level) + 128) >> 8);
+}
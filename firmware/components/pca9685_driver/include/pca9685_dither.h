@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pca9685_driver.h"
+
+// Temporal dithering of a Q8 count target (see pca9685_curve_map_q8) onto
+// whole 12-bit counts: first-order error feedback, so the average over
+// consecutive updates converges on the target and the output only ever
+// toggles between the two neighbouring counts.
+#define PCA9685_DITHER_ERR_MAX  (4 << 8)   // bounds wind-up while a channel is starved
+#define PCA9685_DITHER_UPDATE_BYTES  5     // 4 LEDn bytes + share of burst overhead
+
+typedef struct {
+    int32_t err;    // accumulated target - emitted, Q8
+} pca9685_dither_t;
+
+// Counts to emit next for target_q8.
+static inline uint16_t pca9685_dither_want(const pca9685_dither_t *d, uint32_t target_q8) {
+    uint32_t base = target_q8 >> 8;
+    int32_t v = (int32_t)target_q8 + d->err;
+    uint32_t want = v > 0 ? ((uint32_t)v + 128) >> 8 : 0;
+    if (want < base) want = base;
+    if (want > base + 1) want = base + 1;
+    if (want > PCA9685_FULL_ON) want = PCA9685_FULL_ON;
+    return (uint16_t)want;
+}
+
+// Called once per dither period with what the chip actually outputs, which
+// may not be what was wanted if the update did not fit the bus budget.
+static inline void pca9685_dither_account(pca9685_dither_t *d, uint32_t target_q8, uint16_t emitted) {
+    d->err += (int32_t)target_q8 - ((int32_t)emitted << 8);
+    if (d->err > PCA9685_DITHER_ERR_MAX) d->err = PCA9685_DITHER_ERR_MAX;
+    if (d->err < -PCA9685_DITHER_ERR_MAX) d->err = -PCA9685_DITHER_ERR_MAX;
+}
+
+// The channels one dither period runs over. The pass writes counts[] before
+// handing each update to output, which queues it on the chip.
+typedef struct {
+    int               n;
+    int               rr;          // first channel of the next pass
+    const bool       *live;        // dithering, and not mid-fade
+    const uint32_t   *target_q8;
+    pca9685_dither_t *state;
+    uint16_t         *counts;      // what each channel outputs now
+    void            (*output)(int ch, uint16_t counts, void *ctx);
+    void             *ctx;
+} pca9685_dither_bank_t;
+
+// One dither period: every live channel gets its next count if the byte
+// budget allows, and is charged for what it actually outputs. The starting
+// channel rotates so a tight budget starves nobody. Returns bytes spent.
+uint32_t pca9685_dither_pass(pca9685_dither_bank_t *bank, uint32_t budget);
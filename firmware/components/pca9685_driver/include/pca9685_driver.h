@@ -2,18 +2,73 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "driver/i2c.h"
+#include <stddef.h>
+#include "driver/i2c_types.h"
 #include "esp_err.h"
 
+#define PCA9685_CHANNELS      16     // per chip
+#define PCA9685_MAX_CHIPS     8
+#define PCA9685_FULL_ON       4096   // counts value for the FULL_ON bit
+#define PCA9685_ALLCALL_ADDR  0x70   // power-on ALLCALLADR, answered by every chip
+
+// Chips share one bus and OE line. Channels are numbered chip * 16 + output,
+// in chip_addr order.
 typedef struct {
     i2c_port_t i2c_port;
-    uint8_t i2c_addr;
+    uint8_t i2c_addr;                        // first chip
     uint8_t oe_pin;
+    uint8_t n_chips;                         // 0 or 1: a single chip at i2c_addr
+    uint8_t chip_addr[PCA9685_MAX_CHIPS];    // 0 -> i2c_addr + index
 } pca9685_config_t;
 
+// Completion of an asynchronous write; may run in ISR context.
+typedef void (*pca9685_done_cb_t)(void *arg, esp_err_t result);
+
+// Register transport. write() sends data[0] as the register address followed
+// by data[1..len-1]; write_read() writes reg and reads len bytes back. Both
+// block for a bounded time and are only used for configuration.
+// submit() (optional) queues a write and returns at once: ESP_ERR_NO_MEM if
+// the queue is full, ESP_ERR_TIMEOUT if it is full and stuck. recover()
+// (optional) resets a stuck bus without waiting on it; release() (optional)
+// tears the bus down on pca9685_deinit().
+typedef struct {
+    esp_err_t (*write)(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+    esp_err_t (*write_read)(void *ctx, uint8_t addr, uint8_t reg, uint8_t *out, size_t len);
+    esp_err_t (*submit)(void *ctx, uint8_t addr, const uint8_t *data, size_t len,
+                        pca9685_done_cb_t cb, void *arg);
+    esp_err_t (*recover)(void *ctx);
+    void (*release)(void *ctx);
+    void *ctx;
+} pca9685_bus_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;            // payload incl. register byte, excl. address
+    uint32_t errors;           // failed or rejected writes (channels retried)
+    uint32_t busy;             // flush bursts deferred because the queue was full
+    uint32_t recoveries;       // bus resets
+} pca9685_bus_stats_t;
+
 esp_err_t pca9685_init(const pca9685_config_t *cfg);
+// Same as pca9685_init() over a caller-supplied transport (tests, other buses).
+esp_err_t pca9685_init_bus(const pca9685_config_t *cfg, const pca9685_bus_t *bus);
 esp_err_t pca9685_set_pwm_freq(uint16_t freq_hz);
-esp_err_t pca9685_set_duty(uint8_t channel, float duty);
-esp_err_t pca9685_fade_to(uint8_t channel, float target_duty, uint32_t duration_ms, bool log_curve);
+
+// Duty setters only update the shadow registers; nothing goes on the bus
+// until pca9685_flush(). Unchanged values do not mark a channel dirty.
+// pca9685_flush() queues its bursts (per chip, per dirty range) and returns
+// without waiting for ACKs; failed bursts are marked dirty again and go out
+// with the next flush.
+esp_err_t pca9685_set_duty(uint16_t channel, float duty);
+esp_err_t pca9685_set_counts(uint16_t channel, uint16_t counts);   // 0..4096
+esp_err_t pca9685_flush(void);
+uint16_t  pca9685_channel_count(void);
+
+// Fade interpolation in counts (0..4096) at elapsed_ms of duration_ms. The log
+// curve interpolates in perceived brightness, so a fade looks even instead of
+// rushing through the low end. Callers own the clock (see task_pwm_driver).
+uint16_t  pca9685_fade_counts(uint16_t from, uint16_t to, uint32_t elapsed_ms, uint32_t duration_ms, bool log_curve);
+// Every output on every chip off in one ALLCALL write.
 esp_err_t pca9685_all_off(void);
 esp_err_t pca9685_deinit(void);
+void      pca9685_get_bus_stats(pca9685_bus_stats_t *out);
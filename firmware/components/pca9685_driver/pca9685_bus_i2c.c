@@ -0,0 +1,237 @@
+#include "pca9685_driver.h"
+#include "driver/i2c_master.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+// i2c_master transport for pca9685_init(). Writes are queued on the bus
+// (trans_queue_depth) and complete in order; the completion callback pops
+// the oldest slot, so the write buffer stays valid until the controller is
+// done with it. One device handle per address (each chip plus ALLCALL), all
+// sharing the bus queue and slots.
+//
+// The blocking config accesses go through the same queue. Their result, and
+// a read's data, land in the transport under a ticket, never in the caller's
+// frame: after a timeout the transaction may still complete.
+
+static const char *TAG = "PCA9685_I2C";
+
+#define TX_SLOTS         4
+#define TX_SLOT_BYTES    (1 + 4 * PCA9685_CHANNELS)
+#define XFER_TIMEOUT_MS  20     // per transaction, incl. blocking config access
+#define STUCK_MS         100    // oldest write older than this -> bus is stuck
+#define MAX_DEVS         (PCA9685_MAX_CHIPS + 1)
+
+typedef struct {
+    uint8_t buf[TX_SLOT_BYTES];
+    pca9685_done_cb_t cb;
+    void *arg;
+    uint32_t ticket;            // blocking access, 0 = async write
+    int64_t t_us;
+} tx_slot_t;
+
+typedef struct {
+    uint8_t addr;
+    i2c_master_dev_handle_t handle;
+} i2c_dev_t;
+
+typedef struct {
+    i2c_master_bus_handle_t bus;
+    i2c_dev_t devs[MAX_DEVS];
+    int n_devs;
+    tx_slot_t slots[TX_SLOTS];
+    volatile uint8_t head;      // next free slot (task side)
+    volatile uint8_t tail;      // oldest in flight (ISR side)
+    uint8_t rx[4];              // blocking reads
+    uint32_t ticket;            // newest blocking access
+    volatile uint32_t done_ticket;
+    volatile esp_err_t done_err;
+} i2c_transport_t;
+
+static i2c_transport_t s_tp;
+
+static inline uint8_t in_flight(const i2c_transport_t *tp) {
+    return (uint8_t)(tp->head - tp->tail);
+}
+
+static bool IRAM_ATTR on_trans_done(i2c_master_dev_handle_t dev, const i2c_master_event_data_t *evt, void *arg) {
+    (void)dev;
+    i2c_transport_t *tp = arg;
+    if (in_flight(tp) == 0) {
+        return false;   // dropped by a recovery
+    }
+    tx_slot_t *slot = &tp->slots[tp->tail % TX_SLOTS];
+    tp->tail++;
+    esp_err_t result = evt->event == I2C_EVENT_DONE ? ESP_OK : ESP_FAIL;
+    if (slot->cb) {
+        slot->cb(slot->arg, result);
+    } else if (slot->ticket) {
+        tp->done_err = result;
+        tp->done_ticket = slot->ticket;
+    }
+    return false;
+}
+
+// Looked up (and on first use added) from task context only.
+static i2c_master_dev_handle_t dev_for(i2c_transport_t *tp, uint8_t addr) {
+    for (int i = 0; i < tp->n_devs; i++) {
+        if (tp->devs[i].addr == addr) return tp->devs[i].handle;
+    }
+    if (tp->n_devs >= MAX_DEVS) return NULL;
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = 400000,
+    };
+    i2c_master_dev_handle_t handle = NULL;
+    if (i2c_master_bus_add_device(tp->bus, &dev_cfg, &handle) != ESP_OK) return NULL;
+    i2c_master_event_callbacks_t cbs = { .on_trans_done = on_trans_done };
+    if (i2c_master_register_event_callbacks(handle, &cbs, tp) != ESP_OK) {
+        i2c_master_bus_rm_device(handle);
+        return NULL;
+    }
+    tp->devs[tp->n_devs].addr = addr;
+    tp->devs[tp->n_devs].handle = handle;
+    tp->n_devs++;
+    return handle;
+}
+
+static tx_slot_t *claim_slot(i2c_transport_t *tp, esp_err_t *why) {
+    if (in_flight(tp) >= TX_SLOTS) {
+        const tx_slot_t *oldest = &tp->slots[tp->tail % TX_SLOTS];
+        bool stuck = esp_timer_get_time() - oldest->t_us > STUCK_MS * 1000;
+        *why = stuck ? ESP_ERR_TIMEOUT : ESP_ERR_NO_MEM;
+        return NULL;
+    }
+    tx_slot_t *slot = &tp->slots[tp->head % TX_SLOTS];
+    slot->t_us = esp_timer_get_time();
+    return slot;
+}
+
+static esp_err_t queue_write(i2c_transport_t *tp, uint8_t addr, const uint8_t *data, size_t len,
+                             pca9685_done_cb_t cb, void *arg, uint32_t ticket) {
+    if (len > TX_SLOT_BYTES) return ESP_ERR_INVALID_SIZE;
+    i2c_master_dev_handle_t dev = dev_for(tp, addr);
+    if (!dev) return ESP_ERR_NOT_FOUND;
+
+    esp_err_t err = ESP_OK;
+    tx_slot_t *slot = claim_slot(tp, &err);
+    if (!slot) return err;
+    memcpy(slot->buf, data, len);
+    slot->cb = cb;
+    slot->arg = arg;
+    slot->ticket = ticket;
+    tp->head++;
+    err = i2c_master_transmit(dev, slot->buf, len, XFER_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        tp->head--;   // never queued, so no completion will pop it
+    }
+    return err;
+}
+
+static esp_err_t i2c_bus_submit(void *ctx, uint8_t addr, const uint8_t *data, size_t len,
+                                pca9685_done_cb_t cb, void *arg) {
+    return queue_write(ctx, addr, data, len, cb, arg, 0);
+}
+
+static uint32_t next_ticket(i2c_transport_t *tp) {
+    if (++tp->ticket == 0) tp->ticket = 1;
+    return tp->ticket;
+}
+
+// The blocking access's own result once the queue has drained; a recovery
+// may have dropped it.
+static esp_err_t wait_ticket(i2c_transport_t *tp, uint32_t ticket) {
+    esp_err_t err = i2c_master_bus_wait_all_done(tp->bus, XFER_TIMEOUT_MS);
+    if (err != ESP_OK) return err;
+    return tp->done_ticket == ticket ? tp->done_err : ESP_FAIL;
+}
+
+static esp_err_t i2c_bus_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len) {
+    i2c_transport_t *tp = ctx;
+    uint32_t ticket = next_ticket(tp);
+    esp_err_t err = queue_write(tp, addr, data, len, NULL, NULL, ticket);
+    if (err != ESP_OK) return err;
+    return wait_ticket(tp, ticket);
+}
+
+static esp_err_t i2c_bus_write_read(void *ctx, uint8_t addr, uint8_t reg, uint8_t *out, size_t len) {
+    i2c_transport_t *tp = ctx;
+    if (len > sizeof(tp->rx)) return ESP_ERR_INVALID_SIZE;
+    i2c_master_dev_handle_t dev = dev_for(tp, addr);
+    if (!dev) return ESP_ERR_NOT_FOUND;
+    esp_err_t err = ESP_OK;
+    tx_slot_t *slot = claim_slot(tp, &err);
+    if (!slot) return err;
+    uint32_t ticket = next_ticket(tp);
+    slot->buf[0] = reg;
+    slot->cb = NULL;
+    slot->ticket = ticket;
+    tp->head++;
+    err = i2c_master_transmit_receive(dev, slot->buf, 1, tp->rx, len, XFER_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        tp->head--;
+        return err;
+    }
+    err = wait_ticket(tp, ticket);
+    if (err == ESP_OK) {
+        memcpy(out, tp->rx, len);
+    }
+    return err;
+}
+
+// Only resets once nothing is moving: a queue that is merely busy is left
+// alone, a stuck one is reset and its pending writes are forgotten (the
+// driver rewrites every channel after a recovery).
+static esp_err_t i2c_bus_recover(void *ctx) {
+    i2c_transport_t *tp = ctx;
+    if (in_flight(tp) > 0) {
+        const tx_slot_t *oldest = &tp->slots[tp->tail % TX_SLOTS];
+        if (esp_timer_get_time() - oldest->t_us <= STUCK_MS * 1000) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    esp_err_t err = i2c_master_bus_reset(tp->bus);
+    tp->tail = tp->head;
+    ESP_LOGW(TAG, "Bus reset: %s", esp_err_to_name(err));
+    return err;
+}
+
+static void i2c_bus_release(void *ctx) {
+    i2c_transport_t *tp = ctx;
+    i2c_master_bus_wait_all_done(tp->bus, XFER_TIMEOUT_MS);
+    for (int i = 0; i < tp->n_devs; i++) {
+        i2c_master_bus_rm_device(tp->devs[i].handle);
+    }
+    tp->n_devs = 0;
+    i2c_del_master_bus(tp->bus);
+    tp->bus = NULL;
+}
+
+esp_err_t pca9685_init(const pca9685_config_t *cfg) {
+    if (!cfg) return ESP_ERR_INVALID_ARG;
+
+    memset(&s_tp, 0, sizeof(s_tp));
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = cfg->i2c_port,
+        .sda_io_num = 21,
+        .scl_io_num = 22,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = TX_SLOTS,
+        .flags.enable_internal_pullup = true,
+    };
+    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_cfg, &s_tp.bus));
+
+    pca9685_bus_t bus = {
+        .write = i2c_bus_write,
+        .write_read = i2c_bus_write_read,
+        .submit = i2c_bus_submit,
+        .recover = i2c_bus_recover,
+        .release = i2c_bus_release,
+        .ctx = &s_tp,
+    };
+    return pca9685_init_bus(cfg, &bus);
+}
@@ -0,0 +1,77 @@
+#include "pca9685_curve.h"
+#include "pca9685_driver.h"
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *const KIND_NAMES[] = {
+    [PCA9685_CURVE_LINEAR] = "linear",
+    [PCA9685_CURVE_LOG] = "log",
+    [PCA9685_CURVE_SQUARE] = "square",
+    [PCA9685_CURVE_CIE1931] = "cie1931",
+    [PCA9685_CURVE_CUSTOM] = "custom",
+};
+
+void pca9685_curve_default(pca9685_curve_cfg_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->kind = PCA9685_CURVE_LINEAR;
+    cfg->max_duty = 1.0f;
+}
+
+bool pca9685_curve_parse_kind(const char *name, pca9685_curve_kind_t *out) {
+    if (!name) return false;
+    for (size_t i = 0; i < sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]); i++) {
+        if (strcasecmp(name, KIND_NAMES[i]) == 0) {
+            *out = (pca9685_curve_kind_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *pca9685_curve_kind_name(pca9685_curve_kind_t kind) {
+    return (unsigned)kind < sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]) ? KIND_NAMES[kind] : KIND_NAMES[0];
+}
+
+static float custom_at(const pca9685_curve_cfg_t *cfg, float x) {
+    int n = cfg->n_points;
+    if (n < 2) return x;
+    if (n > PCA9685_CURVE_MAX_POINTS) n = PCA9685_CURVE_MAX_POINTS;
+    float pos = x * (n - 1);
+    int i = (int)pos;
+    if (i >= n - 1) return cfg->points[n - 1];
+    float t = pos - i;
+    return cfg->points[i] + (cfg->points[i + 1] - cfg->points[i]) * t;
+}
+
+// Relative output 0..1 for logical input x in 0..1.
+static float curve_at(const pca9685_curve_cfg_t *cfg, float x) {
+    switch (cfg->kind) {
+        case PCA9685_CURVE_LOG:
+            // Same perceptual scale as log fades: one count to full in even steps.
+            return (powf(4096.0f, x) - 1.0f) / 4095.0f;
+        case PCA9685_CURVE_SQUARE:
+            return x * x;
+        case PCA9685_CURVE_CIE1931: {
+            float l = x * 100.0f;
+            if (l <= 8.0f) return l / 903.3f;
+            float y = (l + 16.0f) / 116.0f;
+            return y * y * y;
+        }
+        case PCA9685_CURVE_CUSTOM:
+            return custom_at(cfg, x);
+        case PCA9685_CURVE_LINEAR:
+        default:
+            return x;
+    }
+}
+
+void pca9685_curve_build(pca9685_curve_t *c, const pca9685_curve_cfg_t *cfg) {
+    float max_duty = cfg->max_duty > 0.0f && cfg->max_duty < 1.0f ? cfg->max_duty : 1.0f;
+    for (int i = 0; i <= PCA9685_CURVE_SEGMENTS; i++) {
+        float y = curve_at(cfg, (float)i / PCA9685_CURVE_SEGMENTS);
+        if (y < 0.0f) y = 0.0f;
+        if (y > 1.0f) y = 1.0f;
+        c->lut[i] = (uint32_t)(y * max_duty * (PCA9685_FULL_ON << 8) + 0.5f);
+    }
+}
@@ -0,0 +1,19 @@
+#include "pca9685_dither.h"
+
+uint32_t pca9685_dither_pass(pca9685_dither_bank_t *bank, uint32_t budget) {
+    if (!bank || bank->n <= 0) return 0;
+    uint32_t spent = 0;
+    for (int k = 0; k < bank->n; k++) {
+        int ch = (bank->rr + k) % bank->n;
+        if (!bank->live[ch]) continue;
+        uint16_t want = pca9685_dither_want(&bank->state[ch], bank->target_q8[ch]);
+        if (want != bank->counts[ch] && budget - spent >= PCA9685_DITHER_UPDATE_BYTES) {
+            spent += PCA9685_DITHER_UPDATE_BYTES;
+            bank->counts[ch] = want;
+            bank->output(ch, want, bank->ctx);
+        }
+        pca9685_dither_account(&bank->state[ch], bank->target_q8[ch], bank->counts[ch]);
+    }
+    bank->rr = (bank->rr + 1) % bank->n;
+    return spent;
+}
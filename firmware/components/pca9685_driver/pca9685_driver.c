@@ -1,13 +1,19 @@
 #include "pca9685_driver.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <math.h>
+#include <string.h>
 
 static const char *TAG = "PCA9685";
 
 #define PCA9685_MODE1 0x00
 #define PCA9685_MODE2 0x01
 #define PCA9685_LED0_ON_L 0x06
+#define PCA9685_ALL_LED_ON_L 0xFA
 #define PCA9685_PRESCALE 0xFE
 #define PCA9685_ALL_LED_OFF_H 0xFD
 
@@ -18,40 +24,122 @@ static const char *TAG = "PCA9685";
 
 #define MODE2_OUTDRV 0x04
 
+#define LED_FULL_BIT 0x10   // bit 4 of LEDn_ON_H / LEDn_OFF_H
+
 static pca9685_config_t s_config;
+static pca9685_bus_t s_bus;
 static bool s_initialized = false;
+static uint8_t s_n_chips = 1;
+static uint8_t s_addr[PCA9685_MAX_CHIPS];
 
-static esp_err_t pca9685_write_reg(uint8_t reg, uint8_t value) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (s_config.i2c_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, value, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(s_config.i2c_port, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+// Shadow of LEDn_ON/OFF as 0..4096 counts. Setters touch only the shadow;
+// pca9685_flush() ships dirty channels in as few auto-increment bursts as
+// possible. s_mux guards shadow+dirty, s_flush_lock orders flushes so an
+// older snapshot can never land after a newer one.
+static uint16_t s_counts[PCA9685_MAX_CHIPS][PCA9685_CHANNELS];
+static uint16_t s_dirty[PCA9685_MAX_CHIPS];
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_flush_lock = NULL;
+static pca9685_bus_stats_t s_stats;
+static volatile bool s_bus_fault = false;
+
+static esp_err_t bus_write(uint8_t addr, const uint8_t *data, size_t len) {
+    s_stats.transactions++;
+    s_stats.bytes += len;
+    return s_bus.write(s_bus.ctx, addr, data, len);
 }
 
-static esp_err_t pca9685_read_reg(uint8_t reg, uint8_t *value) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (s_config.i2c_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (s_config.i2c_addr << 1) | I2C_MASTER_READ, true);
-    i2c_master_read_byte(cmd, value, I2C_MASTER_NACK);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(s_config.i2c_port, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+static esp_err_t pca9685_write_reg(int chip, uint8_t reg, uint8_t value) {
+    uint8_t buf[2] = { reg, value };
+    return bus_write(s_addr[chip], buf, sizeof(buf));
+}
+
+static esp_err_t pca9685_read_reg(int chip, uint8_t reg, uint8_t *value) {
+    s_stats.transactions++;
+    s_stats.bytes += 2;
+    return s_bus.write_read(s_bus.ctx, s_addr[chip], reg, value, 1);
 }
 
-esp_err_t pca9685_init(const pca9685_config_t *cfg) {
-    if (!cfg) return ESP_ERR_INVALID_ARG;
-    
+// Completion tag: chip index in bits 16..23 (ALL_CHIPS for ALLCALL), dirty
+// mask in bits 0..15.
+#define ALL_CHIPS 0xFF
+
+static inline void *burst_tag(int chip, uint16_t mask) {
+    return (void *)(uintptr_t)(((uint32_t)chip << 16) | mask);
+}
+
+// Call with s_mux held; also runs from the completion ISR.
+static void IRAM_ATTR mark_dirty(uint32_t tag) {
+    uint8_t chip = (uint8_t)(tag >> 16);
+    uint16_t mask = (uint16_t)tag;
+    if (chip == ALL_CHIPS) {
+        for (int c = 0; c < s_n_chips; c++) s_dirty[c] = 0xFFFF;
+    } else {
+        s_dirty[chip] |= mask;
+    }
+}
+
+// Async completion: a failed burst puts its channels back in the dirty set
+// and asks the next flush to recover the bus.
+static void IRAM_ATTR on_burst_done(void *arg, esp_err_t result) {
+    if (result == ESP_OK) return;
+    portENTER_CRITICAL_ISR(&s_mux);
+    mark_dirty((uint32_t)(uintptr_t)arg);
+    s_stats.errors++;
+    portEXIT_CRITICAL_ISR(&s_mux);
+    s_bus_fault = true;
+}
+
+static esp_err_t submit_burst(uint8_t addr, const uint8_t *buf, size_t len, void *tag) {
+    if (!s_bus.submit) {
+        return bus_write(addr, buf, len);
+    }
+    esp_err_t err = s_bus.submit(s_bus.ctx, addr, buf, len, on_burst_done, tag);
+    if (err == ESP_OK) {
+        s_stats.transactions++;
+        s_stats.bytes += len;
+    } else if (err == ESP_ERR_NO_MEM) {
+        s_stats.busy++;
+    } else if (err == ESP_ERR_TIMEOUT) {
+        s_bus_fault = true;
+    }
+    return err;
+}
+
+// Called from flush only; never waits on a busy bus. After a reset the chip's
+// LED registers are unknown, so every channel is rewritten.
+static void try_recover(void) {
+    if (!s_bus_fault || !s_bus.recover) return;
+    if (s_bus.recover(s_bus.ctx) != ESP_OK) return;
+    s_bus_fault = false;
+    s_stats.recoveries++;
+    portENTER_CRITICAL(&s_mux);
+    mark_dirty((uint32_t)(uintptr_t)burst_tag(ALL_CHIPS, 0xFFFF));
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// 0 and 4096 use the FULL_OFF / FULL_ON bits; anything else is ON=0, OFF=counts.
+static void encode_led(uint16_t counts, uint8_t *out) {
+    out[0] = 0;
+    out[1] = counts >= PCA9685_FULL_ON ? LED_FULL_BIT : 0;
+    out[2] = (counts > 0 && counts < PCA9685_FULL_ON) ? (counts & 0xFF) : 0;
+    out[3] = counts == 0 ? LED_FULL_BIT : ((counts < PCA9685_FULL_ON) ? (counts >> 8) : 0);
+}
+
+esp_err_t pca9685_init_bus(const pca9685_config_t *cfg, const pca9685_bus_t *bus) {
+    if (!cfg || !bus || !bus->write || !bus->write_read) return ESP_ERR_INVALID_ARG;
+
     s_config = *cfg;
-    
+    s_bus = *bus;
+    s_n_chips = cfg->n_chips ? cfg->n_chips : 1;
+    if (s_n_chips > PCA9685_MAX_CHIPS) s_n_chips = PCA9685_MAX_CHIPS;
+    for (int c = 0; c < s_n_chips; c++) {
+        s_addr[c] = (cfg->n_chips && cfg->chip_addr[c]) ? cfg->chip_addr[c] : (uint8_t)(cfg->i2c_addr + c);
+    }
+    if (!s_flush_lock) {
+        s_flush_lock = xSemaphoreCreateMutex();
+    }
+
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << s_config.oe_pin),
         .mode = GPIO_MODE_OUTPUT,
@@ -61,117 +149,239 @@ esp_err_t pca9685_init(const pca9685_config_t *cfg) {
     };
     gpio_config(&io_conf);
     gpio_set_level(s_config.oe_pin, 1);
-    
-    i2c_config_t i2c_conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = 21,
-        .scl_io_num = 22,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 400000,
-    };
-    ESP_ERROR_CHECK(i2c_param_config(s_config.i2c_port, &i2c_conf));
-    ESP_ERROR_CHECK(i2c_driver_install(s_config.i2c_port, I2C_MODE_MASTER, 0, 0, 0));
-    
-    pca9685_write_reg(PCA9685_MODE1, MODE1_ALLCALL);
+
+    // ALLCALL stays enabled on every chip: pca9685_all_off() relies on it.
+    for (int c = 0; c < s_n_chips; c++) {
+        pca9685_write_reg(c, PCA9685_MODE1, MODE1_ALLCALL);
+    }
     vTaskDelay(pdMS_TO_TICKS(5));
-    
-    uint8_t mode1;
-    pca9685_read_reg(PCA9685_MODE1, &mode1);
-    mode1 &= ~MODE1_SLEEP;
-    pca9685_write_reg(PCA9685_MODE1, mode1);
+
+    for (int c = 0; c < s_n_chips; c++) {
+        uint8_t mode1 = MODE1_ALLCALL;
+        pca9685_read_reg(c, PCA9685_MODE1, &mode1);
+        mode1 &= ~MODE1_SLEEP;
+        pca9685_write_reg(c, PCA9685_MODE1, mode1 | MODE1_ALLCALL);
+        pca9685_write_reg(c, PCA9685_MODE2, MODE2_OUTDRV);
+    }
     vTaskDelay(pdMS_TO_TICKS(5));
-    
-    pca9685_write_reg(PCA9685_MODE2, MODE2_OUTDRV);
-    
+
+    s_initialized = true;
     pca9685_set_pwm_freq(1000);
-    
+
+    // Start from a known all-off state so the shadow matches the chips.
+    memset(s_counts, 0, sizeof(s_counts));
+    for (int c = 0; c < s_n_chips; c++) s_dirty[c] = 0xFFFF;
+    pca9685_flush();
+
     gpio_set_level(s_config.oe_pin, 0);
-    
-    s_initialized = true;
-    ESP_LOGI(TAG, "PCA9685 initialized on I2C%d @ 0x%02X", s_config.i2c_port, s_config.i2c_addr);
+
+    ESP_LOGI(TAG, "PCA9685 x%d initialized on I2C%d @ 0x%02X", s_n_chips, s_config.i2c_port, s_addr[0]);
     return ESP_OK;
 }
 
 esp_err_t pca9685_set_pwm_freq(uint16_t freq_hz) {
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
-    
+    if (freq_hz == 0) return ESP_ERR_INVALID_ARG;
+
     uint32_t prescale_val = (uint32_t)(25000000.0f / (4096.0f * freq_hz)) - 1;
     if (prescale_val < 3) prescale_val = 3;
     if (prescale_val > 255) prescale_val = 255;
-    
-    uint8_t oldmode;
-    pca9685_read_reg(PCA9685_MODE1, &oldmode);
-    uint8_t newmode = (oldmode & ~MODE1_RESTART) | MODE1_SLEEP;
-    pca9685_write_reg(PCA9685_MODE1, newmode);
-    pca9685_write_reg(PCA9685_PRESCALE, (uint8_t)prescale_val);
-    pca9685_write_reg(PCA9685_MODE1, oldmode);
+
+    // Prescale is only writable in sleep; all chips sleep through one 5 ms
+    // oscillator settle instead of one each.
+    uint8_t oldmode[PCA9685_MAX_CHIPS];
+    for (int c = 0; c < s_n_chips; c++) {
+        oldmode[c] = 0;
+        pca9685_read_reg(c, PCA9685_MODE1, &oldmode[c]);
+        uint8_t newmode = (oldmode[c] & ~MODE1_RESTART) | MODE1_SLEEP;
+        pca9685_write_reg(c, PCA9685_MODE1, newmode);
+        pca9685_write_reg(c, PCA9685_PRESCALE, (uint8_t)prescale_val);
+        pca9685_write_reg(c, PCA9685_MODE1, oldmode[c]);
+    }
     vTaskDelay(pdMS_TO_TICKS(5));
-    pca9685_write_reg(PCA9685_MODE1, oldmode | MODE1_RESTART | MODE1_AI);
-    
+    for (int c = 0; c < s_n_chips; c++) {
+        pca9685_write_reg(c, PCA9685_MODE1, oldmode[c] | MODE1_RESTART | MODE1_AI);
+    }
+
     ESP_LOGI(TAG, "PWM frequency set to %d Hz (prescale=%lu)", freq_hz, prescale_val);
     return ESP_OK;
 }
 
-esp_err_t pca9685_set_duty(uint8_t channel, float duty) {
+uint16_t pca9685_channel_count(void) {
+    return (uint16_t)(s_n_chips * PCA9685_CHANNELS);
+}
+
+esp_err_t pca9685_set_counts(uint16_t channel, uint16_t counts) {
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
-    if (channel > 15) return ESP_ERR_INVALID_ARG;
+    if (channel >= pca9685_channel_count()) return ESP_ERR_INVALID_ARG;
+    if (counts > PCA9685_FULL_ON) counts = PCA9685_FULL_ON;
+
+    int chip = channel / PCA9685_CHANNELS;
+    int out = channel % PCA9685_CHANNELS;
+    portENTER_CRITICAL(&s_mux);
+    if (s_counts[chip][out] != counts) {
+        s_counts[chip][out] = counts;
+        s_dirty[chip] |= (uint16_t)(1u << out);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ESP_OK;
+}
+
+esp_err_t pca9685_set_duty(uint16_t channel, float duty) {
     if (duty < 0.0f) duty = 0.0f;
     if (duty > 1.0f) duty = 1.0f;
-    
-    uint16_t on_time = 0;
-    uint16_t off_time = (uint16_t)(duty * 4095.0f);
-    
-    uint8_t reg_base = PCA9685_LED0_ON_L + 4 * channel;
-    
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (s_config.i2c_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg_base, true);
-    i2c_master_write_byte(cmd, on_time & 0xFF, true);
-    i2c_master_write_byte(cmd, (on_time >> 8) & 0xFF, true);
-    i2c_master_write_byte(cmd, off_time & 0xFF, true);
-    i2c_master_write_byte(cmd, (off_time >> 8) & 0xFF, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(s_config.i2c_port, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    
+    return pca9685_set_counts(channel, (uint16_t)(duty * PCA9685_FULL_ON + 0.5f));
+}
+
+// One chip's dirty set: a single ALL_LED write if all 16 change to the same
+// value, otherwise one auto-increment burst per dirty range.
+static esp_err_t flush_chip(int chip, uint16_t dirty, const uint16_t *counts, uint16_t *failed) {
+    esp_err_t ret = ESP_OK;
+    uint8_t addr = s_addr[chip];
+    bool uniform = true;
+    for (int ch = 1; ch < PCA9685_CHANNELS; ch++) {
+        uniform = uniform && counts[ch] == counts[0];
+    }
+
+    if (dirty == 0xFFFF && uniform) {
+        uint8_t buf[5] = { PCA9685_ALL_LED_ON_L };
+        encode_led(counts[0], &buf[1]);
+        ret = submit_burst(addr, buf, sizeof(buf), burst_tag(chip, dirty));
+        if (ret != ESP_OK) *failed = dirty;
+        return ret;
+    }
+
+    uint8_t buf[1 + 4 * PCA9685_CHANNELS];
+    int ch = 0;
+    while (ch < PCA9685_CHANNELS) {
+        if (!(dirty & (1u << ch))) {
+            ch++;
+            continue;
+        }
+        // Bridge single clean channels: rewriting 4 unchanged bytes is
+        // cheaper than another START + address + register.
+        int end = ch;
+        while (end + 1 < PCA9685_CHANNELS &&
+               ((dirty & (1u << (end + 1))) ||
+                (end + 2 < PCA9685_CHANNELS && (dirty & (1u << (end + 2)))))) {
+            end++;
+        }
+        buf[0] = PCA9685_LED0_ON_L + 4 * ch;
+        for (int i = ch; i <= end; i++) {
+            encode_led(counts[i], &buf[1 + 4 * (i - ch)]);
+        }
+        uint16_t mask = (uint16_t)(((1u << (end + 1)) - 1) & ~((1u << ch) - 1));
+        esp_err_t err = submit_burst(addr, buf, 1 + 4 * (end - ch + 1), burst_tag(chip, mask));
+        if (err != ESP_OK) {
+            ret = err;
+            *failed |= mask;
+        }
+        ch = end + 1;
+    }
     return ret;
 }
 
-esp_err_t pca9685_fade_to(uint8_t channel, float target_duty, uint32_t duration_ms, bool log_curve) {
+esp_err_t pca9685_flush(void) {
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
-    if (channel > 15) return ESP_ERR_INVALID_ARG;
-    
-    ESP_LOGI(TAG, "Fade ch%d to %.2f over %lu ms (%s)", channel, target_duty, duration_ms, log_curve ? "log" : "linear");
-    
-    return ESP_OK;
+
+    xSemaphoreTake(s_flush_lock, portMAX_DELAY);
+    try_recover();
+    esp_err_t ret = ESP_OK;
+    for (int chip = 0; chip < s_n_chips; chip++) {
+        uint16_t counts[PCA9685_CHANNELS];
+        portENTER_CRITICAL(&s_mux);
+        uint16_t dirty = s_dirty[chip];
+        s_dirty[chip] = 0;
+        memcpy(counts, s_counts[chip], sizeof(counts));
+        portEXIT_CRITICAL(&s_mux);
+        if (!dirty) continue;
+
+        uint16_t failed = 0;
+        esp_err_t err = flush_chip(chip, dirty, counts, &failed);
+        if (!failed) continue;
+        ret = err;
+        // Retry on the next flush rather than dropping the update. A full
+        // queue is normal back-pressure, not worth a log line.
+        portENTER_CRITICAL(&s_mux);
+        s_dirty[chip] |= failed;
+        if (err != ESP_ERR_NO_MEM) s_stats.errors++;
+        portEXIT_CRITICAL(&s_mux);
+        if (err != ESP_ERR_NO_MEM) {
+            ESP_LOGW(TAG, "Flush 0x%02X failed (%s), %04x pending", s_addr[chip], esp_err_to_name(err), failed);
+        }
+    }
+    xSemaphoreGive(s_flush_lock);
+    return ret;
+}
+
+// Perceived level p in 0..1 for counts c: p = log(1 + c*4095/4096) / log(4096),
+// so one count at the bottom and 4096 at the top span the same range of p.
+static float counts_to_level(uint16_t c) {
+    return logf(1.0f + c * (4095.0f / 4096.0f)) / logf(4096.0f);
+}
+
+static uint16_t level_to_counts(float p) {
+    return (uint16_t)((powf(4096.0f, p) - 1.0f) * (4096.0f / 4095.0f) + 0.5f);
+}
+
+uint16_t pca9685_fade_counts(uint16_t from, uint16_t to, uint32_t elapsed_ms, uint32_t duration_ms, bool log_curve) {
+    if (from > PCA9685_FULL_ON) from = PCA9685_FULL_ON;
+    if (to > PCA9685_FULL_ON) to = PCA9685_FULL_ON;
+    if (elapsed_ms >= duration_ms) return to;
+    if (elapsed_ms == 0) return from;
+
+    if (!log_curve) {
+        int32_t delta = (int32_t)to - from;
+        return (uint16_t)(from + (int32_t)(((int64_t)delta * elapsed_ms + (delta < 0 ? -1 : 1) * (int64_t)(duration_ms / 2)) / duration_ms));
+    }
+    float t = (float)elapsed_ms / duration_ms;
+    float a = counts_to_level(from);
+    float b = counts_to_level(to);
+    uint16_t c = level_to_counts(a + (b - a) * t);
+    return c > PCA9685_FULL_ON ? PCA9685_FULL_ON : c;
 }
 
 esp_err_t pca9685_all_off(void) {
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
-    
-    gpio_set_level(s_config.oe_pin, 1);
-    
-    for (int ch = 0; ch < 16; ch++) {
-        pca9685_set_duty(ch, 0.0f);
+
+    // Writing ALL_LED_OFF_H loads every LEDn_OFF_H, so FULL_OFF through the
+    // ALLCALL address blacks out all chips in one 2-byte transaction. Pending
+    // updates are dropped with the shadow; if the write fails the zeros go
+    // out chip by chip on the next flush instead.
+    xSemaphoreTake(s_flush_lock, portMAX_DELAY);
+    portENTER_CRITICAL(&s_mux);
+    memset(s_counts, 0, sizeof(s_counts));
+    memset(s_dirty, 0, sizeof(s_dirty));
+    portEXIT_CRITICAL(&s_mux);
+    uint8_t buf[2] = { PCA9685_ALL_LED_OFF_H, LED_FULL_BIT };
+    esp_err_t ret = submit_burst(PCA9685_ALLCALL_ADDR, buf, sizeof(buf), burst_tag(ALL_CHIPS, 0xFFFF));
+    if (ret != ESP_OK) {
+        portENTER_CRITICAL(&s_mux);
+        mark_dirty((uint32_t)(uintptr_t)burst_tag(ALL_CHIPS, 0xFFFF));
+        portEXIT_CRITICAL(&s_mux);
     }
-    
-    vTaskDelay(pdMS_TO_TICKS(10));
-    gpio_set_level(s_config.oe_pin, 0);
-    
+    xSemaphoreGive(s_flush_lock);
+
     ESP_LOGI(TAG, "All channels off");
-    return ESP_OK;
+    return ret;
 }
 
 esp_err_t pca9685_deinit(void) {
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
-    
+
     pca9685_all_off();
     gpio_set_level(s_config.oe_pin, 1);
-    i2c_driver_delete(s_config.i2c_port);
+    if (s_bus.release) {
+        s_bus.release(s_bus.ctx);
+    }
     s_initialized = false;
-    
+
     ESP_LOGI(TAG, "PCA9685 deinitialized");
     return ESP_OK;
 }
+
+void pca9685_get_bus_stats(pca9685_bus_stats_t *out) {
+    if (out) {
+        *out = s_stats;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "effects.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// UDP pixel ingest for show controllers: DDP, E1.31 (sACN) and Art-Net.
+// Payload bytes go straight from the datagram into a per-channel back
+// buffer; a latch moves it into the channel's jitter buffer and the
+// consumer (the effect engine) takes it as its front buffer when it is due.
+// No frame is ever copied and nothing is allocated per packet: buffers are
+// sized when a channel is mapped.
+//
+// Jitter buffer: latched frames are ordered by the protocol sequence number
+// (arrival order when the sender sends none) and played at their ideal
+// arrival time plus latency_ms. The ideal arrival tracks the earliest
+// arrivals on an estimated frame period, so Wi-Fi bursts are smoothed out
+// instead of shown as they land. A frame that never arrives is concealed
+// when its slot passes: the previous frame stays up, or with conceal_blend
+// the front is blended halfway towards the next queued frame. latency_ms 0
+// plays every frame as soon as it latches.
+//
+// Latching: DDP on the PUSH flag; E1.31 data with a sync address on the
+// matching sync packet, otherwise on the channel's last universe; Art-Net
+// on ArtSync while ArtSync packets keep arriving (4 s), otherwise on the
+// last universe. Senders are expected to send whole frames: a universe
+// left out shows whatever that buffer slot held last.
+
+#define PIXEL_STREAM_CHANNELS     8
+#define PIXEL_STREAM_MAX_PIXELS   1024
+#define PIXEL_STREAM_MAX_QUEUE    4       // frames held per channel
+
+#define PIXEL_STREAM_PORT_DDP     4048
+#define PIXEL_STREAM_PORT_E131    5568
+#define PIXEL_STREAM_PORT_ARTNET  6454
+
+typedef enum {
+    PIXEL_STREAM_DDP = 0,
+    PIXEL_STREAM_E131,
+    PIXEL_STREAM_ARTNET,
+    PIXEL_STREAM_PROTOS
+} pixel_stream_proto_t;
+
+typedef struct {
+    uint16_t n_pixels;       // 0 = channel not streamed
+    uint16_t universe;       // first E1.31/Art-Net universe: 170 RGB or 128 RGBW px each
+    uint32_t ddp_offset;     // first byte in the DDP address space
+    bool     rgbw;
+    uint16_t latency_ms;     // playout delay; sizes the queue at one frame per 20 ms
+    bool     conceal_blend;  // blend over a lost frame instead of repeating
+} pixel_stream_map_t;
+
+typedef struct {
+    uint32_t shown;
+    uint32_t late;           // arrived after their playout time
+    uint32_t dropped;        // never shown: queue overflow, superseded or duplicate
+    uint32_t concealed;      // lost frames whose slot was covered
+    uint8_t  depth;          // frames queued now
+    float    period_ms;      // estimated source frame interval
+} pixel_stream_ch_stats_t;
+
+typedef struct {
+    uint32_t packets[PIXEL_STREAM_PROTOS];
+    uint32_t bad;            // malformed
+    uint32_t frames;         // latched, all channels
+    uint32_t late;           // channel counters, summed
+    uint32_t dropped;
+    uint32_t concealed;
+    pixel_stream_ch_stats_t ch[PIXEL_STREAM_CHANNELS];
+} pixel_stream_stats_t;
+
+// Maps ALED channel ch (0-based) and (re)allocates its buffers; n_pixels 0
+// takes it out of stream mode.
+esp_err_t pixel_stream_set_map(int ch, const pixel_stream_map_t *map);
+bool      pixel_stream_get_map(int ch, pixel_stream_map_t *out);
+bool      pixel_stream_active(int ch);
+
+// Decodes one datagram. False if it is not a valid packet of proto.
+bool      pixel_stream_handle(pixel_stream_proto_t proto, const uint8_t *buf, size_t len, uint32_t now_ms);
+
+// Consumer side, on the same millisecond clock as pixel_stream_handle. True
+// if a new frame (or a concealment blend) is due for output; *px then stays
+// untouched by the receiver until the next take on this channel. *wait_ms,
+// if given, is the time until the next queued frame is due (UINT32_MAX if
+// none).
+bool      pixel_stream_take(int ch, uint32_t now_ms, px_rgba_t **px, uint16_t *n_pixels, uint32_t *wait_ms);
+// Task notified (xTaskNotifyGive) whenever a frame is latched.
+void      pixel_stream_set_consumer(TaskHandle_t task);
+
+void      pixel_stream_get_stats(pixel_stream_stats_t *out);
+
+// Plain DMX: E1.31/Art-Net universes in [first, first + count) that no
+// channel maps as pixels go to fn (slots without the start code), from the
+// net_io task and outside the stream lock. Synchronised senders are not
+// held for sync. fn NULL or count 0 stops it.
+typedef void (*pixel_stream_dmx_fn)(uint16_t universe, const uint8_t *slots, uint16_t n);
+void      pixel_stream_set_dmx(pixel_stream_dmx_fn fn, uint16_t first, uint16_t count);
+
+// Registers the three protocol ports with net_io; datagrams are decoded on
+// the net_io task.
+esp_err_t pixel_stream_start(void);
+void      pixel_stream_stop(void);
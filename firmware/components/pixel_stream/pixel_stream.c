@@ -0,0 +1,629 @@
+#include "pixel_stream.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "lwip/inet.h"
+#include "net_io.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "PIXEL_STREAM";
+
+#define DDP_FLAG_PUSH        0x01
+#define DDP_FLAG_QUERY       0x02
+#define DDP_FLAG_REPLY       0x04
+#define DDP_FLAG_TIME        0x10
+#define DDP_VERSION_MASK     0xC0
+#define DDP_VERSION_1        0x40
+#define DDP_ID_DISPLAY       1
+#define DDP_HDR_LEN          10
+
+#define E131_ROOT_DATA       0x00000004
+#define E131_ROOT_EXTENDED   0x00000008
+#define E131_FRAME_DATA      0x00000002
+#define E131_FRAME_SYNC      0x00000001
+#define E131_DMP_SET         0x02
+#define E131_OPT_PREVIEW     0x80
+#define E131_DATA_OFFSET     126
+#define E131_SYNC_LEN        49
+
+#define ARTNET_OP_DMX        0x5000
+#define ARTNET_OP_SYNC       0x5200
+#define ARTNET_HDR_LEN       18
+#define ARTSYNC_HOLD_MS      4000
+#define SYNC_ARTNET          0xFFFF   // sACN sync addresses stop at 63999
+
+#define MAX_JOINED           64
+
+#define JB_SLOTS             (PIXEL_STREAM_MAX_QUEUE + 2)   // + back and front
+#define JB_MS_PER_FRAME      20       // queue sizing: one slot per 20 ms of latency
+#define JB_RESET_MS          1000     // silence after which a stream starts over
+#define JB_PERIOD_DEFAULT_MS 25.0f
+#define JB_PERIOD_MIN_MS     5.0f
+#define JB_PERIOD_MAX_MS     250.0f
+
+typedef struct {
+    uint32_t seq;
+    uint32_t play_ms;
+    uint8_t  slot;
+} jb_frame_t;
+
+typedef struct {
+    pixel_stream_map_t map;
+    px_rgba_t *buf[JB_SLOTS];
+    uint8_t    n_slots;
+    uint8_t    back, front;
+    bool       dirty;          // back written since the last latch
+    bool       shown;          // front holds a frame
+    uint16_t   sync_addr;      // of the last data written; 0 = unsynchronised
+    uint16_t   n_universes;
+    uint16_t   universe_bytes;
+    uint16_t   wire_mod;       // sequence modulus of the last data written; 0 = none
+    uint8_t    wire_seq;       // 0-based within wire_mod
+
+    // Jitter buffer, ordered by seq.
+    jb_frame_t queue[PIXEL_STREAM_MAX_QUEUE];
+    uint8_t    depth, cap;
+    bool       started;
+    bool       last_had_seq;
+    uint16_t   last_mod;
+    uint8_t    last_wire;
+    uint32_t   seq;            // unwrapped, newest latched
+    uint32_t   next_seq;       // next to play
+    uint32_t   last_rx_ms;
+    uint32_t   anchor_ms;      // ideal arrival of anchor_seq
+    uint32_t   anchor_seq;
+    float      period_ms;
+    pixel_stream_ch_stats_t st;
+
+    px_rgba_t *retired[JB_SLOTS];  // previous buffers, freed by the consumer
+} stream_ch_t;
+
+static const uint8_t ACN_ID[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+
+// s_lock guards the channel table: the net_io task holds it per packet,
+// the consumer per take, set_map while swapping buffers.
+static SemaphoreHandle_t    s_lock = NULL;
+static stream_ch_t          s_ch[PIXEL_STREAM_CHANNELS];
+static pixel_stream_stats_t s_stats;
+static uint32_t             s_artsync_until_ms = 0;
+static bool                 s_artsync_seen = false;
+static bool                 s_latched = false;
+static TaskHandle_t         s_consumer = NULL;
+static volatile uint32_t    s_map_gen = 0;
+
+static pixel_stream_dmx_fn  s_dmx_fn = NULL;
+static uint16_t             s_dmx_first = 0;
+static uint16_t             s_dmx_count = 0;
+// Set by the decoders under s_lock, delivered by pixel_stream_handle
+// after it is released; points into the caller's datagram.
+static struct {
+    const uint8_t *slots;
+    uint16_t       universe;
+    uint16_t       n;
+} s_dmx_rx;
+
+// net_io handles, one per protocol; E1.31 memberships follow the map.
+static int                  s_net[PIXEL_STREAM_PROTOS] = { -1, -1, -1 };
+static uint16_t             s_joined[MAX_JOINED];
+static int                  s_n_joined = 0;
+static uint32_t             s_joined_gen = 0;
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+static inline uint16_t be16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static inline uint32_t be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+static inline uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static inline uint8_t bpp(const stream_ch_t *c) { return c->map.rgbw ? 4 : 3; }
+static inline uint32_t ch_bytes(const stream_ch_t *c) { return (uint32_t)c->map.n_pixels * bpp(c); }
+
+// Wire bytes are R,G,B[,W] per pixel; px_rgba_t has the same leading order,
+// so component k of a pixel is byte k of the struct.
+static void put_bytes(stream_ch_t *c, uint32_t byte_off, const uint8_t *src, uint32_t n, uint8_t seq, uint16_t mod) {
+    const uint8_t stride = bpp(c);
+    uint32_t comp = byte_off % stride;
+    uint8_t *dst = (uint8_t *)&c->buf[c->back][byte_off / stride];
+    while (n--) {
+        dst[comp] = *src++;
+        if (++comp == stride) {
+            comp = 0;
+            dst += sizeof(px_rgba_t);
+        }
+    }
+    c->dirty = true;
+    c->wire_seq = seq;
+    c->wire_mod = mod;
+}
+
+static inline float period_of(const stream_ch_t *c) {
+    return c->period_ms > 0.0f ? c->period_ms : JB_PERIOD_DEFAULT_MS;
+}
+
+static inline uint32_t ideal_ms(const stream_ch_t *c, uint32_t seq) {
+    return c->anchor_ms + (uint32_t)(int32_t)((int32_t)(seq - c->anchor_seq) * period_of(c));
+}
+
+static void jb_restart(stream_ch_t *c, uint32_t now_ms) {
+    c->st.dropped += c->depth;
+    s_stats.dropped += c->depth;
+    c->depth = 0;
+    c->seq += 1;
+    c->next_seq = c->seq;
+    c->anchor_ms = now_ms;
+    c->anchor_seq = c->seq;
+    c->started = true;
+}
+
+// Sequence of the frame in back, unwrapped against the newest one. Frames
+// from a sender without sequence numbers count up in arrival order.
+static uint32_t jb_unwrap(const stream_ch_t *c) {
+    if (!c->wire_mod || !c->last_had_seq) return c->seq + 1;
+    int32_t d = ((int32_t)c->wire_seq - c->last_wire) % c->wire_mod;
+    if (d < 0) d += c->wire_mod;
+    if (d > c->wire_mod / 2) d -= c->wire_mod;
+    return c->seq + (uint32_t)d;
+}
+
+// First slot that is not back, front or queued.
+static uint8_t jb_free_slot(const stream_ch_t *c) {
+    for (uint8_t s = 0; s < c->n_slots; s++) {
+        bool used = s == c->back || s == c->front;
+        for (int i = 0; i < c->depth && !used; i++) used = c->queue[i].slot == s;
+        if (!used) return s;
+    }
+    return c->back;   // unreachable: n_slots = cap + 2
+}
+
+static void jb_drop(stream_ch_t *c, int i) {
+    memmove(&c->queue[i], &c->queue[i + 1], (size_t)(c->depth - i - 1) * sizeof(jb_frame_t));
+    c->depth--;
+    c->st.dropped++;
+    s_stats.dropped++;
+}
+
+// Moves back into the jitter buffer. Call with s_lock held.
+static void latch(stream_ch_t *c, uint32_t now_ms) {
+    if (!c->dirty) return;
+    c->dirty = false;
+    s_stats.frames++;
+    s_latched = true;
+
+    uint32_t seq;
+    bool restart = !c->started || c->wire_mod != c->last_mod ||
+                   (int32_t)(now_ms - c->last_rx_ms) > JB_RESET_MS;
+    if (restart) {
+        jb_restart(c, now_ms);
+        seq = c->seq;
+    } else {
+        seq = jb_unwrap(c);
+    }
+    int32_t ahead = (int32_t)(seq - c->seq);
+    if (restart || ahead > 0) {
+        if (ahead > 0 && ahead <= PIXEL_STREAM_MAX_QUEUE) {
+            float interval = (float)(int32_t)(now_ms - c->last_rx_ms) / ahead;
+            c->period_ms = c->period_ms > 0.0f ? c->period_ms + (interval - c->period_ms) / 16.0f : interval;
+            if (c->period_ms < JB_PERIOD_MIN_MS) c->period_ms = JB_PERIOD_MIN_MS;
+            if (c->period_ms > JB_PERIOD_MAX_MS) c->period_ms = JB_PERIOD_MAX_MS;
+        }
+        // The least delayed arrival sets the schedule; later ones pull it
+        // back slowly so a lasting change in delay or rate is followed.
+        int32_t err = (int32_t)(now_ms - ideal_ms(c, seq));
+        c->anchor_ms = err < 0 ? now_ms : ideal_ms(c, seq) + (uint32_t)(err / 32);
+        c->anchor_seq = seq;
+        c->seq = seq;
+        c->last_rx_ms = now_ms;
+        c->last_wire = c->wire_seq;
+        c->last_mod = c->wire_mod;
+        c->last_had_seq = c->wire_mod != 0;
+    }
+
+    if ((int32_t)(seq - c->next_seq) < 0) {
+        // Its slot has passed and was concealed.
+        c->st.late++;
+        s_stats.late++;
+        return;
+    }
+    uint32_t play_ms = ideal_ms(c, seq) + c->map.latency_ms;
+    if ((int32_t)(now_ms - play_ms) > 0) {
+        c->st.late++;
+        s_stats.late++;
+    }
+
+    int at = 0;
+    while (at < c->depth && (int32_t)(c->queue[at].seq - seq) < 0) at++;
+    if (at < c->depth && c->queue[at].seq == seq) {
+        jb_drop(c, at);
+    } else if (c->depth == c->cap) {
+        if (at == 0) {
+            c->st.dropped++;
+            s_stats.dropped++;
+            return;
+        }
+        jb_drop(c, 0);
+        at--;
+    }
+    memmove(&c->queue[at + 1], &c->queue[at], (size_t)(c->depth - at) * sizeof(jb_frame_t));
+    c->queue[at] = (jb_frame_t){ .seq = seq, .play_ms = play_ms, .slot = c->back };
+    c->depth++;
+    c->back = jb_free_slot(c);
+}
+
+static void latch_sync(uint16_t sync_addr, uint32_t now_ms) {
+    for (int i = 0; i < PIXEL_STREAM_CHANNELS; i++) {
+        if (s_ch[i].map.n_pixels && s_ch[i].sync_addr == sync_addr) latch(&s_ch[i], now_ms);
+    }
+}
+
+// One E1.31/Art-Net universe into whichever channel owns it. Unsynchronised
+// data latches with the channel's last universe. Universes no channel owns
+// are queued for the DMX handler if they are in its range.
+static void put_universe(uint16_t universe, const uint8_t *data, uint32_t n, uint16_t sync_addr,
+                         uint8_t seq, uint16_t mod, uint32_t now_ms) {
+    bool owned = false;
+    for (int i = 0; i < PIXEL_STREAM_CHANNELS; i++) {
+        stream_ch_t *c = &s_ch[i];
+        if (!c->map.n_pixels || universe < c->map.universe ||
+            universe >= c->map.universe + c->n_universes) {
+            continue;
+        }
+        owned = true;
+        uint32_t k = universe - c->map.universe;
+        uint32_t off = k * c->universe_bytes;
+        uint32_t room = ch_bytes(c) - off;
+        uint32_t take = n < c->universe_bytes ? n : c->universe_bytes;
+        if (take > room) take = room;
+        put_bytes(c, off, data, take, seq, mod);
+        c->sync_addr = sync_addr;
+        if (!sync_addr && k == c->n_universes - 1u) latch(c, now_ms);
+    }
+    if (!owned && s_dmx_fn && (uint16_t)(universe - s_dmx_first) < s_dmx_count) {
+        s_dmx_rx.slots = data;
+        s_dmx_rx.universe = universe;
+        s_dmx_rx.n = (uint16_t)(n < 512 ? n : 512);
+    }
+}
+
+static bool handle_ddp(const uint8_t *b, size_t len, uint32_t now_ms) {
+    if (len < DDP_HDR_LEN || (b[0] & DDP_VERSION_MASK) != DDP_VERSION_1) return false;
+    size_t hdr = (b[0] & DDP_FLAG_TIME) ? DDP_HDR_LEN + 4 : DDP_HDR_LEN;
+    if (len < hdr) return false;
+    if (b[0] & (DDP_FLAG_QUERY | DDP_FLAG_REPLY) || b[3] != DDP_ID_DISPLAY) return true;
+
+    uint32_t offset = be32(b + 4);
+    uint32_t n = be16(b + 8);
+    if (hdr + n > len) return false;
+    const uint8_t *data = b + hdr;
+    // Sequence 1..15, 0 when the sender does not number packets.
+    uint8_t seq = b[1] & 0x0F;
+
+    for (int i = 0; i < PIXEL_STREAM_CHANNELS; i++) {
+        stream_ch_t *c = &s_ch[i];
+        if (!c->map.n_pixels) continue;
+        uint32_t lo = c->map.ddp_offset, hi = lo + ch_bytes(c);
+        uint32_t from = offset > lo ? offset : lo;
+        uint32_t to = offset + n < hi ? offset + n : hi;
+        if (from >= to) continue;
+        put_bytes(c, from - lo, data + (from - offset), to - from, seq ? seq - 1 : 0, seq ? 15 : 0);
+        c->sync_addr = 0;
+    }
+    if (b[0] & DDP_FLAG_PUSH) {
+        for (int i = 0; i < PIXEL_STREAM_CHANNELS; i++) latch(&s_ch[i], now_ms);
+    }
+    return true;
+}
+
+static bool handle_e131(const uint8_t *b, size_t len, uint32_t now_ms) {
+    if (len < E131_SYNC_LEN || be16(b) != 0x0010 || memcmp(b + 4, ACN_ID, sizeof(ACN_ID)) != 0) {
+        return false;
+    }
+    uint32_t root = be32(b + 18);
+    if (root == E131_ROOT_EXTENDED) {
+        // Discovery and other extended packets carry no pixels.
+        if (be32(b + 40) == E131_FRAME_SYNC) latch_sync(be16(b + 45), now_ms);
+        return true;
+    }
+    if (root != E131_ROOT_DATA || len < E131_DATA_OFFSET || be32(b + 40) != E131_FRAME_DATA ||
+        b[117] != E131_DMP_SET) {
+        return false;
+    }
+    // Preview data and non-zero start codes are not for display.
+    if ((b[112] & E131_OPT_PREVIEW) || b[125] != 0) return true;
+
+    uint32_t slots = be16(b + 123);
+    slots = slots ? slots - 1 : 0;
+    if (E131_DATA_OFFSET + slots > len) slots = len - E131_DATA_OFFSET;
+    put_universe(be16(b + 113), b + E131_DATA_OFFSET, slots, be16(b + 109), b[111], 256, now_ms);
+    return true;
+}
+
+static bool handle_artnet(const uint8_t *b, size_t len, uint32_t now_ms) {
+    if (len < 12 || memcmp(b, "Art-Net", 8) != 0) return false;
+    uint16_t op = le16(b + 8);
+    if (op == ARTNET_OP_SYNC) {
+        s_artsync_seen = true;
+        s_artsync_until_ms = now_ms + ARTSYNC_HOLD_MS;
+        latch_sync(SYNC_ARTNET, now_ms);
+        return true;
+    }
+    if (op != ARTNET_OP_DMX) return true;   // polls and the like
+    if (len < ARTNET_HDR_LEN) return false;
+
+    uint16_t port = (uint16_t)(((b[15] & 0x7F) << 8) | b[14]);
+    uint32_t n = be16(b + 16);
+    if (ARTNET_HDR_LEN + n > len) n = len - ARTNET_HDR_LEN;
+    bool synced = s_artsync_seen && (int32_t)(s_artsync_until_ms - now_ms) > 0;
+    // Sequence 1..255, 0 when disabled.
+    uint8_t seq = b[12];
+    put_universe(port, b + ARTNET_HDR_LEN, n, synced ? SYNC_ARTNET : 0, seq ? seq - 1 : 0, seq ? 255 : 0, now_ms);
+    return true;
+}
+
+bool pixel_stream_handle(pixel_stream_proto_t proto, const uint8_t *buf, size_t len, uint32_t now_ms) {
+    if (!buf || proto >= PIXEL_STREAM_PROTOS) return false;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+
+    bool ok = false;
+    switch (proto) {
+        case PIXEL_STREAM_DDP:    ok = handle_ddp(buf, len, now_ms); break;
+        case PIXEL_STREAM_E131:   ok = handle_e131(buf, len, now_ms); break;
+        case PIXEL_STREAM_ARTNET: ok = handle_artnet(buf, len, now_ms); break;
+        default: break;
+    }
+    if (ok) {
+        s_stats.packets[proto]++;
+    } else {
+        s_stats.bad++;
+    }
+    bool wake = s_latched;
+    s_latched = false;
+    TaskHandle_t consumer = s_consumer;
+    pixel_stream_dmx_fn dmx_fn = s_dmx_rx.slots ? s_dmx_fn : NULL;
+    const uint8_t *dmx_slots = s_dmx_rx.slots;
+    uint16_t dmx_universe = s_dmx_rx.universe, dmx_n = s_dmx_rx.n;
+    s_dmx_rx.slots = NULL;
+    xSemaphoreGive(s_lock);
+
+    if (wake && consumer) xTaskNotifyGive(consumer);
+    if (dmx_fn) dmx_fn(dmx_universe, dmx_slots, dmx_n);
+    return ok;
+}
+
+// Halfway from the front towards the next frame, over a lost one.
+static void blend_half(px_rgba_t *dst, const px_rgba_t *next, uint16_t n) {
+    for (uint16_t i = 0; i < n; i++) {
+        dst[i].r = (uint8_t)((dst[i].r + next[i].r + 1) >> 1);
+        dst[i].g = (uint8_t)((dst[i].g + next[i].g + 1) >> 1);
+        dst[i].b = (uint8_t)((dst[i].b + next[i].b + 1) >> 1);
+        dst[i].w = (uint8_t)((dst[i].w + next[i].w + 1) >> 1);
+    }
+}
+
+bool pixel_stream_take(int ch, uint32_t now_ms, px_rgba_t **px, uint16_t *n_pixels, uint32_t *wait_ms) {
+    if (wait_ms) *wait_ms = UINT32_MAX;
+    if (ch < 0 || ch >= PIXEL_STREAM_CHANNELS || !px || !s_lock) return false;
+    px_rgba_t *retired[JB_SLOTS];
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return false;
+
+    stream_ch_t *c = &s_ch[ch];
+    memcpy(retired, c->retired, sizeof(retired));
+    memset(c->retired, 0, sizeof(c->retired));
+    bool out = false;
+    uint32_t due = 0;
+    bool waiting = false;
+    while (c->map.n_pixels && c->depth) {
+        jb_frame_t *h = &c->queue[0];
+        int32_t gap = (int32_t)(h->seq - c->next_seq);
+        if (gap > 0) {
+            // Frames before h were lost; their slots end where h's starts.
+            due = h->play_ms - (uint32_t)(int32_t)(gap * period_of(c));
+            if ((int32_t)(now_ms - due) < 0) {
+                waiting = true;
+                break;
+            }
+            c->st.concealed += (uint32_t)gap;
+            s_stats.concealed += (uint32_t)gap;
+            c->next_seq = h->seq;
+            if (c->map.conceal_blend && c->shown && (int32_t)(now_ms - h->play_ms) < 0) {
+                blend_half(c->buf[c->front], c->buf[h->slot], c->map.n_pixels);
+                out = true;
+            }
+            continue;
+        }
+        if ((int32_t)(now_ms - h->play_ms) < 0) {
+            due = h->play_ms;
+            waiting = true;
+            break;
+        }
+        c->next_seq = h->seq + 1;
+        if (c->depth > 1 && (int32_t)(now_ms - c->queue[1].play_ms) >= 0) {
+            // A newer frame is due as well: show that one.
+            jb_drop(c, 0);
+            continue;
+        }
+        c->front = h->slot;
+        memmove(&c->queue[0], &c->queue[1], (size_t)(c->depth - 1) * sizeof(jb_frame_t));
+        c->depth--;
+        c->shown = true;
+        c->st.shown++;
+        out = true;
+    }
+    if (out) {
+        *px = c->buf[c->front];
+        if (n_pixels) *n_pixels = c->map.n_pixels;
+    }
+    if (waiting && wait_ms) *wait_ms = due - now_ms;
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; i < JB_SLOTS; i++) heap_caps_free(retired[i]);
+    return out;
+}
+
+esp_err_t pixel_stream_set_map(int ch, const pixel_stream_map_t *map) {
+    if (ch < 0 || ch >= PIXEL_STREAM_CHANNELS || !map || map->n_pixels > PIXEL_STREAM_MAX_PIXELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ensure_lock();
+
+    // One queue slot per JB_MS_PER_FRAME of latency: enough for the frames
+    // in flight at 50 fps, plus back and front.
+    uint32_t cap = map->latency_ms / JB_MS_PER_FRAME + 1;
+    if (cap > PIXEL_STREAM_MAX_QUEUE) cap = PIXEL_STREAM_MAX_QUEUE;
+    int n_slots = (int)cap + 2;
+    px_rgba_t *fresh[JB_SLOTS] = { NULL };
+    if (map->n_pixels) {
+        for (int i = 0; i < n_slots; i++) {
+            fresh[i] = heap_caps_calloc(map->n_pixels, sizeof(px_rgba_t), MALLOC_CAP_8BIT);
+            if (!fresh[i]) {
+                for (int j = 0; j < i; j++) heap_caps_free(fresh[j]);
+                ESP_LOGE(TAG, "Channel %d: no memory for %u px", ch, map->n_pixels);
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    px_rgba_t *drop[JB_SLOTS] = { NULL };
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) {
+        for (int i = 0; i < JB_SLOTS; i++) heap_caps_free(fresh[i]);
+        return ESP_FAIL;
+    }
+    stream_ch_t *c = &s_ch[ch];
+    // The consumer may still be sending the front buffer: it frees the old
+    // set on its next take. Buffers it has never seen can go now.
+    if (!s_consumer || c->retired[0]) {
+        memcpy(drop, c->buf, sizeof(drop));
+    } else {
+        memcpy(c->retired, c->buf, sizeof(c->retired));
+    }
+    memset(c, 0, offsetof(stream_ch_t, retired));
+    c->map = *map;
+    memcpy(c->buf, fresh, sizeof(c->buf));
+    c->n_slots = (uint8_t)n_slots;
+    c->cap = (uint8_t)cap;
+    c->back = 0;
+    c->front = 1;
+    c->universe_bytes = map->rgbw ? 512 : 510;
+    c->n_universes = (uint16_t)((ch_bytes(c) + c->universe_bytes - 1) / c->universe_bytes);
+    s_map_gen++;
+    xSemaphoreGive(s_lock);
+    net_io_wake();
+
+    for (int i = 0; i < JB_SLOTS; i++) heap_caps_free(drop[i]);
+    return ESP_OK;
+}
+
+bool pixel_stream_get_map(int ch, pixel_stream_map_t *out) {
+    if (ch < 0 || ch >= PIXEL_STREAM_CHANNELS || !out) return false;
+    *out = s_ch[ch].map;
+    return true;
+}
+
+bool pixel_stream_active(int ch) {
+    return ch >= 0 && ch < PIXEL_STREAM_CHANNELS && s_ch[ch].map.n_pixels > 0;
+}
+
+void pixel_stream_set_consumer(TaskHandle_t task) {
+    s_consumer = task;
+}
+
+void pixel_stream_get_stats(pixel_stream_stats_t *out) {
+    if (!out) return;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        *out = s_stats;
+        for (int i = 0; i < PIXEL_STREAM_CHANNELS; i++) {
+            out->ch[i] = s_ch[i].st;
+            out->ch[i].depth = s_ch[i].depth;
+            out->ch[i].period_ms = s_ch[i].period_ms;
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+void pixel_stream_set_dmx(pixel_stream_dmx_fn fn, uint16_t first, uint16_t count) {
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return;
+    s_dmx_fn = count ? fn : NULL;
+    s_dmx_first = first;
+    s_dmx_count = fn ? count : 0;
+    s_map_gen++;
+    xSemaphoreGive(s_lock);
+    net_io_wake();
+}
+
+// sACN multicast: 239.255.<universe hi>.<universe lo>. Memberships follow
+// the map; the E1.31 poll rejoins whenever it changes.
+static void join_universe(int h, uint16_t u) {
+    if (s_n_joined < MAX_JOINED && net_io_join(h, htonl(0xEFFF0000u | u), true) == ESP_OK) {
+        s_joined[s_n_joined++] = u;
+    }
+}
+
+static void join_universes(int h) {
+    for (int i = 0; i < s_n_joined; i++) {
+        net_io_join(h, htonl(0xEFFF0000u | s_joined[i]), false);
+    }
+    s_n_joined = 0;
+    for (int ch = 0; ch < PIXEL_STREAM_CHANNELS; ch++) {
+        const stream_ch_t *c = &s_ch[ch];
+        for (int k = 0; c->map.n_pixels && k < c->n_universes; k++) {
+            join_universe(h, (uint16_t)(c->map.universe + k));
+        }
+    }
+    for (uint16_t k = 0; s_dmx_fn && k < s_dmx_count; k++) {
+        join_universe(h, (uint16_t)(s_dmx_first + k));
+    }
+}
+
+static void pixel_stream_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                            int64_t rx_us, void *ctx) {
+    pixel_stream_handle((pixel_stream_proto_t)(intptr_t)ctx, buf, len, (uint32_t)(rx_us / 1000));
+}
+
+// Runs on the net_io task every round; set_map and set_dmx wake it.
+static int64_t pixel_stream_poll(int64_t now_us, void *ctx) {
+    uint32_t gen = s_map_gen;
+    if (gen != s_joined_gen && s_net[PIXEL_STREAM_E131] >= 0) {
+        s_joined_gen = gen;
+        join_universes(s_net[PIXEL_STREAM_E131]);
+    }
+    return NET_IO_NEVER;
+}
+
+esp_err_t pixel_stream_start(void) {
+    static const net_io_proto_t PROTOS[PIXEL_STREAM_PROTOS] = {
+        { .name = "ddp",    .port = PIXEL_STREAM_PORT_DDP,    .rx = pixel_stream_rx,
+          .ctx = (void *)(intptr_t)PIXEL_STREAM_DDP },
+        { .name = "e131",   .port = PIXEL_STREAM_PORT_E131,   .rx = pixel_stream_rx,
+          .poll = pixel_stream_poll, .ctx = (void *)(intptr_t)PIXEL_STREAM_E131 },
+        { .name = "artnet", .port = PIXEL_STREAM_PORT_ARTNET, .rx = pixel_stream_rx,
+          .ctx = (void *)(intptr_t)PIXEL_STREAM_ARTNET },
+    };
+    ensure_lock();
+    int ok = 0;
+    for (int p = 0; p < PIXEL_STREAM_PROTOS; p++) {
+        if (s_net[p] < 0) s_net[p] = net_io_register(&PROTOS[p]);
+        if (s_net[p] >= 0) ok++;
+    }
+    s_n_joined = 0;
+    s_joined_gen = s_map_gen - 1;
+    net_io_wake();
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+void pixel_stream_stop(void) {
+    for (int p = 0; p < PIXEL_STREAM_PROTOS; p++) {
+        net_io_unregister(s_net[p]);
+        s_net[p] = -1;
+    }
+}
@@ -3,6 +3,8 @@
 #include "esp_err.h"
 #include "esp_http_server.h"
 #include "effects.h"
+#include "fx_calib.h"
+#include "pca9685_curve.h"
 #include "rest_api_types.h"
 
 #include <stdbool.h>
@@ -17,6 +19,16 @@ typedef struct {
   int  (*channel_count)(void);
   bool (*get_channel_info)(int ch, led_type_t *type, color_order_t *order, uint16_t *n_pixels);
   bool (*set_channel_type)(int ch, led_type_t type, color_order_t order);
+  bool (*set_channel_output)(int ch, bool hdr, uint16_t max_fps);
+  void (*get_fps)(uint16_t *out, size_t len);
+  void (*get_hdr)(bool *on, bool *failed, size_t len);
+  bool (*set_channel_calib)(int ch, const fx_calib_cfg_t *cfg);
+  bool (*get_channel_calib)(int ch, fx_calib_cfg_t *out);
+  bool (*set_channel_canvas)(int ch, const fx_canvas_t *canvas);  // NULL = off
+  bool (*get_channel_canvas)(int ch, fx_canvas_t *out);
+  int  (*pwm_group_channel)(const char *group);   // engine channel driving a PWM group
+  void (*release_pwm_group)(const char *group);   // NULL = all groups
+  bool (*schedule_base)(int ch, const effect_params_t *params, uint32_t fade_ms, uint32_t at_ms);
 } rest_api_effect_ops_t;
 
 typedef struct {
@@ -29,13 +41,212 @@ typedef struct {
   void (*replace_groups)(const pwm_group_t *groups, int count);
   void (*group_set_rgb)(const char* name, float r, float g, float b);
   void (*group_set_rgbw)(const char* name, float r, float g, float b, float w);
+  void (*set_load_mA)(uint8_t ch, float mA);
+  float (*get_load_mA)(uint8_t ch);
+  void (*fade_to)(uint8_t ch, float duty, uint32_t duration_ms, bool log_curve);
+  void (*group_fade)(const char* name, float r, float g, float b, float w, uint32_t fade_ms);
+  void (*set_soft_start_ms)(uint8_t ch, uint32_t ms);
+  uint32_t (*get_soft_start_ms)(uint8_t ch);
+  void (*set_curve)(uint8_t ch, const pca9685_curve_cfg_t *cfg);
+  bool (*get_curve)(uint8_t ch, pca9685_curve_cfg_t *out);
+  int  (*channel_count)(void);
+  void (*blackout)(void);
+  void (*set_dither)(uint8_t ch, bool on);
+  bool (*get_dither)(uint8_t ch);
+  void (*set_dither_budget)(uint32_t bytes_per_s);
+  uint32_t (*get_dither_budget)(void);
 } rest_api_pwm_ops_t;
 
+typedef struct {
+  float    aled_mA;          // steady ALED limit
+  float    psu_mA;           // supply rating incl. PWM loads
+  float    burst_mA;         // short-term ALED ceiling
+  uint32_t burst_window_ms;  // averaging window for the steady limit
+} rest_api_power_limits_t;
+
+typedef struct {
+  void  (*set_limits)(const rest_api_power_limits_t *limits);  // fields <= 0 are kept
+  void  (*get_limits)(rest_api_power_limits_t *out);
+  void  (*set_weight)(int ch, float weight);
+  float (*get_weight)(int ch);
+  void  (*set_led_mA)(int ch, float mA_per_led);
+  float (*get_led_mA)(int ch);
+  void  (*get_channel_mA)(float *out, size_t len);
+  float (*total_mA)(void);
+  float (*window_mA)(void);
+} rest_api_power_ops_t;
+
 typedef struct {
   void (*set_beat)(float phase01);
+  void (*set_tempo)(float bpm);
   void (*strobe)(uint32_t ms);
 } rest_api_trigger_ops_t;
 
+typedef struct {
+  uint32_t addr;        // IPv4, network order
+  uint32_t received;
+  uint32_t lost;
+  uint32_t reordered;
+  float    jitter_us;
+} rest_api_sync_master_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t keyframes;
+  uint32_t packets;
+  uint32_t raw_bytes;
+  uint32_t wire_bytes;
+  uint32_t dropped;
+  uint32_t malformed;
+  uint32_t restarts;
+} rest_api_frame_cast_stats_t;
+
+typedef struct {
+  void     (*set_tick_hz)(uint32_t hz);
+  uint32_t (*get_tick_hz)(void);
+  uint32_t (*scene_gen)(void);
+  int      (*masters)(rest_api_sync_master_t *out, int max);
+  int64_t  (*now_us)(void);
+  // Multicasts a cue to the slaves; false unless this node is a sync master.
+  bool     (*send_cue)(const char *target, const char *preset, uint32_t preset_crc,
+                       uint32_t fade_ms, int64_t t0_us, uint32_t *cue_id);
+  // "Master", "Slave" or "Standalone"; set_role persists it across reboots.
+  bool        (*set_role)(const char *role);
+  const char *(*get_role)(void);
+  // Rendered-frame broadcast: "off", "send" or "receive".
+  bool        (*set_frame_cast)(const char *mode);
+  const char *(*get_frame_cast)(void);
+  void        (*frame_cast_stats)(rest_api_frame_cast_stats_t *out);
+} rest_api_sync_ops_t;
+
+typedef struct {
+  uint16_t pixels;      // 0 = channel renders effects
+  uint16_t universe;    // first E1.31/Art-Net universe
+  uint32_t ddp_offset;  // first byte in the DDP address space
+  uint16_t latency_ms;  // jitter buffer playout delay
+  bool     conceal_blend;
+} rest_api_stream_map_t;
+
+typedef struct {
+  int      ch;
+  uint8_t  depth;
+  float    period_ms;
+  uint32_t shown;
+  uint32_t late;
+  uint32_t dropped;
+  uint32_t concealed;
+} rest_api_stream_channel_t;
+
+typedef struct {
+  uint32_t packets_ddp;
+  uint32_t packets_e131;
+  uint32_t packets_artnet;
+  uint32_t bad;
+  uint32_t frames;
+  uint32_t late;
+  uint32_t dropped;
+  uint32_t concealed;
+} rest_api_stream_stats_t;
+
+typedef struct {
+  bool (*set_map)(int ch, const rest_api_stream_map_t *map);
+  bool (*get_map)(int ch, rest_api_stream_map_t *out);
+  void (*get_stats)(rest_api_stream_stats_t *out);
+  int  (*channels)(rest_api_stream_channel_t *out, int max);  // mapped channels only
+} rest_api_stream_ops_t;
+
+typedef struct {
+  uint16_t universe;
+  uint16_t slot;        // 1-based
+  char     field[12];   // level8, level16, rgb, rgbw, effect, speed, ...
+  char     target[32];  // LEDchN, group:<name> or ALEDchN
+} rest_api_dmx_slot_t;
+
+typedef struct {
+  uint32_t universes;
+  uint32_t unchanged;
+  uint32_t pwm_writes;
+  uint32_t group_writes;
+  uint32_t effect_updates;
+} rest_api_dmx_stats_t;
+
+typedef struct {
+  bool (*set_table)(const rest_api_dmx_slot_t *slots, int n);  // all or nothing
+  int  (*get_table)(rest_api_dmx_slot_t *out, int max);
+  void (*get_stats)(rest_api_dmx_stats_t *out);
+} rest_api_dmx_ops_t;
+
+typedef struct {
+  uint16_t pixels;      // 0 = off
+  bool     rgbw;
+  char     host[16];    // receiver IPv4, dotted quad
+  uint16_t port;        // 0 = 4048
+  uint32_t offset;      // first byte in the receiver's DDP address space
+} rest_api_ddp_channel_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t packets;
+  uint32_t busy;        // frames dropped while the previous one was going out
+  uint32_t errors;
+} rest_api_ddp_stats_t;
+
+typedef struct {
+  int  (*channel)(int v);   // engine channel behind "DDPchN"
+  bool (*set_channel)(int v, const rest_api_ddp_channel_t *cfg);
+  bool (*get_channel)(int v, rest_api_ddp_channel_t *out);
+  void (*get_stats)(int v, rest_api_ddp_stats_t *out);
+} rest_api_ddp_ops_t;
+
+typedef struct {
+  uint32_t at_ms;       // show time
+  uint32_t fade_ms;
+  char     target[24];  // ALEDchN, DDPchN or group:<name>
+  char     preset[24];
+} rest_api_timecode_cue_t;
+
+typedef struct {
+  const char *state;    // stopped, locked, freewheel
+  const char *source;   // none, mtc, osc
+  const char *fps;      // 24, 25, 29.97df, 30
+  char     label[12];   // hh:mm:ss:ff at the playhead
+  uint32_t playhead_ms;
+  float    speed;
+  float    jitter_ms;
+  uint32_t samples;
+  uint32_t outliers;
+  uint32_t jumps;
+  uint32_t dropouts;
+  uint32_t cues_fired;
+  uint32_t malformed;
+  uint16_t port;        // MTC session port, 0 = off
+} rest_api_timecode_status_t;
+
+typedef struct {
+  void     (*get_status)(rest_api_timecode_status_t *out);
+  bool     (*set_cues)(const rest_api_timecode_cue_t *cues, int n);  // all or nothing
+  int      (*get_cues)(rest_api_timecode_cue_t *out, int max);
+  void     (*set_freewheel_ms)(uint32_t ms);
+  uint32_t (*get_freewheel_ms)(void);
+} rest_api_timecode_ops_t;
+
+typedef struct {
+  bool     live;
+  uint16_t port;        // 0 = off
+  uint32_t packets;
+  uint32_t malformed;
+  uint32_t lost;
+  uint32_t stale;
+  uint32_t restarts;
+  uint32_t beat_snaps;
+  float    level;       // 0..1 now
+  float    tempo_bpm;   // 0 = no beat
+} rest_api_audio_stats_t;
+
+typedef struct {
+  void (*get_stats)(rest_api_audio_stats_t *out);
+} rest_api_audio_ops_t;
+
 esp_err_t rest_api_start(void);
 httpd_handle_t rest_api_get_server(void);
 void rest_api_init(void);
@@ -43,3 +254,16 @@ void rest_api_init(void);
 void rest_api_register_effect_ops(const rest_api_effect_ops_t *ops);
 void rest_api_register_pwm_ops(const rest_api_pwm_ops_t *ops);
 void rest_api_register_trigger_ops(const rest_api_trigger_ops_t *ops);
+void rest_api_register_power_ops(const rest_api_power_ops_t *ops);
+void rest_api_register_sync_ops(const rest_api_sync_ops_t *ops);
+void rest_api_register_stream_ops(const rest_api_stream_ops_t *ops);
+void rest_api_register_dmx_ops(const rest_api_dmx_ops_t *ops);
+void rest_api_register_ddp_ops(const rest_api_ddp_ops_t *ops);
+void rest_api_register_timecode_ops(const rest_api_timecode_ops_t *ops);
+void rest_api_register_audio_ops(const rest_api_audio_ops_t *ops);
+
+// Loads a preset now and schedules it on target ("ALEDchN", "DDPchN", "group:<name>")
+// for sync time at_ms. A non-zero preset_crc must match the file's CRC32
+// (ESP_ERR_INVALID_CRC otherwise); crc_out receives it.
+esp_err_t rest_api_play_cue(const char *target, const char *preset, uint32_t preset_crc,
+                            uint32_t fade_ms, uint32_t at_ms, uint32_t *crc_out);
@@ -2,6 +2,9 @@
 
 #include <stdint.h>
 
+#define PWM_MAX_CHANNELS  64   // logical LEDch outputs across all PCA9685 chips
+#define PWM_MAX_GROUPS    16
+
 typedef enum {
   PWMG_RGB = 0,
   PWMG_RGBW = 1
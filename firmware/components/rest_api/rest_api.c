@@ -3,6 +3,7 @@
 #include "cJSON.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 
@@ -25,18 +26,34 @@
 
 #define PRESET_DIR        "/spiffs/presets"
 #define MAX_BODY_LENGTH   4096
+#define CUE_LEAD_MS       250
+#define CUE_NAME_LEN      24
 #define MAX_NAME_LENGTH   48
 #define SSE_INTERVAL_MS   250
+#define DMX_MAX_SLOTS     64
+#define TC_MAX_CUES       64
 
 #define EFFECT_CHANNELS   8
+#define DDP_CHANNELS      8
 
 static rest_api_effect_ops_t  s_effect_ops   = {0};
 static rest_api_pwm_ops_t     s_pwm_ops      = {0};
 static rest_api_trigger_ops_t s_trigger_ops  = {0};
+static rest_api_power_ops_t   s_power_ops    = {0};
+static rest_api_sync_ops_t    s_sync_ops     = {0};
+static rest_api_stream_ops_t  s_stream_ops   = {0};
+static rest_api_dmx_ops_t     s_dmx_ops      = {0};
+static rest_api_ddp_ops_t     s_ddp_ops      = {0};
+static rest_api_timecode_ops_t s_tc_ops      = {0};
+static rest_api_audio_ops_t   s_audio_ops    = {0};
 
 static const char *TAG = "REST_API";
 static httpd_handle_t s_server = NULL;
 
+static int pwm_channels(void){
+  return s_pwm_ops.channel_count ? s_pwm_ops.channel_count() : 8;
+}
+
 static const char* strip_type_to_string(led_type_t type){
   switch (type){
     case LED_SK6812_RGBW: return "SK6812_RGBW";
@@ -186,6 +203,35 @@ static px_rgba_t json_to_color(const cJSON *node, px_rgba_t fallback){
   return c;
 }
 
+// Accepts either a scalar (applied to r,g,b,w) or {"r":..,"g":..,"b":..,"w":..}.
+static void json_to_rgbw_floats(const cJSON *node, float out[4]){
+  if (cJSON_IsNumber(node)){
+    for (int k = 0; k < 4; ++k){
+      out[k] = (float)node->valuedouble;
+    }
+    return;
+  }
+  if (!cJSON_IsObject(node)){
+    return;
+  }
+  static const char *const KEYS[4] = {"r", "g", "b", "w"};
+  for (int k = 0; k < 4; ++k){
+    cJSON *v = cJSON_GetObjectItemCaseSensitive(node, KEYS[k]);
+    if (cJSON_IsNumber(v)){
+      out[k] = (float)v->valuedouble;
+    }
+  }
+}
+
+static cJSON* rgbw_floats_to_json(const float in[4]){
+  cJSON *o = cJSON_CreateObject();
+  cJSON_AddNumberToObject(o, "r", in[0]);
+  cJSON_AddNumberToObject(o, "g", in[1]);
+  cJSON_AddNumberToObject(o, "b", in[2]);
+  cJSON_AddNumberToObject(o, "w", in[3]);
+  return o;
+}
+
 static bool json_to_effect(const cJSON *json, effect_params_t *out){
   if (!json || !cJSON_IsObject(json) || !out){
     return false;
@@ -225,7 +271,9 @@ static bool json_to_effect(const cJSON *json, effect_params_t *out){
   return true;
 }
 
-static esp_err_t load_preset(const char *name, effect_params_t *out){
+// crc (optional) receives the CRC32 of the preset file, the identity cues
+// use to check every node holds the same version.
+static esp_err_t load_preset(const char *name, effect_params_t *out, uint32_t *crc){
   if (!is_safe_token(name) || !out){
     return ESP_ERR_INVALID_ARG;
   }
@@ -246,6 +294,9 @@ static esp_err_t load_preset(const char *name, effect_params_t *out){
   size_t n = fread(buf, 1, MAX_BODY_LENGTH - 1, f);
   fclose(f);
   buf[n] = '\0';
+  if (crc){
+    *crc = esp_rom_crc32_le(0, (const uint8_t *)buf, n);
+  }
 
   cJSON *json = cJSON_Parse(buf);
   free(buf);
@@ -313,6 +364,19 @@ static int parse_channel(const char *target, const char *prefix, int max){
   return (int)(idx - 1);
 }
 
+// "ALEDchN", "DDPchN" or "group:<name>" (claims the group for the engine).
+static int effect_target_channel(const char *target){
+  int ch = parse_channel(target, "ALEDch", EFFECT_CHANNELS);
+  int ddp = parse_channel(target, "DDPch", DDP_CHANNELS);
+  if (ch < 0 && ddp >= 0 && s_ddp_ops.channel){
+    ch = s_ddp_ops.channel(ddp);
+  }
+  if (ch < 0 && target && strncmp(target, "group:", 6) == 0 && s_effect_ops.pwm_group_channel){
+    ch = s_effect_ops.pwm_group_channel(target + 6);
+  }
+  return ch;
+}
+
 static esp_err_t json_reply(httpd_req_t *req, cJSON *root){
   char *buf = cJSON_PrintUnformatted(root);
   if (!buf){
@@ -331,7 +395,7 @@ static esp_err_t json_reply(httpd_req_t *req, cJSON *root){
 static esp_err_t get_status_handler(httpd_req_t *req){
   cJSON *root = cJSON_CreateObject();
   cJSON_AddStringToObject(root, "node_type", "led-node");
-  cJSON_AddStringToObject(root, "role", "Slave");
+  cJSON_AddStringToObject(root, "role", s_sync_ops.get_role ? s_sync_ops.get_role() : "Slave");
   cJSON_AddNumberToObject(root, "uptime_ms", esp_timer_get_time() / 1000ULL);
 
   float power_scale[EFFECT_CHANNELS];
@@ -348,6 +412,15 @@ static esp_err_t get_status_handler(httpd_req_t *req){
       break;
     }
   }
+  float channel_mA[EFFECT_CHANNELS] = {0};
+  if (s_power_ops.get_channel_mA){
+    s_power_ops.get_channel_mA(channel_mA, EFFECT_CHANNELS);
+  }
+  bool hdr_on[EFFECT_CHANNELS] = {0};
+  bool hdr_failed[EFFECT_CHANNELS] = {0};
+  if (s_effect_ops.get_hdr){
+    s_effect_ops.get_hdr(hdr_on, hdr_failed, EFFECT_CHANNELS);
+  }
 
   int ch_total = EFFECT_CHANNELS;
   if (s_effect_ops.channel_count){
@@ -373,16 +446,23 @@ static esp_err_t get_status_handler(httpd_req_t *req){
       cJSON_AddStringToObject(a, "order", order_to_string(order));
       if (i < EFFECT_CHANNELS){
         cJSON_AddNumberToObject(a, "power_scale", power_scale[i]);
+        cJSON_AddNumberToObject(a, "mA", channel_mA[i]);
+        cJSON_AddBoolToObject(a, "hdr", hdr_on[i]);
+        cJSON_AddBoolToObject(a, "hdr_failed", hdr_failed[i]);
       }
       cJSON_AddItemToArray(aled, a);
     }
   }
 
+  uint16_t measured_fps[EFFECT_CHANNELS] = {0};
+  if (s_effect_ops.get_fps){
+    s_effect_ops.get_fps(measured_fps, EFFECT_CHANNELS);
+  }
   cJSON *fps = cJSON_AddObjectToObject(root, "fps");
   for (int i = 0; i < ch_total; ++i){
     char key[24];
     snprintf(key, sizeof(key), "aled_ch%d", i + 1);
-    cJSON_AddNumberToObject(fps, key, 60);
+    cJSON_AddNumberToObject(fps, key, i < EFFECT_CHANNELS ? measured_fps[i] : 0);
   }
 
   cJSON *pg = cJSON_AddArrayToObject(root, "pwm_groups");
@@ -400,7 +480,141 @@ static esp_err_t get_status_handler(httpd_req_t *req){
   }
 
   cJSON_AddBoolToObject(root, "power_limit_active", limit);
+  if (s_power_ops.total_mA){
+    cJSON_AddNumberToObject(root, "power_mA", s_power_ops.total_mA());
+  }
+  if (s_power_ops.window_mA){
+    cJSON_AddNumberToObject(root, "power_avg_mA", s_power_ops.window_mA());
+  }
   cJSON_AddNumberToObject(root, "pwm_max_duty", 0.85);
+  if (s_stream_ops.get_stats){
+    rest_api_stream_stats_t st;
+    s_stream_ops.get_stats(&st);
+    cJSON *stream = cJSON_AddObjectToObject(root, "stream");
+    cJSON_AddNumberToObject(stream, "packets_ddp", st.packets_ddp);
+    cJSON_AddNumberToObject(stream, "packets_e131", st.packets_e131);
+    cJSON_AddNumberToObject(stream, "packets_artnet", st.packets_artnet);
+    cJSON_AddNumberToObject(stream, "bad", st.bad);
+    cJSON_AddNumberToObject(stream, "frames", st.frames);
+    cJSON_AddNumberToObject(stream, "late", st.late);
+    cJSON_AddNumberToObject(stream, "dropped", st.dropped);
+    cJSON_AddNumberToObject(stream, "concealed", st.concealed);
+    if (s_stream_ops.channels){
+      cJSON *chans = cJSON_AddArrayToObject(stream, "channels");
+      rest_api_stream_channel_t c[8];
+      int n = s_stream_ops.channels(c, 8);
+      for (int i = 0; i < n; ++i){
+        cJSON *e = cJSON_CreateObject();
+        cJSON_AddNumberToObject(e, "ch", c[i].ch + 1);
+        cJSON_AddNumberToObject(e, "depth", c[i].depth);
+        cJSON_AddNumberToObject(e, "period_ms", c[i].period_ms);
+        cJSON_AddNumberToObject(e, "shown", c[i].shown);
+        cJSON_AddNumberToObject(e, "late", c[i].late);
+        cJSON_AddNumberToObject(e, "dropped", c[i].dropped);
+        cJSON_AddNumberToObject(e, "concealed", c[i].concealed);
+        cJSON_AddItemToArray(chans, e);
+      }
+    }
+  }
+  if (s_ddp_ops.get_channel && s_ddp_ops.get_stats){
+    cJSON *ddp = cJSON_AddArrayToObject(root, "ddp_out");
+    for (int i = 0; i < DDP_CHANNELS; ++i){
+      rest_api_ddp_channel_t cfg;
+      if (!s_ddp_ops.get_channel(i, &cfg) || !cfg.pixels){
+        continue;
+      }
+      rest_api_ddp_stats_t st;
+      s_ddp_ops.get_stats(i, &st);
+      cJSON *e = cJSON_CreateObject();
+      cJSON_AddNumberToObject(e, "ch", i + 1);
+      cJSON_AddNumberToObject(e, "frames", st.frames);
+      cJSON_AddNumberToObject(e, "packets", st.packets);
+      cJSON_AddNumberToObject(e, "busy", st.busy);
+      cJSON_AddNumberToObject(e, "errors", st.errors);
+      cJSON_AddItemToArray(ddp, e);
+    }
+  }
+  if (s_sync_ops.now_us){
+    cJSON_AddNumberToObject(root, "sync_ms", (double)(s_sync_ops.now_us() / 1000));
+  }
+  if (s_tc_ops.get_status){
+    rest_api_timecode_status_t st;
+    s_tc_ops.get_status(&st);
+    cJSON *tc = cJSON_AddObjectToObject(root, "timecode");
+    cJSON_AddStringToObject(tc, "state", st.state);
+    cJSON_AddStringToObject(tc, "source", st.source);
+    cJSON_AddStringToObject(tc, "fps", st.fps);
+    cJSON_AddStringToObject(tc, "label", st.label);
+    cJSON_AddNumberToObject(tc, "playhead_ms", st.playhead_ms);
+    cJSON_AddNumberToObject(tc, "speed", st.speed);
+    cJSON_AddNumberToObject(tc, "jitter_ms", st.jitter_ms);
+    cJSON_AddNumberToObject(tc, "samples", st.samples);
+    cJSON_AddNumberToObject(tc, "outliers", st.outliers);
+    cJSON_AddNumberToObject(tc, "jumps", st.jumps);
+    cJSON_AddNumberToObject(tc, "dropouts", st.dropouts);
+    cJSON_AddNumberToObject(tc, "cues_fired", st.cues_fired);
+    cJSON_AddNumberToObject(tc, "malformed", st.malformed);
+    cJSON_AddNumberToObject(tc, "port", st.port);
+  }
+  if (s_audio_ops.get_stats){
+    rest_api_audio_stats_t st;
+    s_audio_ops.get_stats(&st);
+    cJSON *audio = cJSON_AddObjectToObject(root, "audio");
+    cJSON_AddBoolToObject(audio, "live", st.live);
+    cJSON_AddNumberToObject(audio, "port", st.port);
+    cJSON_AddNumberToObject(audio, "level", st.level);
+    cJSON_AddNumberToObject(audio, "tempo_bpm", st.tempo_bpm);
+    cJSON_AddNumberToObject(audio, "packets", st.packets);
+    cJSON_AddNumberToObject(audio, "malformed", st.malformed);
+    cJSON_AddNumberToObject(audio, "lost", st.lost);
+    cJSON_AddNumberToObject(audio, "stale", st.stale);
+    cJSON_AddNumberToObject(audio, "restarts", st.restarts);
+    cJSON_AddNumberToObject(audio, "beat_snaps", st.beat_snaps);
+  }
+  if (s_dmx_ops.get_stats){
+    rest_api_dmx_stats_t st;
+    s_dmx_ops.get_stats(&st);
+    cJSON *dmx = cJSON_AddObjectToObject(root, "dmx");
+    cJSON_AddNumberToObject(dmx, "universes", st.universes);
+    cJSON_AddNumberToObject(dmx, "unchanged", st.unchanged);
+    cJSON_AddNumberToObject(dmx, "pwm_writes", st.pwm_writes);
+    cJSON_AddNumberToObject(dmx, "group_writes", st.group_writes);
+    cJSON_AddNumberToObject(dmx, "effect_updates", st.effect_updates);
+  }
+  if (s_sync_ops.masters){
+    cJSON *sync = cJSON_AddObjectToObject(root, "sync");
+    if (s_sync_ops.scene_gen){
+      cJSON_AddNumberToObject(sync, "scene_gen", s_sync_ops.scene_gen());
+    }
+    if (s_sync_ops.frame_cast_stats && s_sync_ops.get_frame_cast){
+      rest_api_frame_cast_stats_t st;
+      s_sync_ops.frame_cast_stats(&st);
+      cJSON *fc = cJSON_AddObjectToObject(sync, "frame_cast");
+      cJSON_AddStringToObject(fc, "mode", s_sync_ops.get_frame_cast());
+      cJSON_AddNumberToObject(fc, "frames", st.frames);
+      cJSON_AddNumberToObject(fc, "keyframes", st.keyframes);
+      cJSON_AddNumberToObject(fc, "packets", st.packets);
+      cJSON_AddNumberToObject(fc, "ratio", st.raw_bytes ? (double)st.wire_bytes / st.raw_bytes : 0.0);
+      cJSON_AddNumberToObject(fc, "dropped", st.dropped);
+      cJSON_AddNumberToObject(fc, "malformed", st.malformed);
+      cJSON_AddNumberToObject(fc, "restarts", st.restarts);
+    }
+    cJSON *masters = cJSON_AddArrayToObject(sync, "masters");
+    rest_api_sync_master_t m[4];
+    int n = s_sync_ops.masters(m, 4);
+    for (int i = 0; i < n; ++i){
+      cJSON *e = cJSON_CreateObject();
+      char ip[16];
+      const uint8_t *a = (const uint8_t *)&m[i].addr;
+      snprintf(ip, sizeof(ip), "%u.%u.%u.%u", a[0], a[1], a[2], a[3]);
+      cJSON_AddStringToObject(e, "addr", ip);
+      cJSON_AddNumberToObject(e, "received", m[i].received);
+      cJSON_AddNumberToObject(e, "lost", m[i].lost);
+      cJSON_AddNumberToObject(e, "reordered", m[i].reordered);
+      cJSON_AddNumberToObject(e, "jitter_us", m[i].jitter_us);
+      cJSON_AddItemToArray(masters, e);
+    }
+  }
   cJSON_AddNullToObject(root, "last_error");
   cJSON_AddNumberToObject(root, "heap_free_kb", esp_get_free_heap_size() / 1024);
 
@@ -452,6 +666,35 @@ static esp_err_t get_config_handler(httpd_req_t *req){
         cJSON_AddNumberToObject(a, "pixels", pixels);
         cJSON_AddStringToObject(a, "strip_type", strip_type_to_string(type));
         cJSON_AddStringToObject(a, "order", order_to_string(order));
+        fx_calib_cfg_t calib;
+        if (s_effect_ops.get_channel_calib && s_effect_ops.get_channel_calib(i, &calib)){
+          cJSON_AddItemToObject(a, "gamma", rgbw_floats_to_json(calib.gamma));
+          cJSON_AddItemToObject(a, "white_point", rgbw_floats_to_json(calib.white_point));
+          cJSON_AddNumberToObject(a, "white_mix", calib.white_mix);
+          cJSON_AddNumberToObject(a, "white_gain", calib.white_gain);
+        }
+        if (s_power_ops.get_weight){
+          cJSON_AddNumberToObject(a, "power_weight", s_power_ops.get_weight(i));
+        }
+        if (s_power_ops.get_led_mA){
+          cJSON_AddNumberToObject(a, "mA_per_led", s_power_ops.get_led_mA(i));
+        }
+        fx_canvas_t canvas;
+        if (s_effect_ops.get_channel_canvas && s_effect_ops.get_channel_canvas(i, &canvas) && canvas.size){
+          cJSON *cv = cJSON_AddObjectToObject(a, "canvas");
+          cJSON_AddNumberToObject(cv, "offset", canvas.offset);
+          cJSON_AddNumberToObject(cv, "size", canvas.size);
+          cJSON_AddNumberToObject(cv, "seed", canvas.seed);
+        }
+        rest_api_stream_map_t sm;
+        if (s_stream_ops.get_map && s_stream_ops.get_map(i, &sm) && sm.pixels){
+          cJSON *st = cJSON_AddObjectToObject(a, "stream");
+          cJSON_AddNumberToObject(st, "pixels", sm.pixels);
+          cJSON_AddNumberToObject(st, "universe", sm.universe);
+          cJSON_AddNumberToObject(st, "ddp_offset", sm.ddp_offset);
+          cJSON_AddNumberToObject(st, "latency_ms", sm.latency_ms);
+          cJSON_AddStringToObject(st, "conceal", sm.conceal_blend ? "blend" : "repeat");
+        }
         cJSON_AddItemToArray(aled, a);
       }
     }
@@ -478,6 +721,103 @@ static esp_err_t get_config_handler(httpd_req_t *req){
     }
   }
 
+  if (s_pwm_ops.get_load_mA){
+    cJSON *pwm = cJSON_AddArrayToObject(root, "pwm");
+    int pwm_count = pwm_channels();
+    for (int i = 0; i < pwm_count; ++i){
+      cJSON *p = cJSON_CreateObject();
+      cJSON_AddNumberToObject(p, "ch", i + 1);
+      cJSON_AddNumberToObject(p, "load_mA", s_pwm_ops.get_load_mA((uint8_t)i));
+      if (s_pwm_ops.get_soft_start_ms){
+        cJSON_AddNumberToObject(p, "soft_start_ms", s_pwm_ops.get_soft_start_ms((uint8_t)i));
+      }
+      if (s_pwm_ops.get_dither){
+        cJSON_AddBoolToObject(p, "dither", s_pwm_ops.get_dither((uint8_t)i));
+      }
+      pca9685_curve_cfg_t curve;
+      if (s_pwm_ops.get_curve && s_pwm_ops.get_curve((uint8_t)i, &curve)){
+        cJSON_AddStringToObject(p, "curve", pca9685_curve_kind_name(curve.kind));
+        cJSON_AddNumberToObject(p, "max_duty", curve.max_duty);
+        if (curve.kind == PCA9685_CURVE_CUSTOM){
+          cJSON *pts = cJSON_AddArrayToObject(p, "curve_points");
+          for (int k = 0; k < curve.n_points; ++k){
+            cJSON_AddItemToArray(pts, cJSON_CreateNumber(curve.points[k]));
+          }
+        }
+      }
+      cJSON_AddItemToArray(pwm, p);
+    }
+  }
+  if (s_pwm_ops.get_dither_budget){
+    cJSON_AddNumberToObject(root, "pwm_dither_Bps", s_pwm_ops.get_dither_budget());
+  }
+  if (s_sync_ops.get_role){
+    cJSON_AddStringToObject(root, "role", s_sync_ops.get_role());
+  }
+  if (s_sync_ops.get_tick_hz){
+    cJSON_AddNumberToObject(root, "sync_tick_hz", s_sync_ops.get_tick_hz());
+  }
+  if (s_sync_ops.get_frame_cast){
+    cJSON_AddStringToObject(root, "frame_cast", s_sync_ops.get_frame_cast());
+  }
+  if (s_ddp_ops.get_channel){
+    cJSON *ddp = cJSON_AddArrayToObject(root, "ddp_out");
+    for (int i = 0; i < DDP_CHANNELS; ++i){
+      rest_api_ddp_channel_t cfg;
+      if (!s_ddp_ops.get_channel(i, &cfg) || !cfg.pixels){
+        continue;
+      }
+      cJSON *e = cJSON_CreateObject();
+      cJSON_AddNumberToObject(e, "ch", i + 1);
+      cJSON_AddNumberToObject(e, "pixels", cfg.pixels);
+      cJSON_AddStringToObject(e, "strip_type", strip_type_to_string(cfg.rgbw ? LED_SK6812_RGBW : LED_WS2812B));
+      cJSON_AddStringToObject(e, "host", cfg.host);
+      cJSON_AddNumberToObject(e, "port", cfg.port ? cfg.port : 4048);
+      cJSON_AddNumberToObject(e, "offset", cfg.offset);
+      cJSON_AddItemToArray(ddp, e);
+    }
+  }
+  if (s_dmx_ops.get_table){
+    rest_api_dmx_slot_t *slots = calloc(DMX_MAX_SLOTS, sizeof(*slots));
+    int n = slots ? s_dmx_ops.get_table(slots, DMX_MAX_SLOTS) : 0;
+    cJSON *dmx = cJSON_AddArrayToObject(root, "dmx");
+    for (int i = 0; i < n; ++i){
+      cJSON *e = cJSON_CreateObject();
+      cJSON_AddNumberToObject(e, "universe", slots[i].universe);
+      cJSON_AddNumberToObject(e, "slot", slots[i].slot);
+      cJSON_AddStringToObject(e, "field", slots[i].field);
+      cJSON_AddStringToObject(e, "target", slots[i].target);
+      cJSON_AddItemToArray(dmx, e);
+    }
+    free(slots);
+  }
+  if (s_tc_ops.get_cues && s_tc_ops.get_freewheel_ms){
+    rest_api_timecode_cue_t *cues = calloc(TC_MAX_CUES, sizeof(*cues));
+    int n = cues ? s_tc_ops.get_cues(cues, TC_MAX_CUES) : 0;
+    cJSON *tc = cJSON_AddObjectToObject(root, "timecode");
+    cJSON_AddNumberToObject(tc, "freewheel_ms", s_tc_ops.get_freewheel_ms());
+    cJSON *list = cJSON_AddArrayToObject(tc, "cues");
+    for (int i = 0; i < n; ++i){
+      cJSON *e = cJSON_CreateObject();
+      cJSON_AddNumberToObject(e, "at_ms", cues[i].at_ms);
+      cJSON_AddStringToObject(e, "target", cues[i].target);
+      cJSON_AddStringToObject(e, "preset", cues[i].preset);
+      cJSON_AddNumberToObject(e, "fade_ms", cues[i].fade_ms);
+      cJSON_AddItemToArray(list, e);
+    }
+    free(cues);
+  }
+
+  if (s_power_ops.get_limits){
+    rest_api_power_limits_t pl = {0};
+    s_power_ops.get_limits(&pl);
+    cJSON *limits = cJSON_AddObjectToObject(root, "power_limits");
+    cJSON_AddNumberToObject(limits, "aled_global_mA", pl.aled_mA);
+    cJSON_AddNumberToObject(limits, "v5_max_A", pl.psu_mA / 1000.f);
+    cJSON_AddNumberToObject(limits, "aled_burst_mA", pl.burst_mA);
+    cJSON_AddNumberToObject(limits, "burst_window_ms", pl.burst_window_ms);
+  }
+
   return json_reply(req, root);
 }
 
@@ -501,13 +841,91 @@ static esp_err_t post_config_handler(httpd_req_t *req){
     return ESP_FAIL;
   }
 
+  cJSON *aled = cJSON_GetObjectItemCaseSensitive(json, "aled");
+  if (aled && cJSON_IsArray(aled)){
+    cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, aled){
+      if (!cJSON_IsObject(entry)){
+        continue;
+      }
+      int ch = (int)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "ch")) - 1;
+      if (ch < 0 || ch >= EFFECT_CHANNELS){
+        continue;
+      }
+      const char *type_str = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "strip_type"));
+      if (!type_str){
+        type_str = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "type"));
+      }
+      const char *order_str = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "order"));
+      led_type_t type;
+      color_order_t order;
+      if (s_effect_ops.set_channel_type && string_to_strip_type(type_str, &type) && string_to_order(order_str, &order)){
+        s_effect_ops.set_channel_type(ch, type, order);
+      }
+      cJSON *weight = cJSON_GetObjectItemCaseSensitive(entry, "power_weight");
+      if (cJSON_IsNumber(weight) && s_power_ops.set_weight){
+        s_power_ops.set_weight(ch, (float)weight->valuedouble);
+      }
+      cJSON *led_mA = cJSON_GetObjectItemCaseSensitive(entry, "mA_per_led");
+      if (cJSON_IsNumber(led_mA) && s_power_ops.set_led_mA){
+        s_power_ops.set_led_mA(ch, (float)led_mA->valuedouble);
+      }
+      // "canvas": {...} places the strip on a shared canvas, false takes it off.
+      cJSON *canvas = cJSON_GetObjectItemCaseSensitive(entry, "canvas");
+      if (canvas && s_effect_ops.set_channel_canvas){
+        fx_canvas_t cv = {0};
+        if (cJSON_IsObject(canvas)){
+          cv.offset = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(canvas, "offset"));
+          cv.size = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(canvas, "size"));
+          cv.seed = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(canvas, "seed"));
+        }
+        s_effect_ops.set_channel_canvas(ch, cv.size ? &cv : NULL);
+      }
+      // "stream": {...} puts the channel in stream mode, false takes it out.
+      cJSON *stream = cJSON_GetObjectItemCaseSensitive(entry, "stream");
+      if (stream && s_stream_ops.set_map){
+        rest_api_stream_map_t sm = {0};
+        if (cJSON_IsObject(stream)){
+          sm.pixels = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(stream, "pixels"));
+          sm.universe = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(stream, "universe"));
+          sm.ddp_offset = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(stream, "ddp_offset"));
+          cJSON *lat = cJSON_GetObjectItemCaseSensitive(stream, "latency_ms");
+          sm.latency_ms = cJSON_IsNumber(lat) ? (uint16_t)lat->valuedouble : 50;
+          cJSON *conceal = cJSON_GetObjectItemCaseSensitive(stream, "conceal");
+          sm.conceal_blend = cJSON_IsString(conceal) && strcmp(conceal->valuestring, "blend") == 0;
+        }
+        s_stream_ops.set_map(ch, &sm);
+      }
+
+      // Calibration is partial-update: start from the live config and only
+      // rebuild the LUTs if one of its fields is present.
+      fx_calib_cfg_t calib;
+      if (!s_effect_ops.get_channel_calib || !s_effect_ops.set_channel_calib ||
+          !s_effect_ops.get_channel_calib(ch, &calib)){
+        continue;
+      }
+      cJSON *gamma = cJSON_GetObjectItemCaseSensitive(entry, "gamma");
+      cJSON *white_point = cJSON_GetObjectItemCaseSensitive(entry, "white_point");
+      cJSON *white_mix = cJSON_GetObjectItemCaseSensitive(entry, "white_mix");
+      cJSON *white_gain = cJSON_GetObjectItemCaseSensitive(entry, "white_gain");
+      if (!gamma && !white_point && !white_mix && !white_gain){
+        continue;
+      }
+      json_to_rgbw_floats(gamma, calib.gamma);
+      json_to_rgbw_floats(white_point, calib.white_point);
+      if (cJSON_IsNumber(white_mix)) calib.white_mix = (float)white_mix->valuedouble;
+      if (cJSON_IsNumber(white_gain)) calib.white_gain = (float)white_gain->valuedouble;
+      s_effect_ops.set_channel_calib(ch, &calib);
+    }
+  }
+
   cJSON *pg = cJSON_GetObjectItemCaseSensitive(json, "pwm_groups");
   if (pg && cJSON_IsArray(pg) && s_pwm_ops.replace_groups){
-    pwm_group_t tmp[8];
+    pwm_group_t tmp[PWM_MAX_GROUPS];
     int count = 0;
     cJSON *entry = NULL;
     cJSON_ArrayForEach(entry, pg){
-      if (!cJSON_IsObject(entry) || count >= 8){
+      if (!cJSON_IsObject(entry) || count >= PWM_MAX_GROUPS){
         continue;
       }
       const char *name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "name"));
@@ -528,6 +946,172 @@ static esp_err_t post_config_handler(httpd_req_t *req){
     s_pwm_ops.replace_groups(tmp, count);
   }
 
+  cJSON *dither_Bps = cJSON_GetObjectItemCaseSensitive(json, "pwm_dither_Bps");
+  if (cJSON_IsNumber(dither_Bps) && dither_Bps->valuedouble >= 0 && s_pwm_ops.set_dither_budget){
+    s_pwm_ops.set_dither_budget((uint32_t)dither_Bps->valuedouble);
+  }
+
+  // "dmx" replaces the whole personality table; an invalid entry rejects it.
+  cJSON *dmx = cJSON_GetObjectItemCaseSensitive(json, "dmx");
+  if (cJSON_IsArray(dmx) && s_dmx_ops.set_table){
+    rest_api_dmx_slot_t *slots = calloc(DMX_MAX_SLOTS, sizeof(*slots));
+    int n = 0;
+    cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, dmx){
+      if (!slots || n >= DMX_MAX_SLOTS || !cJSON_IsObject(entry)){
+        continue;
+      }
+      rest_api_dmx_slot_t *d = &slots[n++];
+      d->universe = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "universe"));
+      d->slot = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "slot"));
+      const char *field = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "field"));
+      const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "target"));
+      strncpy(d->field, field ? field : "", sizeof(d->field) - 1);
+      strncpy(d->target, target ? target : "", sizeof(d->target) - 1);
+    }
+    if (slots && !s_dmx_ops.set_table(slots, n)){
+      ESP_LOGW(TAG, "DMX table rejected");
+    }
+    free(slots);
+  }
+
+  // "ddp_out" entries set one DDP channel each; pixels 0 turns it off.
+  cJSON *ddp = cJSON_GetObjectItemCaseSensitive(json, "ddp_out");
+  if (cJSON_IsArray(ddp) && s_ddp_ops.set_channel){
+    cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, ddp){
+      if (!cJSON_IsObject(entry)){
+        continue;
+      }
+      int v = (int)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "ch")) - 1;
+      if (v < 0 || v >= DDP_CHANNELS){
+        continue;
+      }
+      rest_api_ddp_channel_t cfg = {0};
+      cfg.pixels = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "pixels"));
+      led_type_t type;
+      const char *type_str = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "strip_type"));
+      cfg.rgbw = string_to_strip_type(type_str, &type) && type == LED_SK6812_RGBW;
+      const char *host = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "host"));
+      strncpy(cfg.host, host ? host : "", sizeof(cfg.host) - 1);
+      cfg.port = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "port"));
+      cfg.offset = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "offset"));
+      if (!s_ddp_ops.set_channel(v, &cfg)){
+        ESP_LOGW(TAG, "DDP channel %d rejected", v + 1);
+      }
+    }
+  }
+
+  // "timecode": "cues" replaces the whole show cue list, all or nothing.
+  cJSON *tc = cJSON_GetObjectItemCaseSensitive(json, "timecode");
+  if (cJSON_IsObject(tc)){
+    cJSON *freewheel = cJSON_GetObjectItemCaseSensitive(tc, "freewheel_ms");
+    if (cJSON_IsNumber(freewheel) && freewheel->valuedouble >= 0 && s_tc_ops.set_freewheel_ms){
+      s_tc_ops.set_freewheel_ms((uint32_t)freewheel->valuedouble);
+    }
+    cJSON *list = cJSON_GetObjectItemCaseSensitive(tc, "cues");
+    if (cJSON_IsArray(list) && s_tc_ops.set_cues){
+      rest_api_timecode_cue_t *cues = calloc(TC_MAX_CUES, sizeof(*cues));
+      int n = 0;
+      bool ok = cues != NULL && cJSON_GetArraySize(list) <= TC_MAX_CUES;
+      cJSON *entry = NULL;
+      cJSON_ArrayForEach(entry, list){
+        if (!ok || !cJSON_IsObject(entry)){
+          ok = false;
+          break;
+        }
+        rest_api_timecode_cue_t *c = &cues[n++];
+        c->at_ms = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "at_ms"));
+        cJSON *fade = cJSON_GetObjectItemCaseSensitive(entry, "fade_ms");
+        c->fade_ms = cJSON_IsNumber(fade) ? (uint32_t)fade->valuedouble : 0;
+        const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "target"));
+        const char *preset = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "preset"));
+        strncpy(c->target, target ? target : "", sizeof(c->target) - 1);
+        strncpy(c->preset, preset ? preset : "", sizeof(c->preset) - 1);
+      }
+      if (!ok || !s_tc_ops.set_cues(cues, n)){
+        ESP_LOGW(TAG, "Timecode cue list rejected");
+      }
+      free(cues);
+    }
+  }
+
+  const char *role = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "role"));
+  if (role && s_sync_ops.set_role && !s_sync_ops.set_role(role)){
+    ESP_LOGW(TAG, "role \"%s\" rejected", role);
+  }
+
+  cJSON *tick_hz = cJSON_GetObjectItemCaseSensitive(json, "sync_tick_hz");
+  if (cJSON_IsNumber(tick_hz) && tick_hz->valuedouble >= 1 && s_sync_ops.set_tick_hz){
+    s_sync_ops.set_tick_hz((uint32_t)tick_hz->valuedouble);
+  }
+
+  const char *frame_cast = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "frame_cast"));
+  if (frame_cast && s_sync_ops.set_frame_cast && !s_sync_ops.set_frame_cast(frame_cast)){
+    ESP_LOGW(TAG, "frame_cast \"%s\" rejected", frame_cast);
+  }
+
+  cJSON *pwm = cJSON_GetObjectItemCaseSensitive(json, "pwm");
+  if (pwm && cJSON_IsArray(pwm)){
+    cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, pwm){
+      int ch = (int)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(entry, "ch")) - 1;
+      if (ch < 0 || ch >= pwm_channels()){
+        continue;
+      }
+      cJSON *load = cJSON_GetObjectItemCaseSensitive(entry, "load_mA");
+      if (cJSON_IsNumber(load) && s_pwm_ops.set_load_mA){
+        s_pwm_ops.set_load_mA((uint8_t)ch, (float)load->valuedouble);
+      }
+      cJSON *soft = cJSON_GetObjectItemCaseSensitive(entry, "soft_start_ms");
+      if (cJSON_IsNumber(soft) && soft->valuedouble >= 0 && s_pwm_ops.set_soft_start_ms){
+        s_pwm_ops.set_soft_start_ms((uint8_t)ch, (uint32_t)soft->valuedouble);
+      }
+      cJSON *dither = cJSON_GetObjectItemCaseSensitive(entry, "dither");
+      if (cJSON_IsBool(dither) && s_pwm_ops.set_dither){
+        s_pwm_ops.set_dither((uint8_t)ch, cJSON_IsTrue(dither));
+      }
+      // Curve fields are merged into the current curve; missing ones are kept.
+      cJSON *curve_name = cJSON_GetObjectItemCaseSensitive(entry, "curve");
+      cJSON *max_duty = cJSON_GetObjectItemCaseSensitive(entry, "max_duty");
+      cJSON *points = cJSON_GetObjectItemCaseSensitive(entry, "curve_points");
+      pca9685_curve_cfg_t curve;
+      if ((curve_name || max_duty || points) && s_pwm_ops.get_curve && s_pwm_ops.set_curve &&
+          s_pwm_ops.get_curve((uint8_t)ch, &curve)){
+        pca9685_curve_parse_kind(cJSON_GetStringValue(curve_name), &curve.kind);
+        if (cJSON_IsNumber(max_duty)) curve.max_duty = (float)max_duty->valuedouble;
+        if (cJSON_IsArray(points)){
+          int n = 0;
+          cJSON *pt = NULL;
+          cJSON_ArrayForEach(pt, points){
+            if (n < PCA9685_CURVE_MAX_POINTS && cJSON_IsNumber(pt)){
+              curve.points[n++] = (float)pt->valuedouble;
+            }
+          }
+          curve.n_points = (uint8_t)n;
+          if (!curve_name && n >= 2) curve.kind = PCA9685_CURVE_CUSTOM;
+        }
+        s_pwm_ops.set_curve((uint8_t)ch, &curve);
+      }
+    }
+  }
+
+  // Missing fields keep their current value (set_limits ignores <= 0).
+  cJSON *limits = cJSON_GetObjectItemCaseSensitive(json, "power_limits");
+  if (cJSON_IsObject(limits) && s_power_ops.set_limits){
+    cJSON *aled_mA = cJSON_GetObjectItemCaseSensitive(limits, "aled_global_mA");
+    cJSON *v5_A = cJSON_GetObjectItemCaseSensitive(limits, "v5_max_A");
+    cJSON *burst = cJSON_GetObjectItemCaseSensitive(limits, "aled_burst_mA");
+    cJSON *window = cJSON_GetObjectItemCaseSensitive(limits, "burst_window_ms");
+    rest_api_power_limits_t pl = {
+      .aled_mA = cJSON_IsNumber(aled_mA) ? (float)aled_mA->valuedouble : 0.f,
+      .psu_mA = cJSON_IsNumber(v5_A) ? (float)(v5_A->valuedouble * 1000.0) : 0.f,
+      .burst_mA = cJSON_IsNumber(burst) ? (float)burst->valuedouble : -1.f,
+      .burst_window_ms = cJSON_IsNumber(window) ? (uint32_t)window->valuedouble : 0
+    };
+    s_power_ops.set_limits(&pl);
+  }
+
   cJSON_Delete(json);
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   httpd_resp_sendstr(req, "{\"status\":\"saved\"}");
@@ -594,12 +1178,12 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
     const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "target"));
     const char *name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "name"));
     uint32_t fade_ms = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "fade_ms"));
-    int ch = parse_channel(target, "ALEDch", EFFECT_CHANNELS);
+    int ch = effect_target_channel(target);
     if (ch < 0 || !is_safe_token(name) || !s_effect_ops.set_base){
       status = ESP_ERR_INVALID_ARG;
     } else {
       effect_params_t params;
-      status = load_preset(name, &params);
+      status = load_preset(name, &params, NULL);
       if (status == ESP_OK){
         if (!s_effect_ops.set_base(ch, &params, fade_ms)){
           status = ESP_FAIL;
@@ -609,14 +1193,24 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
   } else if (strcasecmp(action, "set_pwm") == 0){
     const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "target"));
     const char *mode = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "mode"));
-    int ch = parse_channel(target, "LEDch", 8);
+    int ch = parse_channel(target, "LEDch", pwm_channels());
     if (ch < 0){
       status = ESP_ERR_INVALID_ARG;
-    } else if (!mode || strcasecmp(mode, "static") == 0){
-      if (!s_pwm_ops.mode_static){
+    } else if (!mode || strcasecmp(mode, "static") == 0 || strcasecmp(mode, "fade") == 0){
+      // An explicit fade_ms overrides the channel's soft start.
+      cJSON *fade = cJSON_GetObjectItemCaseSensitive(json, "fade_ms");
+      float duty = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "duty"));
+      if (cJSON_IsNumber(fade) && fade->valuedouble >= 0){
+        if (!s_pwm_ops.fade_to){
+          status = ESP_ERR_INVALID_STATE;
+        } else {
+          const char *curve = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "curve"));
+          bool log_curve = curve && strcasecmp(curve, "log") == 0;
+          s_pwm_ops.fade_to((uint8_t)ch, duty, (uint32_t)fade->valuedouble, log_curve);
+        }
+      } else if (!s_pwm_ops.mode_static){
         status = ESP_ERR_INVALID_STATE;
       } else {
-        float duty = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "duty"));
         s_pwm_ops.mode_static((uint8_t)ch, duty);
       }
     } else if (strcasecmp(mode, "breath") == 0){
@@ -654,11 +1248,19 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
     } else if (!s_pwm_ops.group_set_rgb || !s_pwm_ops.group_set_rgbw){
       status = ESP_ERR_INVALID_STATE;
     } else {
+      // A fixed colour takes the group back from the effect engine.
+      if (s_effect_ops.release_pwm_group){
+        s_effect_ops.release_pwm_group(name);
+      }
       float r = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "r"));
       float g = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "g"));
       float b = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "b"));
       cJSON *w_val = cJSON_GetObjectItemCaseSensitive(json, "w");
-      if (w_val && cJSON_IsNumber(w_val)){
+      cJSON *fade = cJSON_GetObjectItemCaseSensitive(json, "fade_ms");
+      if (cJSON_IsNumber(fade) && fade->valuedouble >= 0 && s_pwm_ops.group_fade){
+        float w = cJSON_IsNumber(w_val) ? (float)w_val->valuedouble : 0.f;
+        s_pwm_ops.group_fade(name, r, g, b, w, (uint32_t)fade->valuedouble);
+      } else if (w_val && cJSON_IsNumber(w_val)){
         float w = (float)w_val->valuedouble;
         s_pwm_ops.group_set_rgbw(name, r, g, b, w);
       } else {
@@ -680,10 +1282,24 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
         status = ESP_FAIL;
       }
     }
+  } else if (strcasecmp(action, "set_channel_output") == 0){
+    if (!s_effect_ops.set_channel_output){
+      status = ESP_ERR_INVALID_STATE;
+    } else {
+      int ch = (int)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "ch")) - 1;
+      bool hdr = cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(json, "hdr"));
+      double fps = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "max_fps"));
+      uint16_t max_fps = (fps > 0 && fps <= 1000) ? (uint16_t)fps : 0;
+      if (ch < 0 || ch >= EFFECT_CHANNELS){
+        status = ESP_ERR_INVALID_ARG;
+      } else if (!s_effect_ops.set_channel_output(ch, hdr, max_fps)){
+        status = ESP_FAIL;
+      }
+    }
   } else if (strcasecmp(action, "blackout") == 0){
     const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "target"));
     int aled_ch = parse_channel(target, "ALEDch", EFFECT_CHANNELS);
-    int pwm_ch  = parse_channel(target, "LEDch", 8);
+    int pwm_ch  = parse_channel(target, "LEDch", pwm_channels());
     if (aled_ch >= 0){
       if (!s_effect_ops.set_base){
         status = ESP_ERR_INVALID_STATE;
@@ -703,7 +1319,7 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
         s_pwm_ops.mode_static((uint8_t)pwm_ch, 0.f);
       }
     } else {
-      if (!s_effect_ops.set_base || !s_pwm_ops.mode_static){
+      if (!s_effect_ops.set_base || (!s_pwm_ops.blackout && !s_pwm_ops.mode_static)){
         status = ESP_ERR_INVALID_STATE;
       } else {
         effect_params_t off = {
@@ -715,8 +1331,15 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
         for (int i = 0; i < EFFECT_CHANNELS; ++i){
           s_effect_ops.set_base(i, &off, 0);
         }
-        for (int i = 0; i < 8; ++i){
-          s_pwm_ops.mode_static((uint8_t)i, 0.f);
+        if (s_effect_ops.release_pwm_group){
+          s_effect_ops.release_pwm_group(NULL);
+        }
+        if (s_pwm_ops.blackout){
+          s_pwm_ops.blackout();
+        } else {
+          for (int i = 0; i < pwm_channels(); ++i){
+            s_pwm_ops.mode_static((uint8_t)i, 0.f);
+          }
         }
       }
     }
@@ -724,6 +1347,10 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
     if (!s_trigger_ops.set_beat){
       status = ESP_ERR_INVALID_STATE;
     } else {
+      cJSON *bpm = cJSON_GetObjectItemCaseSensitive(json, "bpm");
+      if (cJSON_IsNumber(bpm) && s_trigger_ops.set_tempo){
+        s_trigger_ops.set_tempo((float)bpm->valuedouble);
+      }
       float phase = (float)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "phase"));
       s_trigger_ops.set_beat(phase);
       uint32_t strobe_ms = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "strobe_ms"));
@@ -745,6 +1372,33 @@ static esp_err_t post_trigger_handler(httpd_req_t *req){
   return httpd_resp_send(req, NULL, 0);
 }
 
+esp_err_t rest_api_play_cue(const char *target, const char *preset, uint32_t preset_crc,
+                            uint32_t fade_ms, uint32_t at_ms, uint32_t *crc_out){
+  if (!s_effect_ops.schedule_base){
+    return ESP_ERR_INVALID_STATE;
+  }
+  effect_params_t params;
+  uint32_t crc = 0;
+  esp_err_t err = load_preset(preset, &params, &crc);
+  if (err != ESP_OK){
+    return err;
+  }
+  if (preset_crc && crc != preset_crc){
+    return ESP_ERR_INVALID_CRC;
+  }
+  int ch = effect_target_channel(target);
+  if (ch < 0){
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_effect_ops.schedule_base(ch, &params, fade_ms, at_ms)){
+    return ESP_FAIL;
+  }
+  if (crc_out){
+    *crc_out = crc;
+  }
+  return ESP_OK;
+}
+
 static esp_err_t post_cue_handler(httpd_req_t *req){
   char *buf = malloc(MAX_BODY_LENGTH);
   if (!buf){
@@ -763,17 +1417,51 @@ static esp_err_t post_cue_handler(httpd_req_t *req){
     httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
     return ESP_FAIL;
   }
-  const char *track = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "track"));
+
+  // "t0" is absolute sync time (ms, see /status "sync_ms"); otherwise the
+  // cue starts "in_ms" from now, by default far enough ahead for every
+  // slave to get a copy and load the preset.
+  const char *target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "target"));
+  if (!target){
+    target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "track"));
+  }
   const char *preset = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "preset"));
-  uint32_t t_start = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "tStart"));
-  uint32_t t_end = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "tEnd"));
-  ESP_LOGI(TAG, "Cue track=%s preset=%s [%" PRIu32 ",%" PRIu32 "]",
-           track ? track : "-", preset ? preset : "-", t_start, t_end);
+  uint32_t fade_ms = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "fade_ms"));
+  int64_t now_us = s_sync_ops.now_us ? s_sync_ops.now_us() : esp_timer_get_time();
+  cJSON *t0 = cJSON_GetObjectItemCaseSensitive(json, "t0");
+  cJSON *in_ms = cJSON_GetObjectItemCaseSensitive(json, "in_ms");
+  int64_t t0_us = now_us + CUE_LEAD_MS * 1000LL;
+  if (cJSON_IsNumber(t0)){
+    t0_us = (int64_t)t0->valuedouble * 1000;
+  } else if (cJSON_IsNumber(in_ms) && in_ms->valuedouble >= 0){
+    t0_us = now_us + (int64_t)in_ms->valuedouble * 1000;
+  }
+
+  uint32_t crc = 0;
+  uint32_t cue_id = 0;
+  esp_err_t status = ESP_ERR_INVALID_ARG;
+  if (target && preset && is_safe_token(preset) && strlen(target) < CUE_NAME_LEN && strlen(preset) < CUE_NAME_LEN){
+    status = rest_api_play_cue(target, preset, 0, fade_ms, (uint32_t)(t0_us / 1000), &crc);
+  }
+  // Slaves get it when this node is a sync master; otherwise it is local.
+  bool sent = status == ESP_OK && s_sync_ops.send_cue &&
+              s_sync_ops.send_cue(target, preset, crc, fade_ms, t0_us, &cue_id);
   cJSON_Delete(json);
 
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_sendstr(req, "{\"status\":\"queued\"}");
-  return ESP_OK;
+  if (status != ESP_OK){
+    httpd_resp_send_err(req, status == ESP_ERR_NOT_FOUND ? HTTPD_404_NOT_FOUND : HTTPD_400_BAD_REQUEST,
+                        esp_err_to_name(status));
+    return ESP_FAIL;
+  }
+  cJSON *root = cJSON_CreateObject();
+  cJSON_AddStringToObject(root, "status", "queued");
+  cJSON_AddNumberToObject(root, "t0", (double)(t0_us / 1000));
+  cJSON_AddNumberToObject(root, "crc", crc);
+  cJSON_AddBoolToObject(root, "multicast", sent);
+  if (sent){
+    cJSON_AddNumberToObject(root, "cue_id", cue_id);
+  }
+  return json_reply(req, root);
 }
 
 static esp_err_t events_handler(httpd_req_t *req){
@@ -919,3 +1607,59 @@ void rest_api_register_trigger_ops(const rest_api_trigger_ops_t *ops){
     memset(&s_trigger_ops, 0, sizeof(s_trigger_ops));
   }
 }
+
+void rest_api_register_power_ops(const rest_api_power_ops_t *ops){
+  if (ops){
+    s_power_ops = *ops;
+  } else {
+    memset(&s_power_ops, 0, sizeof(s_power_ops));
+  }
+}
+
+void rest_api_register_sync_ops(const rest_api_sync_ops_t *ops){
+  if (ops){
+    s_sync_ops = *ops;
+  } else {
+    memset(&s_sync_ops, 0, sizeof(s_sync_ops));
+  }
+}
+
+void rest_api_register_stream_ops(const rest_api_stream_ops_t *ops){
+  if (ops){
+    s_stream_ops = *ops;
+  } else {
+    memset(&s_stream_ops, 0, sizeof(s_stream_ops));
+  }
+}
+
+void rest_api_register_dmx_ops(const rest_api_dmx_ops_t *ops){
+  if (ops){
+    s_dmx_ops = *ops;
+  } else {
+    memset(&s_dmx_ops, 0, sizeof(s_dmx_ops));
+  }
+}
+
+void rest_api_register_ddp_ops(const rest_api_ddp_ops_t *ops){
+  if (ops){
+    s_ddp_ops = *ops;
+  } else {
+    memset(&s_ddp_ops, 0, sizeof(s_ddp_ops));
+  }
+}
+
+void rest_api_register_timecode_ops(const rest_api_timecode_ops_t *ops){
+  if (ops){
+    s_tc_ops = *ops;
+  } else {
+    memset(&s_tc_ops, 0, sizeof(s_tc_ops));
+  }
+}
+
+void rest_api_register_audio_ops(const rest_api_audio_ops_t *ops){
+  if (ops){
+    s_audio_ops = *ops;
+  } else {
+    memset(&s_audio_ops, 0, sizeof(s_audio_ops));
+  }
+}
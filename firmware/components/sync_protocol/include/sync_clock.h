@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Slave-side estimate of the master's clock from (master, local) timestamp
+// pairs. A PI loop tracks offset (P) and rate skew (I); samples further off
+// than a few times the running jitter are treated as Wi-Fi delay spikes and
+// dropped, unless enough arrive in a row to mean the master really jumped,
+// in which case the clock steps. Pure arithmetic, no locking: the caller
+// serialises updates against reads.
+
+typedef struct {
+    int64_t  ref_local_us;    // model anchor: master(ref_local) = ref_master
+    int64_t  ref_master_us;
+    float    skew;            // master rate / local rate - 1
+    float    jitter_us;       // EWMA of |error| over accepted samples
+    uint32_t accepted;
+    uint32_t rejected;
+    uint32_t steps;
+    uint8_t  run_rejected;
+    bool     started;
+    bool     locked;
+} sync_clock_t;
+
+void    sync_clock_reset(sync_clock_t *c);
+// Feeds one tick; returns false if it was rejected as an outlier.
+bool    sync_clock_update(sync_clock_t *c, int64_t master_us, int64_t local_us);
+// Master time at local_us; local_us itself until the first sample.
+int64_t sync_clock_map(const sync_clock_t *c, int64_t local_us);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format, little-endian and packed. Every packet starts with the same
+// header; receivers drop anything with a different magic or version, so the
+// format can change without old nodes misreading new packets.
+
+#define SYNC_MAGIC           0x474C   // "LG"
+#define SYNC_VERSION         2
+
+typedef enum {
+    SYNC_PACKET_TICK = 1,
+    SYNC_PACKET_CUE = 2
+} sync_packet_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  type;
+    uint32_t seq;            // per master, +1 per packet of any type
+    int64_t  master_us;      // master esp_timer time at send
+} sync_header_t;
+
+typedef struct __attribute__((packed)) {
+    sync_header_t hdr;
+    uint32_t tempo_mbpm;     // milli-BPM, 0 = no tempo
+    uint16_t beat_phase_q16; // beat phase at master_us
+    uint16_t flags;          // reserved, 0
+    uint32_t scene_gen;      // bumped by the master on show/scene changes
+} sync_tick_packet_t;
+
+#define SYNC_CUE_NAME_LEN  24
+
+// Scheduled preset change. Cues are retransmitted until t0; receivers key on
+// cue_id, so each copy is applied once.
+typedef struct {
+    uint32_t cue_id;
+    int64_t  t0_us;          // sync time of the first frame showing the preset
+    uint32_t fade_ms;
+    uint32_t preset_crc;     // CRC32 of the preset file; slaves refuse a mismatch
+    char     target[SYNC_CUE_NAME_LEN];   // "ALEDch3", "group:name"
+    char     preset[SYNC_CUE_NAME_LEN];
+} sync_cue_t;
+
+typedef struct __attribute__((packed)) {
+    sync_header_t hdr;
+    uint32_t cue_id;
+    int64_t  t0_us;
+    uint32_t fade_ms;
+    uint32_t preset_crc;
+    char     target[SYNC_CUE_NAME_LEN];
+    char     preset[SYNC_CUE_NAME_LEN];
+} sync_cue_packet_t;
+
+// Show state carried by ticks; the beat phase is valid at ref_us.
+typedef struct {
+    int64_t  ref_us;
+    float    beat_phase;     // 0..1
+    float    tempo_bpm;      // 0 = no tempo, phase is static
+    uint32_t scene_gen;
+} sync_show_t;
+
+size_t sync_packet_encode_tick(sync_tick_packet_t *out, uint32_t seq, int64_t master_us, const sync_show_t *show);
+// Validates magic, version and length. Returns the packet type, or 0.
+int    sync_packet_decode(const void *buf, size_t len, sync_header_t *hdr);
+void   sync_packet_tick_show(const sync_tick_packet_t *pkt, sync_show_t *out);
+size_t sync_packet_encode_cue(sync_cue_packet_t *out, uint32_t seq, int64_t master_us, const sync_cue_t *cue);
+// Names are NUL-terminated on the way out whatever arrived.
+void   sync_packet_cue(const sync_cue_packet_t *pkt, sync_cue_t *out);
+// Phase of show at time t_us (same clock as ref_us), wrapped to 0..1.
+float  sync_show_phase(const sync_show_t *show, int64_t t_us);
+
+// Per-master reception statistics, driven by sequence numbers and arrival
+// times. Jitter is the RFC 3550 interarrival estimate.
+typedef struct {
+    uint32_t addr;           // IPv4, network order; 0 = unused slot
+    uint32_t received;
+    uint32_t lost;           // expected - received, late arrivals counted back
+    uint32_t reordered;
+    uint32_t duplicates;
+    uint32_t restarts;       // sequence jumped: master rebooted
+    uint32_t base_seq;
+    uint32_t max_seq;
+    float    jitter_us;
+    int64_t  last_rx_us;     // local arrival time
+    int64_t  last_master_us;
+} sync_peer_stats_t;
+
+// Returns false for a duplicate, which should not be processed again.
+bool sync_peer_update(sync_peer_stats_t *p, uint32_t seq, int64_t master_us, int64_t rx_us);
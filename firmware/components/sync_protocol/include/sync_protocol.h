@@ -1,8 +1,62 @@
 #pragma once
 
 #include "esp_err.h"
+#include "sync_clock.h"
+#include "sync_packet.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 esp_err_t sync_protocol_start_master(void);
 esp_err_t sync_protocol_start_slave(void);
 esp_err_t sync_protocol_stop(void);
 void sync_protocol_init(void);
+
+// The node's part in sync. Standalone keeps sync_now_us() on local time and
+// sends no cues; set_role stops the current role before starting the new one.
+typedef enum {
+    SYNC_ROLE_STANDALONE = 0,
+    SYNC_ROLE_MASTER,
+    SYNC_ROLE_SLAVE
+} sync_role_t;
+
+esp_err_t   sync_protocol_set_role(sync_role_t role);
+sync_role_t sync_protocol_get_role(void);
+const char *sync_role_name(sync_role_t role);       // "Standalone", "Master", "Slave"
+bool        sync_role_parse(const char *name, sync_role_t *out);
+
+// Show timebase for effects and PWM animations: on a slave, the master's
+// clock as disciplined from its ticks; on a master or standalone node, local
+// esp_timer time. Cheap enough to call per frame.
+int64_t sync_now_us(void);
+void    sync_protocol_clock_stats(sync_clock_t *out);
+
+#define SYNC_TICK_HZ_MAX  60
+
+// Master tick rate, 1..60 Hz (default 20).
+void     sync_protocol_set_tick_hz(uint32_t hz);
+uint32_t sync_protocol_get_tick_hz(void);
+
+// Show state sent with every tick. On the master these set it; on a slave
+// the next tick overwrites them. The beat phase runs at the tempo between
+// updates, so every node reads the same phase for the same sync time.
+void     sync_protocol_set_beat(float phase01);
+void     sync_protocol_set_tempo(float bpm);
+// An external beat (the audio feed's PLL) on a master: phase at now and
+// tempo in one step, so the ticks carry it to the slaves. False (nothing
+// set) unless this node runs as master.
+bool     sync_protocol_follow_beat(float phase01, float bpm);
+uint32_t sync_protocol_next_scene(void);
+uint32_t sync_protocol_scene_gen(void);
+// False until a beat or tempo is set (master) or a tick arrived (slave).
+bool     sync_protocol_beat_phase(int64_t t_us, float *phase01);
+
+// Scheduled cues. On the master send_cue assigns cue->cue_id and multicasts
+// the cue with every tick until t0 (at least three copies); it does not
+// apply it locally. Slaves pass each cue id from the followed master to the
+// handler once, on the net_io task, as soon as it arrives.
+typedef void (*sync_cue_handler_t)(const sync_cue_t *cue);
+esp_err_t sync_protocol_send_cue(sync_cue_t *cue);
+void      sync_protocol_set_cue_handler(sync_cue_handler_t fn);
+
+// Reception statistics per master heard, up to max entries.
+int      sync_protocol_master_stats(sync_peer_stats_t *out, int max);
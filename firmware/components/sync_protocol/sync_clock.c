@@ -0,0 +1,66 @@
+#include "sync_clock.h"
+#include <math.h>
+#include <string.h>
+
+#define KP              0.1f     // share of the error taken as a phase step
+#define KI              0.01f    // share of error / interval added to skew
+#define SKEW_MAX        0.05f    // crystals are nowhere near 5% off
+#define GATE_MIN_US     2000.0f
+#define GATE_JITTERS    4.0f
+#define STEP_AFTER      10       // consecutive outliers -> master jumped
+#define LOCK_SAMPLES    8
+
+void sync_clock_reset(sync_clock_t *c) {
+    memset(c, 0, sizeof(*c));
+    c->jitter_us = GATE_MIN_US;
+}
+
+int64_t sync_clock_map(const sync_clock_t *c, int64_t local_us) {
+    if (!c->started) return local_us;
+    int64_t dt = local_us - c->ref_local_us;
+    return c->ref_master_us + dt + (int64_t)(c->skew * (float)dt);
+}
+
+static void anchor(sync_clock_t *c, int64_t master_us, int64_t local_us) {
+    c->ref_master_us = master_us;
+    c->ref_local_us = local_us;
+}
+
+bool sync_clock_update(sync_clock_t *c, int64_t master_us, int64_t local_us) {
+    if (!c->started) {
+        anchor(c, master_us, local_us);
+        c->started = true;
+        return true;
+    }
+
+    int64_t dt = local_us - c->ref_local_us;
+    int64_t predicted = sync_clock_map(c, local_us);
+    float err = (float)(master_us - predicted);
+
+    float gate = GATE_JITTERS * c->jitter_us;
+    if (gate < GATE_MIN_US) gate = GATE_MIN_US;
+    if (c->locked && fabsf(err) > gate) {
+        c->rejected++;
+        if (++c->run_rejected < STEP_AFTER) return false;
+        // Master restarted or was replaced: keep the rate, take the phase.
+        anchor(c, master_us, local_us);
+        c->run_rejected = 0;
+        c->jitter_us = GATE_MIN_US;
+        c->steps++;
+        return true;
+    }
+    c->run_rejected = 0;
+
+    // Slew: the output moves by a fraction of the error per tick, so effects
+    // never see the clock jump once locked.
+    anchor(c, predicted + (int64_t)(KP * err), local_us);
+    if (dt > 0) {
+        c->skew += KI * err / (float)dt;
+        if (c->skew > SKEW_MAX) c->skew = SKEW_MAX;
+        if (c->skew < -SKEW_MAX) c->skew = -SKEW_MAX;
+    }
+    c->jitter_us += (fabsf(err) - c->jitter_us) / 8.0f;
+    c->accepted++;
+    if (c->accepted >= LOCK_SAMPLES) c->locked = true;
+    return true;
+}
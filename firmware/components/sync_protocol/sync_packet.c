@@ -0,0 +1,126 @@
+#include "sync_packet.h"
+#include <math.h>
+#include <string.h>
+
+// Sequence jumps beyond these mean the master restarted (RFC 3550 A.1).
+#define SEQ_MAX_DROPOUT   3000    // ~50 s at 60 Hz
+#define SEQ_MAX_MISORDER  100
+
+static void encode_header(sync_header_t *hdr, uint8_t type, uint32_t seq, int64_t master_us) {
+    hdr->magic = SYNC_MAGIC;
+    hdr->version = SYNC_VERSION;
+    hdr->type = type;
+    hdr->seq = seq;
+    hdr->master_us = master_us;
+}
+
+size_t sync_packet_encode_tick(sync_tick_packet_t *out, uint32_t seq, int64_t master_us, const sync_show_t *show) {
+    memset(out, 0, sizeof(*out));
+    encode_header(&out->hdr, SYNC_PACKET_TICK, seq, master_us);
+    if (show) {
+        float phase = sync_show_phase(show, master_us);
+        uint32_t q = (uint32_t)(phase * 65536.0f + 0.5f);
+        out->beat_phase_q16 = (uint16_t)(q > 0xFFFF ? 0 : q);
+        out->tempo_mbpm = show->tempo_bpm > 0.0f ? (uint32_t)(show->tempo_bpm * 1000.0f + 0.5f) : 0;
+        out->scene_gen = show->scene_gen;
+    }
+    return sizeof(*out);
+}
+
+int sync_packet_decode(const void *buf, size_t len, sync_header_t *hdr) {
+    if (!buf || len < sizeof(sync_header_t)) return 0;
+    memcpy(hdr, buf, sizeof(*hdr));
+    if (hdr->magic != SYNC_MAGIC || hdr->version != SYNC_VERSION) return 0;
+    switch (hdr->type) {
+        case SYNC_PACKET_TICK:
+            return len >= sizeof(sync_tick_packet_t) ? SYNC_PACKET_TICK : 0;
+        case SYNC_PACKET_CUE:
+            return len >= sizeof(sync_cue_packet_t) ? SYNC_PACKET_CUE : 0;
+        default:
+            return 0;
+    }
+}
+
+void sync_packet_tick_show(const sync_tick_packet_t *pkt, sync_show_t *out) {
+    out->ref_us = pkt->hdr.master_us;
+    out->beat_phase = pkt->beat_phase_q16 / 65536.0f;
+    out->tempo_bpm = pkt->tempo_mbpm / 1000.0f;
+    out->scene_gen = pkt->scene_gen;
+}
+
+size_t sync_packet_encode_cue(sync_cue_packet_t *out, uint32_t seq, int64_t master_us, const sync_cue_t *cue) {
+    memset(out, 0, sizeof(*out));
+    encode_header(&out->hdr, SYNC_PACKET_CUE, seq, master_us);
+    out->cue_id = cue->cue_id;
+    out->t0_us = cue->t0_us;
+    out->fade_ms = cue->fade_ms;
+    out->preset_crc = cue->preset_crc;
+    strncpy(out->target, cue->target, sizeof(out->target) - 1);
+    strncpy(out->preset, cue->preset, sizeof(out->preset) - 1);
+    return sizeof(*out);
+}
+
+void sync_packet_cue(const sync_cue_packet_t *pkt, sync_cue_t *out) {
+    out->cue_id = pkt->cue_id;
+    out->t0_us = pkt->t0_us;
+    out->fade_ms = pkt->fade_ms;
+    out->preset_crc = pkt->preset_crc;
+    memcpy(out->target, pkt->target, sizeof(out->target));
+    memcpy(out->preset, pkt->preset, sizeof(out->preset));
+    out->target[sizeof(out->target) - 1] = '\0';
+    out->preset[sizeof(out->preset) - 1] = '\0';
+}
+
+float sync_show_phase(const sync_show_t *show, int64_t t_us) {
+    float phase = show->beat_phase;
+    if (show->tempo_bpm > 0.0f) {
+        // Beats elapsed in double: an hour at 180 BPM is past float's
+        // fractional resolution.
+        double beats = (double)(t_us - show->ref_us) * show->tempo_bpm / 60e6;
+        phase += (float)(beats - floor(beats));
+    }
+    phase -= floorf(phase);
+    return phase;
+}
+
+static void peer_restart(sync_peer_stats_t *p, uint32_t seq) {
+    p->base_seq = seq;
+    p->max_seq = seq;
+    p->received = 0;
+    p->lost = 0;
+    p->jitter_us = 0.0f;
+    p->last_rx_us = 0;
+}
+
+bool sync_peer_update(sync_peer_stats_t *p, uint32_t seq, int64_t master_us, int64_t rx_us) {
+    if (p->received == 0) {
+        peer_restart(p, seq);
+    } else {
+        int32_t d = (int32_t)(seq - p->max_seq);
+        if (d > SEQ_MAX_DROPOUT || d < -SEQ_MAX_MISORDER) {
+            p->restarts++;
+            peer_restart(p, seq);
+        } else if (d == 0) {
+            p->duplicates++;
+            return false;
+        } else if (d < 0) {
+            p->reordered++;
+        } else {
+            p->max_seq = seq;
+        }
+    }
+    p->received++;
+    uint32_t expected = p->max_seq - p->base_seq + 1;
+    p->lost = expected > p->received ? expected - p->received : 0;
+
+    // Transit-time variation between consecutive arrivals, in order only.
+    if (p->last_rx_us && seq == p->max_seq) {
+        float d = (float)((rx_us - p->last_rx_us) - (master_us - p->last_master_us));
+        p->jitter_us += (fabsf(d) - p->jitter_us) / 16.0f;
+    }
+    if (seq == p->max_seq) {
+        p->last_rx_us = rx_us;
+        p->last_master_us = master_us;
+    }
+    return true;
+}
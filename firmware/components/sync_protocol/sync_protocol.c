@@ -1,84 +1,308 @@
 #include "sync_protocol.h"
+#include "sync_clock.h"
+#include "sync_packet.h"
+#include "net_io.h"
 #include "esp_log.h"
 #include "lwip/sockets.h"
 #include "lwip/inet.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_random.h"
 #include "esp_timer.h"
+#include <math.h>
 #include <string.h>
+#include <strings.h>
 
 static const char *TAG = "SYNC_PROTO";
 
 #define MCAST_GRP "239.10.7.42"
 #define MCAST_PORT 45454
 
-typedef enum {
-    SYNC_PACKET_TICK = 1,
-    SYNC_PACKET_CUE = 2
-} sync_packet_type_t;
+#define TICK_HZ_DEFAULT    20
+#define MAX_MASTERS        4
+#define MASTER_TIMEOUT_US  1000000   // silent this long -> another master may take over
+#define MAX_CUES           8
+#define CUE_MIN_COPIES     3         // sent at least this often, then until t0
+#define SEEN_CUES          16
 
-typedef struct __attribute__((packed)) {
-    uint32_t timestamp_ms;
-    uint8_t type;
-    uint8_t pad[3];
-} sync_packet_t;
-
-static int s_tx_socket = -1;
-static int s_rx_socket = -1;
+static int s_net = -1;              // net_io handle: TX socket (master) or RX (slave)
 static bool s_running = false;
+static volatile uint32_t s_tick_hz = TICK_HZ_DEFAULT;
+static uint32_t s_seq = 0;
 
-static void sync_tx_task(void *arg) {
-    struct sockaddr_in dest_addr = {0};
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(MCAST_PORT);
-    inet_aton(MCAST_GRP, &dest_addr.sin_addr);
-    
-    ESP_LOGI(TAG, "TX task started, sending to %s:%d", MCAST_GRP, MCAST_PORT);
-    
-    while (s_running) {
-        sync_packet_t packet = {
-            .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
-            .type = SYNC_PACKET_TICK,
-            .pad = {0}
-        };
-        
-        int err = sendto(s_tx_socket, &packet, sizeof(packet), 0,
-                        (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-        
-        if (err < 0) {
+// s_mux guards the clock, the show state and the peer table. The net_io
+// task writes them per packet; renderers read the clock and show per frame.
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static sync_clock_t s_clock;
+static bool s_slave = false;
+static sync_show_t s_show;
+static bool s_show_valid = false;
+static sync_peer_stats_t s_peers[MAX_MASTERS];
+static uint32_t s_master_addr = 0;      // the one the clock follows
+static int64_t s_master_seen_us = 0;
+static uint32_t s_bad_packets = 0;
+
+// Master: cues being retransmitted, guarded by s_mux. Slave: ids already
+// handed to the cue handler, net_io task only.
+typedef struct {
+    sync_cue_t cue;
+    uint8_t    sent;
+    bool       active;
+} cue_slot_t;
+static cue_slot_t s_cues[MAX_CUES];
+static uint32_t s_next_cue_id = 0;
+static struct sockaddr_in s_dest;
+static int64_t s_next_tick_us = 0;
+static volatile bool s_cue_pending = false;
+static uint32_t s_seen_cues[SEEN_CUES];
+static int s_seen_head = 0;
+static sync_cue_handler_t s_cue_handler = NULL;
+
+int64_t sync_now_us(void) {
+    int64_t local_us = esp_timer_get_time();
+    if (!s_slave) return local_us;
+    portENTER_CRITICAL(&s_mux);
+    int64_t t = sync_clock_map(&s_clock, local_us);
+    portEXIT_CRITICAL(&s_mux);
+    return t;
+}
+
+void sync_protocol_clock_stats(sync_clock_t *out) {
+    if (!out) return;
+    portENTER_CRITICAL(&s_mux);
+    *out = s_clock;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void sync_protocol_set_tick_hz(uint32_t hz) {
+    if (hz < 1) hz = 1;
+    if (hz > SYNC_TICK_HZ_MAX) hz = SYNC_TICK_HZ_MAX;
+    s_tick_hz = hz;
+}
+
+uint32_t sync_protocol_get_tick_hz(void) {
+    return s_tick_hz;
+}
+
+void sync_protocol_set_beat(float phase01) {
+    int64_t now = sync_now_us();
+    portENTER_CRITICAL(&s_mux);
+    s_show.ref_us = now;
+    s_show.beat_phase = phase01 - floorf(phase01);
+    s_show_valid = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// Re-anchors at the current phase so a tempo change never jumps the beat.
+void sync_protocol_set_tempo(float bpm) {
+    int64_t now = sync_now_us();
+    portENTER_CRITICAL(&s_mux);
+    s_show.beat_phase = sync_show_phase(&s_show, now);
+    s_show.ref_us = now;
+    s_show.tempo_bpm = bpm > 0.f ? bpm : 0.f;
+    s_show_valid = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool sync_protocol_follow_beat(float phase01, float bpm) {
+    if (!s_running || s_slave) return false;
+    int64_t now = sync_now_us();
+    portENTER_CRITICAL(&s_mux);
+    s_show.ref_us = now;
+    s_show.beat_phase = phase01 - floorf(phase01);
+    s_show.tempo_bpm = bpm > 0.f ? bpm : 0.f;
+    s_show_valid = true;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+uint32_t sync_protocol_next_scene(void) {
+    portENTER_CRITICAL(&s_mux);
+    uint32_t gen = ++s_show.scene_gen;
+    portEXIT_CRITICAL(&s_mux);
+    return gen;
+}
+
+uint32_t sync_protocol_scene_gen(void) {
+    return s_show.scene_gen;
+}
+
+bool sync_protocol_beat_phase(int64_t t_us, float *phase01) {
+    if (!phase01) return false;
+    portENTER_CRITICAL(&s_mux);
+    bool valid = s_show_valid;
+    if (valid) *phase01 = sync_show_phase(&s_show, t_us);
+    portEXIT_CRITICAL(&s_mux);
+    return valid;
+}
+
+int sync_protocol_master_stats(sync_peer_stats_t *out, int max) {
+    int n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < MAX_MASTERS && n < max; i++) {
+        if (s_peers[i].addr) out[n++] = s_peers[i];
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void sync_protocol_set_cue_handler(sync_cue_handler_t fn) {
+    s_cue_handler = fn;
+}
+
+esp_err_t sync_protocol_send_cue(sync_cue_t *cue) {
+    if (!cue) return ESP_ERR_INVALID_ARG;
+    if (!s_running || s_slave) return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&s_mux);
+    // A free slot, else the cue due soonest (it has had the most copies).
+    cue_slot_t *slot = &s_cues[0];
+    for (int i = 0; i < MAX_CUES; i++) {
+        if (!s_cues[i].active) {
+            slot = &s_cues[i];
+            break;
+        }
+        if (s_cues[i].cue.t0_us < slot->cue.t0_us) slot = &s_cues[i];
+    }
+    cue->cue_id = s_next_cue_id++;
+    slot->cue = *cue;
+    slot->sent = 0;
+    slot->active = true;
+    portEXIT_CRITICAL(&s_mux);
+
+    // First copy goes out now rather than on the next tick.
+    s_cue_pending = true;
+    net_io_wake();
+    return ESP_OK;
+}
+
+static void send_cues(int sock, const struct sockaddr_in *dest, int64_t now_us) {
+    for (int i = 0; i < MAX_CUES; i++) {
+        sync_cue_t cue;
+        portENTER_CRITICAL(&s_mux);
+        bool active = s_cues[i].active;
+        if (active) {
+            cue = s_cues[i].cue;
+            if (++s_cues[i].sent >= CUE_MIN_COPIES && cue.t0_us <= now_us) {
+                s_cues[i].active = false;
+            }
+        }
+        portEXIT_CRITICAL(&s_mux);
+        if (!active) continue;
+
+        sync_cue_packet_t packet;
+        size_t len = sync_packet_encode_cue(&packet, s_seq++, esp_timer_get_time(), &cue);
+        if (sendto(sock, &packet, len, 0, (const struct sockaddr *)dest, sizeof(*dest)) < 0) {
+            ESP_LOGW(TAG, "Cue TX error: %d", errno);
+        }
+    }
+}
+
+// Ticks run on a microsecond grid, so 60 Hz averages 60 Hz even though
+// each wait is rounded to RTOS ticks. Pending cues ride along with every
+// tick; a new cue wakes the I/O task early.
+static int64_t sync_tx_poll(int64_t now_us, void *ctx) {
+    int sock = net_io_socket(s_net);
+    if (sock < 0) return NET_IO_NEVER;
+
+    bool tick = now_us >= s_next_tick_us;
+    if (tick) {
+        portENTER_CRITICAL(&s_mux);
+        sync_show_t show = s_show;
+        portEXIT_CRITICAL(&s_mux);
+
+        sync_tick_packet_t packet;
+        size_t len = sync_packet_encode_tick(&packet, s_seq++, now_us, &show);
+        if (sendto(sock, &packet, len, 0, (struct sockaddr *)&s_dest, sizeof(s_dest)) < 0) {
             ESP_LOGW(TAG, "TX error: %d", errno);
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(50));
+
+        s_next_tick_us += 1000000 / s_tick_hz;
+        if (s_next_tick_us < now_us) s_next_tick_us = now_us;
     }
-    
-    vTaskDelete(NULL);
+    if (tick || s_cue_pending) {
+        s_cue_pending = false;
+        send_cues(sock, &s_dest, now_us);
+    }
+    return s_next_tick_us;
+}
+
+// Call with s_mux held. Unknown masters take a free slot or the one heard
+// from longest ago.
+static sync_peer_stats_t *peer_for(uint32_t addr) {
+    sync_peer_stats_t *victim = &s_peers[0];
+    for (int i = 0; i < MAX_MASTERS; i++) {
+        if (s_peers[i].addr == addr) return &s_peers[i];
+        if (!s_peers[i].addr || (victim->addr && s_peers[i].last_rx_us < victim->last_rx_us)) {
+            victim = &s_peers[i];
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->addr = addr;
+    return victim;
 }
 
-static void sync_rx_task(void *arg) {
-    ESP_LOGI(TAG, "RX task started, listening on %s:%d", MCAST_GRP, MCAST_PORT);
+// Call with s_mux held. The clock follows one master; another takes over
+// (and the clock restarts) only once it has gone quiet.
+static bool follow_master(uint32_t addr, int64_t now_us) {
+    if (s_master_addr != addr) {
+        if (s_master_addr && now_us - s_master_seen_us < MASTER_TIMEOUT_US) return false;
+        s_master_addr = addr;
+        sync_clock_reset(&s_clock);
+    }
+    s_master_seen_us = now_us;
+    return true;
+}
+
+static bool cue_seen(uint32_t id) {
+    for (int i = 0; i < SEEN_CUES; i++) {
+        if (s_seen_cues[i] == id) return true;
+    }
+    s_seen_cues[s_seen_head] = id;
+    s_seen_head = (s_seen_head + 1) % SEEN_CUES;
+    return false;
+}
+
+static void sync_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                    int64_t local_us, void *ctx) {
+    sync_header_t hdr;
+    int type = sync_packet_decode(buf, len, &hdr);
+    if (!type) {
+        // Other versions share the group during mixed-firmware shows.
+        s_bad_packets++;
+        return;
+    }
     
-    while (s_running) {
-        sync_packet_t packet;
-        struct sockaddr_in source_addr;
-        socklen_t addr_len = sizeof(source_addr);
-        
-        int len = recvfrom(s_rx_socket, &packet, sizeof(packet), 0,
-                          (struct sockaddr *)&source_addr, &addr_len);
-        
-        if (len == sizeof(packet)) {
-            uint32_t local_ms = (uint32_t)(esp_timer_get_time() / 1000);
-            int32_t drift_ms = local_ms - packet.timestamp_ms;
-            
-            if (packet.type == SYNC_PACKET_TICK) {
-                ESP_LOGD(TAG, "Tick received, drift: %ld ms", drift_ms);
-            } else if (packet.type == SYNC_PACKET_CUE) {
-                ESP_LOGI(TAG, "Cue received at %lu", packet.timestamp_ms);
-            }
+    portENTER_CRITICAL(&s_mux);
+    sync_peer_stats_t *peer = peer_for(src->sin_addr.s_addr);
+    bool fresh = sync_peer_update(peer, hdr.seq, hdr.master_us, local_us);
+    bool in_order = hdr.seq == peer->max_seq;
+    bool ok = false;
+    bool followed = fresh && follow_master(peer->addr, local_us);
+    if (followed && type == SYNC_PACKET_TICK) {
+        ok = sync_clock_update(&s_clock, hdr.master_us, local_us);
+        if (in_order) {
+            // Only the newest tick moves the show; a late one would
+            // roll the beat or the scene back.
+            sync_packet_tick_show((const sync_tick_packet_t *)buf, &s_show);
+            s_show_valid = true;
         }
     }
+    float skew_ppm = s_clock.skew * 1e6f;
+    portEXIT_CRITICAL(&s_mux);
     
-    vTaskDelete(NULL);
+    if (type == SYNC_PACKET_TICK) {
+        ESP_LOGD(TAG, "Tick %lu, skew %.0f ppm%s", (unsigned long)hdr.seq, skew_ppm, ok ? "" : " (ignored)");
+    } else if (type == SYNC_PACKET_CUE && followed) {
+        sync_cue_t cue;
+        sync_packet_cue((const sync_cue_packet_t *)buf, &cue);
+        if (!cue_seen(cue.cue_id)) {
+            int64_t lead_us = cue.t0_us - sync_now_us();
+            ESP_LOGI(TAG, "Cue %lu: %s -> %s in %lld ms", (unsigned long)cue.cue_id,
+                     cue.preset, cue.target, (long long)(lead_us / 1000));
+            // The handler loads the preset here, well ahead of t0.
+            if (s_cue_handler) s_cue_handler(&cue);
+        }
+    }
 }
 
 esp_err_t sync_protocol_start_master(void) {
@@ -87,19 +311,33 @@ esp_err_t sync_protocol_start_master(void) {
         return ESP_OK;
     }
     
-    s_tx_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (s_tx_socket < 0) {
+    // Send-only: the socket sits on an ephemeral port and net_io calls
+    // sync_tx_poll for every tick.
+    static const net_io_proto_t TX = { .name = "sync_tx", .port = 0, .poll = sync_tx_poll };
+    
+    // Random first id: a rebooted master must not repeat ids slaves saw.
+    portENTER_CRITICAL(&s_mux);
+    memset(s_cues, 0, sizeof(s_cues));
+    portEXIT_CRITICAL(&s_mux);
+    s_next_cue_id = esp_random();
+    s_next_tick_us = esp_timer_get_time();
+    s_cue_pending = false;
+    memset(&s_dest, 0, sizeof(s_dest));
+    s_dest.sin_family = AF_INET;
+    s_dest.sin_port = htons(MCAST_PORT);
+    inet_aton(MCAST_GRP, &s_dest.sin_addr);
+    
+    s_net = net_io_register(&TX);
+    if (s_net < 0) {
         ESP_LOGE(TAG, "Failed to create TX socket");
         return ESP_FAIL;
     }
     
     uint8_t ttl = 1;
-    setsockopt(s_tx_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
-    
+    setsockopt(net_io_socket(s_net), IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
     s_running = true;
-    xTaskCreate(sync_tx_task, "sync_tx", 4096, NULL, 4, NULL);
     
-    ESP_LOGI(TAG, "Master mode started");
+    ESP_LOGI(TAG, "Master mode started, sending to %s:%d", MCAST_GRP, MCAST_PORT);
     return ESP_OK;
 }
 
@@ -109,58 +347,84 @@ esp_err_t sync_protocol_start_slave(void) {
         return ESP_OK;
     }
     
-    s_rx_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (s_rx_socket < 0) {
-        ESP_LOGE(TAG, "Failed to create RX socket");
-        return ESP_FAIL;
-    }
+    static const net_io_proto_t RX = { .name = "sync_rx", .port = MCAST_PORT, .rx = sync_rx };
     
-    struct sockaddr_in bind_addr = {0};
-    bind_addr.sin_family = AF_INET;
-    bind_addr.sin_port = htons(MCAST_PORT);
-    bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    portENTER_CRITICAL(&s_mux);
+    sync_clock_reset(&s_clock);
+    memset(s_peers, 0, sizeof(s_peers));
+    s_master_addr = 0;
+    portEXIT_CRITICAL(&s_mux);
+    memset(s_seen_cues, 0, sizeof(s_seen_cues));
+    s_slave = true;
     
-    if (bind(s_rx_socket, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) < 0) {
+    s_net = net_io_register(&RX);
+    if (s_net < 0) {
         ESP_LOGE(TAG, "Failed to bind RX socket");
-        close(s_rx_socket);
+        s_slave = false;
         return ESP_FAIL;
     }
     
-    struct ip_mreq imreq = {0};
-    inet_aton(MCAST_GRP, &imreq.imr_multiaddr);
-    imreq.imr_interface.s_addr = htonl(INADDR_ANY);
-    
-    if (setsockopt(s_rx_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP,
-                   &imreq, sizeof(imreq)) < 0) {
+    struct in_addr grp;
+    inet_aton(MCAST_GRP, &grp);
+    if (net_io_join(s_net, grp.s_addr, true) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to join multicast group");
-        close(s_rx_socket);
+        net_io_unregister(s_net);
+        s_net = -1;
+        s_slave = false;
         return ESP_FAIL;
     }
-    
     s_running = true;
-    xTaskCreate(sync_rx_task, "sync_rx", 4096, NULL, 4, NULL);
     
-    ESP_LOGI(TAG, "Slave mode started");
+    ESP_LOGI(TAG, "Slave mode started, listening on %s:%d", MCAST_GRP, MCAST_PORT);
     return ESP_OK;
 }
 
 esp_err_t sync_protocol_stop(void) {
     s_running = false;
+    s_slave = false;
     
-    if (s_tx_socket >= 0) {
-        close(s_tx_socket);
-        s_tx_socket = -1;
-    }
-    
-    if (s_rx_socket >= 0) {
-        close(s_rx_socket);
-        s_rx_socket = -1;
+    if (s_net >= 0) {
+        net_io_unregister(s_net);
+        s_net = -1;
     }
     
     ESP_LOGI(TAG, "Sync protocol stopped");
     return ESP_OK;
 }
 
+static const char *const ROLE_NAMES[] = { "Standalone", "Master", "Slave" };
+
+const char *sync_role_name(sync_role_t role) {
+    return role <= SYNC_ROLE_SLAVE ? ROLE_NAMES[role] : "?";
+}
+
+bool sync_role_parse(const char *name, sync_role_t *out) {
+    if (!name || !out) return false;
+    for (int i = 0; i <= SYNC_ROLE_SLAVE; i++) {
+        if (strcasecmp(name, ROLE_NAMES[i]) == 0) {
+            *out = (sync_role_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+sync_role_t sync_protocol_get_role(void) {
+    if (!s_running) return SYNC_ROLE_STANDALONE;
+    return s_slave ? SYNC_ROLE_SLAVE : SYNC_ROLE_MASTER;
+}
+
+esp_err_t sync_protocol_set_role(sync_role_t role) {
+    if (role == sync_protocol_get_role()) return ESP_OK;
+    if (s_running) sync_protocol_stop();
+    switch (role) {
+    case SYNC_ROLE_MASTER: return sync_protocol_start_master();
+    case SYNC_ROLE_SLAVE:  return sync_protocol_start_slave();
+    case SYNC_ROLE_STANDALONE: return ESP_OK;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
 void sync_protocol_init(void) {
     ESP_LOGI(TAG, "Sync protocol initialized (call start_master or start_slave)");
 }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Show playhead chasing external timecode. Labels (hh:mm:ss:ff) become
+// positions in µs of label time; each position arrives stamped with the
+// local time it was received. As in the sync clock, a PI loop tracks phase
+// (P) and speed (I), so the playhead runs smoothly between samples and
+// through arrival jitter, and a 29.97 fps source labelled 30 shows up as
+// a speed of 0.999. Samples further off than a few times the running
+// jitter are dropped as delay spikes, unless TC_JUMP_AFTER of them in a
+// row agree with each other (four times as many for a short step back,
+// which is what a burst of delayed packets looks like): that is a jump,
+// and the playhead resyncs.
+//
+// After TC_DROPOUT_US without samples the playhead freewheels at the
+// tracked speed; freewheel_ms later it stops there. A locate (MTC full
+// frame) or a position repeated for TC_PARK_US parks it. Pure arithmetic,
+// no locking: the caller serialises updates against reads.
+
+#define TC_DROPOUT_US    250000
+#define TC_PARK_US       100000
+#define TC_JUMP_AFTER    3
+#define TC_FREEWHEEL_MS  2000
+
+typedef enum {
+    TC_FPS_24 = 0,           // MTC rate codes
+    TC_FPS_25,
+    TC_FPS_2997DF,
+    TC_FPS_30
+} tc_fps_t;
+
+typedef struct {
+    uint8_t h, m, s, f;
+} tc_label_t;
+
+typedef enum {
+    TC_STOPPED = 0,
+    TC_LOCKED,
+    TC_FREEWHEEL
+} tc_state_t;
+
+typedef struct {
+    int64_t    ref_local_us;   // model anchor: playhead(ref_local) = ref_pos
+    int64_t    ref_pos_us;
+    float      skew;           // speed - 1
+    float      jitter_us;      // EWMA of |error| over accepted samples
+    int64_t    last_rx_us;
+    int64_t    last_pos_us;
+    int64_t    same_since_us;  // first arrival of last_pos
+    int64_t    jump_lead_us;   // position - local of the first outlier in a run
+    uint32_t   freewheel_ms;
+    uint32_t   samples;
+    uint32_t   outliers;
+    uint32_t   jumps;          // resyncs once settled, the source really jumped
+    uint32_t   resyncs;        // every re-anchor while running, for the timeline
+    uint32_t   dropouts;
+    uint8_t    run_outliers;
+    uint8_t    settled;        // samples taken since the last anchor
+    tc_state_t state;
+    bool       started;        // a position is known
+} tc_chase_t;
+
+void       tc_chase_reset(tc_chase_t *c, uint32_t freewheel_ms);
+// Running timecode at pos_us, received at local_us; false if dropped.
+bool       tc_chase_feed(tc_chase_t *c, int64_t pos_us, int64_t local_us);
+// Parks the playhead at pos_us.
+void       tc_chase_locate(tc_chase_t *c, int64_t pos_us, int64_t local_us);
+// Playhead at local_us, not earlier than the last update; moves to
+// freewheel and stopped as samples stay away.
+tc_state_t tc_chase_playhead(tc_chase_t *c, int64_t local_us, int64_t *pos_us);
+
+// Label time. Drop-frame labels skip frames 0 and 1 of every minute but
+// each tenth, and run at 30000/1001 fps.
+uint32_t   tc_fps_base(tc_fps_t fps);          // frames per label second
+int64_t    tc_frame_us(tc_fps_t fps);
+int64_t    tc_label_to_us(const tc_label_t *l, tc_fps_t fps);
+void       tc_us_to_label(int64_t us, tc_fps_t fps, tc_label_t *out);
+const char *tc_fps_name(tc_fps_t fps);
+
+// Rate detection for sources that don't state it (OSC): the highest frame
+// before a seconds rollover gives the base (only ever raised, in case
+// frames were skipped), a minute starting at frame 2 means drop-frame.
+// 30 until seen; true when the rate changed.
+typedef struct {
+    tc_fps_t   fps;
+    tc_label_t last;
+    uint8_t    max_frame;      // in the current label second
+    bool       has_last;
+    bool       known;
+} tc_rate_detect_t;
+
+void       tc_rate_reset(tc_rate_detect_t *d);
+bool       tc_rate_observe(tc_rate_detect_t *d, const tc_label_t *l);
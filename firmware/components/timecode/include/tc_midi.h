@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tc_chase.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// MIDI timecode in. Quarter frames (F1 0nnndddd) carry a label in eight
+// pieces over two frames; a full time is taken from an ascending run
+// 0..7, and piece 0 went out as the labelled frame began, so on piece 7
+// the source is 7/4 of a frame past the label. A full-frame SysEx
+// (F0 7F dev 01 01 hr mn sc fr F7) is a locate. Both carry the rate code.
+//
+// Over the network the messages come as RTP-MIDI (RFC 6295, Apple's
+// Network MIDI / rtpMIDI): a session port takes invitations and clock
+// syncs (AppleMIDI), the next port up carries RTP packets whose command
+// section is a delta-timed MIDI list with running status. Pure parsing,
+// no I/O.
+
+#define TC_MIDI_SESSION_PORT  5004     // data on the next port up
+
+typedef enum {
+    MTC_NONE = 0,
+    MTC_RUNNING,             // pos_us is where the source is now
+    MTC_LOCATE
+} mtc_kind_t;
+
+typedef struct {
+    mtc_kind_t kind;
+    tc_label_t label;
+    tc_fps_t   fps;
+    int64_t    pos_us;
+} mtc_event_t;
+
+typedef struct {
+    uint8_t nibble[8];
+    uint8_t next;            // piece expected next
+} mtc_decoder_t;
+
+// One complete MIDI message; true with ev set when it completes a time.
+bool   mtc_decode(mtc_decoder_t *d, const uint8_t *msg, size_t len, mtc_event_t *ev);
+
+// Calls fn for each MIDI message in an RTP-MIDI packet's command section;
+// the recovery journal is ignored. False if the packet is malformed.
+typedef void (*rtp_midi_fn)(const uint8_t *msg, size_t len, void *ctx);
+bool   rtp_midi_parse(const uint8_t *pkt, size_t len, rtp_midi_fn fn, void *ctx);
+
+// AppleMIDI session commands start 0xFFFF. Writes the answer to an
+// invitation (IN -> OK) or a clock sync (CK 0 -> CK 1) into out; returns
+// its length, 0 when there is nothing to answer. now is in 100 us units.
+bool   applemidi_is_command(const uint8_t *pkt, size_t len);
+size_t applemidi_reply(const uint8_t *pkt, size_t len, uint32_t ssrc, const char *name,
+                       uint64_t now, uint8_t *out, size_t cap);
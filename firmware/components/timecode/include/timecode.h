@@ -0,0 +1,93 @@
+#pragma once
+
+#include "esp_err.h"
+#include "tc_chase.h"
+#include "tc_midi.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Timecode chase: a show playhead locked to external timecode, for shows
+// run from a DAW or video playback. Sources are MTC over RTP-MIDI (a
+// Network MIDI session on TC_MIDI_SESSION_PORT, tc_midi.h) and labels sent
+// to the OSC /timecode address; the rate comes with MTC and is detected
+// from OSC labels that don't state it. The chase (tc_chase.h) smooths
+// arrival jitter, freewheels through dropouts and resyncs on jumps.
+//
+// While the playhead runs (locked or freewheeling) the effect engine takes
+// its time from it, so effect phases follow the show back and forth. A cue
+// list keyed on show time is fired through the cue handler
+// TIMECODE_PRELOAD_MS ahead, so presets are loaded before they are due;
+// after a jump, or when the show starts, the last cue at or before the
+// playhead fires at once, so the look matches wherever the show is.
+
+#define TIMECODE_MAX_CUES     64
+#define TIMECODE_PRELOAD_MS   250
+#define TIMECODE_RUN_MS       20       // timeline step while running
+#define TIMECODE_NAME_LEN     24       // as sync_cue_t
+
+typedef enum {
+    TIMECODE_SRC_NONE = 0,
+    TIMECODE_SRC_MTC,
+    TIMECODE_SRC_OSC
+} timecode_source_t;
+
+typedef struct {
+    uint32_t at_ms;                    // show time
+    uint32_t fade_ms;
+    char     target[TIMECODE_NAME_LEN];   // "ALEDch3", "group:name"
+    char     preset[TIMECODE_NAME_LEN];
+} timecode_cue_t;
+
+typedef struct {
+    tc_state_t        state;
+    timecode_source_t source;
+    tc_fps_t          fps;
+    tc_label_t        label;           // at the playhead
+    uint32_t          playhead_ms;
+    float             speed;           // 1.0 = the source runs at label rate
+    float             jitter_ms;
+    uint32_t          samples;
+    uint32_t          outliers;        // dropped as delay spikes
+    uint32_t          jumps;
+    uint32_t          dropouts;
+    uint32_t          cues_fired;
+    uint32_t          malformed;       // RTP-MIDI packets
+    uint16_t          port;            // MTC session port, 0 = off
+} timecode_status_t;
+
+// lead_ms: cue time minus the playhead as it fires; <= 0 means now. Runs
+// in the net_io task, outside the timeline lock, so it must not block:
+// hand slow work (preset loads) to another task.
+typedef void (*timecode_cue_handler_t)(const timecode_cue_t *cue, int32_t lead_ms);
+
+// Takes RTP-MIDI sessions on session_port (data on the next one up) and
+// runs the cue timeline; a new start replaces the old listener.
+esp_err_t timecode_start(uint16_t session_port);
+void      timecode_stop(void);
+// Forgets the source and the playhead; cues and settings stay.
+void      timecode_reset(void);
+
+// One MIDI message received at rx_us (esp_timer time), as the RTP-MIDI
+// receiver hands them on.
+void      timecode_feed_mtc(const uint8_t *msg, size_t len, int64_t rx_us);
+// A label from OSC: fps 24, 25, 29.97 or 30, 0 if the sender didn't say
+// (detected); drop forces 29.97 drop-frame. False if the label is invalid.
+bool      timecode_feed_label(const tc_label_t *label, float fps, bool drop, int64_t rx_us);
+
+// Show time now; false while stopped (the engine keeps its own time).
+bool      timecode_playhead_ms(uint32_t *out);
+void      timecode_get_status(timecode_status_t *out);
+
+void      timecode_set_freewheel_ms(uint32_t ms);
+uint32_t  timecode_get_freewheel_ms(void);
+
+// Replaces the cue list (sorted by at_ms here); the timeline carries on
+// from the playhead without firing what it already passed.
+esp_err_t timecode_set_cues(const timecode_cue_t *cues, int n);
+int       timecode_get_cues(timecode_cue_t *out, int max);
+void      timecode_set_cue_handler(timecode_cue_handler_t fn);
+
+// One timeline step at now_us; returns when it next needs to run. net_io
+// polls it; tests call it directly.
+int64_t   timecode_run(int64_t now_us);
@@ -0,0 +1,212 @@
+#include "tc_chase.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KP              0.1f     // share of the error taken as a phase step
+#define KI              0.0025f  // share of error / interval added to skew
+#define SKEW_MAX        0.05f    // varispeed beyond this is a different show
+#define GATE_MIN_US     5000.0f
+#define GATE_JITTERS    4.0f
+#define SETTLE_SAMPLES  8        // a resync before this many is acquisition
+#define SPIKE_MAX_US    200000   // late by more than this is no delay spike
+
+static const char *const FPS_NAMES[] = { "24", "25", "29.97df", "30" };
+
+void tc_chase_reset(tc_chase_t *c, uint32_t freewheel_ms) {
+    memset(c, 0, sizeof(*c));
+    c->jitter_us = GATE_MIN_US;
+    c->freewheel_ms = freewheel_ms;
+}
+
+static int64_t map(const tc_chase_t *c, int64_t local_us) {
+    if (c->state == TC_STOPPED) return c->ref_pos_us;
+    int64_t dt = local_us - c->ref_local_us;
+    return c->ref_pos_us + dt + (int64_t)(c->skew * (float)dt);
+}
+
+static void anchor(tc_chase_t *c, int64_t pos_us, int64_t local_us) {
+    c->ref_pos_us = pos_us;
+    c->ref_local_us = local_us;
+}
+
+void tc_chase_locate(tc_chase_t *c, int64_t pos_us, int64_t local_us) {
+    anchor(c, pos_us, local_us);
+    c->state = TC_STOPPED;
+    c->started = true;
+    c->run_outliers = 0;
+    c->last_pos_us = pos_us;
+    c->same_since_us = local_us;
+    c->last_rx_us = local_us;
+}
+
+bool tc_chase_feed(tc_chase_t *c, int64_t pos_us, int64_t local_us) {
+    c->samples++;
+    // The same position again: a source sending faster than its frame
+    // rate, or one that has stopped.
+    if (c->started && pos_us == c->last_pos_us) {
+        c->last_rx_us = local_us;
+        if (c->state != TC_STOPPED && local_us - c->same_since_us >= TC_PARK_US) {
+            tc_chase_locate(c, pos_us, local_us);
+        }
+        return false;
+    }
+    c->last_pos_us = pos_us;
+    c->same_since_us = local_us;
+    c->last_rx_us = local_us;
+
+    if (!c->started || c->state == TC_STOPPED) {
+        anchor(c, pos_us, local_us);
+        c->state = TC_LOCKED;
+        c->started = true;
+        c->run_outliers = 0;
+        c->settled = 0;
+        c->jitter_us = GATE_MIN_US;
+        return true;
+    }
+    c->state = TC_LOCKED;
+
+    int64_t dt = local_us - c->ref_local_us;
+    int64_t predicted = map(c, local_us);
+    float err = (float)(pos_us - predicted);
+
+    float gate = GATE_JITTERS * c->jitter_us;
+    if (gate < GATE_MIN_US) gate = GATE_MIN_US;
+    if (fabsf(err) > gate) {
+        // Delay spikes scatter; a jump keeps position - local steady.
+        int64_t lead = pos_us - local_us;
+        c->outliers++;
+        if (c->run_outliers) {
+            int64_t d = lead - c->jump_lead_us;
+            // The same jump, only delayed on the way: neither for nor against.
+            if (d < -(int64_t)gate && d > -SPIKE_MAX_US) return false;
+            if (llabs(d) > (int64_t)gate) c->run_outliers = 0;
+        }
+        // Keep the least delayed lead of the run to resync on.
+        if (c->run_outliers++ == 0 || lead > c->jump_lead_us) c->jump_lead_us = lead;
+        // Delay only makes samples late, and a queue draining after a spike
+        // gives a run of them: a short step back needs a longer run.
+        int need = err < 0 && err > -SPIKE_MAX_US ? 4 * TC_JUMP_AFTER : TC_JUMP_AFTER;
+        if (c->run_outliers < need) return false;
+        // Anchored on a delayed first sample, more likely than a jump.
+        if (c->settled >= SETTLE_SAMPLES) c->jumps++;
+        c->resyncs++;
+        anchor(c, local_us + c->jump_lead_us, local_us);
+        c->run_outliers = 0;
+        c->settled = 0;
+        c->jitter_us = GATE_MIN_US;
+        return true;
+    }
+    c->run_outliers = 0;
+
+    anchor(c, predicted + (int64_t)(KP * err), local_us);
+    if (dt > 0) {
+        c->skew += KI * err / (float)dt;
+        if (c->skew > SKEW_MAX) c->skew = SKEW_MAX;
+        if (c->skew < -SKEW_MAX) c->skew = -SKEW_MAX;
+    }
+    c->jitter_us += (fabsf(err) - c->jitter_us) / 8.0f;
+    if (c->settled < SETTLE_SAMPLES) c->settled++;
+    return true;
+}
+
+tc_state_t tc_chase_playhead(tc_chase_t *c, int64_t local_us, int64_t *pos_us) {
+    if (c->state != TC_STOPPED) {
+        if (c->state == TC_LOCKED && local_us - c->last_rx_us > TC_DROPOUT_US) {
+            c->state = TC_FREEWHEEL;
+            c->dropouts++;
+        }
+        // Stops where freewheeling would have got to, however late we look.
+        int64_t stop_at = c->last_rx_us + TC_DROPOUT_US + (int64_t)c->freewheel_ms * 1000;
+        if (c->state == TC_FREEWHEEL && local_us >= stop_at) {
+            anchor(c, map(c, stop_at), stop_at);
+            c->state = TC_STOPPED;
+        }
+    }
+    if (local_us < c->ref_local_us) local_us = c->ref_local_us;
+    if (pos_us) *pos_us = c->started ? map(c, local_us) : 0;
+    return c->state;
+}
+
+uint32_t tc_fps_base(tc_fps_t fps) {
+    return fps == TC_FPS_24 ? 24 : fps == TC_FPS_25 ? 25 : 30;
+}
+
+// Rounded, so converting back (which adds 1 us) lands on the same frame.
+static int64_t frames_to_us(int64_t n, tc_fps_t fps) {
+    if (fps == TC_FPS_2997DF) return (n * 1001000 + 15) / 30;
+    int64_t base = tc_fps_base(fps);
+    return (n * 1000000 + base / 2) / base;
+}
+
+int64_t tc_frame_us(tc_fps_t fps) {
+    return frames_to_us(1, fps);
+}
+
+int64_t tc_label_to_us(const tc_label_t *l, tc_fps_t fps) {
+    int64_t secs = (int64_t)l->h * 3600 + l->m * 60 + l->s;
+    int64_t n = secs * tc_fps_base(fps) + l->f;
+    if (fps == TC_FPS_2997DF) {
+        int64_t minutes = (int64_t)l->h * 60 + l->m;
+        n -= 2 * (minutes - minutes / 10);
+    }
+    return frames_to_us(n, fps);
+}
+
+void tc_us_to_label(int64_t us, tc_fps_t fps, tc_label_t *out) {
+    int64_t base = tc_fps_base(fps);
+    if (us < 0) us = 0;
+    int64_t n;
+    if (fps == TC_FPS_2997DF) {
+        // 17982 frames per ten minutes; put back the labels each minute skips.
+        n = (us + 1) * 30 / 1001000;
+        int64_t tens = n / 17982, rest = n % 17982;
+        n += 18 * tens + (rest >= 2 ? 2 * ((rest - 2) / 1798) : 0);
+    } else {
+        n = (us + 1) * base / 1000000;
+    }
+    int64_t secs = n / base;
+    out->f = (uint8_t)(n % base);
+    out->s = (uint8_t)(secs % 60);
+    out->m = (uint8_t)(secs / 60 % 60);
+    out->h = (uint8_t)(secs / 3600 % 24);
+}
+
+const char *tc_fps_name(tc_fps_t fps) {
+    return fps <= TC_FPS_30 ? FPS_NAMES[fps] : "?";
+}
+
+void tc_rate_reset(tc_rate_detect_t *d) {
+    memset(d, 0, sizeof(*d));
+    d->fps = TC_FPS_30;
+}
+
+bool tc_rate_observe(tc_rate_detect_t *d, const tc_label_t *l) {
+    tc_fps_t fps = d->fps;
+    if (d->has_last) {
+        const tc_label_t *p = &d->last;
+        if (l->s == (p->s + 1) % 60 && l->f < p->f) {
+            uint8_t top = d->max_frame;
+            tc_fps_t seen = top >= 25 ? (fps == TC_FPS_2997DF ? TC_FPS_2997DF : TC_FPS_30)
+                          : top == 24 ? TC_FPS_25 : TC_FPS_24;
+            if (top >= 23 && (!d->known || tc_fps_base(seen) > tc_fps_base(fps))) {
+                fps = seen;
+                d->known = true;
+            }
+            // Into a minute that drops labels, or one that could: from near
+            // the end of the last second, no frame 0 or 1 means drop-frame.
+            if (tc_fps_base(fps) == 30 && l->s == 0 && l->m % 10 && p->f >= 28 && l->f <= 3) {
+                fps = l->f >= 2 ? TC_FPS_2997DF : TC_FPS_30;
+            }
+            d->max_frame = 0;
+        } else if (l->s != p->s) {
+            d->max_frame = 0;
+        }
+    }
+    if (l->f > d->max_frame) d->max_frame = l->f;
+    d->last = *l;
+    d->has_last = true;
+    bool changed = fps != d->fps;
+    d->fps = fps;
+    return changed;
+}
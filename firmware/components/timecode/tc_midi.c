@@ -0,0 +1,168 @@
+#include "tc_midi.h"
+#include <string.h>
+
+#define RTP_HDR_LEN   12
+
+static void put_be32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+}
+
+static bool label_valid(const tc_label_t *l, tc_fps_t fps) {
+    return l->h < 24 && l->m < 60 && l->s < 60 && l->f < tc_fps_base(fps);
+}
+
+bool mtc_decode(mtc_decoder_t *d, const uint8_t *msg, size_t len, mtc_event_t *ev) {
+    if (len == 2 && msg[0] == 0xF1) {
+        uint8_t piece = (msg[1] >> 4) & 7;
+        if (piece != d->next) {
+            // Lost a piece or running backwards: start over at the next 0.
+            d->next = 0;
+            if (piece != 0) return false;
+        }
+        d->nibble[piece] = msg[1] & 0x0F;
+        d->next = (piece + 1) & 7;
+        if (piece != 7) return false;
+        const uint8_t *n = d->nibble;
+        ev->kind = MTC_RUNNING;
+        ev->fps = (tc_fps_t)((n[7] >> 1) & 3);
+        ev->label = (tc_label_t){
+            .h = (uint8_t)(n[6] | (n[7] & 1) << 4),
+            .m = (uint8_t)(n[4] | (n[5] & 3) << 4),
+            .s = (uint8_t)(n[2] | (n[3] & 3) << 4),
+            .f = (uint8_t)(n[0] | (n[1] & 1) << 4)
+        };
+        if (!label_valid(&ev->label, ev->fps)) return false;
+        ev->pos_us = tc_label_to_us(&ev->label, ev->fps) + tc_frame_us(ev->fps) * 7 / 4;
+        return true;
+    }
+    if (len == 10 && msg[0] == 0xF0 && msg[1] == 0x7F && msg[3] == 0x01 && msg[4] == 0x01 &&
+        msg[9] == 0xF7) {
+        ev->kind = MTC_LOCATE;
+        ev->fps = (tc_fps_t)((msg[5] >> 5) & 3);
+        ev->label = (tc_label_t){ .h = msg[5] & 0x1F, .m = msg[6], .s = msg[7], .f = msg[8] };
+        if (!label_valid(&ev->label, ev->fps)) return false;
+        ev->pos_us = tc_label_to_us(&ev->label, ev->fps);
+        d->next = 0;
+        return true;
+    }
+    return false;
+}
+
+// Data bytes after a status byte; -1 for SysEx (runs to F7).
+static int data_len(uint8_t status) {
+    if (status < 0xF0) return (status & 0xE0) == 0xC0 ? 1 : 2;
+    switch (status) {
+    case 0xF0: return -1;
+    case 0xF1: case 0xF3: return 1;
+    case 0xF2: return 2;
+    default:   return 0;
+    }
+}
+
+bool rtp_midi_parse(const uint8_t *pkt, size_t len, rtp_midi_fn fn, void *ctx) {
+    if (len < RTP_HDR_LEN || (pkt[0] >> 6) != 2) return false;
+    size_t i = RTP_HDR_LEN + 4u * (pkt[0] & 0x0F);
+    if (pkt[0] & 0x10) {
+        if (i + 4 > len) return false;
+        i += 4 + 4u * (((size_t)pkt[i + 2] << 8) | pkt[i + 3]);
+    }
+    if (i >= len) return false;
+
+    // Command section header: B J Z P LEN, LEN 12 bits when B is set.
+    uint8_t flags = pkt[i];
+    size_t n = flags & 0x0F;
+    if (flags & 0x80) {
+        if (i + 1 >= len) return false;
+        n = n << 8 | pkt[i + 1];
+        i++;
+    }
+    i++;
+    if (n > len - i) return false;
+    const uint8_t *list = pkt + i;
+
+    uint8_t running = 0;
+    size_t k = 0;
+    bool first = true;
+    while (k < n) {
+        // Delta time before every command but the first, unless Z.
+        if (!first || (flags & 0x20)) {
+            int bytes = 1;
+            while (k < n && (list[k] & 0x80) && bytes < 4) {
+                k++;
+                bytes++;
+            }
+            k++;
+            if (k >= n) return false;
+        }
+        first = false;
+
+        uint8_t msg[3];
+        uint8_t status = list[k];
+        if (status & 0x80) {
+            k++;
+        } else if (running) {
+            status = running;
+        } else {
+            return false;
+        }
+        int dl = data_len(status);
+        if (dl < 0) {
+            // Whole SysEx only; segments (ending F0) and cancels (F4) are skipped.
+            size_t end = k;
+            while (end < n && !(list[end] & 0x80)) end++;
+            if (end >= n) return false;
+            if (list[end] == 0xF7 && fn) fn(list + k - 1, end - k + 2, ctx);
+            k = end + 1;
+            running = 0;
+            continue;
+        }
+        if ((size_t)dl > n - k) return false;
+        msg[0] = status;
+        for (int b = 0; b < dl; b++) {
+            if (list[k + b] & 0x80) return false;
+            msg[1 + b] = list[k + b];
+        }
+        k += dl;
+        if (status < 0xF0) {
+            running = status;
+        } else if (status < 0xF8) {
+            running = 0;
+        }
+        if (fn) fn(msg, 1 + (size_t)dl, ctx);
+    }
+    return true;
+}
+
+bool applemidi_is_command(const uint8_t *pkt, size_t len) {
+    return len >= 4 && pkt[0] == 0xFF && pkt[1] == 0xFF;
+}
+
+size_t applemidi_reply(const uint8_t *pkt, size_t len, uint32_t ssrc, const char *name,
+                       uint64_t now, uint8_t *out, size_t cap) {
+    if (!applemidi_is_command(pkt, len)) return 0;
+    if (pkt[2] == 'I' && pkt[3] == 'N' && len >= 16) {
+        // FF FF "OK" | version 2 | the initiator's token | our SSRC | name
+        size_t name_len = strlen(name) + 1;
+        if (cap < 16 + name_len) return 0;
+        memcpy(out, "\xFF\xFFOK", 4);
+        put_be32(out + 4, 2);
+        memcpy(out + 8, pkt + 8, 4);
+        put_be32(out + 12, ssrc);
+        memcpy(out + 16, name, name_len);
+        return 16 + name_len;
+    }
+    if (pkt[2] == 'C' && pkt[3] == 'K' && len >= 36 && pkt[8] == 0) {
+        // FF FF "CK" | SSRC | count | pad | ts1 | ts2 | ts3: answer with our ts2.
+        if (cap < 36) return 0;
+        memcpy(out, pkt, 36);
+        put_be32(out + 4, ssrc);
+        out[8] = 1;
+        put_be32(out + 20, (uint32_t)(now >> 32));
+        put_be32(out + 24, (uint32_t)now);
+        return 36;
+    }
+    return 0;
+}
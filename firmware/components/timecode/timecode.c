@@ -0,0 +1,338 @@
+#include "timecode.h"
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "net_io.h"
+
+#include <string.h>
+
+static const char *TAG = "TIMECODE";
+
+#define SESSION_NAME  "lumigrid"
+
+// s_mux guards the chase and the source state: the net_io task feeds it,
+// the renderer reads the playhead every frame.
+static portMUX_TYPE      s_mux = portMUX_INITIALIZER_UNLOCKED;
+static tc_chase_t        s_chase;
+static tc_rate_detect_t  s_rate;
+static tc_fps_t          s_fps = TC_FPS_30;
+static timecode_source_t s_source = TIMECODE_SRC_NONE;
+static uint32_t          s_freewheel_ms = TC_FREEWHEEL_MS;
+static bool              s_ready = false;
+
+// s_lock guards the cue list and the timeline: set from REST, run in the
+// net_io task.
+static SemaphoreHandle_t      s_lock = NULL;
+static timecode_cue_t         s_cues[TIMECODE_MAX_CUES];
+static int                    s_count = 0;
+static int                    s_next_cue = 0;      // first cue not yet fired
+static uint32_t               s_scan_ms = 0;       // fired up to here
+static uint32_t               s_seen_resyncs = 0;
+static bool                   s_rolling = false;   // ran at the last step
+static bool                   s_reindex = false;   // list replaced since
+static uint32_t               s_cues_fired = 0;
+static timecode_cue_handler_t s_cue_handler = NULL;
+
+// net_io task only.
+static mtc_decoder_t     s_mtc;
+static int               s_session = -1;
+static int               s_data = -1;
+static uint32_t          s_ssrc = 0;
+static uint32_t          s_malformed = 0;
+// Cues due in one timeline step, copied out to fire after s_lock is given.
+static timecode_cue_t    s_due[TIMECODE_MAX_CUES];
+static int32_t           s_due_lead[TIMECODE_MAX_CUES];
+static int               s_n_due = 0;
+
+static void ensure_lock(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// Call inside s_mux.
+static void ensure_chase(void) {
+    if (!s_ready) {
+        tc_chase_reset(&s_chase, s_freewheel_ms);
+        tc_rate_reset(&s_rate);
+        s_ready = true;
+    }
+}
+
+void timecode_reset(void) {
+    portENTER_CRITICAL(&s_mux);
+    s_ready = false;
+    ensure_chase();
+    s_fps = TC_FPS_30;
+    s_source = TIMECODE_SRC_NONE;
+    portEXIT_CRITICAL(&s_mux);
+    memset(&s_mtc, 0, sizeof(s_mtc));
+    s_malformed = 0;
+
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE) {
+        s_rolling = false;
+        s_cues_fired = 0;
+        xSemaphoreGive(s_lock);
+    }
+}
+
+void timecode_feed_mtc(const uint8_t *msg, size_t len, int64_t rx_us) {
+    mtc_event_t ev;
+    if (!msg || !mtc_decode(&s_mtc, msg, len, &ev)) return;
+    portENTER_CRITICAL(&s_mux);
+    ensure_chase();
+    s_source = TIMECODE_SRC_MTC;
+    s_fps = ev.fps;
+    if (ev.kind == MTC_LOCATE) {
+        tc_chase_locate(&s_chase, ev.pos_us, rx_us);
+    } else {
+        tc_chase_feed(&s_chase, ev.pos_us, rx_us);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool timecode_feed_label(const tc_label_t *label, float fps, bool drop, int64_t rx_us) {
+    if (!label || label->h >= 24 || label->m >= 60 || label->s >= 60) return false;
+    tc_fps_t rate = TC_FPS_30;
+    bool stated = true;
+    if (drop || (fps > 29.9f && fps < 29.99f)) {
+        rate = TC_FPS_2997DF;
+    } else if (fps == 24.f) {
+        rate = TC_FPS_24;
+    } else if (fps == 25.f) {
+        rate = TC_FPS_25;
+    } else if (fps == 30.f) {
+        rate = TC_FPS_30;
+    } else if (fps == 0.f) {
+        stated = false;
+    } else {
+        return false;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    ensure_chase();
+    if (!stated) {
+        tc_rate_observe(&s_rate, label);
+        rate = s_rate.fps;
+    }
+    bool ok = label->f < tc_fps_base(rate);
+    if (ok) {
+        s_source = TIMECODE_SRC_OSC;
+        s_fps = rate;
+        tc_chase_feed(&s_chase, tc_label_to_us(label, rate), rx_us);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+bool timecode_playhead_ms(uint32_t *out) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t pos_us = 0;
+    portENTER_CRITICAL(&s_mux);
+    tc_state_t state = s_ready ? tc_chase_playhead(&s_chase, now_us, &pos_us) : TC_STOPPED;
+    portEXIT_CRITICAL(&s_mux);
+    if (state == TC_STOPPED) return false;
+    if (out) *out = (uint32_t)(pos_us / 1000);
+    return true;
+}
+
+void timecode_get_status(timecode_status_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    int64_t now_us = esp_timer_get_time();
+    int64_t pos_us = 0;
+    portENTER_CRITICAL(&s_mux);
+    ensure_chase();
+    out->state = tc_chase_playhead(&s_chase, now_us, &pos_us);
+    out->source = s_source;
+    out->fps = s_fps;
+    out->speed = 1.f + s_chase.skew;
+    out->jitter_ms = s_chase.jitter_us / 1000.f;
+    out->samples = s_chase.samples;
+    out->outliers = s_chase.outliers;
+    out->jumps = s_chase.jumps;
+    out->dropouts = s_chase.dropouts;
+    portEXIT_CRITICAL(&s_mux);
+    out->playhead_ms = (uint32_t)(pos_us / 1000);
+    tc_us_to_label(pos_us, out->fps, &out->label);
+    out->cues_fired = s_cues_fired;
+    out->malformed = s_malformed;
+    out->port = s_session >= 0 ? net_io_port(s_session) : 0;
+}
+
+void timecode_set_freewheel_ms(uint32_t ms) {
+    portENTER_CRITICAL(&s_mux);
+    ensure_chase();
+    s_freewheel_ms = ms;
+    s_chase.freewheel_ms = ms;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+uint32_t timecode_get_freewheel_ms(void) {
+    return s_freewheel_ms;
+}
+
+esp_err_t timecode_set_cues(const timecode_cue_t *cues, int n) {
+    if (n < 0 || n > TIMECODE_MAX_CUES || (n && !cues)) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < n; i++) {
+        if (!cues[i].target[0] || !cues[i].preset[0]) return ESP_ERR_INVALID_ARG;
+    }
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return ESP_FAIL;
+    // Insertion sort: stable, so cues at the same time fire in given order.
+    for (int i = 0; i < n; i++) {
+        int j = i;
+        while (j > 0 && s_cues[j - 1].at_ms > cues[i].at_ms) {
+            s_cues[j] = s_cues[j - 1];
+            j--;
+        }
+        s_cues[j] = cues[i];
+        s_cues[j].target[TIMECODE_NAME_LEN - 1] = '\0';
+        s_cues[j].preset[TIMECODE_NAME_LEN - 1] = '\0';
+    }
+    s_count = n;
+    s_reindex = true;
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+int timecode_get_cues(timecode_cue_t *out, int max) {
+    if (!out || max <= 0) return 0;
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return 0;
+    int n = s_count < max ? s_count : max;
+    memcpy(out, s_cues, (size_t)n * sizeof(*out));
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+void timecode_set_cue_handler(timecode_cue_handler_t fn) {
+    s_cue_handler = fn;
+}
+
+// Call with s_lock held. Index of the first cue after ms.
+static int first_after(uint32_t ms) {
+    int i = 0;
+    while (i < s_count && s_cues[i].at_ms <= ms) i++;
+    return i;
+}
+
+// Call with s_lock held. Each cue fires at most once per step, so s_due
+// never overflows.
+static void fire(int i, uint32_t playhead_ms) {
+    s_cues_fired++;
+    s_due[s_n_due] = s_cues[i];
+    s_due_lead[s_n_due++] = (int32_t)(s_cues[i].at_ms - playhead_ms);
+}
+
+int64_t timecode_run(int64_t now_us) {
+    int64_t next_us = now_us + TIMECODE_RUN_MS * 1000;
+    int64_t pos_us = 0;
+    portENTER_CRITICAL(&s_mux);
+    tc_state_t state = s_ready ? tc_chase_playhead(&s_chase, now_us, &pos_us) : TC_STOPPED;
+    // Every resync moves the playhead, a second one while settling too.
+    uint32_t resyncs = s_chase.resyncs;
+    portEXIT_CRITICAL(&s_mux);
+
+    ensure_lock();
+    if (xSemaphoreTake(s_lock, portMAX_DELAY) != pdTRUE) return next_us;
+    if (state == TC_STOPPED) {
+        s_rolling = false;
+        xSemaphoreGive(s_lock);
+        return next_us;
+    }
+    uint32_t pos = (uint32_t)(pos_us / 1000);
+    if (!s_rolling || resyncs != s_seen_resyncs) {
+        // Chase into the show: the last cue already passed sets the look.
+        s_next_cue = first_after(pos);
+        if (s_next_cue > 0) fire(s_next_cue - 1, pos);
+        s_scan_ms = pos;
+        s_rolling = true;
+        s_seen_resyncs = resyncs;
+    } else if (s_reindex) {
+        s_next_cue = first_after(s_scan_ms);
+    }
+    s_reindex = false;
+
+    uint32_t horizon = pos + TIMECODE_PRELOAD_MS;
+    while (s_next_cue < s_count && s_cues[s_next_cue].at_ms <= horizon) {
+        fire(s_next_cue++, pos);
+    }
+    if (horizon > s_scan_ms) s_scan_ms = horizon;
+    timecode_cue_handler_t handler = s_cue_handler;
+    int n_due = s_n_due;
+    s_n_due = 0;
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; handler && i < n_due; i++) {
+        handler(&s_due[i], s_due_lead[i]);
+    }
+    return next_us;
+}
+
+static void on_midi(const uint8_t *msg, size_t len, void *ctx) {
+    timecode_feed_mtc(msg, len, *(const int64_t *)ctx);
+}
+
+static void answer(int handle, const uint8_t *buf, size_t len, const struct sockaddr_in *src) {
+    uint8_t out[64];
+    uint64_t now = (uint64_t)(esp_timer_get_time() / 100);
+    size_t n = applemidi_reply(buf, len, s_ssrc, SESSION_NAME, now, out, sizeof(out));
+    if (n && sendto(net_io_socket(handle), out, n, 0, (const struct sockaddr *)src, sizeof(*src)) < 0) {
+        ESP_LOGW(TAG, "Session reply failed");
+    }
+}
+
+static void session_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                       int64_t rx_us, void *ctx) {
+    answer(s_session, buf, len, src);
+}
+
+static void data_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                    int64_t rx_us, void *ctx) {
+    if (applemidi_is_command(buf, len)) {
+        answer(s_data, buf, len, src);
+    } else if (!rtp_midi_parse(buf, len, on_midi, &rx_us)) {
+        s_malformed++;
+    }
+}
+
+static int64_t timeline_poll(int64_t now_us, void *ctx) {
+    return timecode_run(now_us);
+}
+
+esp_err_t timecode_start(uint16_t session_port) {
+    timecode_stop();
+    timecode_reset();
+    s_ssrc = esp_random();
+    net_io_proto_t session = { .name = "rtpmidi", .port = session_port, .rx = session_rx };
+    s_session = net_io_register(&session);
+    if (s_session < 0) {
+        ESP_LOGE(TAG, "No socket for port %u", session_port);
+        return ESP_FAIL;
+    }
+    uint16_t data_port = net_io_port(s_session) + 1;
+    net_io_proto_t data = {
+        .name = "rtpmidi-data", .port = data_port, .rx = data_rx, .poll = timeline_poll
+    };
+    s_data = net_io_register(&data);
+    if (s_data < 0) {
+        ESP_LOGE(TAG, "No socket for port %u", data_port);
+        timecode_stop();
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "RTP-MIDI session on port %u", net_io_port(s_session));
+    return ESP_OK;
+}
+
+void timecode_stop(void) {
+    net_io_unregister(s_data);
+    net_io_unregister(s_session);
+    s_data = -1;
+    s_session = -1;
+}
@@ -22,5 +22,10 @@ static const gpio_num_t ALED_GPIO[8] = {
 // Boot
 #define BOOT_IO GPIO_NUM_0
 
-// Logical PWM mapping: LEDch1..8 -> PCA9685 channels 0..7
-static const uint8_t LEDCH_TO_PCA[8] = { 0,1,2,3,4,5,6,7 };
+// PCA9685 chips on the bus in channel order: chip n drives channels n*16..n*16+15
+static const uint8_t PCA9685_ADDRS[] = { PCA9685_I2C_ADDR };
+
+// Logical PWM mapping: LEDch1..N -> PCA9685 channel (chip * 16 + output).
+// EXP header outputs 8..15 stay unmapped on this board; add chips above and
+// entries here to drive more (up to PWM_MAX_CHANNELS).
+static const uint8_t LEDCH_TO_PCA[] = { 0,1,2,3,4,5,6,7 };
@@ -6,14 +6,32 @@
 #include "rest_api.h"
 #include "ui_server.h"
 #include "sync_protocol.h"
+#include "net_io.h"
+#include "frame_cast.h"
 #include "mqtt_wrapper.h"
 #include "task_effect_engine.h"
 #include "task_pwm_driver.h"
+#include "task_sync_manager.h"
 #include "trigger_engine.h"
+#include "power_budget.h"
+#include "pixel_stream.h"
+#include "dmx_personality.h"
+#include "ddp_out.h"
+#include "osc.h"
+#include "timecode.h"
+#include "audio_feed.h"
+#include "esp_timer.h"
 #include "esp_log.h"
+#include "nvs.h"
 #include "driver/gpio.h"
+#include "lwip/inet.h"
 
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "INIT";
 
 static bool rest_bridge_set_base(int ch, const effect_params_t *params, uint32_t fade_ms){
     return effect_engine_set_base(ch, params, fade_ms);
@@ -42,6 +60,29 @@ static void rest_bridge_get_power_scale(float *out, size_t len){
     }
 }
 
+static void rest_bridge_get_fps(uint16_t *out, size_t len){
+    if (!out || len == 0){
+        return;
+    }
+    effect_engine_stats_t stats;
+    effect_engine_get_stats(&stats);
+    for (size_t i = 0; i < len; ++i){
+        out[i] = i < EFFECT_ENGINE_CH_MAX ? stats.fps[i] : 0;
+    }
+}
+
+static void rest_bridge_get_hdr(bool *on, bool *failed, size_t len){
+    if (!on || !failed || len == 0){
+        return;
+    }
+    effect_engine_stats_t stats;
+    effect_engine_get_stats(&stats);
+    for (size_t i = 0; i < len; ++i){
+        on[i] = i < EFFECT_ENGINE_CH_MAX && stats.hdr[i];
+        failed[i] = i < EFFECT_ENGINE_CH_MAX && stats.hdr_failed[i];
+    }
+}
+
 static const rest_api_effect_ops_t REST_EFFECT_OPS = {
     .set_base = rest_bridge_set_base,
     .set_overlay = rest_bridge_set_overlay,
@@ -49,7 +90,17 @@ static const rest_api_effect_ops_t REST_EFFECT_OPS = {
     .get_power_scale = rest_bridge_get_power_scale,
     .channel_count = effect_engine_channel_count,
     .get_channel_info = effect_engine_get_channel_info,
-    .set_channel_type = effect_engine_set_channel_type
+    .set_channel_type = effect_engine_set_channel_type,
+    .set_channel_output = effect_engine_set_channel_output,
+    .get_fps = rest_bridge_get_fps,
+    .get_hdr = rest_bridge_get_hdr,
+    .set_channel_calib = effect_engine_set_channel_calib,
+    .get_channel_calib = effect_engine_get_channel_calib,
+    .set_channel_canvas = effect_engine_set_channel_canvas,
+    .get_channel_canvas = effect_engine_get_channel_canvas,
+    .pwm_group_channel = effect_engine_pwm_group_channel,
+    .release_pwm_group = effect_engine_release_pwm_group,
+    .schedule_base = effect_engine_schedule_base
 };
 
 static const rest_api_pwm_ops_t REST_PWM_OPS = {
@@ -61,19 +112,609 @@ static const rest_api_pwm_ops_t REST_PWM_OPS = {
     .get_group = pwm_groups_get,
     .replace_groups = pwm_groups_replace,
     .group_set_rgb = pwm_group_set_rgb,
-    .group_set_rgbw = pwm_group_set_rgbw
+    .group_set_rgbw = pwm_group_set_rgbw,
+    .set_load_mA = pwm_set_load_mA,
+    .get_load_mA = pwm_get_load_mA,
+    .fade_to = pwm_fade_to,
+    .group_fade = pwm_group_fade,
+    .set_soft_start_ms = pwm_set_soft_start_ms,
+    .get_soft_start_ms = pwm_get_soft_start_ms,
+    .set_curve = pwm_set_curve,
+    .get_curve = pwm_get_curve,
+    .channel_count = pwm_channel_count,
+    .blackout = pwm_blackout,
+    .set_dither = pwm_set_dither,
+    .get_dither = pwm_get_dither,
+    .set_dither_budget = pwm_set_dither_budget,
+    .get_dither_budget = pwm_get_dither_budget
 };
 
+// The beat goes into the sync show state as well, so a master hands it to
+// every slave with the next tick.
 static void rest_bridge_set_beat(float phase){
     trigger_set_beat(phase);
+    sync_protocol_set_beat(phase);
 }
 
 static const rest_api_trigger_ops_t REST_TRIGGER_OPS = {
     .set_beat = rest_bridge_set_beat,
+    .set_tempo = sync_protocol_set_tempo,
     .strobe = trigger_strobe
 };
 
-static const char *TAG = "INIT";
+static int rest_bridge_sync_masters(rest_api_sync_master_t *out, int max){
+    sync_peer_stats_t peers[4];
+    int n = sync_protocol_master_stats(peers, max < 4 ? max : 4);
+    for (int i = 0; i < n; ++i){
+        out[i] = (rest_api_sync_master_t){
+            .addr = peers[i].addr,
+            .received = peers[i].received,
+            .lost = peers[i].lost,
+            .reordered = peers[i].reordered,
+            .jitter_us = peers[i].jitter_us
+        };
+    }
+    return n;
+}
+
+static bool rest_bridge_send_cue(const char *target, const char *preset, uint32_t preset_crc,
+                                 uint32_t fade_ms, int64_t t0_us, uint32_t *cue_id){
+    sync_cue_t cue = {
+        .t0_us = t0_us,
+        .fade_ms = fade_ms,
+        .preset_crc = preset_crc
+    };
+    strncpy(cue.target, target, sizeof(cue.target) - 1);
+    strncpy(cue.preset, preset, sizeof(cue.preset) - 1);
+    if (sync_protocol_send_cue(&cue) != ESP_OK){
+        return false;
+    }
+    if (cue_id){
+        *cue_id = cue.cue_id;
+    }
+    return true;
+}
+
+// The sync role lives in NVS next to the Wi-Fi credentials; a node that was
+// never configured follows a master, as in default_config.json.
+#define SYNC_ROLE_DEFAULT SYNC_ROLE_SLAVE
+
+static sync_role_t sync_role_load(void){
+    uint8_t role = SYNC_ROLE_DEFAULT;
+    nvs_handle_t nvs;
+    if (nvs_open("sync", NVS_READONLY, &nvs) == ESP_OK){
+        nvs_get_u8(nvs, "role", &role);
+        nvs_close(nvs);
+    }
+    return role <= SYNC_ROLE_SLAVE ? (sync_role_t)role : SYNC_ROLE_DEFAULT;
+}
+
+static esp_err_t sync_role_save(sync_role_t role){
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("sync", NVS_READWRITE, &nvs);
+    if (err != ESP_OK){
+        return err;
+    }
+    err = nvs_set_u8(nvs, "role", (uint8_t)role);
+    if (err == ESP_OK){
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+static bool rest_bridge_set_role(const char *name){
+    sync_role_t role;
+    if (!sync_role_parse(name, &role) || sync_protocol_set_role(role) != ESP_OK){
+        return false;
+    }
+    if (sync_role_save(role) != ESP_OK){
+        ESP_LOGW(TAG, "Sync role not saved");
+    }
+    return true;
+}
+
+static const char *rest_bridge_get_role(void){
+    return sync_role_name(sync_protocol_get_role());
+}
+
+static bool rest_bridge_set_frame_cast(const char *mode){
+    frame_cast_mode_t m;
+    return frame_cast_mode_parse(mode, &m) && frame_cast_set_mode(m) == ESP_OK;
+}
+
+static const char *rest_bridge_get_frame_cast(void){
+    return frame_cast_mode_name(frame_cast_get_mode());
+}
+
+static void rest_bridge_frame_cast_stats(rest_api_frame_cast_stats_t *out){
+    frame_cast_stats_t st;
+    frame_cast_get_stats(&st);
+    out->frames = st.frames;
+    out->keyframes = st.keyframes;
+    out->packets = st.packets;
+    out->raw_bytes = st.raw_bytes;
+    out->wire_bytes = st.wire_bytes;
+    out->dropped = st.dropped;
+    out->malformed = st.malformed;
+    out->restarts = st.restarts;
+}
+
+static const rest_api_sync_ops_t REST_SYNC_OPS = {
+    .set_tick_hz = sync_protocol_set_tick_hz,
+    .get_tick_hz = sync_protocol_get_tick_hz,
+    .scene_gen = sync_protocol_scene_gen,
+    .masters = rest_bridge_sync_masters,
+    .now_us = sync_now_us,
+    .send_cue = rest_bridge_send_cue,
+    .set_role = rest_bridge_set_role,
+    .get_role = rest_bridge_get_role,
+    .set_frame_cast = rest_bridge_set_frame_cast,
+    .get_frame_cast = rest_bridge_get_frame_cast,
+    .frame_cast_stats = rest_bridge_frame_cast_stats
+};
+
+// Bytes per pixel on the wire follow the strip type.
+static bool rest_bridge_stream_set_map(int ch, const rest_api_stream_map_t *map){
+    led_type_t type = LED_WS2812B;
+    color_order_t order;
+    uint16_t pixels;
+    effect_engine_get_channel_info(ch, &type, &order, &pixels);
+    pixel_stream_map_t m = {
+        .n_pixels = map->pixels,
+        .universe = map->universe,
+        .ddp_offset = map->ddp_offset,
+        .rgbw = type == LED_SK6812_RGBW,
+        .latency_ms = map->latency_ms,
+        .conceal_blend = map->conceal_blend
+    };
+    return pixel_stream_set_map(ch, &m) == ESP_OK;
+}
+
+static bool rest_bridge_stream_get_map(int ch, rest_api_stream_map_t *out){
+    pixel_stream_map_t m;
+    if (!pixel_stream_get_map(ch, &m)){
+        return false;
+    }
+    *out = (rest_api_stream_map_t){
+        .pixels = m.n_pixels,
+        .universe = m.universe,
+        .ddp_offset = m.ddp_offset,
+        .latency_ms = m.latency_ms,
+        .conceal_blend = m.conceal_blend
+    };
+    return true;
+}
+
+static void rest_bridge_stream_stats(rest_api_stream_stats_t *out){
+    pixel_stream_stats_t st;
+    pixel_stream_get_stats(&st);
+    *out = (rest_api_stream_stats_t){
+        .packets_ddp = st.packets[PIXEL_STREAM_DDP],
+        .packets_e131 = st.packets[PIXEL_STREAM_E131],
+        .packets_artnet = st.packets[PIXEL_STREAM_ARTNET],
+        .bad = st.bad,
+        .frames = st.frames,
+        .late = st.late,
+        .dropped = st.dropped,
+        .concealed = st.concealed
+    };
+}
+
+static int rest_bridge_stream_channels(rest_api_stream_channel_t *out, int max){
+    pixel_stream_stats_t st;
+    pixel_stream_get_stats(&st);
+    int n = 0;
+    for (int ch = 0; ch < PIXEL_STREAM_CHANNELS && n < max; ch++){
+        if (!pixel_stream_active(ch)){
+            continue;
+        }
+        const pixel_stream_ch_stats_t *c = &st.ch[ch];
+        out[n++] = (rest_api_stream_channel_t){
+            .ch = ch,
+            .depth = c->depth,
+            .period_ms = c->period_ms,
+            .shown = c->shown,
+            .late = c->late,
+            .dropped = c->dropped,
+            .concealed = c->concealed
+        };
+    }
+    return n;
+}
+
+static const rest_api_stream_ops_t REST_STREAM_OPS = {
+    .set_map = rest_bridge_stream_set_map,
+    .get_map = rest_bridge_stream_get_map,
+    .get_stats = rest_bridge_stream_stats,
+    .channels = rest_bridge_stream_channels
+};
+
+// DMX personality outputs. Desk levels jump (the desk does the fading); a
+// group the desk drives is taken back from the effect engine.
+static void dmx_bridge_pwm_level(uint8_t ch, uint16_t level){
+    pwm_fade_to(ch, level / 65535.f, 0, false);
+}
+
+static void dmx_bridge_group_level(const char *group, const uint16_t level[4]){
+    effect_engine_release_pwm_group(group);
+    pwm_group_stream(group, level);
+}
+
+// Runs on net_io: queued to the engine like OSC, never waiting on its lock.
+static bool dmx_bridge_set_effect(int ch, const effect_params_t *params){
+    effect_live_t cmd = { .op = EFFECT_LIVE_PARAMS, .ch = ch, .params = *params };
+    return effect_engine_live(&cmd);
+}
+
+static const dmx_personality_ops_t DMX_OPS = {
+    .pwm_level = dmx_bridge_pwm_level,
+    .group_level = dmx_bridge_group_level,
+    .set_effect = dmx_bridge_set_effect,
+    .get_effect = effect_engine_get_base
+};
+
+// "LEDchN" for levels, "group:<name>" for colours, "ALEDchN" for effect fields.
+static bool dmx_parse_target(dmx_slot_map_t *m, const char *target){
+    const char *prefix;
+    int max;
+    switch (m->field){
+        case DMX_FIELD_LEVEL8:
+        case DMX_FIELD_LEVEL16:
+            prefix = "LEDch";
+            max = pwm_channel_count();
+            break;
+        case DMX_FIELD_RGB:
+        case DMX_FIELD_RGBW:
+            if (strncmp(target, "group:", 6) != 0 || !target[6]){
+                return false;
+            }
+            strncpy(m->group, target + 6, sizeof(m->group) - 1);
+            return true;
+        default:
+            prefix = "ALEDch";
+            max = effect_engine_channel_count();
+            break;
+    }
+    size_t len = strlen(prefix);
+    char *end = NULL;
+    long n = strncmp(target, prefix, len) == 0 ? strtol(target + len, &end, 10) : 0;
+    if (!end || *end != '\0' || n < 1 || n > max){
+        return false;
+    }
+    m->ch = (uint8_t)(n - 1);
+    return true;
+}
+
+static void dmx_bridge_listen(void){
+    uint16_t first = 0, count = 0;
+    if (dmx_personality_universes(&first, &count)){
+        pixel_stream_set_dmx(dmx_personality_apply, first, count);
+    } else {
+        pixel_stream_set_dmx(NULL, 0, 0);
+    }
+}
+
+static bool rest_bridge_dmx_set(const rest_api_dmx_slot_t *slots, int n){
+    if (n > DMX_PERSONALITY_MAX){
+        return false;
+    }
+    dmx_slot_map_t *table = calloc(n ? n : 1, sizeof(*table));
+    if (!table){
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < n && ok; i++){
+        table[i].universe = slots[i].universe;
+        table[i].slot = slots[i].slot;
+        ok = dmx_field_parse(slots[i].field, &table[i].field) &&
+             dmx_parse_target(&table[i], slots[i].target);
+        if (!ok){
+            ESP_LOGW(TAG, "DMX entry %d: bad field '%s' or target '%s'", i, slots[i].field, slots[i].target);
+        }
+    }
+    ok = ok && dmx_personality_set(table, n) == ESP_OK;
+    free(table);
+    if (ok){
+        dmx_bridge_listen();
+    }
+    return ok;
+}
+
+static int rest_bridge_dmx_get(rest_api_dmx_slot_t *out, int max){
+    dmx_slot_map_t *table = calloc(DMX_PERSONALITY_MAX, sizeof(*table));
+    if (!table){
+        return 0;
+    }
+    int n = dmx_personality_get(table, max < DMX_PERSONALITY_MAX ? max : DMX_PERSONALITY_MAX);
+    for (int i = 0; i < n; i++){
+        const dmx_slot_map_t *m = &table[i];
+        out[i] = (rest_api_dmx_slot_t){ .universe = m->universe, .slot = m->slot };
+        strncpy(out[i].field, dmx_field_name(m->field), sizeof(out[i].field) - 1);
+        if (m->field == DMX_FIELD_RGB || m->field == DMX_FIELD_RGBW){
+            snprintf(out[i].target, sizeof(out[i].target), "group:%s", m->group);
+        } else {
+            snprintf(out[i].target, sizeof(out[i].target), "%s%d",
+                     m->field <= DMX_FIELD_LEVEL16 ? "LEDch" : "ALEDch", m->ch + 1);
+        }
+    }
+    free(table);
+    return n;
+}
+
+static void rest_bridge_dmx_stats(rest_api_dmx_stats_t *out){
+    dmx_personality_stats_t st;
+    dmx_personality_get_stats(&st);
+    *out = (rest_api_dmx_stats_t){
+        .universes = st.universes,
+        .unchanged = st.unchanged,
+        .pwm_writes = st.pwm_writes,
+        .group_writes = st.group_writes,
+        .effect_updates = st.effect_updates
+    };
+}
+
+static const rest_api_dmx_ops_t REST_DMX_OPS = {
+    .set_table = rest_bridge_dmx_set,
+    .get_table = rest_bridge_dmx_get,
+    .get_stats = rest_bridge_dmx_stats
+};
+
+// DDP output channels: the engine renders, ddp_out sends. Pixels with a
+// bad host are rejected and leave the channel off.
+static bool rest_bridge_ddp_set(int v, const rest_api_ddp_channel_t *cfg){
+    struct in_addr addr = {0};
+    bool on = cfg->pixels && inet_aton(cfg->host, &addr) && addr.s_addr;
+    ddp_out_target_t t = {
+        .addr = on ? addr.s_addr : 0,
+        .port = cfg->port,
+        .offset = cfg->offset
+    };
+    bool ok = ddp_out_set_target(v, &t) == ESP_OK &&
+              effect_engine_set_ddp_channel(v, on ? cfg->pixels : 0,
+                                            cfg->rgbw ? LED_SK6812_RGBW : LED_WS2812B);
+    return ok && (on || !cfg->pixels);
+}
+
+static bool rest_bridge_ddp_get(int v, rest_api_ddp_channel_t *out){
+    ddp_out_target_t t;
+    led_type_t type;
+    memset(out, 0, sizeof(*out));
+    if (!ddp_out_get_target(v, &t) || !effect_engine_get_ddp_channel(v, &out->pixels, &type)){
+        return false;
+    }
+    struct in_addr addr = { .s_addr = t.addr };
+    out->rgbw = type == LED_SK6812_RGBW;
+    strncpy(out->host, inet_ntoa(addr), sizeof(out->host) - 1);
+    out->port = t.port;
+    out->offset = t.offset;
+    return true;
+}
+
+static void rest_bridge_ddp_stats(int v, rest_api_ddp_stats_t *out){
+    ddp_out_stats_t st;
+    ddp_out_get_stats(v, &st);
+    *out = (rest_api_ddp_stats_t){
+        .frames = st.frames,
+        .packets = st.packets,
+        .busy = st.busy,
+        .errors = st.errors
+    };
+}
+
+static const rest_api_ddp_ops_t REST_DDP_OPS = {
+    .channel = effect_engine_ddp_channel,
+    .set_channel = rest_bridge_ddp_set,
+    .get_channel = rest_bridge_ddp_get,
+    .get_stats = rest_bridge_ddp_stats
+};
+
+static void rest_bridge_tc_status(rest_api_timecode_status_t *out){
+    static const char *const STATES[] = { "stopped", "locked", "freewheel" };
+    static const char *const SOURCES[] = { "none", "mtc", "osc" };
+    timecode_status_t st;
+    timecode_get_status(&st);
+    *out = (rest_api_timecode_status_t){
+        .state = STATES[st.state],
+        .source = SOURCES[st.source],
+        .fps = tc_fps_name(st.fps),
+        .playhead_ms = st.playhead_ms,
+        .speed = st.speed,
+        .jitter_ms = st.jitter_ms,
+        .samples = st.samples,
+        .outliers = st.outliers,
+        .jumps = st.jumps,
+        .dropouts = st.dropouts,
+        .cues_fired = st.cues_fired,
+        .malformed = st.malformed,
+        .port = st.port
+    };
+    snprintf(out->label, sizeof(out->label), "%02u:%02u:%02u%c%02u", st.label.h, st.label.m,
+             st.label.s, st.fps == TC_FPS_2997DF ? ';' : ':', st.label.f);
+}
+
+static bool rest_bridge_tc_set_cues(const rest_api_timecode_cue_t *cues, int n){
+    timecode_cue_t *tmp = calloc(n > 0 ? n : 1, sizeof(*tmp));
+    if (!tmp){
+        return false;
+    }
+    for (int i = 0; i < n; ++i){
+        tmp[i].at_ms = cues[i].at_ms;
+        tmp[i].fade_ms = cues[i].fade_ms;
+        strncpy(tmp[i].target, cues[i].target, sizeof(tmp[i].target) - 1);
+        strncpy(tmp[i].preset, cues[i].preset, sizeof(tmp[i].preset) - 1);
+    }
+    esp_err_t err = timecode_set_cues(tmp, n);
+    free(tmp);
+    return err == ESP_OK;
+}
+
+static int rest_bridge_tc_get_cues(rest_api_timecode_cue_t *out, int max){
+    timecode_cue_t *tmp = calloc(max > 0 ? max : 1, sizeof(*tmp));
+    int n = tmp ? timecode_get_cues(tmp, max) : 0;
+    for (int i = 0; i < n; ++i){
+        out[i] = (rest_api_timecode_cue_t){ .at_ms = tmp[i].at_ms, .fade_ms = tmp[i].fade_ms };
+        strncpy(out[i].target, tmp[i].target, sizeof(out[i].target) - 1);
+        strncpy(out[i].preset, tmp[i].preset, sizeof(out[i].preset) - 1);
+    }
+    free(tmp);
+    return n;
+}
+
+static void rest_bridge_audio_stats(rest_api_audio_stats_t *out){
+    audio_feed_stats_t st;
+    audio_feed_get_stats(&st);
+    fx_audio_t now = {0};
+    audio_feed_read(esp_timer_get_time(), &now);
+    *out = (rest_api_audio_stats_t){
+        .live = now.live,
+        .port = audio_feed_port(),
+        .packets = st.packets,
+        .malformed = st.malformed,
+        .lost = st.lost,
+        .stale = st.stale,
+        .restarts = st.restarts,
+        .beat_snaps = st.beat_snaps,
+        .level = now.level,
+        .tempo_bpm = now.tempo_bpm
+    };
+}
+
+static const rest_api_audio_ops_t REST_AUDIO_OPS = {
+    .get_stats = rest_bridge_audio_stats
+};
+
+static const rest_api_timecode_ops_t REST_TIMECODE_OPS = {
+    .get_status = rest_bridge_tc_status,
+    .set_cues = rest_bridge_tc_set_cues,
+    .get_cues = rest_bridge_tc_get_cues,
+    .set_freewheel_ms = timecode_set_freewheel_ms,
+    .get_freewheel_ms = timecode_get_freewheel_ms
+};
+
+// OSC runs on the net_io task: strip and group changes go through the
+// engine's live queue, PWM levels, beats and strobes are lock-free already.
+static bool osc_bridge_effect(int ch, uint32_t effect_id){
+    effect_live_t cmd = { .op = EFFECT_LIVE_EFFECT, .ch = ch, .effect_id = effect_id };
+    return ch < EFFECT_ENGINE_CH_MAX && effect_engine_live(&cmd);
+}
+
+static bool osc_bridge_intensity(int ch, float level){
+    effect_live_t cmd = { .op = EFFECT_LIVE_INTENSITY, .ch = ch, .level = { level } };
+    return ch < EFFECT_ENGINE_CH_MAX && effect_engine_live(&cmd);
+}
+
+static bool osc_bridge_pwm(int ch, float level){
+    int n = pwm_channel_count();
+    if (ch >= n){
+        return false;
+    }
+    for (int i = ch < 0 ? 0 : ch; i < (ch < 0 ? n : ch + 1); ++i){
+        pwm_set_mode_static((uint8_t)i, level);
+    }
+    return true;
+}
+
+static bool osc_bridge_group_rgb(const char *group, const float rgbw[4], bool has_w){
+    effect_live_t cmd = { .op = EFFECT_LIVE_GROUP_RGB, .ch = 0, .has_w = has_w };
+    memcpy(cmd.level, rgbw, sizeof(cmd.level));
+    strncpy(cmd.group, group, sizeof(cmd.group) - 1);
+    return effect_engine_live(&cmd);
+}
+
+// A tap is a downbeat; a tempo with it re-anchors first.
+static void osc_bridge_beat(float bpm){
+    if (bpm > 0.f){
+        sync_protocol_set_tempo(bpm);
+    }
+    rest_bridge_set_beat(0.f);
+}
+
+// Labels are stamped on arrival; the chase takes the network jitter out.
+static bool osc_bridge_timecode(const uint8_t hmsf[4], float fps, bool drop){
+    tc_label_t label = { .h = hmsf[0], .m = hmsf[1], .s = hmsf[2], .f = hmsf[3] };
+    return timecode_feed_label(&label, fps, drop, esp_timer_get_time());
+}
+
+static const osc_ops_t OSC_OPS = {
+    .effect = osc_bridge_effect,
+    .intensity = osc_bridge_intensity,
+    .pwm = osc_bridge_pwm,
+    .group_rgb = osc_bridge_group_rgb,
+    .beat = osc_bridge_beat,
+    .strobe = trigger_strobe,
+    .timecode = osc_bridge_timecode
+};
+
+// Cues from the master arrive on the net_io task: the sync manager loads the
+// preset, the engine switches at t0.
+static void sync_bridge_cue(const sync_cue_t *cue){
+    sync_manager_cue_t job = {
+        .at_ms = (uint32_t)(cue->t0_us / 1000),
+        .fade_ms = cue->fade_ms,
+        .preset_crc = cue->preset_crc,
+        .origin = "sync"
+    };
+    strncpy(job.target, cue->target, sizeof(job.target) - 1);
+    strncpy(job.preset, cue->preset, sizeof(job.preset) - 1);
+    if (!task_sync_manager_post(&job)){
+        ESP_LOGW(TAG, "Cue %lu (%s on %s) dropped: queue full", (unsigned long)cue->cue_id,
+                 cue->preset, cue->target);
+    }
+}
+
+// Show cues fire TIMECODE_PRELOAD_MS ahead: the sync manager loads the
+// preset, the engine switches when due on the sync clock (at once for cues
+// already passed).
+static void timecode_bridge_cue(const timecode_cue_t *cue, int32_t lead_ms){
+    sync_manager_cue_t job = {
+        .at_ms = (uint32_t)(sync_now_us() / 1000) + (uint32_t)(lead_ms > 0 ? lead_ms : 0),
+        .fade_ms = cue->fade_ms,
+        .origin = "show"
+    };
+    strncpy(job.target, cue->target, sizeof(job.target) - 1);
+    strncpy(job.preset, cue->preset, sizeof(job.preset) - 1);
+    if (!task_sync_manager_post(&job)){
+        ESP_LOGW(TAG, "Show cue at %lu ms (%s on %s) dropped: queue full", (unsigned long)cue->at_ms,
+                 cue->preset, cue->target);
+    }
+}
+
+static void rest_bridge_set_power_limits(const rest_api_power_limits_t *limits){
+    power_cfg_t cfg = {
+        .limit_mA = limits->aled_mA,
+        .psu_mA = limits->psu_mA,
+        .burst_mA = limits->burst_mA,
+        .burst_window_ms = limits->burst_window_ms
+    };
+    power_set_cfg(cfg);
+}
+
+static void rest_bridge_get_power_limits(rest_api_power_limits_t *out){
+    const power_cfg_t *cfg = power_get_cfg();
+    out->aled_mA = cfg->limit_mA;
+    out->psu_mA = cfg->psu_mA;
+    out->burst_mA = cfg->burst_mA;
+    out->burst_window_ms = cfg->burst_window_ms;
+}
+
+static void rest_bridge_get_channel_mA(float *out, size_t len){
+    for (size_t i = 0; i < len; ++i){
+        out[i] = power_channel_mA((int)i);
+    }
+}
+
+static const rest_api_power_ops_t REST_POWER_OPS = {
+    .set_limits = rest_bridge_set_power_limits,
+    .get_limits = rest_bridge_get_power_limits,
+    .set_weight = power_set_weight,
+    .get_weight = power_get_weight,
+    .set_led_mA = power_set_led_mA,
+    .get_led_mA = power_get_led_mA,
+    .get_channel_mA = rest_bridge_get_channel_mA,
+    .total_mA = power_total_mA,
+    .window_mA = power_window_mA
+};
 
 void lednode_init(void) {
     ESP_LOGI(TAG, "=== LumiGrid LED Node Initialization ===");
@@ -93,10 +734,13 @@ void lednode_init(void) {
     ESP_LOGI(TAG, "[3/8] PCA9685 PWM driver");
     pca9685_config_t pca_cfg = {
         .i2c_port = I2C_NUM_0,
-        .i2c_addr = PCA9685_I2C_ADDR,
+        .i2c_addr = PCA9685_ADDRS[0],
         .oe_pin = PCA9685_OE,
+        .n_chips = sizeof(PCA9685_ADDRS) / sizeof(PCA9685_ADDRS[0]),
     };
+    memcpy(pca_cfg.chip_addr, PCA9685_ADDRS, sizeof(PCA9685_ADDRS));
     ESP_ERROR_CHECK(pca9685_init(&pca_cfg));
+    pwm_set_channel_map(LEDCH_TO_PCA, sizeof(LEDCH_TO_PCA));
     
     ESP_LOGI(TAG, "[4/8] LED effects engine");
     task_effect_engine_start();
@@ -104,10 +748,16 @@ void lednode_init(void) {
     rest_api_register_effect_ops(&REST_EFFECT_OPS);
     rest_api_register_pwm_ops(&REST_PWM_OPS);
     rest_api_register_trigger_ops(&REST_TRIGGER_OPS);
+    rest_api_register_power_ops(&REST_POWER_OPS);
+    rest_api_register_sync_ops(&REST_SYNC_OPS);
+    rest_api_register_stream_ops(&REST_STREAM_OPS);
+    rest_api_register_dmx_ops(&REST_DMX_OPS);
+    rest_api_register_ddp_ops(&REST_DDP_OPS);
+    rest_api_register_timecode_ops(&REST_TIMECODE_OPS);
+    rest_api_register_audio_ops(&REST_AUDIO_OPS);
+    dmx_personality_set_ops(&DMX_OPS);
+    osc_set_ops(&OSC_OPS);
     
-    for (int ch = 0; ch < 8; ch++) {
-        pca9685_set_duty(ch, 0.0f);
-    }
     
     ESP_LOGI(TAG, "[5/8] Wi-Fi connection");
     task_wifi_init();
@@ -118,7 +768,19 @@ void lednode_init(void) {
     ui_server_start(rest_api_get_server());
     
     ESP_LOGI(TAG, "[7/8] Communication protocols");
+    net_io_start();
+    task_sync_manager_start();
     sync_protocol_init();
+    sync_protocol_set_cue_handler(sync_bridge_cue);
+    sync_role_t role = sync_role_load();
+    if (sync_protocol_set_role(role) != ESP_OK){
+        ESP_LOGE(TAG, "Sync %s failed to start, standalone", sync_role_name(role));
+    }
+    pixel_stream_start();
+    osc_start(OSC_PORT);
+    timecode_set_cue_handler(timecode_bridge_cue);
+    timecode_start(TC_MIDI_SESSION_PORT);
+    audio_feed_start(AUDIO_FEED_PORT);
     mqtt_wrapper_init();
     
     ESP_LOGI(TAG, "[8/8] Self-test");
@@ -2,27 +2,48 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 
 #include "aled_rmt.h"
+#include "audio_feed.h"
 #include "board_pinmap.h"
+#include "ddp_out.h"
 #include "effects.h"
+#include "frame_cast.h"
 #include "fx_blend.h"
+#include "fx_calib.h"
 #include "fx_transitions.h"
+#include "fx_util.h"
+#include "pixel_stream.h"
 #include "power_budget.h"
+#include "sync_protocol.h"
+#include "task_pwm_driver.h"
+#include "timecode.h"
+#include "trigger_engine.h"
 
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define CH_MAX                 8
 #define DEFAULT_PIXELS        120
 #define DEFAULT_FRAME_INTERVAL 16U
+#define MIN_FRAME_INTERVAL      4U
+#define MAX_FRAME_INTERVAL    100U
+#define IDLE_POLL_MS            5U
 #define XFADE_COMPLETE_THRESH  0.995f
+#define GROUP_MAX             PWM_MAX_GROUPS
+#define DDP_BASE              (CH_MAX + GROUP_MAX)
+#define DDP_MAX               DDP_OUT_CHANNELS
+#define CTX_MAX               (DDP_BASE + DDP_MAX)
+#define LIVE_QUEUE_LEN         32
+#define CLOCK_STEP_MS          20U   // engine time moved this much more or less than local time
 
 typedef struct {
   aled_channel_t   led;
@@ -38,12 +59,52 @@ typedef struct {
   effect_params_t  overlay;
   bool             overlay_active;
 
+  // Cued base: becomes current/pending on the first frame at or past
+  // cued_at_ms, with the crossfade starting at cued_at_ms on every node.
+  effect_params_t  cued;
+  uint32_t         cued_fade_ms;
+  uint32_t         cued_at_ms;
+  bool             cued_valid;
+
   xfade_t          xfade;
 
+  // HDR path: composite at 16 bits/component, sigma-delta down to 8 at output.
+  // Buffers are owned by the render task and (de)allocated there on mode change.
+  // A failed allocation clears hdr and sets hdr_failed (both under
+  // s_state_lock) so it is not retried every frame; setting the mode again
+  // retries.
+  bool             hdr;
+  bool             hdr_failed;
+  bool             hdr_ready;
+  px_rgba16_t     *acc16;
+  px_rgba16_t     *aux16;
+  px_rgba_t       *dither_res;
+
+  // Output calibration: cfg/calib_next are guarded by s_state_lock; calib is
+  // owned by the render task, which swaps in calib_next between frames.
+  fx_calib_cfg_t   calib_cfg;
+  fx_calib_t      *calib;
+  fx_calib_t      *calib_next;
+
+  // Canvas slice, guarded by s_state_lock; the render task copies it into
+  // led.canvas with each snapshot.
+  fx_canvas_t      canvas;
+
+  // DDP channels: size and type are set under s_state_lock and applied by
+  // the render task, which ping-pongs framebuf with tx_buf while ddp_out
+  // sends from the other one.
+  uint16_t         ddp_pixels;
+  bool             ddp_rgbw;
+  px_rgba_t       *tx_buf;
+
   uint32_t         t_end_ms;
   uint32_t         next_deadline_ms;
   uint32_t         frame_interval_ms;
   float            last_power_scale;
+  float            mA_per_sum;
+  uint32_t         fps_window_ms;
+  uint16_t         fps_frames;
+  uint16_t         last_fps;
   bool             rmt_ready;
 } channel_ctx_t;
 
@@ -55,12 +116,59 @@ typedef struct {
   effect_params_t overlay;
   bool            overlay_active;
   xfade_t         xfade;
+  bool            hdr;
+  fx_calib_t     *calib_next;
+  fx_canvas_t     canvas;
 } channel_snapshot_t;
 
-static channel_ctx_t       s_channels[CH_MAX];
+static channel_ctx_t       s_channels[CTX_MAX];
 static SemaphoreHandle_t   s_state_lock = NULL;
+
+// PWM groups claimed by the engine: channel CH_MAX + slot renders one pixel
+// that becomes the group's member levels. Names are guarded by s_state_lock;
+// the render task only tests for "" without it. All groups share one frame
+// deadline so a frame is a single PCA9685 flush.
+static char                s_group_name[GROUP_MAX][sizeof(((pwm_group_t *)0)->name)];
+static uint32_t            s_group_deadline_ms;
+
+// Live commands: posted from any task without s_state_lock, drained by the
+// render task at the top of each pass.
+static QueueHandle_t       s_live_q = NULL;
+static TaskHandle_t        s_engine_task = NULL;
+
+// Show time minus sync time: follows the timecode playhead while it runs
+// and holds when it stops, so effects carry on from where the show left
+// them. Written by the render task only.
+static volatile uint32_t   s_show_offset_ms = 0;
+
 static const char         *TAG = "EFFECT_ENGINE";
 
+// Effects, crossfades and frame deadlines all run on the sync timebase, so
+// slaves render the same phase as the master; a timecode show shifts it
+// onto the show playhead.
+static inline uint32_t engine_now_ms(void){
+  return (uint32_t)(sync_now_us() / 1000) + s_show_offset_ms;
+}
+
+// A step of the engine clock (sync clock step, timecode jump) moves running
+// crossfades with it: they carry on from where they were instead of
+// freezing on a step back or skipping ahead on a step forward.
+static void rebase_xfades(int32_t step_ms){
+  if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE){
+    return;
+  }
+  for (int i = 0; i < CTX_MAX; ++i){
+    xfade_shift(&s_channels[i].xfade, step_ms);
+  }
+  xSemaphoreGive(s_state_lock);
+}
+
+// Also due if the deadline lies further ahead than any frame interval: the
+// sync clock stepped back.
+static inline bool frame_due(uint32_t deadline_ms, uint32_t now_ms){
+  return (int32_t)(now_ms - deadline_ms) >= 0 || deadline_ms - now_ms > MAX_FRAME_INTERVAL;
+}
+
 static inline size_t frame_bytes(const channel_ctx_t *ctx){
   return ctx->led.n_pixels * sizeof(px_rgba_t);
 }
@@ -85,25 +193,118 @@ static uint32_t render_into(channel_ctx_t *ctx, const effect_params_t *params,
   return sum;
 }
 
-static void apply_power_scale(channel_ctx_t *ctx, float scale){
-  if (!ctx->led.framebuf){
-    ctx->last_power_scale = 1.f;
+static uint32_t render_into16(channel_ctx_t *ctx, const effect_params_t *params,
+                              px_rgba16_t *dest, uint32_t now_ms, uint32_t t_end_ms){
+  const effect_vtable_t *fx = (params && params->effect_id) ? fx_lookup(params->effect_id) : NULL;
+  if (fx && fx->render16){
+    memset(dest, 0, ctx->led.n_pixels * sizeof(px_rgba16_t));
+    ctx->led.framebuf16 = dest;
+    uint32_t sum = fx->render16(&ctx->led, params, now_ms, t_end_ms);
+    ctx->led.framebuf16 = NULL;
+    return sum;
+  }
+  // 8-bit-only effect: render into the (otherwise unused in HDR) overlay
+  // buffer and widen.
+  uint32_t sum = render_into(ctx, params, ctx->overlay_buf, now_ms, t_end_ms);
+  px_promote16(ctx->overlay_buf, dest, ctx->led.n_pixels);
+  return sum;
+}
+
+static void hdr_release(channel_ctx_t *ctx){
+  heap_caps_free(ctx->acc16);
+  heap_caps_free(ctx->aux16);
+  heap_caps_free(ctx->dither_res);
+  ctx->acc16 = NULL;
+  ctx->aux16 = NULL;
+  ctx->dither_res = NULL;
+  ctx->hdr_ready = false;
+}
+
+static void hdr_prepare(channel_ctx_t *ctx, bool enable){
+  hdr_release(ctx);
+  if (!enable || !ctx->overlay_buf){
     return;
   }
-  if (scale >= 0.999f){
-    ctx->last_power_scale = 1.f;
+  ctx->acc16 = heap_caps_calloc(ctx->led.n_pixels, sizeof(px_rgba16_t), MALLOC_CAP_INTERNAL);
+  ctx->aux16 = heap_caps_calloc(ctx->led.n_pixels, sizeof(px_rgba16_t), MALLOC_CAP_INTERNAL);
+  ctx->dither_res = heap_caps_calloc(ctx->led.n_pixels, sizeof(px_rgba_t), MALLOC_CAP_INTERNAL);
+  if (!ctx->acc16 || !ctx->aux16 || !ctx->dither_res){
+    ESP_LOGE(TAG, "Channel %d HDR allocation failed, staying 8-bit", ctx->led.ch);
+    hdr_release(ctx);
     return;
   }
+  ctx->hdr_ready = true;
+}
+
+// Fallback when the calibration tables could not be allocated: scale in
+// place and report the draw like the calibrated pass does.
+static void apply_power_scale(channel_ctx_t *ctx, uint32_t q, uint32_t sums[4]){
+  memset(sums, 0, 4 * sizeof(uint32_t));
   for (int i = 0; i < ctx->led.n_pixels; ++i){
-    ctx->led.framebuf[i].r = (uint8_t)(ctx->led.framebuf[i].r * scale);
-    ctx->led.framebuf[i].g = (uint8_t)(ctx->led.framebuf[i].g * scale);
-    ctx->led.framebuf[i].b = (uint8_t)(ctx->led.framebuf[i].b * scale);
-    ctx->led.framebuf[i].w = (uint8_t)(ctx->led.framebuf[i].w * scale);
+    px_rgba_t *p = &ctx->led.framebuf[i];
+    sums[0] += p->r; sums[1] += p->g; sums[2] += p->b; sums[3] += p->w;
+    p->r = (uint8_t)((p->r * q) >> 16);
+    p->g = (uint8_t)((p->g * q) >> 16);
+    p->b = (uint8_t)((p->b * q) >> 16);
+    p->w = (uint8_t)((p->w * q) >> 16);
   }
+}
+
+// Render sums are linear; the output pass reports corrected per-color totals
+// for the current model. Last frame's mA per unit of render sum turns this
+// frame's sum into a demand estimate before any pixel is touched, so
+// limiting costs no extra pass.
+static uint32_t power_scale_q16(channel_ctx_t *ctx, uint32_t linear_sum, uint32_t now_ms){
+  float scale = power_request(ctx->led.ch, linear_sum * ctx->mA_per_sum, now_ms);
+  if (scale > 1.f) scale = 1.f;
+  if (scale < 0.f) scale = 0.f;
   ctx->last_power_scale = scale;
+  return (uint32_t)(scale * 65536.f);
+}
+
+static void power_track(channel_ctx_t *ctx, uint32_t linear_sum, const uint32_t sums[4]){
+  if (linear_sum > 0){
+    ctx->mA_per_sum = power_model_mA(ctx->led.ch, sums) / (float)linear_sum;
+  }
 }
 
-static void snapshot_channel(const channel_ctx_t *ctx, channel_snapshot_t *out){
+static uint32_t mix_sum(uint32_t a, uint32_t b, float mix){
+  return (uint32_t)(a * (1.f - mix) + b * mix);
+}
+
+static uint32_t overlay_sum(blend_mode_t blend, uint32_t base, uint32_t over, uint8_t opacity){
+  uint32_t o = (uint32_t)(((uint64_t)over * opacity) / 255u);
+  switch (blend){
+    case BLEND_NORMAL:   return o;
+    case BLEND_MULTIPLY: return base;
+    default:             return base + o;
+  }
+}
+
+// Call with s_state_lock held.
+static void apply_base(channel_ctx_t *ctx, const effect_params_t *params, uint32_t fade_ms, uint32_t start_ms){
+  if (!ctx->current_valid || fade_ms == 0){
+    ctx->current = *params;
+    ctx->current_valid = true;
+    ctx->pending_valid = false;
+    ctx->xfade.active = 0;
+  } else {
+    ctx->pending = *params;
+    ctx->pending_valid = true;
+    xfade_begin(&ctx->xfade, start_ms, fade_ms);
+  }
+}
+
+// Call with s_state_lock held. Cues are scheduled in sync time.
+static void take_cue(channel_ctx_t *ctx, uint32_t now_ms){
+  uint32_t at_ms = ctx->cued_at_ms + s_show_offset_ms;
+  if (ctx->cued_valid && (int32_t)(now_ms - at_ms) >= 0){
+    apply_base(ctx, &ctx->cued, ctx->cued_fade_ms, at_ms);
+    ctx->cued_valid = false;
+  }
+}
+
+static void snapshot_channel(channel_ctx_t *ctx, channel_snapshot_t *out){
   out->current        = ctx->current;
   out->current_valid  = ctx->current_valid;
   out->pending        = ctx->pending;
@@ -111,6 +312,10 @@ static void snapshot_channel(const channel_ctx_t *ctx, channel_snapshot_t *out){
   out->overlay        = ctx->overlay;
   out->overlay_active = ctx->overlay_active;
   out->xfade          = ctx->xfade;
+  out->hdr            = ctx->hdr;
+  out->calib_next     = ctx->calib_next;
+  ctx->calib_next     = NULL;
+  out->canvas         = ctx->canvas;
 }
 
 static void init_channel(channel_ctx_t *ctx, int idx){
@@ -125,6 +330,14 @@ static void init_channel(channel_ctx_t *ctx, int idx){
   ctx->frame_interval_ms = DEFAULT_FRAME_INTERVAL;
   ctx->next_deadline_ms = 0;
   ctx->last_power_scale = 1.f;
+  power_set_channel_model(idx, ctx->led.type, ctx->led.n_pixels);
+  ctx->mA_per_sum = power_model_mA_per_code(idx);
+
+  fx_calib_default(&ctx->calib_cfg, ctx->led.gamma);
+  ctx->calib = malloc(sizeof(fx_calib_t));
+  if (ctx->calib){
+    fx_calib_build(ctx->calib, &ctx->calib_cfg, ctx->led.type == LED_SK6812_RGBW);
+  }
 
   size_t bytes = frame_bytes(ctx);
   ctx->led.framebuf = heap_caps_calloc(ctx->led.n_pixels, sizeof(px_rgba_t),
@@ -150,6 +363,38 @@ static void init_channel(channel_ctx_t *ctx, int idx){
   }
 }
 
+// One pixel, always composited at 16 bits: PWM curves take 16-bit levels,
+// so there is no calibration, power limit or dither on this path.
+static void init_group_channel(channel_ctx_t *ctx, int idx){
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->led.ch = idx;
+  ctx->led.type = LED_SK6812_RGBW;
+  ctx->led.n_pixels = 1;
+  ctx->led.max_brightness = 255;
+  ctx->frame_interval_ms = DEFAULT_FRAME_INTERVAL;
+  ctx->last_power_scale = 1.f;
+  ctx->led.framebuf = calloc(1, sizeof(px_rgba_t));
+  ctx->overlay_buf = calloc(1, sizeof(px_rgba_t));
+  ctx->xfade_buf = calloc(1, sizeof(px_rgba_t));
+  ctx->acc16 = calloc(1, sizeof(px_rgba16_t));
+  ctx->aux16 = calloc(1, sizeof(px_rgba16_t));
+  if (!ctx->led.framebuf || !ctx->overlay_buf || !ctx->xfade_buf || !ctx->acc16 || !ctx->aux16){
+    ESP_LOGE(TAG, "PWM group channel %d allocation failed", idx);
+  }
+}
+
+// No buffers until a size is configured; the render task allocates them.
+static void init_ddp_channel(channel_ctx_t *ctx, int idx){
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->led.ch = idx;
+  ctx->led.type = LED_WS2812B;
+  ctx->led.gamma = 2.2f;
+  ctx->led.max_brightness = 255;
+  ctx->frame_interval_ms = DEFAULT_FRAME_INTERVAL;
+  ctx->last_power_scale = 1.f;
+  fx_calib_default(&ctx->calib_cfg, ctx->led.gamma);
+}
+
 static void ensure_lock(void){
   if (!s_state_lock){
     s_state_lock = xSemaphoreCreateMutex();
@@ -157,7 +402,7 @@ static void ensure_lock(void){
 }
 
 bool effect_engine_set_base(int ch, const effect_params_t *params, uint32_t fade_ms){
-  if (ch < 0 || ch >= CH_MAX || !params){
+  if (ch < 0 || ch >= CTX_MAX || !params){
     return false;
   }
   ensure_lock();
@@ -172,25 +417,72 @@ bool effect_engine_set_base(int ch, const effect_params_t *params, uint32_t fade
   }
 
   channel_ctx_t *ctx = &s_channels[ch];
-  uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000ULL);
+  apply_base(ctx, &sanitized, fade_ms, engine_now_ms());
+  // A direct change supersedes a cue still waiting.
+  ctx->cued_valid = false;
 
-  if (!ctx->current_valid || fade_ms == 0){
-    ctx->current = sanitized;
-    ctx->current_valid = true;
-    ctx->pending_valid = false;
-    ctx->xfade.active = 0;
-  } else {
-    ctx->pending = sanitized;
-    ctx->pending_valid = true;
-    xfade_begin(&ctx->xfade, now_ms, fade_ms);
+  xSemaphoreGive(s_state_lock);
+  return true;
+}
+
+bool effect_engine_get_base(int ch, effect_params_t *out){
+  if (ch < 0 || ch >= CTX_MAX || !out){
+    return false;
   }
+  ensure_lock();
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(20)) != pdTRUE){
+    return false;
+  }
+  const channel_ctx_t *ctx = &s_channels[ch];
+  *out = ctx->pending_valid ? ctx->pending : ctx->current;
+  xSemaphoreGive(s_state_lock);
+  return true;
+}
 
+bool effect_engine_live(const effect_live_t *cmd){
+  if (!cmd || !s_live_q || cmd->ch < -1 || cmd->ch >= CTX_MAX){
+    return false;
+  }
+  if (cmd->op == EFFECT_LIVE_EFFECT && !fx_lookup(cmd->effect_id)){
+    return false;
+  }
+  if (cmd->op == EFFECT_LIVE_PARAMS && (cmd->ch < 0 || !fx_lookup(cmd->params.effect_id))){
+    return false;
+  }
+  if (xQueueSend(s_live_q, cmd, 0) != pdTRUE){
+    return false;
+  }
+  if (s_engine_task){
+    xTaskNotifyGive(s_engine_task);
+  }
+  return true;
+}
+
+bool effect_engine_schedule_base(int ch, const effect_params_t *params, uint32_t fade_ms, uint32_t at_ms){
+  if (ch < 0 || ch >= CTX_MAX || !params || !fx_lookup(params->effect_id)){
+    return false;
+  }
+  ensure_lock();
+
+  effect_params_t sanitized = *params;
+  if (sanitized.opacity == 0){
+    sanitized.opacity = 255;
+  }
+
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) != pdTRUE){
+    return false;
+  }
+  channel_ctx_t *ctx = &s_channels[ch];
+  ctx->cued = sanitized;
+  ctx->cued_fade_ms = fade_ms;
+  ctx->cued_at_ms = at_ms;
+  ctx->cued_valid = true;
   xSemaphoreGive(s_state_lock);
   return true;
 }
 
 bool effect_engine_set_overlay(int ch, const effect_params_t *params){
-  if (ch < 0 || ch >= CH_MAX){
+  if (ch < 0 || ch >= CTX_MAX){
     return false;
   }
   ensure_lock();
@@ -218,6 +510,59 @@ void effect_engine_clear_overlay(int ch){
   effect_engine_set_overlay(ch, NULL);
 }
 
+int effect_engine_pwm_group_channel(const char *group){
+  if (!group || !group[0]){
+    return -1;
+  }
+  pwm_group_t info;
+  bool found = false;
+  for (int i = 0; !found && pwm_groups_get(i, &info); ++i){
+    found = strcmp(info.name, group) == 0;
+  }
+  if (!found){
+    return -1;
+  }
+  ensure_lock();
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) != pdTRUE){
+    return -1;
+  }
+  int slot = -1;
+  for (int i = 0; i < GROUP_MAX && slot < 0; ++i){
+    if (strcmp(s_group_name[i], group) == 0) slot = i;
+  }
+  for (int i = 0; i < GROUP_MAX && slot < 0; ++i){
+    if (!s_group_name[i][0]){
+      slot = i;
+      channel_ctx_t *ctx = &s_channels[CH_MAX + i];
+      ctx->current_valid = false;
+      ctx->pending_valid = false;
+      ctx->overlay_active = false;
+      ctx->xfade.active = 0;
+      strncpy(s_group_name[i], group, sizeof(s_group_name[i]) - 1);
+    }
+  }
+  if (slot >= 0){
+    // RGB groups render as RGB strips, so effects leave white alone.
+    s_channels[CH_MAX + slot].led.type = info.kind == PWMG_RGBW ? LED_SK6812_RGBW : LED_WS2812B;
+  }
+  xSemaphoreGive(s_state_lock);
+  return slot < 0 ? -1 : CH_MAX + slot;
+}
+
+void effect_engine_release_pwm_group(const char *group){
+  ensure_lock();
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) != pdTRUE){
+    return;
+  }
+  for (int i = 0; i < GROUP_MAX; ++i){
+    if (s_group_name[i][0] && (!group || strcmp(s_group_name[i], group) == 0)){
+      s_group_name[i][0] = '\0';
+      s_channels[CH_MAX + i].current_valid = false;
+    }
+  }
+  xSemaphoreGive(s_state_lock);
+}
+
 void effect_engine_get_stats(effect_engine_stats_t *out){
   if (!out){
     return;
@@ -226,6 +571,9 @@ void effect_engine_get_stats(effect_engine_stats_t *out){
   if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(20)) == pdTRUE){
     for (int ch = 0; ch < CH_MAX; ++ch){
       out->power_scale[ch] = s_channels[ch].last_power_scale;
+      out->fps[ch] = s_channels[ch].last_fps;
+      out->hdr[ch] = s_channels[ch].hdr_ready;
+      out->hdr_failed[ch] = s_channels[ch].hdr_failed;
     }
     xSemaphoreGive(s_state_lock);
   } else {
@@ -259,93 +607,559 @@ bool effect_engine_get_channel_info(int ch, led_type_t *type, color_order_t *ord
   return ok;
 }
 
+// Builds the LUTs outside the lock; the render task picks them up on its
+// next frame. Only called on config changes, never per frame.
+static bool stage_calib(int ch, const fx_calib_cfg_t *cfg, bool rgbw){
+  fx_calib_t *next = malloc(sizeof(fx_calib_t));
+  if (!next){
+    return false;
+  }
+  fx_calib_build(next, cfg, rgbw);
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) != pdTRUE){
+    free(next);
+    return false;
+  }
+  channel_ctx_t *ctx = &s_channels[ch];
+  free(ctx->calib_next);
+  ctx->calib_next = next;
+  ctx->calib_cfg = *cfg;
+  ctx->led.gamma = cfg->gamma[0];
+  xSemaphoreGive(s_state_lock);
+  return true;
+}
+
 bool effect_engine_set_channel_type(int ch, led_type_t type, color_order_t order){
   if (ch < 0 || ch >= CH_MAX){
     return false;
   }
   ensure_lock();
   bool ok = false;
+  bool rebuild = false;
+  fx_calib_cfg_t cfg;
   if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) == pdTRUE){
+    rebuild = s_channels[ch].led.type != type;
     s_channels[ch].led.type = type;
+    power_set_channel_model(ch, type, s_channels[ch].led.n_pixels);
     s_channels[ch].led.order = order;
+    cfg = s_channels[ch].calib_cfg;
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  if (ok && rebuild){
+    ok = stage_calib(ch, &cfg, type == LED_SK6812_RGBW);
+  }
+  return ok;
+}
+
+bool effect_engine_set_channel_calib(int ch, const fx_calib_cfg_t *cfg){
+  if (ch < 0 || ch >= CH_MAX || !cfg){
+    return false;
+  }
+  ensure_lock();
+  led_type_t type;
+  if (!effect_engine_get_channel_info(ch, &type, NULL, NULL)){
+    return false;
+  }
+  return stage_calib(ch, cfg, type == LED_SK6812_RGBW);
+}
+
+bool effect_engine_get_channel_calib(int ch, fx_calib_cfg_t *out){
+  if (ch < 0 || ch >= CH_MAX || !out){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(20)) == pdTRUE){
+    *out = s_channels[ch].calib_cfg;
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  return ok;
+}
+
+bool effect_engine_set_channel_canvas(int ch, const fx_canvas_t *canvas){
+  if (ch < 0 || ch >= CH_MAX){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) == pdTRUE){
+    if (canvas && canvas->size){
+      s_channels[ch].canvas = *canvas;
+    } else {
+      memset(&s_channels[ch].canvas, 0, sizeof(fx_canvas_t));
+    }
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  return ok;
+}
+
+bool effect_engine_get_channel_canvas(int ch, fx_canvas_t *out){
+  if (ch < 0 || ch >= CH_MAX || !out){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(20)) == pdTRUE){
+    *out = s_channels[ch].canvas;
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  return ok;
+}
+
+int effect_engine_ddp_channel(int v){
+  return (v >= 0 && v < DDP_MAX) ? DDP_BASE + v : -1;
+}
+
+bool effect_engine_set_ddp_channel(int v, uint16_t n_pixels, led_type_t type){
+  if (v < 0 || v >= DDP_MAX || n_pixels > DDP_OUT_MAX_PIXELS){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) == pdTRUE){
+    s_channels[DDP_BASE + v].ddp_pixels = n_pixels;
+    s_channels[DDP_BASE + v].ddp_rgbw = type == LED_SK6812_RGBW;
     xSemaphoreGive(s_state_lock);
     ok = true;
   }
   return ok;
 }
 
+bool effect_engine_get_ddp_channel(int v, uint16_t *n_pixels, led_type_t *type){
+  if (v < 0 || v >= DDP_MAX){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(20)) == pdTRUE){
+    if (n_pixels){
+      *n_pixels = s_channels[DDP_BASE + v].ddp_pixels;
+    }
+    if (type){
+      *type = s_channels[DDP_BASE + v].ddp_rgbw ? LED_SK6812_RGBW : LED_WS2812B;
+    }
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  return ok;
+}
+
+bool effect_engine_set_channel_output(int ch, bool hdr, uint16_t max_fps){
+  if (ch < 0 || ch >= CH_MAX){
+    return false;
+  }
+  ensure_lock();
+  bool ok = false;
+  if (xSemaphoreTake(s_state_lock, pdMS_TO_TICKS(50)) == pdTRUE){
+    s_channels[ch].hdr = hdr;
+    s_channels[ch].hdr_failed = false;
+    if (max_fps > 0){
+      uint32_t interval = 1000U / max_fps;
+      if (interval < MIN_FRAME_INTERVAL) interval = MIN_FRAME_INTERVAL;
+      if (interval > MAX_FRAME_INTERVAL) interval = MAX_FRAME_INTERVAL;
+      s_channels[ch].frame_interval_ms = interval;
+    }
+    xSemaphoreGive(s_state_lock);
+    ok = true;
+  }
+  return ok;
+}
+
+static void commit_xfade(channel_ctx_t *ctx, const channel_snapshot_t *snap){
+  ensure_lock();
+  if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE){
+    ctx->current = snap->pending;
+    ctx->current_valid = true;
+    ctx->pending_valid = false;
+    ctx->xfade.active = 0;
+    xSemaphoreGive(s_state_lock);
+  }
+}
+
+static float xfade_clamped(const channel_snapshot_t *snap, uint32_t now_ms){
+  float mix = xfade_mix(&snap->xfade, now_ms);
+  if (mix < 0.f) mix = 0.f;
+  if (mix > 1.f) mix = 1.f;
+  return mix;
+}
+
+// 8-bit composite into framebuf: base -> crossfade -> overlay. Returns the
+// render sum for the power estimate.
+static uint32_t compose8(channel_ctx_t *ctx, const channel_snapshot_t *snap, uint32_t now_ms){
+  uint32_t sum = render_into(ctx, &snap->current, ctx->led.framebuf, now_ms, ctx->t_end_ms);
+
+  if (snap->xfade.active && snap->pending_valid && ctx->xfade_buf){
+    uint32_t next = render_into(ctx, &snap->pending, ctx->xfade_buf, now_ms, ctx->t_end_ms);
+    float mix = xfade_clamped(snap, now_ms);
+    xfade_apply(ctx->led.framebuf, ctx->xfade_buf, ctx->led.n_pixels, mix);
+    sum = mix_sum(sum, next, mix);
+    if (mix >= XFADE_COMPLETE_THRESH){
+      commit_xfade(ctx, snap);
+    }
+  }
+
+  if (snap->overlay_active && ctx->overlay_buf && ctx->xfade_buf){
+    memcpy(ctx->overlay_buf, ctx->led.framebuf, frame_bytes(ctx));
+    uint32_t over_sum = render_into(ctx, &snap->overlay, ctx->xfade_buf, now_ms, ctx->t_end_ms);
+    sum = overlay_sum(snap->overlay.blend, sum, over_sum, snap->overlay.opacity);
+    for (int i = 0; i < ctx->led.n_pixels; ++i){
+      px_rgba_t base = ctx->overlay_buf[i];
+      px_rgba_t over = ctx->xfade_buf[i];
+      over.r = (uint8_t)((over.r * snap->overlay.opacity) / 255);
+      over.g = (uint8_t)((over.g * snap->overlay.opacity) / 255);
+      over.b = (uint8_t)((over.b * snap->overlay.opacity) / 255);
+      over.w = (uint8_t)((over.w * snap->overlay.opacity) / 255);
+      ctx->led.framebuf[i] = blend_apply(snap->overlay.blend, base, over);
+    }
+  }
+  return sum;
+}
+
+// 16-bit composite into acc16: base -> crossfade -> overlay. Returns the
+// linear render sum for the power estimate.
+static uint32_t compose16(channel_ctx_t *ctx, const channel_snapshot_t *snap, uint32_t now_ms){
+  const int n = ctx->led.n_pixels;
+  uint32_t sum = render_into16(ctx, &snap->current, ctx->acc16, now_ms, ctx->t_end_ms);
+
+  if (snap->xfade.active && snap->pending_valid){
+    uint32_t next = render_into16(ctx, &snap->pending, ctx->aux16, now_ms, ctx->t_end_ms);
+    float mix = xfade_clamped(snap, now_ms);
+    xfade_apply16(ctx->acc16, ctx->aux16, n, mix);
+    sum = mix_sum(sum, next, mix);
+    if (mix >= XFADE_COMPLETE_THRESH){
+      commit_xfade(ctx, snap);
+    }
+  }
+
+  if (snap->overlay_active){
+    uint32_t over_sum = render_into16(ctx, &snap->overlay, ctx->aux16, now_ms, ctx->t_end_ms);
+    sum = overlay_sum(snap->overlay.blend, sum, over_sum, snap->overlay.opacity);
+    uint32_t op = snap->overlay.opacity * 257u;
+    for (int i = 0; i < n; ++i){
+      px_rgba16_t over = ctx->aux16[i];
+      over.r = (uint16_t)((over.r * op) / 65535u);
+      over.g = (uint16_t)((over.g * op) / 65535u);
+      over.b = (uint16_t)((over.b * op) / 65535u);
+      over.w = (uint16_t)((over.w * op) / 65535u);
+      ctx->acc16[i] = blend_apply16(snap->overlay.blend, ctx->acc16[i], over);
+    }
+  }
+  return sum;
+}
+
+// 16-bit path: composite -> calibration + power limit -> dither.
+static void render_channel16(channel_ctx_t *ctx, const channel_snapshot_t *snap, uint32_t now_ms){
+  const int n = ctx->led.n_pixels;
+  uint32_t sum = compose16(ctx, snap, now_ms);
+  uint32_t q = power_scale_q16(ctx, sum, now_ms);
+  if (ctx->calib){
+    uint32_t sums[4];
+    fx_calib_apply16(ctx->calib, ctx->acc16, n, q, sums);
+    power_track(ctx, sum, sums);
+  } else {
+    for (int i = 0; i < n; ++i){
+      ctx->acc16[i].r = (uint16_t)((ctx->acc16[i].r * q) >> 16);
+      ctx->acc16[i].g = (uint16_t)((ctx->acc16[i].g * q) >> 16);
+      ctx->acc16[i].b = (uint16_t)((ctx->acc16[i].b * q) >> 16);
+      ctx->acc16[i].w = (uint16_t)((ctx->acc16[i].w * q) >> 16);
+    }
+  }
+  dither_temporal16(ctx->acc16, ctx->led.framebuf, ctx->dither_res, n);
+}
+
+static void count_frame(channel_ctx_t *ctx, uint32_t now_ms){
+  ctx->fps_frames++;
+  if (now_ms - ctx->fps_window_ms >= 1000U){
+    ctx->last_fps = ctx->fps_frames;
+    ctx->fps_frames = 0;
+    ctx->fps_window_ms = now_ms;
+  }
+}
+
+// Stream mode: the frame arrives latched from pixel_stream (or complete from
+// frame_cast) in output codes, so there is no effect, crossfade or
+// calibration pass, only the power limit. The frame stays the receiver's:
+// pixel_stream may blend it again to conceal a lost frame, so a limited
+// frame is scaled into framebuf, which stream mode does not render into.
+static void output_stream(channel_ctx_t *ctx, const px_rgba_t *px, uint16_t n, uint32_t now_ms){
+  uint32_t sums[4] = {0};
+  for (int i = 0; i < n; ++i){
+    sums[0] += px[i].r; sums[1] += px[i].g; sums[2] += px[i].b; sums[3] += px[i].w;
+  }
+  float scale = power_request(ctx->led.ch, power_model_mA(ctx->led.ch, sums), now_ms);
+  if (scale > 1.f) scale = 1.f;
+  if (scale < 0.f) scale = 0.f;
+  ctx->last_power_scale = scale;
+  if (scale < 1.f){
+    px_rgba_t *out = ctx->led.framebuf;
+    if (!out){
+      return;
+    }
+    if (n > ctx->led.n_pixels){
+      n = ctx->led.n_pixels;
+    }
+    uint32_t q = (uint32_t)(scale * 65536.f);
+    for (int i = 0; i < n; ++i){
+      out[i].r = (uint8_t)((px[i].r * q) >> 16);
+      out[i].g = (uint8_t)((px[i].g * q) >> 16);
+      out[i].b = (uint8_t)((px[i].b * q) >> 16);
+      out[i].w = (uint8_t)((px[i].w * q) >> 16);
+    }
+    px = out;
+  }
+  frame_cast_send(ctx->led.ch, px, n, ctx->led.type == LED_SK6812_RGBW);
+  if (ctx->rmt_ready){
+    aled_rmt_write(ctx->led.ch, px, n, ctx->led.type, ctx->led.order);
+  }
+  count_frame(ctx, now_ms);
+}
+
 static void render_channel(channel_ctx_t *ctx, uint32_t now_ms){
   channel_snapshot_t snap;
 
   ensure_lock();
   if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE){
+    take_cue(ctx, now_ms);
     snapshot_channel(ctx, &snap);
     xSemaphoreGive(s_state_lock);
   } else {
     return;
   }
 
+  if (snap.calib_next){
+    free(ctx->calib);
+    ctx->calib = snap.calib_next;
+  }
+  ctx->led.canvas = snap.canvas;
+
   if (!ctx->led.framebuf){
     ctx->next_deadline_ms = now_ms + ctx->frame_interval_ms;
     return;
   }
 
-  if (!snap.current_valid || !ctx->led.framebuf){
-    if (ctx->led.framebuf){
-      memset(ctx->led.framebuf, 0, frame_bytes(ctx));
+  if (snap.hdr != ctx->hdr_ready){
+    hdr_prepare(ctx, snap.hdr);
+    if (snap.hdr && !ctx->hdr_ready && xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE){
+      ctx->hdr = false;
+      ctx->hdr_failed = true;
+      xSemaphoreGive(s_state_lock);
     }
+  }
+
+  if (!snap.current_valid){
+    memset(ctx->led.framebuf, 0, frame_bytes(ctx));
+    power_request(ctx->led.ch, 0.f, now_ms);
+    ctx->last_power_scale = 1.f;
+  } else if (ctx->hdr_ready){
+    render_channel16(ctx, &snap, now_ms);
   } else {
-    render_into(ctx, &snap.current, ctx->led.framebuf, now_ms, ctx->t_end_ms);
-
-    if (snap.xfade.active && snap.pending_valid && ctx->xfade_buf){
-      render_into(ctx, &snap.pending, ctx->xfade_buf, now_ms, ctx->t_end_ms);
-      float mix = xfade_mix(&snap.xfade, now_ms);
-      if (mix < 0.f) mix = 0.f;
-      if (mix > 1.f) mix = 1.f;
-      float inv = 1.f - mix;
-      for (int i = 0; i < ctx->led.n_pixels; ++i){
-        const px_rgba_t next = ctx->xfade_buf[i];
-        px_rgba_t cur = ctx->led.framebuf[i];
-        ctx->led.framebuf[i].r = (uint8_t)(cur.r * inv + next.r * mix);
-        ctx->led.framebuf[i].g = (uint8_t)(cur.g * inv + next.g * mix);
-        ctx->led.framebuf[i].b = (uint8_t)(cur.b * inv + next.b * mix);
-        ctx->led.framebuf[i].w = (uint8_t)(cur.w * inv + next.w * mix);
-      }
-      if (mix >= XFADE_COMPLETE_THRESH){
-        ensure_lock();
-        if (xSemaphoreTake(s_state_lock, portMAX_DELAY) == pdTRUE){
-          ctx->current = snap.pending;
-          ctx->current_valid = true;
-          ctx->pending_valid = false;
-          ctx->xfade.active = 0;
-          xSemaphoreGive(s_state_lock);
-        }
-      }
+    uint32_t sum = compose8(ctx, &snap, now_ms);
+    uint32_t q = power_scale_q16(ctx, sum, now_ms);
+    uint32_t sums[4];
+    if (ctx->calib){
+      fx_calib_apply8(ctx->calib, ctx->led.framebuf, ctx->led.n_pixels, q, sums);
+    } else {
+      apply_power_scale(ctx, q, sums);
     }
+    power_track(ctx, sum, sums);
+  }
 
-    if (snap.overlay_active && ctx->overlay_buf && ctx->xfade_buf){
-      memcpy(ctx->overlay_buf, ctx->led.framebuf, frame_bytes(ctx));
-      render_into(ctx, &snap.overlay, ctx->xfade_buf, now_ms, ctx->t_end_ms);
-      for (int i = 0; i < ctx->led.n_pixels; ++i){
-        px_rgba_t base = ctx->overlay_buf[i];
-        px_rgba_t over = ctx->xfade_buf[i];
-        over.r = (uint8_t)((over.r * snap.overlay.opacity) / 255);
-        over.g = (uint8_t)((over.g * snap.overlay.opacity) / 255);
-        over.b = (uint8_t)((over.b * snap.overlay.opacity) / 255);
-        over.w = (uint8_t)((over.w * snap.overlay.opacity) / 255);
-        ctx->led.framebuf[i] = blend_apply(snap.overlay.blend, base, over);
-      }
+  // Receivers get exactly what this strip shows.
+  frame_cast_send(ctx->led.ch, ctx->led.framebuf, ctx->led.n_pixels, ctx->led.type == LED_SK6812_RGBW);
+  if (ctx->rmt_ready){
+    aled_rmt_write(ctx->led.ch, ctx->led.framebuf, ctx->led.n_pixels, ctx->led.type, ctx->led.order);
+  }
+
+  count_frame(ctx, now_ms);
+
+  // Advance on the frame grid so high rates don't lose a tick per frame to
+  // loop latency; resync if we fell more than one interval behind.
+  ctx->next_deadline_ms += ctx->frame_interval_ms;
+  if (frame_due(ctx->next_deadline_ms, now_ms)){
+    ctx->next_deadline_ms = now_ms + ctx->frame_interval_ms;
+  }
+}
+
+// Renders a claimed group's pixel and stages it as the members' levels; the
+// caller flushes once for all groups. Returns false if nothing was staged.
+static bool render_group(int slot, uint32_t now_ms){
+  channel_ctx_t *ctx = &s_channels[CH_MAX + slot];
+  channel_snapshot_t snap;
+  char name[sizeof(s_group_name[0])];
+
+  if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE){
+    return false;
+  }
+  take_cue(ctx, now_ms);
+  snapshot_channel(ctx, &snap);
+  memcpy(name, s_group_name[slot], sizeof(name));
+  xSemaphoreGive(s_state_lock);
+
+  if (!name[0] || !snap.current_valid || !ctx->acc16 || !ctx->aux16){
+    return false;
+  }
+  compose16(ctx, &snap, now_ms);
+  const px_rgba16_t *px = &ctx->acc16[0];
+  uint16_t level[4] = { px->r, px->g, px->b, px->w };
+  if (!pwm_group_stream(name, level)){
+    // Group removed from config: hand the slot back.
+    effect_engine_release_pwm_group(name);
+    return false;
+  }
+  return true;
+}
+
+// Groups run on the default frame grid, the same clock as the strips.
+static void render_groups(uint32_t now_ms){
+  bool staged = false;
+  for (int i = 0; i < GROUP_MAX; ++i){
+    if (s_group_name[i][0]){
+      staged |= render_group(i, now_ms);
     }
   }
+  if (staged){
+    pwm_commit();
+  }
+  s_group_deadline_ms += DEFAULT_FRAME_INTERVAL;
+  if (frame_due(s_group_deadline_ms, now_ms)){
+    s_group_deadline_ms = now_ms + DEFAULT_FRAME_INTERVAL;
+  }
+}
 
-  float scale = power_scale_for_frame(ctx->led.framebuf, ctx->led.n_pixels, power_get_cfg());
-  apply_power_scale(ctx, scale);
+// Render task only, while ddp_out holds neither buffer.
+static void ddp_prepare(channel_ctx_t *ctx, uint16_t n, bool rgbw){
+  free(ctx->led.framebuf);
+  free(ctx->tx_buf);
+  free(ctx->overlay_buf);
+  free(ctx->xfade_buf);
+  ctx->led.framebuf = ctx->tx_buf = ctx->overlay_buf = ctx->xfade_buf = NULL;
+  ctx->led.n_pixels = 0;
+  ctx->led.type = rgbw ? LED_SK6812_RGBW : LED_WS2812B;
+  if (!n){
+    return;
+  }
+  ctx->led.framebuf = calloc(n, sizeof(px_rgba_t));
+  ctx->tx_buf = calloc(n, sizeof(px_rgba_t));
+  ctx->overlay_buf = calloc(n, sizeof(px_rgba_t));
+  ctx->xfade_buf = calloc(n, sizeof(px_rgba_t));
+  if (!ctx->led.framebuf || !ctx->tx_buf || !ctx->overlay_buf || !ctx->xfade_buf){
+    ESP_LOGE(TAG, "DDP channel %d allocation failed (%u px)", ctx->led.ch - DDP_BASE + 1, n);
+    ddp_prepare(ctx, 0, rgbw);
+    return;
+  }
+  ctx->led.n_pixels = n;
+  if (!ctx->calib){
+    ctx->calib = malloc(sizeof(fx_calib_t));
+  }
+  if (ctx->calib){
+    fx_calib_build(ctx->calib, &ctx->calib_cfg, rgbw);
+  }
+}
 
-  if (ctx->rmt_ready){
-    aled_rmt_write(ctx->led.ch, ctx->led.framebuf, ctx->led.n_pixels, ctx->led.type, ctx->led.order);
+// DDP channels compose like a strip and get its calibration, but no power
+// limit: the receiver has its own supply. A frame ddp_out refuses (the last
+// one is still going out) is dropped; an accepted one is paced over half
+// the frame interval, and the other buffer becomes the next framebuf.
+static void render_ddp(int v, uint32_t now_ms){
+  channel_ctx_t *ctx = &s_channels[DDP_BASE + v];
+  channel_snapshot_t snap;
+  uint16_t want;
+  bool rgbw;
+
+  if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE){
+    return;
   }
+  take_cue(ctx, now_ms);
+  snapshot_channel(ctx, &snap);
+  want = ctx->ddp_pixels;
+  rgbw = ctx->ddp_rgbw;
+  xSemaphoreGive(s_state_lock);
+
+  ctx->led.canvas = snap.canvas;
+  ctx->next_deadline_ms += ctx->frame_interval_ms;
+  if (frame_due(ctx->next_deadline_ms, now_ms)){
+    ctx->next_deadline_ms = now_ms + ctx->frame_interval_ms;
+  }
+
+  if (want != ctx->led.n_pixels || rgbw != (ctx->led.type == LED_SK6812_RGBW)){
+    if (ddp_out_busy(v)){
+      return;
+    }
+    ddp_prepare(ctx, want, rgbw);
+  }
+  if (!ctx->led.n_pixels){
+    return;
+  }
+
+  if (snap.current_valid){
+    compose8(ctx, &snap, now_ms);
+  } else {
+    memset(ctx->led.framebuf, 0, frame_bytes(ctx));
+  }
+  if (ctx->calib){
+    uint32_t sums[4];
+    fx_calib_apply8(ctx->calib, ctx->led.framebuf, ctx->led.n_pixels, 65536u, sums);
+  }
+  if (ddp_out_submit(v, ctx->led.framebuf, ctx->led.n_pixels, rgbw, ctx->frame_interval_ms * 500U)){
+    px_rgba_t *sent = ctx->led.framebuf;
+    ctx->led.framebuf = ctx->tx_buf;
+    ctx->tx_buf = sent;
+    count_frame(ctx, now_ms);
+  }
+}
+
+// Render task only, with s_state_lock held. The channel renders on this
+// pass instead of at its next deadline.
+static void live_apply(channel_ctx_t *ctx, const effect_live_t *cmd, uint32_t now_ms){
+  if (cmd->op == EFFECT_LIVE_EFFECT || cmd->op == EFFECT_LIVE_PARAMS){
+    effect_params_t p = ctx->pending_valid ? ctx->pending : ctx->current;
+    if (cmd->op == EFFECT_LIVE_PARAMS){
+      p = cmd->params;
+    } else {
+      p.effect_id = cmd->effect_id;
+    }
+    if (p.opacity == 0){
+      p.opacity = 255;
+    }
+    apply_base(ctx, &p, 0, now_ms);
+    ctx->cued_valid = false;
+  } else {
+    ctx->current.intensity = cmd->level[0];
+    ctx->pending.intensity = cmd->level[0];
+  }
+  if (ctx->led.ch >= CH_MAX && ctx->led.ch < DDP_BASE){
+    s_group_deadline_ms = now_ms;
+  } else {
+    ctx->next_deadline_ms = now_ms;
+  }
+}
 
-  ctx->next_deadline_ms = now_ms + ctx->frame_interval_ms;
+static void take_live(uint32_t now_ms){
+  effect_live_t cmd;
+  while (xQueueReceive(s_live_q, &cmd, 0) == pdTRUE){
+    if (cmd.op == EFFECT_LIVE_GROUP_RGB){
+      cmd.group[sizeof(cmd.group) - 1] = '\0';
+      effect_engine_release_pwm_group(cmd.group);
+      if (cmd.has_w){
+        pwm_group_set_rgbw(cmd.group, cmd.level[0], cmd.level[1], cmd.level[2], cmd.level[3]);
+      } else {
+        pwm_group_set_rgb(cmd.group, cmd.level[0], cmd.level[1], cmd.level[2]);
+      }
+      continue;
+    }
+    int first = cmd.ch < 0 ? 0 : cmd.ch;
+    int last = cmd.ch < 0 ? CH_MAX - 1 : cmd.ch;
+    if (xSemaphoreTake(s_state_lock, portMAX_DELAY) != pdTRUE){
+      return;
+    }
+    for (int ch = first; ch <= last; ++ch){
+      live_apply(&s_channels[ch], &cmd, now_ms);
+    }
+    xSemaphoreGive(s_state_lock);
+  }
 }
 
 static void effect_engine_task(void *arg){
@@ -372,23 +1186,109 @@ static void effect_engine_task(void *arg){
   for (int ch = 0; ch < CH_MAX; ++ch){
     effect_engine_set_base(ch, &off, 0);
   }
+  pixel_stream_set_consumer(xTaskGetCurrentTaskHandle());
+  frame_cast_set_consumer(xTaskGetCurrentTaskHandle());
+  s_engine_task = xTaskGetCurrentTaskHandle();
 
+  uint32_t last_now_ms = engine_now_ms();
+  uint32_t last_local_ms = (uint32_t)(esp_timer_get_time() / 1000);
   while (1){
-    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000ULL);
+    uint32_t show_ms;
+    if (timecode_playhead_ms(&show_ms)){
+      s_show_offset_ms = show_ms - (uint32_t)(sync_now_us() / 1000);
+    }
+    uint32_t now_ms = engine_now_ms();
+    // Stream playout runs on the receiver's clock (local, not sync time).
+    uint32_t stream_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    int32_t step = (int32_t)((now_ms - last_now_ms) - (stream_ms - last_local_ms));
+    if (step > (int32_t)CLOCK_STEP_MS || step < -(int32_t)CLOCK_STEP_MS){
+      rebase_xfades(step);
+    }
+    last_now_ms = now_ms;
+    last_local_ms = stream_ms;
+    // Audio features for this pass, on the receiver's clock; the last good
+    // frame stays if the feed was mid-write.
+    fx_audio_t audio;
+    if (audio_feed_read(esp_timer_get_time(), &audio)){
+      g_fx_audio = audio;
+    }
+    // Beat phase from an audio feed with a beat, else from the sync show
+    // state, so beat-driven effects line up across nodes between REST beat
+    // hits. A master passes the audio beat on to its slaves.
+    float beat;
+    if (g_fx_audio.live && g_fx_audio.tempo_bpm > 0.f){
+      trigger_set_beat(g_fx_audio.beat_phase);
+      sync_protocol_follow_beat(g_fx_audio.beat_phase, g_fx_audio.tempo_bpm);
+    } else if (sync_protocol_beat_phase(sync_now_us(), &beat)){
+      trigger_set_beat(beat);
+    }
+    take_live(now_ms);
+    uint32_t sleep_ms = IDLE_POLL_MS;
     for (int ch = 0; ch < CH_MAX; ++ch){
       channel_ctx_t *ctx = &s_channels[ch];
-      if (now_ms >= ctx->next_deadline_ms){
+      if (frame_cast_active(ch, stream_ms)){
+        // The sending node renders; each completed frame wakes us.
+        if (ctx->led.framebuf && frame_cast_take(ch, ctx->led.framebuf, ctx->led.n_pixels)){
+          output_stream(ctx, ctx->led.framebuf, ctx->led.n_pixels, now_ms);
+        }
+        continue;
+      }
+      if (pixel_stream_active(ch)){
+        // The receiver wakes us on each latch; queued frames set the sleep.
+        px_rgba_t *px;
+        uint16_t n;
+        uint32_t wait;
+        if (pixel_stream_take(ch, stream_ms, &px, &n, &wait)){
+          output_stream(ctx, px, n, now_ms);
+        }
+        if (wait < sleep_ms){
+          sleep_ms = wait;
+        }
+        continue;
+      }
+      if (frame_due(ctx->next_deadline_ms, now_ms)){
         render_channel(ctx, now_ms);
       }
+      uint32_t wait = ctx->next_deadline_ms - now_ms;
+      if ((int32_t)wait > 0 && wait < sleep_ms){
+        sleep_ms = wait;
+      }
+    }
+    if (frame_due(s_group_deadline_ms, now_ms)){
+      render_groups(now_ms);
+    }
+    uint32_t group_wait = s_group_deadline_ms - now_ms;
+    if ((int32_t)group_wait > 0 && group_wait < sleep_ms){
+      sleep_ms = group_wait;
     }
-    vTaskDelay(pdMS_TO_TICKS(5));
+    for (int v = 0; v < DDP_MAX; ++v){
+      channel_ctx_t *ctx = &s_channels[DDP_BASE + v];
+      if (frame_due(ctx->next_deadline_ms, now_ms)){
+        render_ddp(v, now_ms);
+      }
+      uint32_t wait = ctx->next_deadline_ms - now_ms;
+      if (ctx->led.n_pixels && (int32_t)wait > 0 && wait < sleep_ms){
+        sleep_ms = wait;
+      }
+    }
+    // Sleep until the earliest channel deadline so >100 fps channels are
+    // not quantised to the idle poll interval; a latched stream frame or a
+    // live command ends the sleep early, a queued frame sets its length.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms) ? pdMS_TO_TICKS(sleep_ms) : 1);
   }
 }
 
 void task_effect_engine_start(void){
   ensure_lock();
+  s_live_q = xQueueCreate(LIVE_QUEUE_LEN, sizeof(effect_live_t));
   for (int ch = 0; ch < CH_MAX; ++ch){
     init_channel(&s_channels[ch], ch);
   }
+  for (int i = 0; i < GROUP_MAX; ++i){
+    init_group_channel(&s_channels[CH_MAX + i], CH_MAX + i);
+  }
+  for (int v = 0; v < DDP_MAX; ++v){
+    init_ddp_channel(&s_channels[DDP_BASE + v], DDP_BASE + v);
+  }
   xTaskCreate(effect_engine_task, "effect_engine", 6144, NULL, 5, NULL);
 }
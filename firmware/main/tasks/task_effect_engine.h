@@ -4,18 +4,71 @@
 #include <stdint.h>
 
 #include "effects.h"
+#include "fx_calib.h"
 
 #define EFFECT_ENGINE_CH_MAX 8
 
 typedef struct {
-  float power_scale[EFFECT_ENGINE_CH_MAX];
+  float    power_scale[EFFECT_ENGINE_CH_MAX];
+  uint16_t fps[EFFECT_ENGINE_CH_MAX];
+  bool     hdr[EFFECT_ENGINE_CH_MAX];
+  bool     hdr_failed[EFFECT_ENGINE_CH_MAX];   // allocation failed, 8-bit until set again
 } effect_engine_stats_t;
 
 void task_effect_engine_start(void);
 bool effect_engine_set_base(int ch, const effect_params_t *params, uint32_t fade_ms);
+// Applies params as set_base would on the first frame at or past at_ms (sync
+// time), so nodes sharing a cue switch on the same frame. One cue per
+// channel; a newer cue or a set_base replaces it.
+bool effect_engine_schedule_base(int ch, const effect_params_t *params, uint32_t fade_ms, uint32_t at_ms);
+// The base the channel shows, or fades to while a crossfade runs.
+bool effect_engine_get_base(int ch, effect_params_t *out);
 bool effect_engine_set_overlay(int ch, const effect_params_t *params);
 void effect_engine_clear_overlay(int ch);
 void effect_engine_get_stats(effect_engine_stats_t *out);
 int  effect_engine_channel_count(void);
 bool effect_engine_get_channel_info(int ch, led_type_t *type, color_order_t *order, uint16_t *n_pixels);
 bool effect_engine_set_channel_type(int ch, led_type_t type, color_order_t order);
+bool effect_engine_set_channel_output(int ch, bool hdr, uint16_t max_fps);
+bool effect_engine_set_channel_calib(int ch, const fx_calib_cfg_t *cfg);
+bool effect_engine_get_channel_calib(int ch, fx_calib_cfg_t *out);
+// Places the strip on a canvas shared with other nodes; NULL or size 0
+// renders it on its own again. Applies from the next frame.
+bool effect_engine_set_channel_canvas(int ch, const fx_canvas_t *canvas);
+bool effect_engine_get_channel_canvas(int ch, fx_canvas_t *out);
+
+// PWM RGB/RGBW groups as 1-pixel channels numbered after the strips. Claim
+// one by group name, then drive it with set_base/set_overlay like a strip;
+// its members follow the rendered pixel until released (NULL = all groups).
+int  effect_engine_pwm_group_channel(const char *group);
+void effect_engine_release_pwm_group(const char *group);
+
+// DDP output channels (ddp_out), numbered after the PWM groups: presets,
+// cues and overlays address them like strips, and each frame goes to the
+// channel's DDP target instead of RMT. 0 pixels = off.
+int  effect_engine_ddp_channel(int v);
+bool effect_engine_set_ddp_channel(int v, uint16_t n_pixels, led_type_t type);
+bool effect_engine_get_ddp_channel(int v, uint16_t *n_pixels, led_type_t *type);
+
+// Live control (OSC, DMX): the caller never takes the engine's state lock. The
+// command is queued, and the render task applies it on its next pass and
+// renders the channel at once instead of at its next deadline. ch -1 = every
+// strip. False if the queue is full or the command is invalid.
+typedef enum {
+  EFFECT_LIVE_EFFECT = 0,     // effect_id, other parameters kept; a cut
+  EFFECT_LIVE_INTENSITY,      // level[0]
+  EFFECT_LIVE_GROUP_RGB,      // group released from the engine, set to level[]
+  EFFECT_LIVE_PARAMS          // params replace the base (DMX); a cut
+} effect_live_op_t;
+
+typedef struct {
+  effect_live_op_t op;
+  int              ch;
+  uint32_t         effect_id;
+  float            level[4];
+  bool             has_w;
+  char             group[24];
+  effect_params_t  params;
+} effect_live_t;
+
+bool effect_engine_live(const effect_live_t *cmd);
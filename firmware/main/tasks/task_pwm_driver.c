@@ -4,24 +4,35 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "pca9685_driver.h"
+#include "pca9685_curve.h"
+#include "pca9685_dither.h"
+#include "power_budget.h"
+#include "sync_protocol.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "PWM_DRIVER";
 
+#define PWM_TICK_MS              20     // animations and fades
+#define DITHER_TICK_MS           5      // while any channel dithers
+#define DITHER_DEFAULT_BPS       16000  // ~35% of a 400 kHz bus
+
 typedef enum {
     PWM_MODE_STATIC,
     PWM_MODE_BREATH,
     PWM_MODE_CANDLE,
-    PWM_MODE_WARMDIM
+    PWM_MODE_FADE
 } pwm_mode_t;
 
 typedef struct {
     uint8_t ch;
     pwm_mode_t mode;
-    float target;
-    float current;
-    uint32_t t0;
+    uint32_t gen;        // bumped by every command
+    uint16_t level;      // static / fade target, logical 0..65535
+    uint16_t from;       // counts at fade start
+    uint16_t to;         // counts at fade end
+    uint32_t t0;         // local ms, see fade_now_ms()
     uint32_t duration_ms;
     bool log_curve;
     float breath_min;
@@ -32,49 +43,296 @@ typedef struct {
     uint32_t seed;
 } pwm_anim_t;
 
-static pwm_anim_t s_anims[8] = {0};
-static pwm_group_t s_groups[8];
+static pwm_anim_t s_anims[PWM_MAX_CHANNELS] = {0};
+static pwm_group_t s_groups[PWM_MAX_GROUPS];
 static int s_groups_len = 0;
+static uint16_t s_counts[PWM_MAX_CHANNELS];
+static uint16_t s_level[PWM_MAX_CHANNELS];
+static float s_load_mA[PWM_MAX_CHANNELS];
+static uint32_t s_soft_start_ms[PWM_MAX_CHANNELS];
+
+// Logical LEDch -> driver channel (chip * 16 + output). Fixed at boot.
+static uint8_t s_phys[PWM_MAX_CHANNELS] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+static int s_n_channels = 8;
+
+// Dithered channels toggle between the two counts around s_target_q8 each
+// DITHER_TICK_MS, within s_dither_Bps of bus traffic. Guarded by s_anim_mux.
+static bool s_dither_on[PWM_MAX_CHANNELS];
+static pca9685_dither_t s_dither[PWM_MAX_CHANNELS];
+static uint32_t s_target_q8[PWM_MAX_CHANNELS];
+static int s_n_dither = 0;
+static uint32_t s_dither_Bps = DITHER_DEFAULT_BPS;
+static int s_dither_rr = 0;
+static bool s_dither_live[PWM_MAX_CHANNELS];
+
+// Channels on the default curve share one table; others own a heap copy,
+// so a 64-channel chain only pays for the curves that differ.
+static pca9685_curve_cfg_t s_curve_cfg[PWM_MAX_CHANNELS];
+static pca9685_curve_t s_linear;
+static pca9685_curve_t *s_curve[PWM_MAX_CHANNELS];   // guarded by s_anim_mux
+
+// Mode changes come from REST and the task reads them every tick; a fade's
+// from/to/t0 must be seen together, and the task only commits a computed
+// value if no command replaced the mode meanwhile (gen unchanged).
+static portMUX_TYPE s_anim_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Same timebase as the effect engine, so breath and candle line up across
+// synced nodes.
+static uint32_t now_ms(void){
+    return (uint32_t)(sync_now_us() / 1000);
+}
+
+// Fades are timed locally: a sync clock step must not freeze or cut one.
+static uint32_t fade_now_ms(void){
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static uint16_t duty_to_level(float duty){
+    if (duty < 0.f) duty = 0.f;
+    if (duty > 1.f) duty = 1.f;
+    return (uint16_t)(duty * 65535.f + 0.5f);
+}
+
+// Every write goes through here so the PWM share of the supply is known to
+// the global power budget.
+static void output_counts(uint8_t ch, uint16_t counts){
+    s_counts[ch] = counts;
+    pca9685_set_counts(s_phys[ch], counts);
+}
 
-static inline void set_channel(int ch, float value){
-    if (ch >= 0 && ch < 8){
-        if (value < 0.f) value = 0.f;
-        if (value > 1.f) value = 1.f;
-        pca9685_set_duty((uint8_t)ch, value);
+// Logical level through the channel curve (incl. max_duty). Call with
+// s_anim_mux held. Dithered channels keep the fraction for the dither pass.
+static void output_level(uint8_t ch, uint16_t level){
+    uint32_t q8 = pca9685_curve_map_q8(s_curve[ch], level);
+    s_level[ch] = level;
+    s_target_q8[ch] = q8;
+    if (s_dither_on[ch]) {
+        output_counts(ch, pca9685_dither_want(&s_dither[ch], q8));
+    } else {
+        output_counts(ch, (uint16_t)((q8 + 128) >> 8));
+    }
+}
+
+static void dither_output(int ch, uint16_t counts, void *ctx){
+    (void)ctx;
+    output_counts((uint8_t)ch, counts);
+}
+
+// One dither period over the dithered channels not mid-fade
+// (pca9685_dither_pass).
+static void dither_pass(uint32_t budget){
+    portENTER_CRITICAL(&s_anim_mux);
+    for (int ch = 0; ch < s_n_channels; ch++) {
+        s_dither_live[ch] = s_dither_on[ch] && s_anims[ch].mode != PWM_MODE_FADE;
     }
+    pca9685_dither_bank_t bank = {
+        .n = s_n_channels,
+        .rr = s_dither_rr,
+        .live = s_dither_live,
+        .target_q8 = s_target_q8,
+        .state = s_dither,
+        .counts = s_counts,
+        .output = dither_output
+    };
+    pca9685_dither_pass(&bank, budget);
+    s_dither_rr = bank.rr;
+    portEXIT_CRITICAL(&s_anim_mux);
+}
+
+// Starts a fade from whatever the channel outputs now; 0 ms is a plain set.
+// Replaces any running mode, so the task stops animating the channel. The
+// fade itself runs in counts, between the curve-mapped endpoints.
+static void start_fade(uint8_t ch, uint16_t level, uint32_t duration_ms, bool log_curve){
+    portENTER_CRITICAL(&s_anim_mux);
+    pwm_anim_t *anim = &s_anims[ch];
+    uint16_t to = pca9685_curve_map(s_curve[ch], level);
+    anim->gen++;
+    anim->level = level;
+    if (duration_ms == 0 || s_counts[ch] == to){
+        anim->mode = PWM_MODE_STATIC;
+        output_level(ch, level);
+        portEXIT_CRITICAL(&s_anim_mux);
+        return;
+    }
+    s_level[ch] = level;
+    anim->from = s_counts[ch];
+    anim->to = to;
+    anim->t0 = fade_now_ms();
+    anim->duration_ms = duration_ms;
+    anim->log_curve = log_curve;
+    anim->mode = PWM_MODE_FADE;
+    portEXIT_CRITICAL(&s_anim_mux);
+}
+
+static void report_load(void){
+    float mA = 0.f;
+    for (int i = 0; i < s_n_channels; i++) {
+        mA += s_counts[i] * s_load_mA[i] / PCA9685_FULL_ON;
+    }
+    power_report_pwm_mA(mA);
+}
+
+static inline void set_channel(int ch, float value, uint32_t fade_ms){
+    if (ch >= 0 && ch < s_n_channels){
+        start_fade((uint8_t)ch, duty_to_level(value), fade_ms, false);
+    }
+}
+
+void pwm_set_load_mA(uint8_t ch, float mA){
+    if (ch >= s_n_channels) return;
+    s_load_mA[ch] = mA > 0.f ? mA : 0.f;
+}
+
+float pwm_get_load_mA(uint8_t ch){
+    return ch < s_n_channels ? s_load_mA[ch] : 0.f;
+}
+
+void pwm_set_channel_map(const uint8_t *phys, int count){
+    if (!phys || count <= 0) return;
+    if (count > PWM_MAX_CHANNELS) count = PWM_MAX_CHANNELS;
+    int outputs = pca9685_channel_count();
+    int n = 0;
+    for (; n < count; n++) {
+        if (phys[n] >= outputs) {
+            ESP_LOGW(TAG, "LEDch%d -> output %d beyond %d chip outputs", n + 1, phys[n], outputs);
+            break;
+        }
+        s_phys[n] = phys[n];
+    }
+    s_n_channels = n;
+}
+
+int pwm_channel_count(void){
+    return s_n_channels;
+}
+
+// Drops every running mode and fade, then one ALLCALL write turns all chips
+// off; no per-channel soft start.
+void pwm_blackout(void){
+    portENTER_CRITICAL(&s_anim_mux);
+    for (int i = 0; i < s_n_channels; i++) {
+        s_anims[i].gen++;
+        s_anims[i].mode = PWM_MODE_STATIC;
+        s_anims[i].level = 0;
+        s_level[i] = 0;
+        s_counts[i] = 0;
+        s_target_q8[i] = 0;
+        s_dither[i].err = 0;
+    }
+    portEXIT_CRITICAL(&s_anim_mux);
+    pca9685_all_off();
+}
+
+void pwm_set_dither(uint8_t ch, bool on){
+    if (ch >= s_n_channels) return;
+    portENTER_CRITICAL(&s_anim_mux);
+    if (s_dither_on[ch] != on) {
+        s_dither_on[ch] = on;
+        s_n_dither += on ? 1 : -1;
+        s_dither[ch].err = 0;
+        output_level(ch, s_level[ch]);
+    }
+    portEXIT_CRITICAL(&s_anim_mux);
+}
+
+bool pwm_get_dither(uint8_t ch){
+    return ch < s_n_channels && s_dither_on[ch];
+}
+
+void pwm_set_dither_budget(uint32_t bytes_per_s){
+    s_dither_Bps = bytes_per_s;
+}
+
+uint32_t pwm_get_dither_budget(void){
+    return s_dither_Bps;
+}
+
+void pwm_set_soft_start_ms(uint8_t ch, uint32_t ms){
+    if (ch >= s_n_channels) return;
+    s_soft_start_ms[ch] = ms;
+}
+
+uint32_t pwm_get_soft_start_ms(uint8_t ch){
+    return ch < s_n_channels ? s_soft_start_ms[ch] : 0;
 }
 
 void pwm_set_mode_static(uint8_t ch, float duty) {
-    if (ch >= 8) return;
-    s_anims[ch].mode = PWM_MODE_STATIC;
-    s_anims[ch].target = duty;
-    pca9685_set_duty(ch, duty);
+    if (ch >= s_n_channels) return;
+    start_fade(ch, duty_to_level(duty), s_soft_start_ms[ch], false);
+}
+
+void pwm_fade_to(uint8_t ch, float duty, uint32_t duration_ms, bool log_curve) {
+    if (ch >= s_n_channels) return;
+    start_fade(ch, duty_to_level(duty), duration_ms, log_curve);
+}
+
+// Builds outside the lock, swaps under it, and re-targets the channel so a
+// new curve or max_duty takes effect without waiting for the next command.
+void pwm_set_curve(uint8_t ch, const pca9685_curve_cfg_t *cfg){
+    if (ch >= s_n_channels || !cfg) return;
+    bool shared = cfg->kind == PCA9685_CURVE_LINEAR && (cfg->max_duty <= 0.f || cfg->max_duty >= 1.f);
+    pca9685_curve_t *curve = &s_linear;
+    if (!shared) {
+        curve = malloc(sizeof(*curve));
+        if (!curve) {
+            ESP_LOGE(TAG, "No memory for LEDch%d curve", ch + 1);
+            return;
+        }
+        pca9685_curve_build(curve, cfg);
+    }
+
+    portENTER_CRITICAL(&s_anim_mux);
+    pca9685_curve_t *old = s_curve[ch];
+    s_curve_cfg[ch] = *cfg;
+    s_curve[ch] = curve;
+    pwm_anim_t *anim = &s_anims[ch];
+    if (anim->mode == PWM_MODE_STATIC) {
+        output_level(ch, anim->level);
+    } else if (anim->mode == PWM_MODE_FADE) {
+        anim->to = pca9685_curve_map(s_curve[ch], anim->level);
+    }
+    portEXIT_CRITICAL(&s_anim_mux);
+    // Only read under s_anim_mux, so nothing can still hold the old table.
+    if (old != &s_linear) {
+        free(old);
+    }
+}
+
+bool pwm_get_curve(uint8_t ch, pca9685_curve_cfg_t *out){
+    if (ch >= s_n_channels || !out) return false;
+    portENTER_CRITICAL(&s_anim_mux);
+    *out = s_curve_cfg[ch];
+    portEXIT_CRITICAL(&s_anim_mux);
+    return true;
 }
 
 void pwm_set_mode_breath(uint8_t ch, float min_val, float max_val, float period_ms) {
-    if (ch >= 8) return;
+    if (ch >= s_n_channels) return;
+    portENTER_CRITICAL(&s_anim_mux);
+    s_anims[ch].gen++;
     s_anims[ch].mode = PWM_MODE_BREATH;
     s_anims[ch].breath_min = min_val;
     s_anims[ch].breath_max = max_val;
     s_anims[ch].breath_period_ms = period_ms > 0 ? period_ms : 2000.f;
+    portEXIT_CRITICAL(&s_anim_mux);
 }
 
 void pwm_set_mode_candle(uint8_t ch, float base, float flicker, uint32_t seed) {
-    if (ch >= 8) return;
-   s_anims[ch].mode = PWM_MODE_CANDLE;
-   s_anims[ch].candle_base = base;
-   s_anims[ch].candle_flick = flicker;
-   s_anims[ch].seed = seed;
+    if (ch >= s_n_channels) return;
+    portENTER_CRITICAL(&s_anim_mux);
+    s_anims[ch].gen++;
+    s_anims[ch].mode = PWM_MODE_CANDLE;
+    s_anims[ch].candle_base = base;
+    s_anims[ch].candle_flick = flicker;
+    s_anims[ch].seed = seed;
+    portEXIT_CRITICAL(&s_anim_mux);
 }
 
 void pwm_set_mode_warmdim(uint8_t ch, float duty) {
-    if (ch >= 8) return;
-    s_anims[ch].mode = PWM_MODE_WARMDIM;
-    s_anims[ch].target = duty;
-    float clamped = duty;
-    if (clamped < 0.f) clamped = 0.f;
-    if (clamped > 1.f) clamped = 1.f;
-    pca9685_set_duty(ch, powf(clamped, 2.0f));
+    if (ch >= s_n_channels) return;
+    // Square law on the logical level, ahead of the channel curve.
+    uint32_t l = duty_to_level(duty);
+    start_fade(ch, (uint16_t)((l * l + 32767u) / 65535u), s_soft_start_ms[ch], false);
 }
 
 void pwm_groups_init_from_config(void){
@@ -86,15 +344,15 @@ void pwm_groups_replace(const pwm_group_t *groups, int count){
         s_groups_len = 0;
         return;
     }
-    if (count > 8){
-        count = 8;
+    if (count > PWM_MAX_GROUPS){
+        count = PWM_MAX_GROUPS;
     }
     for (int i = 0; i < count; ++i){
         s_groups[i] = groups[i];
-        if (s_groups[i].map_r < 0 || s_groups[i].map_r >= 8) s_groups[i].map_r = -1;
-        if (s_groups[i].map_g < 0 || s_groups[i].map_g >= 8) s_groups[i].map_g = -1;
-        if (s_groups[i].map_b < 0 || s_groups[i].map_b >= 8) s_groups[i].map_b = -1;
-        if (s_groups[i].map_w < 0 || s_groups[i].map_w >= 8) s_groups[i].map_w = -1;
+        if (s_groups[i].map_r < 0 || s_groups[i].map_r >= s_n_channels) s_groups[i].map_r = -1;
+        if (s_groups[i].map_g < 0 || s_groups[i].map_g >= s_n_channels) s_groups[i].map_g = -1;
+        if (s_groups[i].map_b < 0 || s_groups[i].map_b >= s_n_channels) s_groups[i].map_b = -1;
+        if (s_groups[i].map_w < 0 || s_groups[i].map_w >= s_n_channels) s_groups[i].map_w = -1;
     }
     s_groups_len = count;
 }
@@ -111,6 +369,10 @@ bool pwm_groups_get(int index, pwm_group_t *out){
     return true;
 }
 
+static uint32_t soft_start(int ch){
+    return (ch >= 0 && ch < s_n_channels) ? s_soft_start_ms[ch] : 0;
+}
+
 static pwm_group_t* find_group(const char *name){
     if (!name){
         return NULL;
@@ -128,9 +390,9 @@ void pwm_group_set_rgb(const char* name, float r, float g, float b){
     if (!gptr || gptr->kind != PWMG_RGB){
         return;
     }
-    set_channel(gptr->map_r, r);
-    set_channel(gptr->map_g, g);
-    set_channel(gptr->map_b, b);
+    set_channel(gptr->map_r, r, soft_start(gptr->map_r));
+    set_channel(gptr->map_g, g, soft_start(gptr->map_g));
+    set_channel(gptr->map_b, b, soft_start(gptr->map_b));
 }
 
 void pwm_group_set_rgbw(const char* name, float r, float g, float b, float w){
@@ -139,18 +401,64 @@ void pwm_group_set_rgbw(const char* name, float r, float g, float b, float w){
         return;
     }
     if (gptr->kind == PWMG_RGB){
-        set_channel(gptr->map_r, r);
-        set_channel(gptr->map_g, g);
-        set_channel(gptr->map_b, b);
+        set_channel(gptr->map_r, r, soft_start(gptr->map_r));
+        set_channel(gptr->map_g, g, soft_start(gptr->map_g));
+        set_channel(gptr->map_b, b, soft_start(gptr->map_b));
     } else {
-        set_channel(gptr->map_r, r);
-        set_channel(gptr->map_g, g);
-        set_channel(gptr->map_b, b);
-        set_channel(gptr->map_w, w);
+        set_channel(gptr->map_r, r, soft_start(gptr->map_r));
+        set_channel(gptr->map_g, g, soft_start(gptr->map_g));
+        set_channel(gptr->map_b, b, soft_start(gptr->map_b));
+        set_channel(gptr->map_w, w, soft_start(gptr->map_w));
+    }
+}
+
+static inline void stream_channel(int ch, uint16_t level){
+    if (ch >= 0 && ch < s_n_channels){
+        start_fade((uint8_t)ch, level, 0, false);
     }
 }
 
-static void pwm_update_channel(pwm_anim_t* anim, uint32_t t_ms) {
+bool pwm_group_stream(const char* name, const uint16_t level[4]){
+    pwm_group_t *gptr = find_group(name);
+    if (!gptr || !level){
+        return false;
+    }
+    stream_channel(gptr->map_r, level[0]);
+    stream_channel(gptr->map_g, level[1]);
+    stream_channel(gptr->map_b, level[2]);
+    if (gptr->kind == PWMG_RGBW){
+        stream_channel(gptr->map_w, level[3]);
+    }
+    return true;
+}
+
+void pwm_commit(void){
+    pca9685_flush();
+}
+
+// All members start on the same tick with the same duration, so a group
+// fades as one colour.
+void pwm_group_fade(const char* name, float r, float g, float b, float w, uint32_t fade_ms){
+    pwm_group_t *gptr = find_group(name);
+    if (!gptr){
+        return;
+    }
+    set_channel(gptr->map_r, r, fade_ms);
+    set_channel(gptr->map_g, g, fade_ms);
+    set_channel(gptr->map_b, b, fade_ms);
+    if (gptr->kind == PWMG_RGBW){
+        set_channel(gptr->map_w, w, fade_ms);
+    }
+}
+
+// A fade started from REST after this tick read the clock has not begun yet.
+static uint32_t fade_elapsed(const pwm_anim_t *anim, uint32_t t_ms){
+    int32_t dt = (int32_t)(t_ms - anim->t0);
+    return dt > 0 ? (uint32_t)dt : 0;
+}
+
+// Logical level of an animated channel; fades are handled in counts.
+static uint16_t pwm_anim_level(const pwm_anim_t* anim, uint32_t t_ms) {
     float duty = 0.0f;
     
     switch (anim->mode) {
@@ -171,46 +479,79 @@ static void pwm_update_channel(pwm_anim_t* anim, uint32_t t_ms) {
             break;
         }
 
-        case PWM_MODE_WARMDIM: {
-            float clamped = anim->target;
-            if (clamped < 0.f) clamped = 0.f;
-            if (clamped > 1.f) clamped = 1.f;
-            duty = powf(clamped, 2.0f);
-            break;
-        }
-
         case PWM_MODE_STATIC:
+        case PWM_MODE_FADE:
         default:
-            duty = anim->target;
-            break;
+            return anim->level;
     }
     
-    pca9685_set_duty(anim->ch, duty);
+    return duty_to_level(duty);
 }
 
 static void pwm_driver_task(void *arg) {
     ESP_LOGI(TAG, "PWM driver task started");
     
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < s_n_channels; i++) {
         s_anims[i].ch = i;
         s_anims[i].mode = PWM_MODE_STATIC;
-        s_anims[i].target = 0.0f;
+        s_anims[i].level = 0;
     }
     
+    uint32_t last_anim_ms = now_ms() - PWM_TICK_MS;
     while (1) {
-        uint32_t t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        uint32_t t_ms = now_ms();
+        uint32_t fade_ms = fade_now_ms();
+        bool dithering = s_n_dither > 0;
+        uint32_t tick_ms = dithering ? DITHER_TICK_MS : PWM_TICK_MS;
         
-        for (int i = 0; i < 8; i++) {
-            if (s_anims[i].mode != PWM_MODE_STATIC) {
-                pwm_update_channel(&s_anims[i], t_ms);
+        // Animations keep their 50 Hz rate when the task runs faster for
+        // dithering, so the extra bus traffic is the dither budget only.
+        bool anim_due = t_ms - last_anim_ms >= PWM_TICK_MS - DITHER_TICK_MS / 2;
+        if (anim_due) last_anim_ms = t_ms;
+        for (int i = 0; anim_due && i < s_n_channels; i++) {
+            if (s_anims[i].mode == PWM_MODE_STATIC) continue;
+            portENTER_CRITICAL(&s_anim_mux);
+            pwm_anim_t anim = s_anims[i];
+            portEXIT_CRITICAL(&s_anim_mux);
+            if (anim.mode == PWM_MODE_STATIC) continue;
+            bool fading = anim.mode == PWM_MODE_FADE;
+            uint16_t value = fading
+                ? pca9685_fade_counts(anim.from, anim.to, fade_elapsed(&anim, fade_ms), anim.duration_ms, anim.log_curve)
+                : pwm_anim_level(&anim, t_ms);
+            portENTER_CRITICAL(&s_anim_mux);
+            if (s_anims[i].gen == anim.gen) {
+                if (!fading) {
+                    output_level(anim.ch, value);
+                } else if (fade_elapsed(&anim, fade_ms) >= anim.duration_ms) {
+                    // Land on the curve-mapped target even if the curve changed mid-fade.
+                    output_level(anim.ch, anim.level);
+                    s_anims[i].mode = PWM_MODE_STATIC;
+                } else {
+                    output_counts(anim.ch, value);
+                }
             }
+            portEXIT_CRITICAL(&s_anim_mux);
+        }
+        if (dithering) {
+            dither_pass(s_dither_Bps * tick_ms / 1000);
         }
+        // Setters (here and from REST) only stage shadow registers; one
+        // flush per tick puts every change on the bus in batched bursts.
+        pca9685_flush();
+        report_load();
         
-        vTaskDelay(pdMS_TO_TICKS(20));
+        vTaskDelay(pdMS_TO_TICKS(tick_ms));
     }
 }
 
 void task_pwm_driver_start(void) {
+    pca9685_curve_cfg_t linear;
+    pca9685_curve_default(&linear);
+    pca9685_curve_build(&s_linear, &linear);
+    for (int i = 0; i < PWM_MAX_CHANNELS; i++) {
+        s_curve_cfg[i] = linear;
+        s_curve[i] = &s_linear;
+    }
     pwm_groups_init_from_config();
     xTaskCreate(pwm_driver_task, "pwm_drv", 4096, NULL, 6, NULL);
     ESP_LOGI(TAG, "PWM driver task spawned");
@@ -4,17 +4,55 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "pca9685_curve.h"
 #include "rest_api_types.h"
 
+// Logical LEDch outputs -> driver channels (chip * 16 + output), from the
+// board map. Call once before task_pwm_driver_start(); default is 1:1 x 8.
+void pwm_set_channel_map(const uint8_t *phys, int count);
+int  pwm_channel_count(void);
 void task_pwm_driver_start(void);
+void pwm_blackout(void);
 void pwm_set_mode_static(uint8_t ch, float duty);
 void pwm_set_mode_breath(uint8_t ch, float min_val, float max_val, float period_ms);
 void pwm_set_mode_candle(uint8_t ch, float base, float flicker, uint32_t seed);
 void pwm_set_mode_warmdim(uint8_t ch, float duty);
 
+// Time-based fade from the current output, at full 12-bit resolution. Static
+// and group sets fade over the channel's soft_start_ms (0 = immediate).
+void     pwm_fade_to(uint8_t ch, float duty, uint32_t duration_ms, bool log_curve);
+void     pwm_set_soft_start_ms(uint8_t ch, uint32_t ms);
+uint32_t pwm_get_soft_start_ms(uint8_t ch);
+
+// Temporal dithering: the channel alternates between neighbouring counts at
+// 200 Hz so its average hits the curve output below one 12-bit step. The
+// budget caps the bus traffic all dithered channels together may add.
+void     pwm_set_dither(uint8_t ch, bool on);
+bool     pwm_get_dither(uint8_t ch);
+void     pwm_set_dither_budget(uint32_t bytes_per_s);
+uint32_t pwm_get_dither_budget(void);
+
+// Per-channel output curve (linear/log/square/CIE1931/custom) and max_duty.
+// The table is rebuilt here, so call on config changes only.
+void     pwm_set_curve(uint8_t ch, const pca9685_curve_cfg_t *cfg);
+bool     pwm_get_curve(uint8_t ch, pca9685_curve_cfg_t *out);
+
+// Full-duty current of the load on each output, for the shared power budget.
+void  pwm_set_load_mA(uint8_t ch, float mA);
+float pwm_get_load_mA(uint8_t ch);
+
 void pwm_groups_init_from_config(void);
 void pwm_groups_replace(const pwm_group_t *groups, int count);
 int  pwm_groups_count(void);
 bool pwm_groups_get(int index, pwm_group_t *out);
 void pwm_group_set_rgb(const char* name, float r, float g, float b);
 void pwm_group_set_rgbw(const char* name, float r, float g, float b, float w);
+// w is ignored for RGB groups.
+void pwm_group_fade(const char* name, float r, float g, float b, float w, uint32_t fade_ms);
+
+// Effect-engine output: members jump to the given logical levels (r, g, b, w)
+// through their curves, cancelling any mode or fade, and are only staged;
+// pwm_commit() puts a whole frame on the bus in one flush. Returns false if
+// no such group exists.
+bool pwm_group_stream(const char* name, const uint16_t level[4]);
+void pwm_commit(void);
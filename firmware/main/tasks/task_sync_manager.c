@@ -1,9 +1,42 @@
+#include "task_sync_manager.h"
+
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "rest_api.h"
 
 static const char *TAG = "SYNC_MGR";
 
+#define CUE_QUEUE_LEN 8
+
+static QueueHandle_t s_cue_q = NULL;
+
+static void sync_manager_task(void *arg) {
+    (void)arg;
+    sync_manager_cue_t cue;
+    while (1) {
+        if (xQueueReceive(s_cue_q, &cue, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        esp_err_t err = rest_api_play_cue(cue.target, cue.preset, cue.preset_crc,
+                                          cue.fade_ms, cue.at_ms, NULL);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s cue at %lu ms (%s on %s) refused: %s", cue.origin,
+                     (unsigned long)cue.at_ms, cue.preset, cue.target, esp_err_to_name(err));
+        }
+    }
+}
+
+bool task_sync_manager_post(const sync_manager_cue_t *cue) {
+    return s_cue_q && xQueueSend(s_cue_q, cue, 0) == pdTRUE;
+}
+
 void task_sync_manager_start(void) {
-    ESP_LOGI(TAG, "Sync manager task placeholder");
+    if (s_cue_q) {
+        return;
+    }
+    s_cue_q = xQueueCreate(CUE_QUEUE_LEN, sizeof(sync_manager_cue_t));
+    // Below net_io, so a preset load never holds up packet I/O.
+    xTaskCreate(sync_manager_task, "sync_mgr", 4096, NULL, 4, NULL);
 }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sync_packet.h"
+
+// A cue to load and schedule. Network callbacks must not block, so cues
+// arriving there are posted here and the preset is read from flash on the
+// sync manager task.
+typedef struct {
+    uint32_t    at_ms;                        // switch on this sync time
+    uint32_t    fade_ms;
+    uint32_t    preset_crc;                   // 0 = any
+    const char *origin;                       // for the log: "sync", "show"
+    char        target[SYNC_CUE_NAME_LEN];
+    char        preset[SYNC_CUE_NAME_LEN];
+} sync_manager_cue_t;
+
+void task_sync_manager_start(void);
+// Never blocks; false when the queue is full.
+bool task_sync_manager_post(const sync_manager_cue_t *cue);
@@ -0,0 +1,203 @@
+#include "pca9685_mock.h"
+#include <string.h>
+
+#define REG_MODE1          0x00
+#define REG_MODE2          0x01
+#define REG_LED0_ON_L      0x06
+#define REG_LED15_OFF_H    0x45
+#define REG_ALL_LED_ON_L   0xFA
+#define REG_ALL_LED_OFF_H  0xFD
+#define REG_PRESCALE       0xFE
+
+#define MODE1_RESTART      0x80
+#define MODE1_AI           0x20
+#define MODE1_SLEEP        0x10
+#define MODE1_ALLCALL      0x01
+#define LED_FULL_BIT       0x10
+
+#define OSC_HZ             25000000.0f
+
+static void chip_reset(pca9685_mock_chip_t *chip, uint8_t addr) {
+    memset(chip->regs, 0, sizeof(chip->regs));
+    chip->addr = addr;
+    chip->regs[REG_MODE1] = MODE1_SLEEP | MODE1_ALLCALL;
+    chip->regs[REG_MODE2] = 0x04;
+    chip->regs[REG_PRESCALE] = 0x1E;
+    for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+        chip->regs[REG_LED0_ON_L + 4 * ch + 3] = LED_FULL_BIT;
+    }
+}
+
+void pca9685_mock_reset(pca9685_mock_t *m, int n_chips) {
+    memset(m, 0, sizeof(*m));
+    if (n_chips < 1) n_chips = 1;
+    if (n_chips > PCA9685_MAX_CHIPS) n_chips = PCA9685_MAX_CHIPS;
+    m->n_chips = n_chips;
+    m->scl_hz = 400000;
+    for (int c = 0; c < n_chips; c++) {
+        chip_reset(&m->chips[c], (uint8_t)(0x40 + c));
+    }
+}
+
+void pca9685_mock_clear_log(pca9685_mock_t *m) {
+    m->n_txn = 0;
+    m->n_nack = 0;
+    m->busy_us = 0;
+    m->bytes = 0;
+}
+
+static bool answers(const pca9685_mock_chip_t *chip, uint8_t addr) {
+    return chip->addr == addr ||
+           (addr == PCA9685_ALLCALL_ADDR && (chip->regs[REG_MODE1] & MODE1_ALLCALL));
+}
+
+// With AI set the pointer walks MODE1..LED15_OFF_H and wraps to MODE1, as on
+// the chip; ALL_LED and PRE_SCALE are only reached by addressing them.
+static uint8_t next_reg(const pca9685_mock_chip_t *chip, uint8_t reg) {
+    if (!(chip->regs[REG_MODE1] & MODE1_AI)) return reg;
+    return reg == REG_LED15_OFF_H ? REG_MODE1 : (uint8_t)(reg + 1);
+}
+
+static void store(pca9685_mock_t *m, pca9685_mock_chip_t *chip, uint8_t reg, uint8_t v) {
+    if (reg == REG_MODE1) {
+        chip->regs[reg] = v & ~MODE1_RESTART;   // RESTART self-clears
+    } else if (reg == REG_PRESCALE) {
+        if (chip->regs[REG_MODE1] & MODE1_SLEEP) {
+            chip->regs[reg] = v;
+        } else {
+            m->ignored_writes++;
+        }
+    } else if (reg >= REG_ALL_LED_ON_L && reg <= REG_ALL_LED_OFF_H) {
+        // Write-only broadcast into every LEDn; reads back as 0.
+        for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+            chip->regs[REG_LED0_ON_L + 4 * ch + (reg - REG_ALL_LED_ON_L)] = v;
+        }
+    } else {
+        chip->regs[reg] = v;
+    }
+}
+
+// START, address, payload, STOP: 9 bits per byte with ACK, plus start/stop.
+static uint32_t bus_time_us(const pca9685_mock_t *m, uint32_t bytes_on_wire, uint32_t starts) {
+    uint64_t bits = 9ull * bytes_on_wire + 2ull * starts;
+    return (uint32_t)((bits * 1000000ull + m->scl_hz - 1) / m->scl_hz);
+}
+
+static void record(pca9685_mock_t *m, uint8_t addr, uint8_t reg, size_t len, bool read, bool nack,
+                   uint32_t dur_us) {
+    pca9685_mock_txn_t *t = &m->log[m->n_txn % PCA9685_MOCK_LOG_LEN];
+    t->t_us = m->now_us;
+    t->dur_us = dur_us;
+    t->addr = addr;
+    t->reg = reg;
+    t->len = (uint16_t)len;
+    t->read = read;
+    t->nack = nack;
+    m->n_txn++;
+    m->busy_us += dur_us;
+    m->bytes += 1 + len;
+    if (nack) m->n_nack++;
+}
+
+static esp_err_t mock_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len) {
+    pca9685_mock_t *m = ctx;
+    if (!data || len == 0) return ESP_ERR_INVALID_ARG;
+    bool acked = false;
+    for (int c = 0; c < m->n_chips; c++) {
+        pca9685_mock_chip_t *chip = &m->chips[c];
+        if (!answers(chip, addr)) continue;
+        acked = true;
+        uint8_t reg = data[0];
+        for (size_t i = 1; i < len; i++) {
+            store(m, chip, reg, data[i]);
+            reg = next_reg(chip, reg);
+        }
+    }
+    record(m, addr, data[0], len - 1, false, !acked, bus_time_us(m, 1 + len, 1));
+    return acked ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t mock_write_read(void *ctx, uint8_t addr, uint8_t reg, uint8_t *out, size_t len) {
+    pca9685_mock_t *m = ctx;
+    pca9685_mock_chip_t *chip = NULL;
+    for (int c = 0; c < m->n_chips && !chip; c++) {
+        if (m->chips[c].addr == addr) chip = &m->chips[c];
+    }
+    if (chip) {
+        uint8_t r = reg;
+        for (size_t i = 0; i < len; i++) {
+            out[i] = (r >= REG_ALL_LED_ON_L && r <= REG_ALL_LED_OFF_H) ? 0 : chip->regs[r];
+            r = next_reg(chip, r);
+        }
+    }
+    record(m, addr, reg, len, true, !chip, bus_time_us(m, 3 + len, 2));
+    return chip ? ESP_OK : ESP_FAIL;
+}
+
+void pca9685_mock_bus(pca9685_mock_t *m, pca9685_bus_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->write = mock_write;
+    out->write_read = mock_write_read;
+    out->ctx = m;
+}
+
+esp_err_t pca9685_mock_start(pca9685_mock_t *m, int n_chips) {
+    pca9685_mock_reset(m, n_chips);
+    pca9685_config_t cfg = {
+        .i2c_port = 0,
+        .i2c_addr = 0x40,
+        .oe_pin = 25,
+        .n_chips = (uint8_t)m->n_chips,
+    };
+    pca9685_bus_t bus;
+    pca9685_mock_bus(m, &bus);
+    return pca9685_init_bus(&cfg, &bus);
+}
+
+uint8_t pca9685_mock_reg(const pca9685_mock_t *m, int chip, uint8_t reg) {
+    return (chip >= 0 && chip < m->n_chips) ? m->chips[chip].regs[reg] : 0;
+}
+
+// FULL_OFF wins over FULL_ON; otherwise the high time is OFF - ON modulo the
+// 4096-step period. A sleeping chip drives nothing.
+uint16_t pca9685_mock_counts(const pca9685_mock_t *m, int channel) {
+    int c = channel / PCA9685_CHANNELS;
+    if (channel < 0 || c >= m->n_chips) return 0;
+    const uint8_t *regs = m->chips[c].regs;
+    if (regs[REG_MODE1] & MODE1_SLEEP) return 0;
+    const uint8_t *led = &regs[REG_LED0_ON_L + 4 * (channel % PCA9685_CHANNELS)];
+    if (led[3] & LED_FULL_BIT) return 0;
+    if (led[1] & LED_FULL_BIT) return PCA9685_FULL_ON;
+    uint16_t on = (uint16_t)(led[0] | ((led[1] & 0x0F) << 8));
+    uint16_t off = (uint16_t)(led[2] | ((led[3] & 0x0F) << 8));
+    return (uint16_t)((off - on) & 0x0FFF);
+}
+
+float pca9685_mock_duty(const pca9685_mock_t *m, int channel) {
+    return pca9685_mock_counts(m, channel) / (float)PCA9685_FULL_ON;
+}
+
+float pca9685_mock_pwm_hz(const pca9685_mock_t *m, int chip) {
+    return OSC_HZ / (4096.0f * (pca9685_mock_reg(m, chip, REG_PRESCALE) + 1));
+}
+
+float pca9685_mock_utilization(const pca9685_mock_t *m, int64_t t0_us, int64_t t1_us) {
+    if (t1_us <= t0_us) return 0.0f;
+    uint64_t busy = 0;
+    uint32_t kept = m->n_txn < PCA9685_MOCK_LOG_LEN ? m->n_txn : PCA9685_MOCK_LOG_LEN;
+    for (uint32_t i = m->n_txn - kept; i < m->n_txn; i++) {
+        const pca9685_mock_txn_t *t = &m->log[i % PCA9685_MOCK_LOG_LEN];
+        if (t->t_us >= t0_us && t->t_us < t1_us) busy += t->dur_us;
+    }
+    return (float)busy / (float)(t1_us - t0_us);
+}
+
+uint32_t pca9685_mock_bytes(const pca9685_mock_t *m, int64_t t0_us, int64_t t1_us) {
+    uint32_t bytes = 0;
+    uint32_t kept = m->n_txn < PCA9685_MOCK_LOG_LEN ? m->n_txn : PCA9685_MOCK_LOG_LEN;
+    for (uint32_t i = m->n_txn - kept; i < m->n_txn; i++) {
+        const pca9685_mock_txn_t *t = &m->log[i % PCA9685_MOCK_LOG_LEN];
+        if (t->t_us >= t0_us && t->t_us < t1_us) bytes += 1 + t->len;
+    }
+    return bytes;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pca9685_driver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host-side fake of the I2C layer with a PCA9685 register model: MODE1/MODE2,
+// PRE_SCALE (writable in sleep only), auto-increment, LEDn and ALL_LED, ALLCALL
+// addressing. Every transaction is logged against a mock clock the test
+// advances, with its bus time at scl_hz, so workloads can be costed without
+// hardware.
+
+#define PCA9685_MOCK_LOG_LEN   1024
+
+typedef struct {
+    int64_t  t_us;      // start, mock clock
+    uint32_t dur_us;    // bus time incl. start/address/ACK bits
+    uint8_t  addr;
+    uint8_t  reg;
+    uint16_t len;       // data bytes after the register byte
+    bool     read;
+    bool     nack;      // no chip answered
+} pca9685_mock_txn_t;
+
+typedef struct {
+    uint8_t addr;
+    uint8_t regs[256];
+} pca9685_mock_chip_t;
+
+typedef struct {
+    pca9685_mock_chip_t chips[PCA9685_MAX_CHIPS];
+    int      n_chips;
+    uint32_t scl_hz;
+    int64_t  now_us;
+    pca9685_mock_txn_t log[PCA9685_MOCK_LOG_LEN];   // ring, last LOG_LEN kept
+    uint32_t n_txn;             // ever recorded
+    uint32_t n_nack;
+    uint32_t ignored_writes;    // e.g. PRE_SCALE while awake
+    uint64_t busy_us;           // ever
+    uint64_t bytes;             // ever, incl. register byte, excl. address
+} pca9685_mock_t;
+
+// Power-on register state for n_chips at 0x40 + i, 400 kHz.
+void pca9685_mock_reset(pca9685_mock_t *m, int n_chips);
+// pca9685_init_bus() over the mock (synchronous transport).
+esp_err_t pca9685_mock_start(pca9685_mock_t *m, int n_chips);
+void pca9685_mock_bus(pca9685_mock_t *m, pca9685_bus_t *out);
+void pca9685_mock_clear_log(pca9685_mock_t *m);
+static inline void pca9685_mock_advance_us(pca9685_mock_t *m, int64_t us) {
+    m->now_us += us;
+}
+
+// Output state as the chip would drive it; channel = chip * 16 + output.
+uint8_t  pca9685_mock_reg(const pca9685_mock_t *m, int chip, uint8_t reg);
+uint16_t pca9685_mock_counts(const pca9685_mock_t *m, int channel);   // high time, 0..4096
+float    pca9685_mock_duty(const pca9685_mock_t *m, int channel);
+float    pca9685_mock_pwm_hz(const pca9685_mock_t *m, int chip);
+
+// Traffic of logged transactions starting in [t0_us, t1_us).
+float    pca9685_mock_utilization(const pca9685_mock_t *m, int64_t t0_us, int64_t t1_us);
+uint32_t pca9685_mock_bytes(const pca9685_mock_t *m, int64_t t0_us, int64_t t1_us);
@@ -0,0 +1,346 @@
+#include "unity.h"
+#include "audio_feed.h"
+#include "audio_replay.h"
+#include "effects.h"
+#include "fx_palette.h"
+#include "fx_util.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_US      23220        // 1024 samples at 44.1 kHz
+#define RUN_US        24000000LL
+#define STEP_US       10000        // engine pass
+#define START_US      1000000LL    // local time of the recording's start
+#define DRIFT         0.002        // host clock runs fast by this
+#define DROP_FROM_US  8000000LL    // host stops sending for a while
+#define DROP_TO_US    8800000LL
+#define RETEMPO_US    14000000LL   // 120 -> 128 BPM, new downbeat
+
+static uint32_t s_rng = 77;
+
+static float rnd01(void) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return (s_rng >> 8) / 16777216.0f;
+}
+
+// Wi-Fi-like delay: a floor, an exponential tail and a few spikes, which
+// reorder packets.
+static int64_t net_delay_us(void) {
+    float d = 500.0f - 1500.0f * logf(1.0f - rnd01());
+    if (rnd01() < 0.02f) d += 20000.0f + 20000.0f * rnd01();
+    return (int64_t)d;
+}
+
+// The host's beat tracker: 120 BPM from host time 0, then 128 BPM with
+// the downbeat at RETEMPO_US.
+static double host_beats(int64_t host_us) {
+    if (host_us < RETEMPO_US) return host_us * 2.0 / 1e6;
+    return (host_us - RETEMPO_US) * (128.0 / 60.0) / 1e6 + 0.37;
+}
+
+static float host_bpm(int64_t host_us) {
+    return host_us < RETEMPO_US ? 120.0f : 128.0f;
+}
+
+static float wrap_half(double x) {
+    return (float)(x - floor(x + 0.5));
+}
+
+typedef struct {
+    uint32_t t_us;
+    uint16_t len;
+    uint8_t  pkt[64];
+} rec_t;
+
+static int cmp_rec(const void *a, const void *b) {
+    const rec_t *x = a, *y = b;
+    return x->t_us < y->t_us ? -1 : x->t_us > y->t_us;
+}
+
+// A recorded show: frames every FRAME_US of host time, the host clock
+// DRIFT fast of ours, delays and 3% loss, records in arrival order. A
+// kick on every beat lights the low bands and sets the low onset. The
+// feed counts gaps from the first packet it hears, so the first frame is
+// neither lost nor held up, and the last is not lost.
+static size_t record_show(uint8_t *buf, size_t cap, uint32_t *kicks, uint32_t *dropped) {
+    size_t n = RUN_US / FRAME_US;
+    rec_t *recs = calloc(n, sizeof(*recs));
+    TEST_ASSERT_NOT_NULL(recs);
+    size_t count = 0;
+    double prev_beats = 0.0;
+    *kicks = 0;
+    *dropped = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t host_us = (int64_t)i * FRAME_US;
+        double beats = host_beats(host_us);
+        bool kick = floor(beats) != floor(prev_beats) || i == 0;
+        prev_beats = beats;
+        double since_kick = beats - floor(beats);
+        audio_frame_t f = {
+            .seq = (uint32_t)i + 1,
+            .host_us = host_us,
+            .tempo_bpm = host_bpm(host_us),
+            .beat_phase = (float)since_kick,
+            .onsets = kick ? AUDIO_ONSET_LOW : 0,
+            .n_bands = 16
+        };
+        for (int b = 0; b < 16; b++) {
+            float env = expf(-(float)since_kick * 6.0f);
+            f.bands[b] = b < 4 ? env : 0.2f + 0.1f * rnd01();
+        }
+        f.level = 0.3f + 0.5f * expf(-(float)since_kick * 6.0f);
+        f.peak = fminf(f.level + 0.1f, 1.0f);
+        if ((host_us >= DROP_FROM_US && host_us < DROP_TO_US) || (rnd01() < 0.03f && i > 0 && i + 1 < n)) {
+            (*dropped)++;
+            continue;
+        }
+        if (kick) (*kicks)++;
+        rec_t *r = &recs[count++];
+        int64_t local_us = llround(host_us / (1.0 + DRIFT)) + (i ? net_delay_us() : 500);
+        r->t_us = (uint32_t)local_us;
+        r->len = (uint16_t)audio_packet_encode(r->pkt, sizeof(r->pkt), &f);
+        TEST_ASSERT_EQUAL(28 + 32, r->len);
+    }
+    qsort(recs, count, sizeof(*recs), cmp_rec);
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(audio_replay_record(buf, cap, &used, recs[i].t_us, recs[i].pkt, recs[i].len));
+    }
+    free(recs);
+    return used;
+}
+
+TEST_CASE("audio feature packets round-trip and junk is rejected", "[audio]") {
+    audio_frame_t f = {
+        .seq = 7, .host_us = 123456789, .tempo_bpm = 124.5f, .beat_phase = 0.25f,
+        .onsets = AUDIO_ONSET_LOW | AUDIO_ONSET_HIGH, .level = 0.5f, .peak = 1.0f, .n_bands = 16
+    };
+    for (int b = 0; b < 16; b++) f.bands[b] = b / 15.0f;
+    uint8_t buf[64];
+    size_t len = audio_packet_encode(buf, sizeof(buf), &f);
+    TEST_ASSERT_EQUAL(sizeof(audio_header_t) + 32, len);
+    TEST_ASSERT_EQUAL_HEX8(0x4C, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x41, buf[1]);
+
+    audio_frame_t g;
+    TEST_ASSERT_TRUE(audio_packet_decode(buf, len, &g));
+    TEST_ASSERT_EQUAL_UINT32(7, g.seq);
+    TEST_ASSERT_EQUAL_INT64(123456789, g.host_us);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 124.5f, g.tempo_bpm);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.25f, g.beat_phase);
+    TEST_ASSERT_EQUAL_HEX8(AUDIO_ONSET_LOW | AUDIO_ONSET_HIGH, g.onsets);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, g.level);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, g.peak);
+    for (int b = 0; b < 16; b++) TEST_ASSERT_FLOAT_WITHIN(1e-4f, f.bands[b], g.bands[b]);
+
+    // Short, wrong magic or version, band counts out of range.
+    TEST_ASSERT_FALSE(audio_packet_decode(buf, len - 1, &g));
+    uint8_t bad[64];
+    memcpy(bad, buf, len);
+    bad[0] = 'X';
+    TEST_ASSERT_FALSE(audio_packet_decode(bad, len, &g));
+    memcpy(bad, buf, len);
+    bad[2] = AUDIO_VERSION + 1;
+    TEST_ASSERT_FALSE(audio_packet_decode(bad, len, &g));
+    memcpy(bad, buf, len);
+    bad[3] = 0;
+    TEST_ASSERT_FALSE(audio_packet_decode(bad, len, &g));
+    bad[3] = AUDIO_BANDS_MAX + 1;
+    TEST_ASSERT_FALSE(audio_packet_decode(bad, sizeof(bad), &g));
+    f.n_bands = 0;
+    TEST_ASSERT_EQUAL(0, audio_packet_encode(buf, sizeof(buf), &f));
+    f.n_bands = 16;
+    TEST_ASSERT_EQUAL(0, audio_packet_encode(buf, 40, &f));
+
+    // The feed counts junk, drops what is older than it has, counts gaps.
+    audio_feed_reset();
+    audio_feed_handle(bad, len, 1000);
+    f.seq = 10;
+    len = audio_packet_encode(buf, sizeof(buf), &f);
+    audio_feed_handle(buf, len, 2000);
+    f.seq = 13;
+    len = audio_packet_encode(buf, sizeof(buf), &f);
+    audio_feed_handle(buf, len, 3000);
+    f.seq = 12;
+    len = audio_packet_encode(buf, sizeof(buf), &f);
+    audio_feed_handle(buf, len, 4000);
+    f.seq = 90000;
+    len = audio_packet_encode(buf, sizeof(buf), &f);
+    audio_feed_handle(buf, len, 5000);
+    audio_feed_stats_t st;
+    audio_feed_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(5, st.packets);
+    TEST_ASSERT_EQUAL_UINT32(1, st.malformed);
+    TEST_ASSERT_EQUAL_UINT32(2, st.lost);
+    TEST_ASSERT_EQUAL_UINT32(1, st.stale);
+    TEST_ASSERT_EQUAL_UINT32(1, st.restarts);
+
+    fx_audio_t a;
+    TEST_ASSERT_TRUE(audio_feed_read(5000, &a));
+    TEST_ASSERT_TRUE(a.live);
+    TEST_ASSERT_EQUAL(16, a.n_bands);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, a.level);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, a.onset[0]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, a.onset[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 124.5f, a.tempo_bpm);
+    audio_feed_reset();
+    TEST_ASSERT_TRUE(audio_feed_read(5000, &a));
+    TEST_ASSERT_FALSE(a.live);
+}
+
+// Replays a recorded show as the engine would read it, a pass every
+// STEP_US: the beat runs smoothly on the PLL through jitter, loss and a
+// dropout, follows a tempo change, every kick shows, and levels fall when
+// the host goes quiet.
+TEST_CASE("audio feed replay locks the beat PLL and keeps it running between packets", "[audio]") {
+    size_t cap = (RUN_US / FRAME_US) * 70;
+    uint8_t *rec = malloc(cap);
+    TEST_ASSERT_NOT_NULL(rec);
+    uint32_t kicks, dropped;
+    size_t len = record_show(rec, cap, &kicks, &dropped);
+
+    audio_feed_reset();
+    audio_replay_t r;
+    audio_replay_start(&r, rec, len, START_US);
+    float worst = 0.0f, worst_step = 0.0f, prev = 0.0f;
+    float dropout_level = 1.0f, dropout_err = 0.0f;
+    uint32_t seen_kicks = 0;
+    float prev_onset = 0.0f;
+    bool have_prev = false;
+    int64_t last_rx = START_US;
+    for (int64_t now = START_US; now < START_US + RUN_US + 3000000LL; now += STEP_US) {
+        uint32_t before = r.packets;
+        int64_t next = audio_replay_run(&r, now);
+        if (r.packets != before) last_rx = now;
+        fx_audio_t a;
+        TEST_ASSERT_TRUE(audio_feed_read(now, &a));
+        int64_t t = now - START_US;
+        if (next == INT64_MAX && now - last_rx >= AUDIO_FEED_TIMEOUT_MS * 1000LL) {
+            TEST_ASSERT_FALSE(a.live);
+            continue;
+        }
+        if (a.onset[0] > prev_onset + 0.5f) seen_kicks++;
+        prev_onset = a.onset[0];
+        // The last arrivals may have been overtaken ones, which don't renew it.
+        if (t < 100000 || now - last_rx > (AUDIO_FEED_TIMEOUT_MS - 100) * 1000LL) continue;
+        TEST_ASSERT_TRUE(a.live);
+
+        // Truth: the host's phase at the host time of now.
+        int64_t host_us = llround(t * (1.0 + DRIFT));
+        float err = wrap_half(a.beat_phase - host_beats(host_us));
+        bool retempo = host_us >= RETEMPO_US && host_us < RETEMPO_US + 1000000LL;
+        bool settling = t < 1000000LL || retempo;
+        if (!settling && host_us < RUN_US && fabsf(err) > worst) worst = fabsf(err);
+
+        // Pass to pass the phase moves by the tempo, give or take a little.
+        float step = wrap_half(a.beat_phase - prev - a.tempo_bpm / 60.0f * STEP_US / 1e6f);
+        if (have_prev && !retempo && fabsf(step) > worst_step) worst_step = fabsf(step);
+        prev = a.beat_phase;
+        have_prev = true;
+
+        if (host_us > DROP_FROM_US + 600000LL && host_us < DROP_TO_US) {
+            if (a.level < dropout_level) dropout_level = a.level;
+            if (fabsf(err) > dropout_err) dropout_err = fabsf(err);
+        }
+        if (host_us > RETEMPO_US + 2000000LL && host_us < RUN_US) {
+            TEST_ASSERT_FLOAT_WITHIN(0.3f, 128.0f * (1.0f + DRIFT), a.tempo_bpm);
+        }
+    }
+
+    audio_feed_stats_t st;
+    audio_feed_get_stats(&st);
+    printf("audio feed replay: %u packets, worst beat error %.4f, worst step %.4f, "
+           "dropout error %.4f, %u outliers, %u snaps, %u/%u kicks, %u stale\n",
+           (unsigned)r.packets, worst, worst_step, dropout_err, (unsigned)st.beat_outliers, (unsigned)st.beat_snaps,
+           (unsigned)seen_kicks, (unsigned)kicks, (unsigned)st.stale);
+    TEST_ASSERT_EQUAL_UINT32(r.packets, st.packets);
+    TEST_ASSERT_EQUAL_UINT32(0, st.malformed);
+    TEST_ASSERT_TRUE(worst < 0.02f);          // 10 ms at 120 BPM
+    TEST_ASSERT_TRUE(worst_step < 0.01f);     // never a visible jump
+    TEST_ASSERT_TRUE(dropout_err < 0.03f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, dropout_level);
+    TEST_ASSERT_EQUAL_UINT32(kicks, seen_kicks);
+    TEST_ASSERT_EQUAL_UINT32(1, st.beat_snaps);         // the new downbeat
+    // A packet overtaken by a later one counts as lost, then as stale.
+    TEST_ASSERT_EQUAL_UINT32(dropped + st.stale, st.lost);
+    audio_feed_reset();
+    free(rec);
+}
+
+TEST_CASE("spectrum and VU effects render the audio feed", "[audio][fx]") {
+    static px_rgba_t fb[40];
+    static px_rgba16_t fb16[40];
+    util_init_gamma(2.2f);
+    aled_channel_t ch = {
+        .type = LED_WS2812B,
+        .n_pixels = 40,
+        .gamma = 2.2f,
+        .max_brightness = 255,
+        .framebuf = fb,
+        .framebuf16 = fb16
+    };
+    fx_audio_t saved = g_fx_audio;
+    memset(&g_fx_audio, 0, sizeof(g_fx_audio));
+    g_fx_audio.live = true;
+    g_fx_audio.n_bands = 4;
+    g_fx_audio.bands[0] = 1.0f;
+    g_fx_audio.bands[1] = 0.5f;
+    g_fx_audio.bands[2] = 0.25f;
+    g_fx_audio.bands[3] = 0.0f;
+    g_fx_audio.level = 0.5f;
+    g_fx_audio.peak = 0.75f;
+
+    // Spectrum: band 0 at full palette colour, the last band dark, bands in
+    // between at their energy.
+    effect_params_t sp = { .effect_id = FX_SPECTRUM, .intensity = 1.0f, .palette_id = 0, .opacity = 255 };
+    const effect_vtable_t *fx = fx_lookup(FX_SPECTRUM);
+    TEST_ASSERT_NOT_NULL(fx);
+    TEST_ASSERT_NOT_NULL(fx->render16);
+    fx->render(&ch, &sp, 0, 0);
+    fx->render16(&ch, &sp, 0, 0);
+    rgb8_t c0 = palette_sample(palette_by_id(0), 0.0f);
+    TEST_ASSERT_EQUAL_UINT8(c0.r, fb[0].r);
+    TEST_ASSERT_EQUAL_UINT8(c0.g, fb[0].g);
+    TEST_ASSERT_EQUAL_UINT8(c0.b, fb[0].b);
+    TEST_ASSERT_EQUAL_UINT32(0, fb[39].r + fb[39].g + fb[39].b);
+    TEST_ASSERT_EQUAL_UINT32(0, fb16[39].r + fb16[39].g + fb16[39].b);
+    // Pixel 13 of 39 sits on band 1 (u = 1/3).
+    rgb8_t c13 = palette_sample(palette_by_id(0), 13 / 39.0f);
+    TEST_ASSERT_INT_WITHIN(1, c13.r / 2, fb[13].r);
+    TEST_ASSERT_INT_WITHIN(1, c13.g / 2, fb[13].g);
+    TEST_ASSERT_INT_WITHIN(1, c13.b / 2, fb[13].b);
+    for (int i = 0; i < 40; i++) {
+        TEST_ASSERT_INT_WITHIN(1, fb[i].r, fb16[i].r >> 8);
+    }
+
+    // VU: half the strip lit from color1 to color2, the peak in color3.
+    effect_params_t vu = {
+        .effect_id = FX_VU, .intensity = 1.0f, .opacity = 255,
+        .color1 = {0, 255, 0, 0}, .color2 = {255, 0, 0, 0}, .color3 = {255, 255, 255, 0}
+    };
+    fx = fx_lookup(FX_VU);
+    TEST_ASSERT_NOT_NULL(fx);
+    fx->render(&ch, &vu, 0, 0);
+    fx->render16(&ch, &vu, 0, 0);
+    TEST_ASSERT_EQUAL_UINT8(255, fb[0].g);
+    TEST_ASSERT_EQUAL_UINT8(0, fb[0].r);
+    for (int i = 0; i < 40; i++) {
+        bool lit = fb[i].r + fb[i].g + fb[i].b > 0;
+        TEST_ASSERT_TRUE_MESSAGE(lit == (i < 20 || i == 29), "vu pixel");
+        TEST_ASSERT_INT_WITHIN(1, fb[i].g, fb16[i].g >> 8);
+    }
+    TEST_ASSERT_EQUAL_UINT8(255, fb[29].b);
+    TEST_ASSERT_TRUE(fb[19].r > fb[10].r);
+
+    // No feed: both go dark.
+    g_fx_audio.live = false;
+    fx->render(&ch, &vu, 0, 0);
+    for (int i = 0; i < 40; i++) TEST_ASSERT_EQUAL_UINT32(0, fb[i].r + fb[i].g + fb[i].b);
+    fx_lookup(FX_SPECTRUM)->render(&ch, &sp, 0, 0);
+    for (int i = 0; i < 40; i++) TEST_ASSERT_EQUAL_UINT32(0, fb[i].r + fb[i].g + fb[i].b);
+    g_fx_audio = saved;
+}
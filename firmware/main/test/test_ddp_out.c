@@ -0,0 +1,125 @@
+#include "unity.h"
+#include "ddp_out.h"
+#include "net_io.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
+
+// A local UDP listener stands in for the pixel receiver; the test drives
+// net_io_service directly, so every packet is sent from this thread.
+
+#define DDP_TEST_MAX_PKTS 8
+
+typedef struct {
+    uint8_t buf[DDP_TEST_MAX_PKTS][DDP_OUT_HDR_LEN + DDP_OUT_MAX_DATA];
+    int     len[DDP_TEST_MAX_PKTS];
+    int64_t at_us[DDP_TEST_MAX_PKTS];
+    int     n;
+} ddp_rx_t;
+
+static int open_listener(uint16_t *port) {
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    TEST_ASSERT_TRUE(s >= 0);
+    struct sockaddr_in sa = {0};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(s, (struct sockaddr *)&sa, sizeof(sa)));
+    socklen_t len = sizeof(sa);
+    TEST_ASSERT_EQUAL(0, getsockname(s, (struct sockaddr *)&sa, &len));
+    *port = ntohs(sa.sin_port);
+    return s;
+}
+
+// Services net_io until ch has sent its frame, logging packets as they land.
+static void pump(int ch, int listener, ddp_rx_t *rx) {
+    rx->n = 0;
+    for (int i = 0; i < 200; i++) {
+        bool busy = ddp_out_busy(ch);
+        net_io_service(5);
+        int len;
+        while (rx->n < DDP_TEST_MAX_PKTS &&
+               (len = recv(listener, rx->buf[rx->n], sizeof(rx->buf[0]), MSG_DONTWAIT)) > 0) {
+            rx->len[rx->n] = len;
+            rx->at_us[rx->n++] = esp_timer_get_time();
+        }
+        if (!busy) break;
+    }
+}
+
+static uint32_t be32(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+TEST_CASE("ddp out paces a frame to a local listener", "[ddp_out]") {
+    enum { N = 1000, CH = 1, OFFSET = 300, WINDOW_US = 12000 };
+    static px_rgba_t frame[N];
+    static ddp_rx_t rx;
+    uint16_t port;
+    int listener = open_listener(&port);
+
+    ddp_out_target_t t = { .addr = htonl(INADDR_LOOPBACK), .port = port, .offset = OFFSET };
+    TEST_ASSERT_EQUAL(ESP_OK, ddp_out_set_target(CH, &t));
+    ddp_out_stats_t before;
+    ddp_out_get_stats(CH, &before);
+
+    // RGB: 3000 bytes, three packets.
+    for (int i = 0; i < N; i++) frame[i] = (px_rgba_t){ (uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i * 7), 0xEE };
+    TEST_ASSERT_TRUE(ddp_out_submit(CH, frame, N, false, WINDOW_US));
+    TEST_ASSERT_TRUE(ddp_out_busy(CH));
+    TEST_ASSERT_FALSE(ddp_out_submit(CH, frame, N, false, WINDOW_US));
+    pump(CH, listener, &rx);
+    TEST_ASSERT_FALSE(ddp_out_busy(CH));
+
+    TEST_ASSERT_EQUAL(3, rx.n);
+    uint32_t expect_off = OFFSET;
+    for (int p = 0; p < rx.n; p++) {
+        const uint8_t *b = rx.buf[p];
+        uint32_t len = ((uint32_t)b[8] << 8) | b[9];
+        TEST_ASSERT_EQUAL_HEX8(p == rx.n - 1 ? 0x41 : 0x40, b[0]);
+        TEST_ASSERT_EQUAL_UINT8(rx.buf[0][1], b[1]);
+        TEST_ASSERT_EQUAL_HEX8(0x0B, b[2]);
+        TEST_ASSERT_EQUAL_UINT32(expect_off, be32(b + 4));
+        TEST_ASSERT_EQUAL(DDP_OUT_HDR_LEN + (int)len, rx.len[p]);
+        for (uint32_t k = 0; k < len; k++) {
+            uint32_t byte = expect_off - OFFSET + k, i = byte / 3;
+            uint8_t want = byte % 3 == 0 ? (uint8_t)i : byte % 3 == 1 ? (uint8_t)(i >> 8) : (uint8_t)(i * 7);
+            TEST_ASSERT_EQUAL_UINT8(want, b[DDP_OUT_HDR_LEN + k]);
+        }
+        expect_off += len;
+    }
+    TEST_ASSERT_EQUAL_UINT32(OFFSET + 3 * N, expect_off);
+
+    // Spread over the window, never back to back.
+    int64_t span = rx.at_us[rx.n - 1] - rx.at_us[0];
+    printf("ddp out: 3 packets over %lld us (window %d us)\n", (long long)span, WINDOW_US);
+    TEST_ASSERT_TRUE(span >= WINDOW_US / 3);
+    for (int p = 1; p < rx.n; p++) {
+        TEST_ASSERT_TRUE(rx.at_us[p] - rx.at_us[p - 1] >= WINDOW_US / 3 / 2 - 1000);
+    }
+
+    // RGBW goes out as the framebuffer bytes: one packet, next sequence.
+    uint8_t seq = rx.buf[0][1];
+    for (int i = 0; i < 100; i++) frame[i] = (px_rgba_t){ 1, 2, 3, (uint8_t)i };
+    TEST_ASSERT_TRUE(ddp_out_submit(CH, frame, 100, true, WINDOW_US));
+    pump(CH, listener, &rx);
+    TEST_ASSERT_EQUAL(1, rx.n);
+    TEST_ASSERT_EQUAL_HEX8(0x41, rx.buf[0][0]);
+    TEST_ASSERT_EQUAL_UINT8(seq % 15 + 1, rx.buf[0][1]);
+    TEST_ASSERT_EQUAL_HEX8(0x1B, rx.buf[0][2]);
+    TEST_ASSERT_EQUAL(DDP_OUT_HDR_LEN + 400, rx.len[0]);
+    TEST_ASSERT_EQUAL_MEMORY(frame, rx.buf[0] + DDP_OUT_HDR_LEN, 400);
+
+    ddp_out_stats_t st;
+    ddp_out_get_stats(CH, &st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.frames - before.frames);
+    TEST_ASSERT_EQUAL_UINT32(4, st.packets - before.packets);
+    TEST_ASSERT_EQUAL_UINT32(1, st.busy - before.busy);
+    TEST_ASSERT_EQUAL_UINT32(0, st.errors - before.errors);
+
+    // No target: nothing is taken.
+    TEST_ASSERT_EQUAL(ESP_OK, ddp_out_set_target(CH, NULL));
+    TEST_ASSERT_FALSE(ddp_out_submit(CH, frame, 100, true, WINDOW_US));
+    close(listener);
+}
@@ -0,0 +1,200 @@
+#include "unity.h"
+#include "dmx_personality.h"
+#include <string.h>
+
+static int             s_pwm_calls, s_group_calls, s_fx_calls[8];
+static uint16_t        s_pwm_level[8];
+static uint16_t        s_group_level[4];
+static char            s_group_name[24];
+static effect_params_t s_fx[8];
+
+static void mock_pwm_level(uint8_t ch, uint16_t level) {
+    s_pwm_calls++;
+    s_pwm_level[ch] = level;
+}
+
+static void mock_group_level(const char *group, const uint16_t level[4]) {
+    s_group_calls++;
+    strncpy(s_group_name, group, sizeof(s_group_name) - 1);
+    memcpy(s_group_level, level, sizeof(s_group_level));
+}
+
+static bool            s_fx_refuse;
+
+static bool mock_set_effect(int ch, const effect_params_t *params) {
+    s_fx_calls[ch]++;
+    if (s_fx_refuse) return false;
+    s_fx[ch] = *params;
+    return true;
+}
+
+// What the engine runs before the desk takes over: rainbow everywhere.
+static bool mock_get_effect(int ch, effect_params_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->effect_id = FX_RAINBOW;
+    out->speed = 3.0f;
+    out->intensity = 0.5f;
+    out->color1 = (px_rgba_t){ 255, 0, 0, 0 };
+    out->seed = 42u + (uint32_t)ch;
+    out->opacity = 255;
+    return true;
+}
+
+static const dmx_personality_ops_t MOCK_OPS = {
+    .pwm_level = mock_pwm_level,
+    .group_level = mock_group_level,
+    .set_effect = mock_set_effect,
+    .get_effect = mock_get_effect
+};
+
+static void reset_mock(void) {
+    s_pwm_calls = 0;
+    s_group_calls = 0;
+    memset(s_fx_calls, 0, sizeof(s_fx_calls));
+}
+
+// Universe 3: LEDch1 16-bit at 1-2, LEDch2 8-bit at 3, group "stage" RGBW at
+// 4-7, ALEDch1 effect/intensity/color1 at 10-14, ALEDch2 speed at 20.
+static const dmx_slot_map_t TABLE[] = {
+    { .universe = 3, .slot = 1,  .field = DMX_FIELD_LEVEL16,   .ch = 0 },
+    { .universe = 3, .slot = 3,  .field = DMX_FIELD_LEVEL8,    .ch = 1 },
+    { .universe = 3, .slot = 4,  .field = DMX_FIELD_RGBW,      .group = "stage" },
+    { .universe = 3, .slot = 10, .field = DMX_FIELD_EFFECT,    .ch = 0 },
+    { .universe = 3, .slot = 11, .field = DMX_FIELD_INTENSITY, .ch = 0 },
+    { .universe = 3, .slot = 12, .field = DMX_FIELD_COLOR1,    .ch = 0 },
+    { .universe = 3, .slot = 20, .field = DMX_FIELD_SPEED,     .ch = 1 },
+};
+#define N_TABLE (int)(sizeof(TABLE) / sizeof(TABLE[0]))
+
+TEST_CASE("dmx personality maps slots to levels, groups and effect fields", "[dmx]") {
+    dmx_personality_set_ops(&MOCK_OPS);
+    TEST_ASSERT_EQUAL(ESP_OK, dmx_personality_set(TABLE, N_TABLE));
+    uint16_t first, count;
+    TEST_ASSERT_TRUE(dmx_personality_universes(&first, &count));
+    TEST_ASSERT_EQUAL(3, first);
+    TEST_ASSERT_EQUAL(1, count);
+
+    uint8_t u[512] = {0};
+    u[0] = 0x12; u[1] = 0x34;                          // LEDch1
+    u[2] = 255;                                        // LEDch2
+    u[3] = 10; u[4] = 20; u[5] = 30; u[6] = 40;        // stage
+    u[9] = 25;                                         // chase
+    u[10] = 51;                                        // intensity 0.2
+    u[11] = 255; u[12] = 128; u[13] = 0;               // color1
+    u[19] = 255;                                       // speed max
+
+    reset_mock();
+    dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(2, s_pwm_calls);
+    TEST_ASSERT_EQUAL_UINT16(0x1234, s_pwm_level[0]);
+    TEST_ASSERT_EQUAL_UINT16(65535, s_pwm_level[1]);
+    TEST_ASSERT_EQUAL(1, s_group_calls);
+    TEST_ASSERT_EQUAL_STRING("stage", s_group_name);
+    TEST_ASSERT_EQUAL_UINT16(40 * 257, s_group_level[3]);
+    // Four fields of ALEDch1 arrive as one parameter set.
+    TEST_ASSERT_EQUAL(1, s_fx_calls[0]);
+    TEST_ASSERT_EQUAL(1, s_fx_calls[1]);
+    TEST_ASSERT_EQUAL_UINT32(FX_CHASE, s_fx[0].effect_id);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.2f, s_fx[0].intensity);
+    TEST_ASSERT_EQUAL_UINT8(128, s_fx[0].color1.g);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, DMX_SPEED_MAX, s_fx[1].speed);
+    TEST_ASSERT_EQUAL_UINT8(255, s_fx[1].opacity);
+
+    // Effect ranges: waves 70..79, spectrum 80..89, vu from 90 up.
+    static const struct { uint8_t v; uint32_t fx; } RANGES[] = {
+        { 70, FX_WAVES }, { 79, FX_WAVES }, { 80, FX_SPECTRUM }, { 89, FX_SPECTRUM },
+        { 90, FX_VU }, { 255, FX_VU }
+    };
+    for (size_t i = 0; i < sizeof(RANGES) / sizeof(RANGES[0]); i++) {
+        u[9] = RANGES[i].v;
+        dmx_personality_apply(3, u, sizeof(u));
+        TEST_ASSERT_EQUAL_UINT32(RANGES[i].fx, s_fx[0].effect_id);
+    }
+}
+
+TEST_CASE("dmx personality only touches targets whose slots changed", "[dmx]") {
+    dmx_personality_set_ops(&MOCK_OPS);
+    TEST_ASSERT_EQUAL(ESP_OK, dmx_personality_set(TABLE, N_TABLE));
+    uint8_t u[512] = {0};
+    u[0] = 0x80;
+    dmx_personality_apply(3, u, sizeof(u));
+
+    // Desks resend the same universe continuously: nothing moves.
+    dmx_personality_stats_t before, after;
+    dmx_personality_get_stats(&before);
+    reset_mock();
+    for (int i = 0; i < 44; i++) dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(0, s_pwm_calls);
+    TEST_ASSERT_EQUAL(0, s_group_calls);
+    TEST_ASSERT_EQUAL(0, s_fx_calls[0] + s_fx_calls[1]);
+    dmx_personality_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT32(44 * N_TABLE, after.unchanged - before.unchanged);
+    TEST_ASSERT_EQUAL_UINT32(44, after.universes - before.universes);
+
+    // A fine byte moves one PWM channel; an intensity moves one effect.
+    u[1] = 0x01;
+    u[10] = 200;
+    dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(1, s_pwm_calls);
+    TEST_ASSERT_EQUAL_UINT16(0x8001, s_pwm_level[0]);
+    TEST_ASSERT_EQUAL(0, s_group_calls);
+    TEST_ASSERT_EQUAL(1, s_fx_calls[0]);
+    TEST_ASSERT_EQUAL(0, s_fx_calls[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 200 / 255.0f, s_fx[0].intensity);
+
+    // Other universes and slots past a short universe are left alone.
+    reset_mock();
+    u[2] = 99;
+    dmx_personality_apply(4, u, sizeof(u));
+    dmx_personality_apply(3, u, 2);
+    TEST_ASSERT_EQUAL(0, s_pwm_calls);
+    dmx_personality_apply(3, u, 3);
+    TEST_ASSERT_EQUAL(1, s_pwm_calls);
+    TEST_ASSERT_EQUAL_UINT16(99 * 257, s_pwm_level[1]);
+}
+
+TEST_CASE("dmx personality keeps the running effect in fields it does not map", "[dmx]") {
+    dmx_personality_set_ops(&MOCK_OPS);
+    TEST_ASSERT_EQUAL(ESP_OK, dmx_personality_set(TABLE, N_TABLE));
+    uint8_t u[512] = {0};
+    u[19] = 51;                                        // ALEDch2 speed only
+    reset_mock();
+    dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(1, s_fx_calls[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 51 * DMX_SPEED_MAX / 255.0f, s_fx[1].speed);
+    TEST_ASSERT_EQUAL_UINT32(FX_RAINBOW, s_fx[1].effect_id);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, s_fx[1].intensity);
+    TEST_ASSERT_EQUAL_UINT8(255, s_fx[1].color1.r);
+    TEST_ASSERT_EQUAL_UINT8(0, s_fx[1].color1.g);
+    TEST_ASSERT_EQUAL_UINT32(43, s_fx[1].seed);
+
+    // A full engine queue refuses the update: the resent universe retries.
+    u[19] = 102;
+    s_fx_refuse = true;
+    dmx_personality_apply(3, u, sizeof(u));
+    s_fx_refuse = false;
+    TEST_ASSERT_EQUAL(2, s_fx_calls[1]);
+    dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(3, s_fx_calls[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 102 * DMX_SPEED_MAX / 255.0f, s_fx[1].speed);
+    dmx_personality_apply(3, u, sizeof(u));
+    TEST_ASSERT_EQUAL(3, s_fx_calls[1]);
+}
+
+TEST_CASE("dmx personality rejects entries outside the universe", "[dmx]") {
+    dmx_slot_map_t bad = { .universe = 1, .slot = 511, .field = DMX_FIELD_RGB, .group = "g" };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dmx_personality_set(&bad, 1));
+    bad.slot = 510;
+    TEST_ASSERT_EQUAL(ESP_OK, dmx_personality_set(&bad, 1));
+    bad.group[0] = '\0';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dmx_personality_set(&bad, 1));
+    dmx_slot_map_t fx = { .universe = 1, .slot = 1, .field = DMX_FIELD_SPEED, .ch = 8 };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dmx_personality_set(&fx, 1));
+
+    dmx_field_t f;
+    TEST_ASSERT_TRUE(dmx_field_parse("level16", &f));
+    TEST_ASSERT_EQUAL(DMX_FIELD_LEVEL16, f);
+    TEST_ASSERT_FALSE(dmx_field_parse("pan", &f));
+    TEST_ASSERT_EQUAL(0, dmx_personality_set(NULL, 0));
+    TEST_ASSERT_FALSE(dmx_personality_universes(NULL, NULL));
+}
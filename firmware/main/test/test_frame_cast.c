@@ -0,0 +1,226 @@
+#include "unity.h"
+#include "frame_cast.h"
+#include "effects.h"
+#include "fx_util.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CAST_PIXELS   300
+#define CAST_FRAMES   120
+#define CAST_MAX_PKTS 8
+
+typedef struct {
+    uint8_t buf[CAST_MAX_PKTS][FRAME_CAST_PACKET_MAX];
+    size_t  len[CAST_MAX_PKTS];
+    int     n;
+} captured_t;
+
+static uint8_t s_scratch[FRAME_CAST_PACKET_MAX];
+
+static void capture(const uint8_t *pkt, size_t len, void *ctx) {
+    captured_t *c = ctx;
+    TEST_ASSERT_TRUE(c->n < CAST_MAX_PKTS);
+    memcpy(c->buf[c->n], pkt, len);
+    c->len[c->n++] = len;
+}
+
+static bool same_rgb(const px_rgba_t *a, const px_rgba_t *b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i].r != b[i].r || a[i].g != b[i].g || a[i].b != b[i].b) return false;
+    }
+    return true;
+}
+
+static const effect_params_t CAST_FX[] = {
+    { .effect_id = FX_SOLID,    .intensity = 1.0f, .color1 = {200, 40, 0, 0}, .opacity = 255 },
+    { .effect_id = FX_GRADIENT, .intensity = 1.0f, .color1 = {255, 0, 0, 0}, .color2 = {0, 0, 255, 0}, .opacity = 255 },
+    { .effect_id = FX_CHASE,    .speed = 30.0f, .intensity = 1.0f, .color1 = {255, 255, 255, 0}, .opacity = 255 },
+    { .effect_id = FX_TWINKLE,  .speed = 1.0f, .intensity = 0.3f, .color1 = {255, 200, 120, 0}, .seed = 7, .opacity = 255 },
+    { .effect_id = FX_RAINBOW,  .speed = 0.2f, .intensity = 1.0f, .opacity = 255 },
+    { .effect_id = FX_NOISE,    .speed = 1.2f, .intensity = 0.8f, .color1 = {10, 60, 200, 0}, .opacity = 255 },
+    { .effect_id = FX_FIRE,     .speed = 1.0f, .intensity = 0.8f, .seed = 3, .opacity = 255 },
+    { .effect_id = FX_WAVES,    .speed = 0.5f, .intensity = 1.0f, .color1 = {0, 80, 255, 0}, .opacity = 255 },
+};
+
+// Every built-in effect at 60 fps, keyframe every FRAME_CAST_KEY_FRAMES:
+// lossless round trip, coded size against raw RGB, coding cost per frame.
+TEST_CASE("frame cast codes each built-in effect losslessly", "[frame_cast][bench]") {
+    static px_rgba_t cur[CAST_PIXELS], prev[CAST_PIXELS], mirror[CAST_PIXELS];
+    static captured_t cap;
+    util_init_gamma(2.2f);
+
+    for (size_t e = 0; e < sizeof(CAST_FX) / sizeof(CAST_FX[0]); e++) {
+        const effect_vtable_t *fx = fx_lookup(CAST_FX[e].effect_id);
+        TEST_ASSERT_NOT_NULL(fx);
+        aled_channel_t ch = {
+            .type = LED_WS2812B,
+            .order = ORDER_GRB,
+            .n_pixels = CAST_PIXELS,
+            .gamma = 2.2f,
+            .max_brightness = 255,
+            .framebuf = cur
+        };
+        if (fx->init) fx->init(&ch, &CAST_FX[e]);
+        memset(mirror, 0, sizeof(mirror));
+
+        uint32_t raw = 0, wire = 0;
+        int64_t enc_us = 0, dec_us = 0;
+        for (int f = 0; f < CAST_FRAMES; f++) {
+            memset(cur, 0, sizeof(cur));
+            fx->render(&ch, &CAST_FX[e], (uint32_t)f * 16, 0);
+            bool key = f % FRAME_CAST_KEY_FRAMES == 0;
+
+            cap.n = 0;
+            int64_t t0 = esp_timer_get_time();
+            frame_cast_packetize(0, 1, (uint32_t)f, cur, key ? NULL : prev, CAST_PIXELS, 3,
+                                 s_scratch, capture, &cap);
+            enc_us += esp_timer_get_time() - t0;
+
+            t0 = esp_timer_get_time();
+            for (int p = 0; p < cap.n; p++) {
+                frame_cast_header_t h;
+                TEST_ASSERT_TRUE(frame_cast_parse(cap.buf[p], cap.len[p], &h));
+                TEST_ASSERT_TRUE(frame_cast_decode(cap.buf[p] + sizeof(h), h.len, mirror + h.start, h.count, 3));
+                wire += h.len;
+            }
+            dec_us += esp_timer_get_time() - t0;
+
+            TEST_ASSERT_TRUE_MESSAGE(same_rgb(cur, mirror, CAST_PIXELS), fx->name);
+            memcpy(prev, cur, sizeof(prev));
+            raw += CAST_PIXELS * 3;
+        }
+        printf("frame cast %-8s %5.1f%% of raw, encode %5.1f us, decode %5.1f us per %d px frame\n",
+               fx->name, 100.0 * wire / raw, (double)enc_us / CAST_FRAMES,
+               (double)dec_us / CAST_FRAMES, CAST_PIXELS);
+        // Incompressible frames cost at most a header byte per 32 pixels.
+        TEST_ASSERT_TRUE(wire <= raw + raw / 90 + 2 * CAST_FRAMES);
+        if (CAST_FX[e].effect_id == FX_SOLID) {
+            TEST_ASSERT_TRUE(wire * 100 < raw);
+        }
+    }
+}
+
+static void feed_at(const captured_t *c, int skip_part, uint32_t now_ms) {
+    for (int p = 0; p < c->n; p++) {
+        if (p != skip_part) frame_cast_handle(c->buf[p], c->len[p], now_ms);
+    }
+}
+
+static void feed(const captured_t *c, int skip_part) {
+    feed_at(c, skip_part, 1000);
+}
+
+static void make_frame(px_rgba_t *px, int n, int f) {
+    // Noise-like content so a 700 px RGBW frame needs several parts.
+    for (int i = 0; i < n; i++) {
+        uint32_t h = (uint32_t)(i * 2654435761u) ^ (uint32_t)(f * 40503u);
+        px[i] = (px_rgba_t){ (uint8_t)h, (uint8_t)(h >> 8), (uint8_t)(h >> 16), (uint8_t)(i & 0x0F ? 0 : f) };
+    }
+}
+
+TEST_CASE("frame cast receiver holds its frame until the next keyframe after a loss", "[frame_cast]") {
+    enum { N = 700, CH = 2 };
+    static px_rgba_t cur[N], prev[N], shown[N];
+    static captured_t cap;
+    TEST_ASSERT_EQUAL(ESP_OK, frame_cast_set_mode(FRAME_CAST_RECEIVE));
+    TEST_ASSERT_FALSE(frame_cast_active(CH, 1000));
+
+    for (int f = 0; f < 2 * FRAME_CAST_KEY_FRAMES + 2; f++) {
+        make_frame(cur, N, f);
+        bool key = f % FRAME_CAST_KEY_FRAMES == 0;
+        cap.n = 0;
+        frame_cast_packetize(CH, 1, (uint32_t)f, cur, key ? NULL : prev, N, 4, s_scratch, capture, &cap);
+        TEST_ASSERT_TRUE(cap.n > 1);
+
+        // Frame 5 loses its second part: frames 5..29 are not shown.
+        bool lost = f == 5;
+        feed(&cap, lost ? 1 : -1);
+        bool fresh = frame_cast_take(CH, shown, N);
+        if (f >= 5 && f < FRAME_CAST_KEY_FRAMES) {
+            TEST_ASSERT_FALSE(fresh);
+        } else {
+            TEST_ASSERT_TRUE(fresh);
+            TEST_ASSERT_EQUAL_MEMORY(cur, shown, sizeof(shown));
+        }
+        memcpy(prev, cur, sizeof(prev));
+    }
+    TEST_ASSERT_TRUE(frame_cast_active(CH, 1000 + FRAME_CAST_HOLD_MS - 1));
+    TEST_ASSERT_FALSE(frame_cast_active(CH, 1000 + FRAME_CAST_HOLD_MS));
+    TEST_ASSERT_FALSE(frame_cast_active(CH + 1, 1000));
+
+    frame_cast_stats_t st;
+    frame_cast_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2 * FRAME_CAST_KEY_FRAMES + 2 - 25, st.frames);
+    TEST_ASSERT_EQUAL_UINT32(3, st.keyframes);
+    TEST_ASSERT_EQUAL_UINT32(25, st.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, st.malformed);
+
+    // A duplicated frame is ignored without losing sync.
+    feed(&cap, -1);
+    TEST_ASSERT_FALSE(frame_cast_take(CH, shown, N));
+    make_frame(cur, N, 2 * FRAME_CAST_KEY_FRAMES + 2);
+    cap.n = 0;
+    frame_cast_packetize(CH, 1, 2 * FRAME_CAST_KEY_FRAMES + 2, cur, prev, N, 4, s_scratch, capture, &cap);
+    feed(&cap, -1);
+    // A longer local strip shows the frame and black after it.
+    static px_rgba_t wide[N + 10];
+    memset(wide, 0xFF, sizeof(wide));
+    TEST_ASSERT_TRUE(frame_cast_take(CH, wide, N + 10));
+    TEST_ASSERT_EQUAL_MEMORY(cur, wide, sizeof(cur));
+    TEST_ASSERT_EQUAL_UINT8(0, wide[N + 9].g);
+
+    uint8_t junk[sizeof(frame_cast_header_t) + 2] = {0};
+    frame_cast_handle(junk, sizeof(junk), 1000);
+    frame_cast_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(25, st.dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, st.malformed);
+
+    TEST_ASSERT_EQUAL(ESP_OK, frame_cast_set_mode(FRAME_CAST_OFF));
+    TEST_ASSERT_FALSE(frame_cast_active(CH, 1000));
+}
+
+TEST_CASE("frame cast receiver follows a sender that restarted its frame count", "[frame_cast]") {
+    enum { N = 60, CH = 1 };
+    static px_rgba_t cur[N], prev[N], shown[N];
+    static captured_t cap;
+    TEST_ASSERT_EQUAL(ESP_OK, frame_cast_set_mode(FRAME_CAST_RECEIVE));
+    frame_cast_stats_t before;
+    frame_cast_get_stats(&before);
+
+    // Each session counts from 0 with a keyframe: a reboot after 500 frames
+    // that drew the same epoch, a restart only 40 frames in, and another
+    // same-epoch reboot that comes back after the channel went quiet.
+    static const struct { uint8_t epoch; int frames; uint32_t at_ms; } SESSIONS[] = {
+        { 1, 500, 1000 }, { 1, 40, 1000 }, { 2, 40, 1000 }, { 2, 20, 1000 + FRAME_CAST_HOLD_MS }
+    };
+    int i = 0;
+    for (size_t s = 0; s < sizeof(SESSIONS) / sizeof(SESSIONS[0]); s++) {
+        for (int f = 0; f < SESSIONS[s].frames; f++, i++) {
+            make_frame(cur, N, i);
+            bool key = f % FRAME_CAST_KEY_FRAMES == 0;
+            cap.n = 0;
+            frame_cast_packetize(CH, SESSIONS[s].epoch, (uint32_t)f, cur, key ? NULL : prev, N, 3,
+                                 s_scratch, capture, &cap);
+            feed_at(&cap, -1, SESSIONS[s].at_ms);
+            TEST_ASSERT_TRUE(frame_cast_take(CH, shown, N));
+            TEST_ASSERT_TRUE(same_rgb(cur, shown, N));
+            memcpy(prev, cur, sizeof(prev));
+        }
+    }
+    TEST_ASSERT_TRUE(frame_cast_active(CH, 1000 + FRAME_CAST_HOLD_MS));
+
+    // A delta from another session never lands on this one's frames.
+    make_frame(cur, N, i);
+    cap.n = 0;
+    frame_cast_packetize(CH, 3, 20, cur, prev, N, 3, s_scratch, capture, &cap);
+    feed_at(&cap, -1, 1000 + FRAME_CAST_HOLD_MS);
+    TEST_ASSERT_FALSE(frame_cast_take(CH, shown, N));
+
+    frame_cast_stats_t st;
+    frame_cast_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(3, st.restarts - before.restarts);
+    TEST_ASSERT_EQUAL_UINT32(600, st.frames - before.frames);
+    TEST_ASSERT_EQUAL_UINT32(0, st.dropped - before.dropped);
+    TEST_ASSERT_EQUAL(ESP_OK, frame_cast_set_mode(FRAME_CAST_OFF));
+}
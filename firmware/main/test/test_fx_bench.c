@@ -0,0 +1,114 @@
+#include "unity.h"
+#include "effects.h"
+#include "fx_transitions.h"
+#include "fx_util.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_PIXELS 180
+#define BENCH_FRAMES 200
+
+static aled_channel_t bench_channel(px_rgba_t *fb, px_rgba16_t *fb16){
+    return (aled_channel_t){
+        .ch = 0,
+        .type = LED_WS2812B,
+        .order = ORDER_GRB,
+        .n_pixels = BENCH_PIXELS,
+        .gamma = 2.2f,
+        .max_brightness = 255,
+        .framebuf = fb,
+        .framebuf16 = fb16
+    };
+}
+
+static const effect_params_t BENCH_A = {
+    .effect_id = FX_GRADIENT,
+    .color1 = {0, 2, 8, 0},
+    .color2 = {4, 0, 1, 0},
+    .opacity = 255
+};
+
+static const effect_params_t BENCH_B = {
+    .effect_id = FX_NOISE,
+    .speed = 1.2f,
+    .intensity = 0.05f,
+    .color1 = {10, 6, 2, 0},
+    .opacity = 255
+};
+
+// Base + crossfade target per frame, i.e. the engine's worst steady state.
+TEST_CASE("8-bit vs 16-bit pipeline cost", "[fx][bench]") {
+    static px_rgba_t cur8[BENCH_PIXELS], next8[BENCH_PIXELS], res[BENCH_PIXELS], out8[BENCH_PIXELS];
+    static px_rgba16_t cur16[BENCH_PIXELS], next16[BENCH_PIXELS];
+
+    const effect_vtable_t *a = fx_lookup(BENCH_A.effect_id);
+    const effect_vtable_t *b = fx_lookup(BENCH_B.effect_id);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_NOT_NULL(a->render16);
+    TEST_ASSERT_NOT_NULL(b->render16);
+
+    int64_t t0 = esp_timer_get_time();
+    for (int f = 0; f < BENCH_FRAMES; ++f){
+        aled_channel_t ch = bench_channel(cur8, NULL);
+        a->render(&ch, &BENCH_A, f * 8, 0);
+        ch.framebuf = next8;
+        b->render(&ch, &BENCH_B, f * 8, 0);
+        xfade_apply(cur8, next8, BENCH_PIXELS, f / (float)BENCH_FRAMES);
+    }
+    int64_t t8 = esp_timer_get_time() - t0;
+
+    memset(res, 0, sizeof(res));
+    t0 = esp_timer_get_time();
+    for (int f = 0; f < BENCH_FRAMES; ++f){
+        aled_channel_t ch = bench_channel(NULL, cur16);
+        a->render16(&ch, &BENCH_A, f * 8, 0);
+        ch.framebuf16 = next16;
+        b->render16(&ch, &BENCH_B, f * 8, 0);
+        xfade_apply16(cur16, next16, BENCH_PIXELS, f / (float)BENCH_FRAMES);
+        dither_temporal16(cur16, out8, res, BENCH_PIXELS);
+    }
+    int64_t t16 = esp_timer_get_time() - t0;
+
+    // Engine buffers per channel: framebuf + overlay + xfade (8-bit), plus
+    // acc16 + aux16 + dither residual when HDR is enabled.
+    size_t mem8 = 3 * sizeof(px_rgba_t) * BENCH_PIXELS;
+    size_t mem16 = mem8 + 2 * sizeof(px_rgba16_t) * BENCH_PIXELS + sizeof(px_rgba_t) * BENCH_PIXELS;
+    printf("pipeline %d px: 8-bit %lld us/frame %u B, 16-bit %lld us/frame %u B\n",
+           BENCH_PIXELS, t8 / BENCH_FRAMES, (unsigned)mem8, t16 / BENCH_FRAMES, (unsigned)mem16);
+
+    TEST_ASSERT(t8 > 0 && t16 > 0);
+}
+
+// A level between two 8-bit codes must average out to the 16-bit value.
+TEST_CASE("temporal dither converges on 16-bit level", "[fx]") {
+    px_rgba16_t in = { .r = 0x0140, .g = 0x00C0, .b = 0xFF80, .w = 0 };
+    px_rgba_t res = {0}, out;
+    uint32_t sum_r = 0, sum_g = 0, sum_b = 0;
+    for (int f = 0; f < 256; ++f){
+        dither_temporal16(&in, &out, &res, 1);
+        sum_r += out.r;
+        sum_g += out.g;
+        sum_b += out.b;
+        TEST_ASSERT_EQUAL_UINT8(0, out.w);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0x140, sum_r);
+    TEST_ASSERT_EQUAL_UINT32(0x0C0, sum_g);
+    TEST_ASSERT_EQUAL_UINT32(255 * 256, sum_b);
+}
+
+TEST_CASE("crossfade shifted with a clock step carries on where it was", "[fx]") {
+    xfade_t x;
+    xfade_begin(&x, 10000, 1000);
+    float before = xfade_mix(&x, 10400);
+    // The clock steps back 5 s: unshifted, the fade would drop to the old
+    // effect until the clock caught up.
+    TEST_ASSERT_EQUAL_FLOAT(0.f, xfade_mix(&x, 5400));
+    xfade_shift(&x, -5000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, before, xfade_mix(&x, 5400));
+    TEST_ASSERT_EQUAL_FLOAT(1.f, xfade_mix(&x, 6000));
+    // Crossing zero wraps like the clock does.
+    xfade_shift(&x, -5800);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, before, xfade_mix(&x, (uint32_t)-400));
+}
@@ -0,0 +1,73 @@
+#include "unity.h"
+#include "fx_calib.h"
+#include <string.h>
+
+TEST_CASE("calibration gamma and white point", "[fx]") {
+    static fx_calib_t c;
+    fx_calib_cfg_t cfg;
+    fx_calib_default(&cfg, 1.0f);
+    cfg.white_point[2] = 0.5f;
+    fx_calib_build(&c, &cfg, false);
+
+    px_rgba_t px = {200, 100, 200, 77};
+    fx_calib_apply8(&c, &px, 1, 65536, NULL);
+    TEST_ASSERT_EQUAL_UINT8(200, px.r);
+    TEST_ASSERT_EQUAL_UINT8(100, px.g);
+    TEST_ASSERT_EQUAL_UINT8(100, px.b);
+    TEST_ASSERT_EQUAL_UINT8(0, px.w);   // RGB strip: no white channel
+
+    fx_calib_default(&cfg, 2.2f);
+    fx_calib_build(&c, &cfg, false);
+    px_rgba16_t lo = {0x0800, 0x0880, 0xFFFF, 0};
+    fx_calib_apply16(&c, &lo, 1, 65536, NULL);
+    TEST_ASSERT(lo.r > 0 && lo.r < lo.g);  // distinct below one 8-bit output LSB
+    TEST_ASSERT(lo.g < 0x100);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, lo.b);
+}
+
+TEST_CASE("calibration RGBW white extraction", "[fx]") {
+    static fx_calib_t c;
+    fx_calib_cfg_t cfg;
+    fx_calib_default(&cfg, 1.0f);
+    fx_calib_build(&c, &cfg, true);
+
+    px_rgba_t px = {255, 200, 120, 0};
+    fx_calib_apply8(&c, &px, 1, 65536, NULL);
+    TEST_ASSERT_EQUAL_UINT8(135, px.r);
+    TEST_ASSERT_EQUAL_UINT8(80, px.g);
+    TEST_ASSERT_EQUAL_UINT8(0, px.b);
+    TEST_ASSERT_EQUAL_UINT8(120, px.w);
+
+    cfg.white_mix = 0.5f;
+    cfg.white_gain = 2.0f;
+    fx_calib_build(&c, &cfg, true);
+    px_rgba16_t w16 = {0xFFFF, 0xFFFF, 0xFFFF, 0};
+    fx_calib_apply16(&c, &w16, 1, 65536, NULL);
+    TEST_ASSERT_UINT32_WITHIN(2, 0x8000, w16.r);
+    TEST_ASSERT_UINT32_WITHIN(2, 0x4000, w16.w);
+}
+
+TEST_CASE("calibration pass applies power scale and reports unscaled draw", "[fx]") {
+    static fx_calib_t c;
+    fx_calib_cfg_t cfg;
+    fx_calib_default(&cfg, 1.0f);
+    fx_calib_build(&c, &cfg, false);
+
+    px_rgba_t fb[4] = {{200, 100, 50, 9}, {255, 255, 255, 0}, {0, 0, 0, 0}, {10, 20, 30, 0}};
+    uint32_t sums[4];
+    fx_calib_apply8(&c, fb, 4, 32768, sums);
+    TEST_ASSERT_EQUAL_UINT32(465, sums[0]);
+    TEST_ASSERT_EQUAL_UINT32(375, sums[1]);
+    TEST_ASSERT_EQUAL_UINT32(335, sums[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, sums[3]);  // RGB strip: w dropped
+    TEST_ASSERT_EQUAL_UINT8(100, fb[0].r);
+    TEST_ASSERT_EQUAL_UINT8(128, fb[1].g);
+    TEST_ASSERT_EQUAL_UINT8(0, fb[2].b);
+
+    px_rgba16_t fb16[2] = {{0xFFFF, 0x8000, 0, 0}, {0x4000, 0, 0, 0}};
+    fx_calib_apply16(&c, fb16, 2, 65536 / 4, sums);
+    TEST_ASSERT_UINT32_WITHIN(1, 255 + 64, sums[0]);
+    TEST_ASSERT_UINT32_WITHIN(1, 128, sums[1]);
+    TEST_ASSERT_UINT32_WITHIN(2, 0x4000, fb16[0].r);
+    TEST_ASSERT_UINT32_WITHIN(2, 0x1000, fb16[1].r);
+}
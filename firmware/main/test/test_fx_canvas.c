@@ -0,0 +1,82 @@
+#include "unity.h"
+#include "effects.h"
+#include "fx_util.h"
+#include <string.h>
+
+#define CANVAS_PIXELS 300
+#define CANVAS_SEED   42u
+
+static const effect_params_t CANVAS_FX[] = {
+    { .effect_id = FX_GRADIENT, .intensity = 1.0f, .color1 = {255, 0, 0, 0}, .color2 = {0, 0, 255, 0}, .opacity = 255 },
+    { .effect_id = FX_CHASE,    .speed = 90.0f, .intensity = 1.0f, .color1 = {255, 255, 255, 0}, .opacity = 255 },
+    { .effect_id = FX_TWINKLE,  .speed = 1.0f, .intensity = 0.5f, .color1 = {255, 200, 120, 0}, .opacity = 255 },
+    { .effect_id = FX_RAINBOW,  .speed = 0.2f, .intensity = 1.0f, .opacity = 255 },
+    { .effect_id = FX_NOISE,    .speed = 1.2f, .intensity = 0.8f, .color1 = {10, 60, 200, 0}, .opacity = 255 },
+    { .effect_id = FX_FIRE,     .speed = 1.0f, .intensity = 0.8f, .opacity = 255 },
+    { .effect_id = FX_WAVES,    .speed = 0.5f, .intensity = 1.0f, .color1 = {0, 80, 255, 0}, .color2 = {255, 0, 40, 0}, .opacity = 255 },
+};
+
+// Three nodes of 100, 120 and 80 px, each with its own effect seed, render
+// the same instant; put side by side they must match one node rendering
+// the whole canvas, in 8 and 16 bits.
+TEST_CASE("canvas slices render as one seamless strip", "[fx][canvas]") {
+    static const uint16_t slice[] = { 100, 120, 80 };
+    static px_rgba_t whole[CANVAS_PIXELS], joined[CANVAS_PIXELS];
+    static px_rgba16_t whole16[CANVAS_PIXELS], joined16[CANVAS_PIXELS];
+    util_init_gamma(2.2f);
+
+    for (size_t e = 0; e < sizeof(CANVAS_FX) / sizeof(CANVAS_FX[0]); e++) {
+        const effect_vtable_t *fx = fx_lookup(CANVAS_FX[e].effect_id);
+        TEST_ASSERT_NOT_NULL(fx);
+        for (uint32_t t_ms = 0; t_ms < 5000; t_ms += 1250) {
+            aled_channel_t all = {
+                .type = LED_WS2812B,
+                .n_pixels = CANVAS_PIXELS,
+                .gamma = 2.2f,
+                .max_brightness = 255,
+                .framebuf = whole,
+                .framebuf16 = whole16,
+                .canvas = { .offset = 0, .size = CANVAS_PIXELS, .seed = CANVAS_SEED }
+            };
+            effect_params_t p = CANVAS_FX[e];
+            memset(whole, 0, sizeof(whole));
+            memset(whole16, 0, sizeof(whole16));
+            fx->render(&all, &p, t_ms, 0);
+            if (fx->render16) fx->render16(&all, &p, t_ms, 0);
+
+            uint32_t offset = 0;
+            for (size_t n = 0; n < sizeof(slice) / sizeof(slice[0]); n++) {
+                aled_channel_t node = all;
+                node.ch = (int)n;
+                node.n_pixels = slice[n];
+                node.framebuf = joined + offset;
+                node.framebuf16 = joined16 + offset;
+                node.canvas.offset = offset;
+                p.seed = 1000u + (uint32_t)n;
+                fx->render(&node, &p, t_ms, 0);
+                if (fx->render16) fx->render16(&node, &p, t_ms, 0);
+                offset += slice[n];
+            }
+            TEST_ASSERT_EQUAL_UINT32(CANVAS_PIXELS, offset);
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(whole, joined, sizeof(whole), fx->name);
+            if (fx->render16) {
+                TEST_ASSERT_EQUAL_MEMORY_MESSAGE(whole16, joined16, sizeof(whole16), fx->name);
+            }
+        }
+    }
+
+    // A slice covering its whole canvas renders like a strip on its own.
+    const effect_vtable_t *grad = fx_lookup(FX_GRADIENT);
+    aled_channel_t alone = {
+        .type = LED_WS2812B,
+        .n_pixels = CANVAS_PIXELS,
+        .gamma = 2.2f,
+        .max_brightness = 255,
+        .framebuf = joined
+    };
+    grad->render(&alone, &CANVAS_FX[0], 0, 0);
+    alone.framebuf = whole;
+    alone.canvas.size = CANVAS_PIXELS;
+    grad->render(&alone, &CANVAS_FX[0], 0, 0);
+    TEST_ASSERT_EQUAL_MEMORY(joined, whole, sizeof(whole));
+}
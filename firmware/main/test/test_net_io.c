@@ -0,0 +1,126 @@
+#include "unity.h"
+#include "net_io.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include <string.h>
+
+// The tests drive net_io_service directly; no I/O task is started.
+
+typedef struct {
+    int    packets;
+    size_t bytes;
+    uint8_t first;
+} rx_log_t;
+
+static void log_rx(const uint8_t *buf, size_t len, const struct sockaddr_in *src,
+                   int64_t rx_us, void *ctx) {
+    rx_log_t *log = ctx;
+    if (!log->packets) log->first = buf[0];
+    log->packets++;
+    log->bytes += len;
+}
+
+static int s_polls;
+static int64_t s_poll_period_us;
+
+static int64_t count_poll(int64_t now_us, void *ctx) {
+    s_polls++;
+    return s_poll_period_us ? now_us + s_poll_period_us : NET_IO_NEVER;
+}
+
+static void send_to(int sock, uint16_t port, uint8_t tag, size_t len) {
+    uint8_t buf[256];
+    memset(buf, tag, sizeof(buf));
+    struct sockaddr_in dst = {0};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL((int)len, sendto(sock, buf, len, 0, (struct sockaddr *)&dst, sizeof(dst)));
+}
+
+static int service_until(int want, int rounds) {
+    int got = 0;
+    for (int i = 0; i < rounds && got < want; i++) got += net_io_service(20);
+    return got;
+}
+
+TEST_CASE("net io dispatches each socket to its protocol", "[net_io]") {
+    rx_log_t a = {0}, b = {0};
+    net_io_proto_t pa = { .name = "a", .rx = log_rx, .ctx = &a };
+    net_io_proto_t pb = { .name = "b", .rx = log_rx, .ctx = &b };
+    int ha = net_io_register(&pa);
+    int hb = net_io_register(&pb);
+    TEST_ASSERT_TRUE(ha >= 0 && hb >= 0 && ha != hb);
+    uint16_t port_a = net_io_port(ha), port_b = net_io_port(hb);
+    TEST_ASSERT_TRUE(port_a && port_b && port_a != port_b);
+
+    int tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    TEST_ASSERT_TRUE(tx >= 0);
+    for (int i = 0; i < 12; i++) send_to(tx, port_a, 0xA0, 100);
+    send_to(tx, port_b, 0xB0, 200);
+    send_to(tx, port_b, 0xB1, 50);
+
+    // Twelve datagrams on one socket take two rounds of at most eight.
+    TEST_ASSERT_EQUAL(14, service_until(14, 10));
+    TEST_ASSERT_EQUAL(12, a.packets);
+    TEST_ASSERT_EQUAL(1200, (int)a.bytes);
+    TEST_ASSERT_EQUAL_HEX8(0xA0, a.first);
+    TEST_ASSERT_EQUAL(2, b.packets);
+    TEST_ASSERT_EQUAL(250, (int)b.bytes);
+    TEST_ASSERT_EQUAL_HEX8(0xB0, b.first);
+
+    net_io_stats_t st[NET_IO_MAX_PROTOS];
+    int n = net_io_get_stats(st, NET_IO_MAX_PROTOS);
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        if (st[i].port == port_b) {
+            TEST_ASSERT_EQUAL_UINT32(2, st[i].rx_packets);
+            TEST_ASSERT_EQUAL_UINT32(250, st[i].rx_bytes);
+            found++;
+        }
+    }
+    TEST_ASSERT_EQUAL(1, found);
+
+    // Unregistered sockets are closed and never dispatched again.
+    net_io_unregister(ha);
+    TEST_ASSERT_EQUAL(-1, net_io_socket(ha));
+    send_to(tx, port_b, 0xB2, 10);
+    TEST_ASSERT_EQUAL(1, service_until(1, 10));
+    TEST_ASSERT_EQUAL(12, a.packets);
+    TEST_ASSERT_EQUAL(3, b.packets);
+
+    net_io_unregister(hb);
+    close(tx);
+}
+
+TEST_CASE("net io polls bound the wait and a wake ends it", "[net_io]") {
+    net_io_proto_t pp = { .name = "poll", .poll = count_poll };
+    s_polls = 0;
+    s_poll_period_us = 5000;
+    int h = net_io_register(&pp);
+    TEST_ASSERT_TRUE(h >= 0);
+    net_io_service(0);     // drains the wake from register
+
+    // A 5 ms deadline cuts a 1 s wait short.
+    int polls = s_polls;
+    int64_t t0 = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(0, net_io_service(1000));
+    int64_t dt = esp_timer_get_time() - t0;
+    TEST_ASSERT_TRUE(dt >= 4000 && dt < 100000);
+    TEST_ASSERT_EQUAL(polls + 1, s_polls);
+
+    // Nothing scheduled: only the wake ends the wait.
+    s_poll_period_us = 0;
+    net_io_service(0);
+    net_io_wake();
+    t0 = esp_timer_get_time();
+    net_io_service(1000);
+    TEST_ASSERT_TRUE(esp_timer_get_time() - t0 < 100000);
+
+    net_io_unregister(h);
+    TEST_ASSERT_EQUAL(-1, net_io_socket(h));
+    polls = s_polls;
+    net_io_service(0);
+    TEST_ASSERT_EQUAL(polls, s_polls);
+}
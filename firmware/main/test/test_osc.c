@@ -0,0 +1,371 @@
+#include "unity.h"
+#include "osc.h"
+#include "net_io.h"
+#include "effects.h"
+#include "fx_util.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    int      calls;
+    char     op;             // e, i, p, g, b, s
+    int      ch;
+    uint32_t effect_id;
+    float    level;
+    float    rgbw[4];
+    bool     has_w;
+    char     group[OSC_NAME_MAX];
+    float    bpm;
+    uint32_t ms;
+    uint8_t  hmsf[4];
+    float    fps;
+    bool     drop;
+    int64_t  at_us;
+} osc_rec_t;
+
+static osc_rec_t s_rec;
+
+static void rec(char op, int ch) {
+    s_rec.calls++;
+    s_rec.op = op;
+    s_rec.ch = ch;
+    s_rec.at_us = esp_timer_get_time();
+}
+
+static bool mock_effect(int ch, uint32_t id) {
+    rec('e', ch);
+    s_rec.effect_id = id;
+    return id != 999;        // stands in for an unknown effect
+}
+
+static bool mock_intensity(int ch, float level) {
+    rec('i', ch);
+    s_rec.level = level;
+    return true;
+}
+
+static bool mock_pwm(int ch, float level) {
+    rec('p', ch);
+    s_rec.level = level;
+    return true;
+}
+
+static bool mock_group(const char *group, const float rgbw[4], bool has_w) {
+    rec('g', 0);
+    strncpy(s_rec.group, group, sizeof(s_rec.group) - 1);
+    memcpy(s_rec.rgbw, rgbw, sizeof(s_rec.rgbw));
+    s_rec.has_w = has_w;
+    return true;
+}
+
+static void mock_beat(float bpm) {
+    rec('b', 0);
+    s_rec.bpm = bpm;
+}
+
+static void mock_strobe(uint32_t ms) {
+    rec('s', 0);
+    s_rec.ms = ms;
+}
+
+static bool mock_timecode(const uint8_t hmsf[4], float fps, bool drop) {
+    rec('t', 0);
+    memcpy(s_rec.hmsf, hmsf, sizeof(s_rec.hmsf));
+    s_rec.fps = fps;
+    s_rec.drop = drop;
+    return true;
+}
+
+static const osc_ops_t MOCK_OPS = {
+    .effect = mock_effect,
+    .intensity = mock_intensity,
+    .pwm = mock_pwm,
+    .group_rgb = mock_group,
+    .beat = mock_beat,
+    .strobe = mock_strobe,
+    .timecode = mock_timecode
+};
+
+static size_t put_str(uint8_t *b, const char *s) {
+    size_t n = strlen(s) + 1;
+    size_t padded = (n + 3) & ~(size_t)3;
+    memset(b, 0, padded);
+    memcpy(b, s, n);
+    return padded;
+}
+
+static size_t put_be32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+    return 4;
+}
+
+// Arguments follow types: i int, f double (float), s string; T/F take none.
+static size_t build(uint8_t *buf, const char *addr, const char *types, ...) {
+    size_t n = put_str(buf, addr);
+    char tags[16] = ",";
+    strncat(tags, types, sizeof(tags) - 2);
+    n += put_str(buf + n, tags);
+    va_list ap;
+    va_start(ap, types);
+    for (const char *t = types; *t; t++) {
+        if (*t == 'i') {
+            n += put_be32(buf + n, (uint32_t)va_arg(ap, int));
+        } else if (*t == 'f') {
+            float f = (float)va_arg(ap, double);
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            n += put_be32(buf + n, bits);
+        } else if (*t == 's') {
+            n += put_str(buf + n, va_arg(ap, const char *));
+        }
+    }
+    va_end(ap);
+    return n;
+}
+
+static osc_stats_t stats_since(const osc_stats_t *before) {
+    osc_stats_t st;
+    osc_get_stats(&st);
+    st.packets -= before->packets;
+    st.malformed -= before->malformed;
+    st.messages -= before->messages;
+    st.unknown -= before->unknown;
+    st.bad_args -= before->bad_args;
+    st.refused -= before->refused;
+    return st;
+}
+
+TEST_CASE("osc routes each address to its op", "[osc]") {
+    uint8_t buf[128];
+    osc_stats_t before;
+    osc_set_ops(&MOCK_OPS);
+    osc_get_stats(&before);
+    memset(&s_rec, 0, sizeof(s_rec));
+
+    osc_handle(buf, build(buf, "/ch/3/effect", "i", FX_FIRE));
+    TEST_ASSERT_EQUAL('e', s_rec.op);
+    TEST_ASSERT_EQUAL(2, s_rec.ch);
+    TEST_ASSERT_EQUAL_UINT32(FX_FIRE, s_rec.effect_id);
+
+    // Float for an int, and every channel.
+    osc_handle(buf, build(buf, "/ch/*/effect", "f", 2.0));
+    TEST_ASSERT_EQUAL(-1, s_rec.ch);
+    TEST_ASSERT_EQUAL_UINT32(FX_GRADIENT, s_rec.effect_id);
+
+    osc_handle(buf, build(buf, "/ch/8/intensity", "f", 0.5));
+    TEST_ASSERT_EQUAL('i', s_rec.op);
+    TEST_ASSERT_EQUAL(7, s_rec.ch);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, s_rec.level);
+    osc_handle(buf, build(buf, "/ch/1/intensity", "f", 7.0));
+    TEST_ASSERT_EQUAL_FLOAT(1.f, s_rec.level);
+    osc_handle(buf, build(buf, "/ch/1/intensity", "T"));
+    TEST_ASSERT_EQUAL_FLOAT(1.f, s_rec.level);
+
+    osc_handle(buf, build(buf, "/pwm/12", "f", 0.25));
+    TEST_ASSERT_EQUAL('p', s_rec.op);
+    TEST_ASSERT_EQUAL(11, s_rec.ch);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, s_rec.level);
+
+    osc_handle(buf, build(buf, "/group/desk_left/rgb", "fff", 1.0, 0.5, 0.0));
+    TEST_ASSERT_EQUAL('g', s_rec.op);
+    TEST_ASSERT_EQUAL_STRING("desk_left", s_rec.group);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, s_rec.rgbw[1]);
+    TEST_ASSERT_FALSE(s_rec.has_w);
+    osc_handle(buf, build(buf, "/group/desk_left/rgb", "ffff", 0.0, 0.0, 0.0, 0.75));
+    TEST_ASSERT_TRUE(s_rec.has_w);
+    TEST_ASSERT_EQUAL_FLOAT(0.75f, s_rec.rgbw[3]);
+
+    osc_handle(buf, build(buf, "/beat", ""));
+    TEST_ASSERT_EQUAL('b', s_rec.op);
+    TEST_ASSERT_EQUAL_FLOAT(0.f, s_rec.bpm);
+    osc_handle(buf, build(buf, "/beat", "f", 128.0));
+    TEST_ASSERT_EQUAL_FLOAT(128.f, s_rec.bpm);
+
+    osc_handle(buf, build(buf, "/strobe", ""));
+    TEST_ASSERT_EQUAL('s', s_rec.op);
+    TEST_ASSERT_EQUAL_UINT32(OSC_STROBE_MS, s_rec.ms);
+    osc_handle(buf, build(buf, "/strobe", "i", 120));
+    TEST_ASSERT_EQUAL_UINT32(120, s_rec.ms);
+
+    osc_stats_t st = stats_since(&before);
+    TEST_ASSERT_EQUAL_UINT32(12, st.packets);
+    TEST_ASSERT_EQUAL_UINT32(12, st.messages);
+    TEST_ASSERT_EQUAL_UINT32(0, st.unknown + st.bad_args + st.refused + st.malformed);
+
+    // Nothing reaches the ops for these.
+    int calls = s_rec.calls;
+    osc_handle(buf, build(buf, "/ch/0/effect", "i", 1));
+    osc_handle(buf, build(buf, "/ch/3/effect/x", "i", 1));
+    osc_handle(buf, build(buf, "/ch/3", "i", 1));
+    osc_handle(buf, build(buf, "/group//rgb", "fff", 1.0, 1.0, 1.0));
+    osc_handle(buf, build(buf, "/group/a_group_name_longer_than_24/rgb", "fff", 1.0, 1.0, 1.0));
+    osc_handle(buf, build(buf, "/ch/3/effect", "s", "fire"));
+    osc_handle(buf, build(buf, "/ch/3/intensity", ""));
+    osc_handle(buf, build(buf, "/group/desk/rgb", "ff", 1.0, 1.0));
+    osc_handle(buf, build(buf, "/beat", "f", -1.0));
+    TEST_ASSERT_EQUAL(calls, s_rec.calls);
+    osc_handle(buf, build(buf, "/ch/3/effect", "i", 999));
+    TEST_ASSERT_EQUAL(calls + 1, s_rec.calls);
+
+    st = stats_since(&before);
+    TEST_ASSERT_EQUAL_UINT32(12, st.messages);
+    TEST_ASSERT_EQUAL_UINT32(5, st.unknown);
+    TEST_ASSERT_EQUAL_UINT32(4, st.bad_args);
+    TEST_ASSERT_EQUAL_UINT32(1, st.refused);
+    TEST_ASSERT_EQUAL_UINT32(0, st.malformed);
+
+    // Timecode as a label string, or as numbers with a rate.
+    const uint8_t label[4] = { 1, 2, 3, 4 };
+    osc_handle(buf, build(buf, "/timecode", "s", "01:02:03;04"));
+    TEST_ASSERT_EQUAL('t', s_rec.op);
+    TEST_ASSERT_EQUAL_MEMORY(label, s_rec.hmsf, 4);
+    TEST_ASSERT_TRUE(s_rec.drop);
+    TEST_ASSERT_EQUAL_FLOAT(0.f, s_rec.fps);
+    osc_handle(buf, build(buf, "/timecode", "iiiif", 10, 0, 59, 24, 25.0));
+    TEST_ASSERT_FALSE(s_rec.drop);
+    TEST_ASSERT_EQUAL_FLOAT(25.f, s_rec.fps);
+    TEST_ASSERT_EQUAL_UINT8(24, s_rec.hmsf[3]);
+    calls = s_rec.calls;
+    osc_handle(buf, build(buf, "/timecode", "s", "1:02:03:04"));
+    osc_handle(buf, build(buf, "/timecode", "s", "01:02;03:04"));
+    osc_handle(buf, build(buf, "/timecode", "iii", 1, 2, 3));
+    osc_handle(buf, build(buf, "/timecode", "sff", "01:02:03:04", 25.0, 1.0));
+    TEST_ASSERT_EQUAL(calls, s_rec.calls);
+}
+
+TEST_CASE("osc unpacks bundles and rejects malformed packets whole", "[osc]") {
+    uint8_t msg[64], pkt[256];
+    osc_stats_t before;
+    osc_set_ops(&MOCK_OPS);
+    osc_get_stats(&before);
+    memset(&s_rec, 0, sizeof(s_rec));
+
+    // #bundle { /ch/1/effect 3, #bundle { /ch/1/intensity 0.4 } }
+    size_t n = put_str(pkt, "#bundle");
+    n += put_be32(pkt + n, 0);
+    n += put_be32(pkt + n, 1);
+    size_t len = build(msg, "/ch/1/effect", "i", FX_CHASE);
+    n += put_be32(pkt + n, (uint32_t)len);
+    memcpy(pkt + n, msg, len);
+    n += len;
+    size_t inner = n;
+    n += 4;
+    n += put_str(pkt + n, "#bundle");
+    n += put_be32(pkt + n, 0);
+    n += put_be32(pkt + n, 1);
+    len = build(msg, "/ch/1/intensity", "f", 0.4);
+    n += put_be32(pkt + n, (uint32_t)len);
+    memcpy(pkt + n, msg, len);
+    n += len;
+    put_be32(pkt + inner, (uint32_t)(n - inner - 4));
+
+    osc_handle(pkt, n);
+    TEST_ASSERT_EQUAL(2, s_rec.calls);
+    TEST_ASSERT_EQUAL('i', s_rec.op);
+    TEST_ASSERT_EQUAL_FLOAT(0.4f, s_rec.level);
+
+    // Cut anywhere but between elements, the bundle delivers nothing.
+    for (size_t cut = 4; cut < n; cut += 4) {
+        if (cut != 16 && cut != inner) osc_handle(pkt, cut);
+    }
+    // An element size past the end.
+    put_be32(pkt + inner, 0x7FFFFFFC);
+    osc_handle(pkt, n);
+    TEST_ASSERT_EQUAL(2, s_rec.calls);
+
+    // Strings without their NUL, args shorter than their tags, unknown tags,
+    // data without a type tag string, unpadded lengths.
+    len = build(msg, "/ch/1/intensity", "f", 0.4);
+    osc_handle(msg, len - 4);
+    memcpy(msg + len - 8, ",ff", 4);
+    osc_handle(msg, len);
+    len = build(msg, "/strobe", "i", 10);
+    msg[9] = 'q';
+    osc_handle(msg, len);
+    len = put_str(msg, "/strobe");
+    len += put_be32(msg + len, 10);
+    osc_handle(msg, len);
+    memset(msg, '/', 16);
+    osc_handle(msg, 16);
+    osc_handle(msg, 6);
+    TEST_ASSERT_EQUAL(2, s_rec.calls);
+
+    osc_stats_t st = stats_since(&before);
+    TEST_ASSERT_EQUAL_UINT32(st.packets - 1, st.malformed);
+    TEST_ASSERT_EQUAL_UINT32(2, st.messages);
+}
+
+// Loopback UDP into the net_io socket, through the parser and router to the
+// op, then one strip frame rendered with the new value: the latency of a
+// fader move up to a finished frame, minus the wait for the render task.
+TEST_CASE("osc command to frame latency over loopback", "[osc][bench]") {
+    enum { ROUNDS = 200, PIXELS = 300 };
+    static px_rgba_t frame[PIXELS];
+    uint8_t buf[64];
+    osc_set_ops(&MOCK_OPS);
+    TEST_ASSERT_EQUAL(ESP_OK, osc_start(0));
+    uint16_t port = osc_port();
+    TEST_ASSERT_TRUE(port != 0);
+
+    int tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    TEST_ASSERT_TRUE(tx >= 0);
+    struct sockaddr_in dst = {0};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    util_init_gamma(2.2f);
+    const effect_vtable_t *fx = fx_lookup(FX_TWINKLE);
+    TEST_ASSERT_NOT_NULL(fx);
+    aled_channel_t ch = {
+        .type = LED_WS2812B,
+        .n_pixels = PIXELS,
+        .gamma = 2.2f,
+        .max_brightness = 255,
+        .framebuf = frame
+    };
+    effect_params_t p = { .effect_id = FX_TWINKLE, .speed = 1.0f, .color1 = {255, 255, 255, 0}, .opacity = 255 };
+
+    int64_t to_op = 0, to_frame = 0, worst = 0;
+    uint32_t last = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        float level = (r & 1) ? 0.8f : 0.3f;
+        size_t len = build(buf, "/ch/1/intensity", "f", (double)level);
+        int calls = s_rec.calls;
+        int64_t t0 = esp_timer_get_time();
+        TEST_ASSERT_EQUAL((int)len, sendto(tx, buf, len, 0, (struct sockaddr *)&dst, sizeof(dst)));
+        for (int i = 0; i < 100 && s_rec.calls == calls; i++) {
+            net_io_service(10);
+        }
+        TEST_ASSERT_EQUAL(calls + 1, s_rec.calls);
+        TEST_ASSERT_EQUAL_FLOAT(level, s_rec.level);
+
+        p.intensity = s_rec.level;
+        memset(frame, 0, sizeof(frame));
+        uint32_t sum = fx->render(&ch, &p, 1000, 0);
+        int64_t t1 = esp_timer_get_time();
+        // Same instant every round: only the intensity moves the frame.
+        TEST_ASSERT_TRUE(r == 0 || (sum > last) == ((r & 1) != 0));
+        last = sum;
+
+        to_op += s_rec.at_us - t0;
+        to_frame += t1 - t0;
+        if (t1 - t0 > worst) worst = t1 - t0;
+    }
+    printf("osc latency: command to op %5.1f us, to frame %5.1f us avg, %lld us worst (%d px)\n",
+           (double)to_op / ROUNDS, (double)to_frame / ROUNDS, (long long)worst, PIXELS);
+    // Well inside one 60 fps frame interval.
+    TEST_ASSERT_TRUE(to_frame / ROUNDS < 16000);
+
+    close(tx);
+    osc_stop();
+    net_io_service(0);
+    TEST_ASSERT_EQUAL_UINT16(0, osc_port());
+}
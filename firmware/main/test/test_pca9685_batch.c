@@ -0,0 +1,166 @@
+#include "unity.h"
+#include "pca9685_driver.h"
+#include "pca9685_mock.h"
+#include <string.h>
+
+static pca9685_mock_t s_bus;
+
+static void mock_init(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, 1));
+    pca9685_mock_clear_log(&s_bus);
+}
+
+// Raw LEDn_OFF register pair, so FULL_OFF rewrites can be told apart.
+static uint16_t mock_off(int ch) {
+    return pca9685_mock_reg(&s_bus, 0, (uint8_t)(0x08 + 4 * ch)) |
+           (pca9685_mock_reg(&s_bus, 0, (uint8_t)(0x09 + 4 * ch)) << 8);
+}
+
+TEST_CASE("pca9685 flush batches dirty ranges", "[pwm]") {
+    mock_init();
+
+    // Unchanged values never reach the bus.
+    pca9685_set_duty(3, 0.0f);
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_flush());
+    TEST_ASSERT_EQUAL_UINT32(0, s_bus.n_txn);
+
+    // 0..5 contiguous, 7 bridged over clean 6, 12 separate: two bursts.
+    for (int ch = 0; ch < 6; ch++) {
+        pca9685_set_counts(ch, 100 + ch);
+    }
+    pca9685_set_counts(7, 700);
+    pca9685_set_counts(12, 1200);
+    pca9685_flush();
+    TEST_ASSERT_EQUAL_UINT32(2, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_UINT32((1 + 4 * 8) + (1 + 4), s_bus.bytes);
+    TEST_ASSERT_EQUAL_UINT16(105, mock_off(5));
+    TEST_ASSERT_EQUAL_UINT16(0x1000, mock_off(6));   // rewritten, still FULL_OFF
+    TEST_ASSERT_EQUAL_UINT16(700, mock_off(7));
+    TEST_ASSERT_EQUAL_UINT16(1200, mock_off(12));
+
+    // All sixteen to the same value: one ALL_LED write.
+    pca9685_mock_clear_log(&s_bus);
+    pca9685_all_off();
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_HEX8(0xFD, s_bus.log[0].reg);   // ALL_LED_OFF_H FULL_OFF
+    for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+        TEST_ASSERT_EQUAL_HEX8(0x10, pca9685_mock_reg(&s_bus, 0, 0x09 + 4 * ch));
+        TEST_ASSERT_EQUAL_UINT16(0, pca9685_mock_counts(&s_bus, ch));
+    }
+
+    pca9685_set_counts(9, PCA9685_FULL_ON);
+    pca9685_flush();
+    TEST_ASSERT_EQUAL_HEX8(0x10, pca9685_mock_reg(&s_bus, 0, 0x07 + 4 * 9));   // LED9_ON_H FULL_ON
+    TEST_ASSERT_EQUAL_UINT16(0, mock_off(9));
+    TEST_ASSERT_EQUAL_UINT16(PCA9685_FULL_ON, pca9685_mock_counts(&s_bus, 9));
+}
+
+// Deferred transport: submit() only queues; the test decides when and how
+// each write completes, as the I2C ISR would.
+#define ASYNC_SLOTS 2
+
+typedef struct {
+    uint8_t addr;
+    uint8_t data[1 + 4 * PCA9685_CHANNELS];
+    size_t len;
+    pca9685_done_cb_t cb;
+    void *arg;
+} async_slot_t;
+
+static pca9685_bus_t s_async_bus;
+static async_slot_t s_slots[ASYNC_SLOTS];
+static int s_queued;
+static bool s_stuck;
+static int s_recovers;
+
+static esp_err_t mock_submit(void *ctx, uint8_t addr, const uint8_t *data, size_t len,
+                             pca9685_done_cb_t cb, void *arg) {
+    (void)ctx;
+    if (s_queued == ASYNC_SLOTS) return s_stuck ? ESP_ERR_TIMEOUT : ESP_ERR_NO_MEM;
+    async_slot_t *slot = &s_slots[s_queued++];
+    slot->addr = addr;
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->cb = cb;
+    slot->arg = arg;
+    return ESP_OK;
+}
+
+static esp_err_t mock_recover(void *ctx) {
+    (void)ctx;
+    s_recovers++;
+    s_queued = 0;
+    s_stuck = false;
+    return ESP_OK;
+}
+
+static void mock_complete_all(esp_err_t result) {
+    for (int i = 0; i < s_queued; i++) {
+        if (result == ESP_OK) {
+            s_async_bus.write(s_async_bus.ctx, s_slots[i].addr, s_slots[i].data, s_slots[i].len);
+        }
+        s_slots[i].cb(s_slots[i].arg, result);
+    }
+    s_queued = 0;
+}
+
+TEST_CASE("pca9685 async flush does not wait and retries failures", "[pwm]") {
+    pca9685_mock_reset(&s_bus, 1);
+    s_queued = 0;
+    s_stuck = false;
+    s_recovers = 0;
+    pca9685_config_t cfg = { .i2c_port = 0, .i2c_addr = 0x40, .oe_pin = 25 };
+    pca9685_mock_bus(&s_bus, &s_async_bus);
+    s_async_bus.submit = mock_submit;
+    s_async_bus.recover = mock_recover;
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_init_bus(&cfg, &s_async_bus));
+    mock_complete_all(ESP_OK);
+    pca9685_bus_stats_t base;
+    pca9685_get_bus_stats(&base);
+
+    // Queued, not yet on the wire.
+    pca9685_set_counts(2, 200);
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_flush());
+    TEST_ASSERT_EQUAL(1, s_queued);
+    TEST_ASSERT_NOT_EQUAL(200, mock_off(2));
+
+    // A NACK puts the channel back; the next flush recovers and resends
+    // everything, since the chip state is unknown after a reset.
+    mock_complete_all(ESP_FAIL);
+    pca9685_flush();
+    TEST_ASSERT_EQUAL(1, s_recovers);
+    mock_complete_all(ESP_OK);
+    TEST_ASSERT_EQUAL_UINT16(200, mock_off(2));
+
+    // Full queue: the flush returns at once and the channels stay dirty.
+    pca9685_set_counts(0, 10);
+    pca9685_set_counts(9, 90);
+    pca9685_set_counts(15, 150);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, pca9685_flush());
+    TEST_ASSERT_EQUAL(ASYNC_SLOTS, s_queued);
+    mock_complete_all(ESP_OK);
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_flush());
+    mock_complete_all(ESP_OK);
+    TEST_ASSERT_EQUAL_UINT16(10, mock_off(0));
+    TEST_ASSERT_EQUAL_UINT16(90, mock_off(9));
+    TEST_ASSERT_EQUAL_UINT16(150, mock_off(15));
+
+    // Stuck queue: reported as a timeout and reset on the following flush.
+    pca9685_set_counts(4, 40);
+    pca9685_set_counts(11, 110);
+    pca9685_set_counts(14, 140);
+    s_stuck = true;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, pca9685_flush());
+    pca9685_flush();
+    TEST_ASSERT_EQUAL(2, s_recovers);
+    mock_complete_all(ESP_OK);
+    pca9685_flush();
+    mock_complete_all(ESP_OK);
+    TEST_ASSERT_EQUAL_UINT16(140, mock_off(14));
+
+    pca9685_bus_stats_t st;
+    pca9685_get_bus_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.recoveries - base.recoveries);
+    TEST_ASSERT_TRUE(st.busy > base.busy);
+    TEST_ASSERT_TRUE(st.errors > base.errors);
+}
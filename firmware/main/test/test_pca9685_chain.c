@@ -0,0 +1,52 @@
+#include "unity.h"
+#include "pca9685_driver.h"
+#include "pca9685_mock.h"
+
+// Four chips on the mock bus: ALLCALL reaches every chip and ALL_LED
+// writes load all sixteen LEDn registers, as on the real part.
+#define CHAIN_CHIPS 4
+
+static pca9685_mock_t s_bus;
+
+// Raw LEDn_OFF register pair of one chip's output.
+static uint16_t chain_off(int chip, int ch) {
+    return pca9685_mock_reg(&s_bus, chip, (uint8_t)(0x08 + 4 * ch)) |
+           (pca9685_mock_reg(&s_bus, chip, (uint8_t)(0x09 + 4 * ch)) << 8);
+}
+
+static void chain_init(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, CHAIN_CHIPS));
+    pca9685_mock_clear_log(&s_bus);
+}
+
+TEST_CASE("pca9685 chain addresses channels across chips", "[pwm]") {
+    chain_init();
+    TEST_ASSERT_EQUAL_UINT16(CHAIN_CHIPS * PCA9685_CHANNELS, pca9685_channel_count());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, pca9685_set_counts(CHAIN_CHIPS * PCA9685_CHANNELS, 1));
+
+    // Channel 37 is chip 2, output 5; only that chip sees a write.
+    pca9685_set_counts(37, 1234);
+    pca9685_flush();
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_HEX8(0x42, s_bus.log[0].addr);
+    TEST_ASSERT_EQUAL_UINT16(1234, chain_off(2, 5));
+    TEST_ASSERT_EQUAL_UINT16(0x1000, chain_off(1, 5));
+
+    // Blackout is one ALLCALL write whatever the chain length.
+    pca9685_set_counts(3, 300);
+    pca9685_set_counts(60, 600);
+    pca9685_flush();
+    pca9685_mock_clear_log(&s_bus);
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_all_off());
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_HEX8(PCA9685_ALLCALL_ADDR, s_bus.log[0].addr);
+    for (int c = 0; c < CHAIN_CHIPS; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNELS; ch++) {
+            TEST_ASSERT_EQUAL_HEX8(0x10, pca9685_mock_reg(&s_bus, c, 0x09 + 4 * ch));
+        }
+    }
+    // The shadow followed: re-setting zero is not a change.
+    pca9685_set_counts(60, 0);
+    pca9685_flush();
+    TEST_ASSERT_EQUAL_UINT32(1, s_bus.n_txn);
+}
@@ -0,0 +1,56 @@
+#include "unity.h"
+#include "pca9685_curve.h"
+#include "pca9685_driver.h"
+#include <stdlib.h>
+
+static pca9685_curve_t s_curve;
+
+static void build(pca9685_curve_kind_t kind, float max_duty) {
+    pca9685_curve_cfg_t cfg;
+    pca9685_curve_default(&cfg);
+    cfg.kind = kind;
+    cfg.max_duty = max_duty;
+    pca9685_curve_build(&s_curve, &cfg);
+}
+
+TEST_CASE("pca9685 curves map 16-bit levels onto 12-bit counts", "[pwm]") {
+    build(PCA9685_CURVE_LINEAR, 1.0f);
+    TEST_ASSERT_EQUAL_UINT16(0, pca9685_curve_map(&s_curve, 0));
+    TEST_ASSERT_EQUAL_UINT16(PCA9685_FULL_ON, pca9685_curve_map(&s_curve, 65535));
+    TEST_ASSERT_EQUAL_UINT16(2048, pca9685_curve_map(&s_curve, 32768));
+    // Interpolation resolves levels between table entries.
+    TEST_ASSERT_EQUAL_UINT16(1, pca9685_curve_map(&s_curve, 16));
+
+    build(PCA9685_CURVE_SQUARE, 1.0f);
+    TEST_ASSERT_EQUAL_UINT16(1024, pca9685_curve_map(&s_curve, 32768));
+
+    // CIE1931 at L* = 50 is Y = 0.184.
+    build(PCA9685_CURVE_CIE1931, 1.0f);
+    TEST_ASSERT_TRUE(abs((int)pca9685_curve_map(&s_curve, 32768) - 755) <= 2);
+
+    // max_duty caps the top; the log curve still starts from zero.
+    build(PCA9685_CURVE_LOG, 0.85f);
+    TEST_ASSERT_EQUAL_UINT16(3482, pca9685_curve_map(&s_curve, 65535));
+    TEST_ASSERT_EQUAL_UINT16(0, pca9685_curve_map(&s_curve, 0));
+    uint16_t prev = 0;
+    for (uint32_t l = 0; l <= 65535; l += 257) {
+        uint16_t c = pca9685_curve_map(&s_curve, (uint16_t)l);
+        TEST_ASSERT_TRUE(c >= prev);
+        prev = c;
+    }
+}
+
+TEST_CASE("pca9685 custom curve interpolates uploaded points", "[pwm]") {
+    pca9685_curve_cfg_t cfg;
+    pca9685_curve_default(&cfg);
+    TEST_ASSERT_TRUE(pca9685_curve_parse_kind("CUSTOM", &cfg.kind));
+    cfg.n_points = 3;
+    cfg.points[0] = 0.0f;
+    cfg.points[1] = 0.1f;
+    cfg.points[2] = 1.0f;
+    pca9685_curve_build(&s_curve, &cfg);
+    TEST_ASSERT_EQUAL_UINT16(410, pca9685_curve_map(&s_curve, 32768));
+    TEST_ASSERT_EQUAL_UINT16(205, pca9685_curve_map(&s_curve, 16384));
+    TEST_ASSERT_EQUAL_UINT16(PCA9685_FULL_ON, pca9685_curve_map(&s_curve, 65535));
+    TEST_ASSERT_EQUAL_STRING("custom", pca9685_curve_kind_name(cfg.kind));
+}
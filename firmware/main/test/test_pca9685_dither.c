@@ -0,0 +1,94 @@
+#include "unity.h"
+#include "pca9685_driver.h"
+#include "pca9685_curve.h"
+#include "pca9685_dither.h"
+#include "pca9685_mock.h"
+#include <math.h>
+#include <stdio.h>
+
+// Sampled after every flush: what the output shows for the next 5 ms.
+static pca9685_mock_t s_bus;
+
+#define DITHER_CHANNELS 8
+
+static void mock_output(int ch, uint16_t counts, void *ctx) {
+    (void)ctx;
+    pca9685_set_counts(ch, counts);
+}
+
+// Runs the PWM task's dither pass for ticks at 200 Hz with a per-tick byte
+// budget and returns the mean counts each channel showed.
+static void run_dither(const uint32_t *target_q8, int ticks, uint32_t budget, double *mean) {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, 1));
+
+    // Start settled on the integer part, as a channel that just finished
+    // a fade would be; the budget only limits the dither steps.
+    bool live[DITHER_CHANNELS];
+    pca9685_dither_t state[DITHER_CHANNELS] = {0};
+    uint16_t out[DITHER_CHANNELS] = {0};
+    for (int ch = 0; ch < DITHER_CHANNELS; ch++) {
+        live[ch] = true;
+        out[ch] = (uint16_t)(target_q8[ch] >> 8);
+        pca9685_set_counts(ch, out[ch]);
+    }
+    pca9685_flush();
+    pca9685_mock_clear_log(&s_bus);
+    pca9685_dither_bank_t bank = {
+        .n = DITHER_CHANNELS,
+        .live = live,
+        .target_q8 = target_q8,
+        .state = state,
+        .counts = out,
+        .output = mock_output
+    };
+    double sum[DITHER_CHANNELS] = {0};
+    for (int t = 0; t < ticks; t++) {
+        TEST_ASSERT_TRUE(pca9685_dither_pass(&bank, budget) <= budget);
+        pca9685_flush();
+        for (int ch = 0; ch < DITHER_CHANNELS; ch++) {
+            TEST_ASSERT_EQUAL(out[ch], pca9685_mock_counts(&s_bus, ch));
+            sum[ch] += out[ch];
+        }
+    }
+    for (int ch = 0; ch < DITHER_CHANNELS; ch++) {
+        mean[ch] = sum[ch] / ticks;
+    }
+}
+
+// Targets below and between 12-bit steps, as a log curve produces them at
+// the bottom of the range.
+static const uint32_t TARGETS_Q8[DITHER_CHANNELS] = {
+    64,            // 0.25 counts
+    320,           // 1.25
+    2688,          // 10.5
+    26,            // 0.1
+    25830,         // 100.9
+    0,             // off stays off
+    PCA9685_FULL_ON << 8,
+    (3 << 8) + 171 // 3.67
+};
+
+TEST_CASE("pca9685 dither average tracks 16-bit target", "[pwm]") {
+    double mean[DITHER_CHANNELS];
+    // Two seconds at 200 Hz, unconstrained.
+    run_dither(TARGETS_Q8, 400, 1000, mean);
+    for (int ch = 0; ch < DITHER_CHANNELS; ch++) {
+        double want = TARGETS_Q8[ch] / 256.0;
+        printf("dither ch%d: target %.3f counts, mean %.3f\n", ch, want, mean[ch]);
+        TEST_ASSERT_TRUE(fabs(mean[ch] - want) < 0.01);
+    }
+}
+
+TEST_CASE("pca9685 dither respects bus budget", "[pwm][bench]") {
+    double mean[DITHER_CHANNELS];
+    // 10 bytes per 5 ms tick = 2 kB/s: two channel updates per tick for
+    // six toggling channels. Starved channels fall back on their error
+    // accumulators and still converge, more slowly.
+    run_dither(TARGETS_Q8, 2000, 10, mean);
+    uint32_t per_s = (uint32_t)(s_bus.bytes / 10);
+    printf("dither budget 2000 B/s: %u B/s on the bus\n", (unsigned)per_s);
+    TEST_ASSERT_TRUE(per_s <= 2000 + 2000 / 5);   // + burst register byte per tick
+    for (int ch = 0; ch < DITHER_CHANNELS; ch++) {
+        TEST_ASSERT_TRUE(fabs(mean[ch] - TARGETS_Q8[ch] / 256.0) < 0.02);
+    }
+}
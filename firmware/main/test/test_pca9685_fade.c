@@ -0,0 +1,34 @@
+#include "unity.h"
+#include "pca9685_driver.h"
+#include <stdlib.h>
+
+TEST_CASE("pca9685 linear fade hits every endpoint exactly", "[pwm]") {
+    TEST_ASSERT_EQUAL_UINT16(100, pca9685_fade_counts(100, 3000, 0, 500, false));
+    TEST_ASSERT_EQUAL_UINT16(1550, pca9685_fade_counts(100, 3000, 250, 500, false));
+    TEST_ASSERT_EQUAL_UINT16(3000, pca9685_fade_counts(100, 3000, 500, 500, false));
+    TEST_ASSERT_EQUAL_UINT16(3000, pca9685_fade_counts(100, 3000, 9999, 500, false));
+    TEST_ASSERT_EQUAL_UINT16(2048, pca9685_fade_counts(4096, 0, 500, 1000, false));
+    TEST_ASSERT_EQUAL_UINT16(0, pca9685_fade_counts(4096, 0, 1000, 1000, false));
+
+    // 12-bit steps: a 0 -> 4096 fade over 4096 ms moves one count per ms.
+    for (uint32_t t = 0; t <= 4096; t += 97) {
+        TEST_ASSERT_EQUAL_UINT16(t, pca9685_fade_counts(0, 4096, t, 4096, false));
+    }
+}
+
+TEST_CASE("pca9685 log fade is monotonic and spends time at the low end", "[pwm]") {
+    uint16_t prev = 0;
+    for (uint32_t t = 0; t <= 1000; t += 10) {
+        uint16_t c = pca9685_fade_counts(0, 4096, t, 1000, true);
+        TEST_ASSERT_TRUE(c >= prev);
+        prev = c;
+    }
+    TEST_ASSERT_EQUAL_UINT16(4096, prev);
+    // Halfway through a full-range log fade is ~64 counts (sqrt(4096)), not 2048.
+    uint16_t mid = pca9685_fade_counts(0, 4096, 500, 1000, true);
+    TEST_ASSERT_TRUE(abs((int)mid - 64) <= 2);
+
+    // Downwards mirrors upwards.
+    TEST_ASSERT_EQUAL_UINT16(mid, pca9685_fade_counts(4096, 0, 500, 1000, true));
+    TEST_ASSERT_EQUAL_UINT16(0, pca9685_fade_counts(4096, 0, 1000, 1000, true));
+}
@@ -0,0 +1,123 @@
+#include "unity.h"
+#include "pca9685_driver.h"
+#include "pca9685_mock.h"
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define TICK_US  20000   // PWM task rate
+
+static pca9685_mock_t s_bus;
+
+TEST_CASE("pca9685 mock register model follows the driver", "[pwm]") {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, 2));
+
+    // Awake, auto-increment on, ALLCALL kept, prescale written while asleep.
+    uint8_t mode1 = pca9685_mock_reg(&s_bus, 1, 0x00);
+    TEST_ASSERT_EQUAL_HEX8(0x21, mode1);
+    TEST_ASSERT_EQUAL_HEX8(0x04, pca9685_mock_reg(&s_bus, 1, 0x01));
+    TEST_ASSERT_EQUAL_UINT32(0, s_bus.ignored_writes);
+    TEST_ASSERT_EQUAL_UINT32(0, s_bus.n_nack);
+    TEST_ASSERT_TRUE(fabsf(pca9685_mock_pwm_hz(&s_bus, 0) - 1000.0f) < 25.0f);
+
+    static const uint16_t counts[] = { 0, 1, 2048, 4095, PCA9685_FULL_ON };
+    for (int i = 0; i < 5; i++) {
+        pca9685_set_counts(i, counts[i]);
+        pca9685_set_counts(16 + 15 - i, counts[i]);
+    }
+    pca9685_flush();
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT16(counts[i], pca9685_mock_counts(&s_bus, i));
+        TEST_ASSERT_EQUAL_UINT16(counts[i], pca9685_mock_counts(&s_bus, 31 - i));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, pca9685_mock_duty(&s_bus, 2));
+
+    // ALLCALL reaches both chips in one transaction.
+    uint32_t before = s_bus.n_txn;
+    pca9685_all_off();
+    TEST_ASSERT_EQUAL_UINT32(before + 1, s_bus.n_txn);
+    for (int ch = 0; ch < 32; ch++) {
+        TEST_ASSERT_EQUAL_UINT16(0, pca9685_mock_counts(&s_bus, ch));
+    }
+}
+
+// Drives one channel through a fade on the PWM task's 20 ms grid and checks
+// what the chip output at every step, not just the interpolation.
+static void trace_fade(bool log_curve, uint16_t *trace, int steps, uint32_t duration_ms) {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, 1));
+    pca9685_mock_clear_log(&s_bus);
+    for (int i = 0; i <= steps; i++) {
+        uint32_t t_ms = (uint32_t)i * (TICK_US / 1000);
+        pca9685_set_counts(0, pca9685_fade_counts(0, PCA9685_FULL_ON, t_ms, duration_ms, log_curve));
+        pca9685_flush();
+        trace[i] = pca9685_mock_counts(&s_bus, 0);
+        pca9685_mock_advance_us(&s_bus, TICK_US);
+    }
+}
+
+TEST_CASE("pca9685 mock traces fade curves on the bus", "[pwm]") {
+    uint16_t lin[51];
+    uint16_t lg[51];
+    trace_fade(false, lin, 50, 1000);
+    // One burst per tick, stamped on the tick; tick 0 repeats the power-on
+    // zero and stays off the bus.
+    TEST_ASSERT_EQUAL_UINT32(50, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_INT64(TICK_US, s_bus.log[0].t_us);
+    TEST_ASSERT_EQUAL_INT64(50 * (int64_t)TICK_US, s_bus.log[49].t_us);
+    trace_fade(true, lg, 50, 1000);
+
+    TEST_ASSERT_EQUAL_UINT16(0, lin[0]);
+    TEST_ASSERT_EQUAL_UINT16(PCA9685_FULL_ON, lin[50]);
+    TEST_ASSERT_EQUAL_UINT16(PCA9685_FULL_ON, lg[50]);
+    for (int i = 1; i <= 50; i++) {
+        TEST_ASSERT_TRUE(lin[i] >= lin[i - 1]);
+        TEST_ASSERT_TRUE(lg[i] >= lg[i - 1]);
+        // Linear: even 20 ms steps of ~82 counts.
+        TEST_ASSERT_TRUE(abs((int)lin[i] - (int)(i * 4096 / 50)) <= 1);
+    }
+    TEST_ASSERT_TRUE(abs((int)lg[25] - 64) <= 2);
+    TEST_ASSERT_TRUE(lg[10] < lin[10] / 10);
+}
+
+// Every channel animated (as breath/candle do) for one second of ticks.
+static float animated_load(int n_chips, uint32_t *bytes_per_s) {
+    TEST_ASSERT_EQUAL(ESP_OK, pca9685_mock_start(&s_bus, n_chips));
+    pca9685_mock_clear_log(&s_bus);
+    int64_t t0 = s_bus.now_us;
+    for (int tick = 0; tick < 1000000 / TICK_US; tick++) {
+        for (int ch = 0; ch < n_chips * PCA9685_CHANNELS; ch++) {
+            pca9685_set_counts(ch, (uint16_t)((tick * 37 + ch * 101) % 4000 + 1));
+        }
+        pca9685_flush();
+        pca9685_mock_advance_us(&s_bus, TICK_US);
+    }
+    *bytes_per_s = pca9685_mock_bytes(&s_bus, t0, t0 + 1000000);
+    return pca9685_mock_utilization(&s_bus, t0, t0 + 1000000);
+}
+
+// The one bus-load bench: shadow batching sends one burst per chip per
+// tick, where per-channel writes cost a 5-byte transaction each (800/s for
+// 16 channels).
+TEST_CASE("pca9685 mock bus utilization per second", "[pwm][bench]") {
+    uint32_t bytes = 0;
+    float one = animated_load(1, &bytes);
+    printf("16 animated channels @ 50 Hz: %u transactions/s, %u B/s, %.1f%% of 400 kHz\n",
+           (unsigned)s_bus.n_txn, (unsigned)bytes, one * 100.0f);
+    // One 64-byte burst per tick: 50 x (addr + reg + 64) bytes at 9 bits each.
+    TEST_ASSERT_EQUAL_UINT32(50, s_bus.n_txn);
+    TEST_ASSERT_EQUAL_UINT32(50 * 65, bytes);
+    TEST_ASSERT_TRUE(fabsf(one - 50 * (9 * 66 + 2) / 400000.0f) < 0.002f);
+
+    float four = animated_load(4, &bytes);
+    printf("64 animated channels @ 50 Hz: %u transactions/s, %u B/s, %.1f%% of 400 kHz\n",
+           (unsigned)s_bus.n_txn, (unsigned)bytes, four * 100.0f);
+    TEST_ASSERT_EQUAL_UINT32(50 * 4, s_bus.n_txn);
+    TEST_ASSERT_TRUE(four < 0.5f);
+
+    float eight = animated_load(8, &bytes);
+    printf("128 animated channels @ 50 Hz: %u transactions/s, %u B/s, %.1f%% of 400 kHz\n",
+           (unsigned)s_bus.n_txn, (unsigned)bytes, eight * 100.0f);
+    TEST_ASSERT_EQUAL_UINT32(50 * 8, s_bus.n_txn);
+    TEST_ASSERT_TRUE(eight > 7.9f * one && eight < 8.1f * one);
+    TEST_ASSERT_TRUE(eight < 1.0f);
+}
@@ -0,0 +1,374 @@
+#include "unity.h"
+#include "pixel_stream.h"
+#include "dmx_personality.h"
+#include "esp_timer.h"
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CHANNELS     8
+#define PIXELS       680        // 4 universes of 170 RGB pixels
+#define FRAMES       40
+#define CH_BYTES     (PIXELS * 3)
+#define DDP_CHUNK    1440       // 480 RGB pixels, the usual DDP payload
+
+static uint8_t s_pkt[1500];
+
+static uint8_t pattern(int frame, int ch, int byte) {
+    return (uint8_t)(frame * 7 + ch * 31 + byte);
+}
+
+static void map_all(void) {
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        pixel_stream_map_t m = {
+            .n_pixels = PIXELS,
+            .universe = (uint16_t)(1 + ch * 4),
+            .ddp_offset = (uint32_t)ch * CH_BYTES
+        };
+        TEST_ASSERT_EQUAL(ESP_OK, pixel_stream_set_map(ch, &m));
+    }
+}
+
+static void unmap_all(void) {
+    pixel_stream_map_t off = {0};
+    for (int ch = 0; ch < PIXEL_STREAM_CHANNELS; ch++) {
+        pixel_stream_set_map(ch, &off);
+    }
+}
+
+static size_t ddp_packet(int frame, uint32_t offset, uint32_t len, bool push) {
+    memset(s_pkt, 0, 10);
+    s_pkt[0] = 0x40 | (push ? 0x01 : 0);
+    s_pkt[1] = (uint8_t)(frame % 15 + 1);
+    s_pkt[2] = 0x0B;
+    s_pkt[3] = 1;
+    s_pkt[4] = (uint8_t)(offset >> 24); s_pkt[5] = (uint8_t)(offset >> 16);
+    s_pkt[6] = (uint8_t)(offset >> 8);  s_pkt[7] = (uint8_t)offset;
+    s_pkt[8] = (uint8_t)(len >> 8);     s_pkt[9] = (uint8_t)len;
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t a = offset + i;
+        s_pkt[10 + i] = pattern(frame, (int)(a / CH_BYTES), (int)(a % CH_BYTES));
+    }
+    return 10 + len;
+}
+
+static size_t e131_packet(int frame, uint16_t universe, uint16_t sync_addr) {
+    static const uint8_t acn[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    memset(s_pkt, 0, 126);
+    s_pkt[1] = 0x10;
+    memcpy(s_pkt + 4, acn, sizeof(acn));
+    s_pkt[21] = 0x04;                        // root: data
+    s_pkt[43] = 0x02;                        // framing: data
+    s_pkt[108] = 100;
+    s_pkt[109] = (uint8_t)(sync_addr >> 8); s_pkt[110] = (uint8_t)sync_addr;
+    s_pkt[111] = (uint8_t)frame;
+    s_pkt[113] = (uint8_t)(universe >> 8);  s_pkt[114] = (uint8_t)universe;
+    s_pkt[117] = 0x02;
+    s_pkt[118] = 0xA1;
+    s_pkt[122] = 1;
+    s_pkt[123] = (uint8_t)(511 >> 8);       s_pkt[124] = (uint8_t)(511 & 0xFF);
+    int ch = (universe - 1) / 4, k = (universe - 1) % 4;
+    for (int i = 0; i < 510; i++) {
+        s_pkt[126 + i] = pattern(frame, ch, k * 510 + i);
+    }
+    return 126 + 510;
+}
+
+static size_t e131_sync(uint16_t sync_addr) {
+    static const uint8_t acn[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    memset(s_pkt, 0, 49);
+    s_pkt[1] = 0x10;
+    memcpy(s_pkt + 4, acn, sizeof(acn));
+    s_pkt[21] = 0x08;                        // root: extended
+    s_pkt[43] = 0x01;                        // framing: sync
+    s_pkt[45] = (uint8_t)(sync_addr >> 8);  s_pkt[46] = (uint8_t)sync_addr;
+    return 49;
+}
+
+static size_t artnet_packet(int frame, uint16_t port) {
+    memcpy(s_pkt, "Art-Net", 8);
+    s_pkt[8] = 0x00; s_pkt[9] = 0x50;        // OpDmx, little-endian
+    s_pkt[10] = 0; s_pkt[11] = 14;
+    s_pkt[12] = (uint8_t)frame;
+    s_pkt[13] = 0;
+    s_pkt[14] = (uint8_t)port;
+    s_pkt[15] = (uint8_t)(port >> 8);
+    s_pkt[16] = 510 >> 8; s_pkt[17] = 510 & 0xFF;
+    int ch = (port - 1) / 4, k = (port - 1) % 4;
+    for (int i = 0; i < 510; i++) {
+        s_pkt[18 + i] = pattern(frame, ch, k * 510 + i);
+    }
+    return 18 + 510;
+}
+
+static size_t artsync_packet(void) {
+    memcpy(s_pkt, "Art-Net", 8);
+    s_pkt[8] = 0x00; s_pkt[9] = 0x52;
+    s_pkt[10] = 0; s_pkt[11] = 14;
+    s_pkt[12] = 0; s_pkt[13] = 0;
+    return 14;
+}
+
+static void check_frame(int frame) {
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        px_rgba_t *px = NULL;
+        uint16_t n = 0;
+        TEST_ASSERT_TRUE(pixel_stream_take(ch, 0, &px, &n, NULL));
+        TEST_ASSERT_EQUAL(PIXELS, n);
+        for (int i = 0; i < PIXELS; i += 37) {
+            TEST_ASSERT_EQUAL_UINT8(pattern(frame, ch, i * 3 + 0), px[i].r);
+            TEST_ASSERT_EQUAL_UINT8(pattern(frame, ch, i * 3 + 1), px[i].g);
+            TEST_ASSERT_EQUAL_UINT8(pattern(frame, ch, i * 3 + 2), px[i].b);
+        }
+        TEST_ASSERT_EQUAL_UINT8(pattern(frame, ch, CH_BYTES - 1), px[PIXELS - 1].b);
+        TEST_ASSERT_FALSE(pixel_stream_take(ch, 0, &px, &n, NULL));
+    }
+}
+
+typedef struct {
+    int tx, rx;
+    struct sockaddr_in to;
+    int64_t handle_us;
+    int packets;
+} loopback_t;
+
+static void loopback_open(loopback_t *lb) {
+    memset(lb, 0, sizeof(*lb));
+    lb->rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    lb->tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    TEST_ASSERT_TRUE(lb->rx >= 0 && lb->tx >= 0);
+    lb->to.sin_family = AF_INET;
+    lb->to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(lb->rx, (struct sockaddr *)&lb->to, sizeof(lb->to)));
+    socklen_t alen = sizeof(lb->to);
+    getsockname(lb->rx, (struct sockaddr *)&lb->to, &alen);
+    int rcvbuf = 256 * 1024;
+    setsockopt(lb->rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(lb->rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static void loopback_close(loopback_t *lb) {
+    close(lb->rx);
+    close(lb->tx);
+}
+
+static void send_pkt(loopback_t *lb, size_t len) {
+    TEST_ASSERT_EQUAL((int)len, sendto(lb->tx, s_pkt, len, 0, (struct sockaddr *)&lb->to, sizeof(lb->to)));
+}
+
+// Receives n datagrams and feeds them to the decoder, timing only the
+// decoder.
+static void pump(loopback_t *lb, pixel_stream_proto_t proto, int n) {
+    static uint8_t rx[1500];
+    for (int i = 0; i < n; i++) {
+        int len = recv(lb->rx, rx, sizeof(rx), 0);
+        TEST_ASSERT_TRUE(len > 0);
+        int64_t t0 = esp_timer_get_time();
+        TEST_ASSERT_TRUE(pixel_stream_handle(proto, rx, (size_t)len, 0));
+        lb->handle_us += esp_timer_get_time() - t0;
+        lb->packets++;
+    }
+}
+
+TEST_CASE("pixel stream ingests 8x680 px at 40 fps over UDP", "[stream]") {
+    static const char *NAMES[] = { "DDP", "E1.31", "Art-Net" };
+    map_all();
+    for (int proto = 0; proto < PIXEL_STREAM_PROTOS; proto++) {
+        pixel_stream_stats_t before;
+        pixel_stream_get_stats(&before);
+        loopback_t lb;
+        loopback_open(&lb);
+        for (int f = 0; f < FRAMES; f++) {
+            int sent = 0;
+            if (proto == PIXEL_STREAM_DDP) {
+                const uint32_t total = CHANNELS * CH_BYTES;
+                for (uint32_t off = 0; off < total; off += DDP_CHUNK, sent++) {
+                    uint32_t len = total - off < DDP_CHUNK ? total - off : DDP_CHUNK;
+                    send_pkt(&lb, ddp_packet(f, off, len, off + len == total));
+                }
+            } else {
+                for (uint16_t u = 1; u <= CHANNELS * 4; u++, sent++) {
+                    send_pkt(&lb, proto == PIXEL_STREAM_E131 ? e131_packet(f, u, 0) : artnet_packet(f, u));
+                }
+            }
+            pump(&lb, (pixel_stream_proto_t)proto, sent);
+            check_frame(f);
+        }
+        loopback_close(&lb);
+
+        pixel_stream_stats_t after;
+        pixel_stream_get_stats(&after);
+        TEST_ASSERT_EQUAL_UINT32(FRAMES * CHANNELS, after.frames - before.frames);
+        TEST_ASSERT_EQUAL_UINT32(0, after.dropped - before.dropped);
+        TEST_ASSERT_EQUAL_UINT32(0, after.bad - before.bad);
+        float us_per_frame = (float)lb.handle_us / FRAMES;
+        printf("%s: %d packets, %.0f us decode per %d px frame (budget 25000)\n",
+               NAMES[proto], lb.packets, us_per_frame, CHANNELS * PIXELS);
+        TEST_ASSERT_TRUE(us_per_frame < 5000.0f);
+    }
+    unmap_all();
+}
+
+static int frame_of(const px_rgba_t *px) {
+    for (int f = 0; f < 16; f++) {
+        if (px[0].r == pattern(f, 0, 0) && px[0].g == pattern(f, 0, 1)) return f;
+    }
+    return -1;
+}
+
+TEST_CASE("pixel stream jitter buffer orders, paces and conceals", "[stream]") {
+    pixel_stream_map_t m = { .n_pixels = PIXELS, .latency_ms = 50, .conceal_blend = true };
+    TEST_ASSERT_EQUAL(ESP_OK, pixel_stream_set_map(0, &m));
+    pixel_stream_stats_t before;
+    pixel_stream_get_stats(&before);
+
+    // 40 fps source, frame f sent at 25 f ms: 5 overtakes 4, 6 is lost and
+    // 8 arrives 60 ms behind.
+    static const struct { int frame; uint32_t at_ms; } RX[] = {
+        { 0, 0 }, { 1, 25 }, { 2, 50 }, { 3, 75 }, { 5, 125 }, { 4, 130 }, { 7, 175 }, { 8, 260 }
+    };
+    // Played 50 ms after the schedule, evenly; the lost slot is a blend of
+    // 5 and 7, which the pattern (linear in f) makes equal to frame 6.
+    static const struct { int frame; uint32_t at_ms; } OUT[] = {
+        { 0, 50 }, { 1, 75 }, { 2, 100 }, { 3, 125 }, { 4, 150 }, { 5, 175 },
+        { 6, 200 }, { 7, 225 }, { 8, 260 }
+    };
+    const int n_rx = sizeof(RX) / sizeof(RX[0]);
+    const int n_out = sizeof(OUT) / sizeof(OUT[0]);
+
+    int next = 0, shown = 0;
+    for (uint32_t t = 0; t <= 300; t += 5) {
+        while (next < n_rx && RX[next].at_ms == t) {
+            pixel_stream_handle(PIXEL_STREAM_DDP, s_pkt, ddp_packet(RX[next].frame, 0, DDP_CHUNK, true), t);
+            next++;
+        }
+        px_rgba_t *px;
+        uint16_t n;
+        uint32_t wait;
+        bool out = pixel_stream_take(0, t, &px, &n, &wait);
+        if (t == 0) {
+            TEST_ASSERT_FALSE(out);
+            TEST_ASSERT_EQUAL_UINT32(50, wait);
+        }
+        if (out) {
+            TEST_ASSERT_TRUE(shown < n_out);
+            TEST_ASSERT_EQUAL(OUT[shown].frame, frame_of(px));
+            TEST_ASSERT_EQUAL_UINT32(OUT[shown].at_ms, t);
+            shown++;
+        }
+    }
+    TEST_ASSERT_EQUAL(n_out, shown);
+
+    pixel_stream_stats_t after;
+    pixel_stream_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT32(1, after.late - before.late);
+    TEST_ASSERT_EQUAL_UINT32(1, after.concealed - before.concealed);
+    TEST_ASSERT_EQUAL_UINT32(0, after.dropped - before.dropped);
+    TEST_ASSERT_EQUAL_UINT32(8, after.ch[0].shown);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, 25.0f, after.ch[0].period_ms);
+
+    // No latency: one queued frame, a newer latch replaces it.
+    m.latency_ms = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, pixel_stream_set_map(0, &m));
+    for (int f = 0; f < 3; f++) {
+        pixel_stream_handle(PIXEL_STREAM_DDP, s_pkt, ddp_packet(f, 0, DDP_CHUNK, true), 1000);
+    }
+    px_rgba_t *px;
+    uint16_t n;
+    TEST_ASSERT_TRUE(pixel_stream_take(0, 1000, &px, &n, NULL));
+    TEST_ASSERT_EQUAL(2, frame_of(px));
+    pixel_stream_get_stats(&before);
+    TEST_ASSERT_EQUAL_UINT32(2, before.ch[0].dropped);
+    unmap_all();
+}
+
+TEST_CASE("pixel stream latches on E1.31 sync and ArtSync", "[stream]") {
+    map_all();
+    px_rgba_t *px;
+    uint16_t n;
+
+    // sACN with sync address 7: nothing shows until the sync packet.
+    for (uint16_t u = 1; u <= 4; u++) {
+        TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_packet(1, u, 7), 0));
+    }
+    TEST_ASSERT_FALSE(pixel_stream_take(0, 0, &px, &n, NULL));
+    TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_sync(9), 0));
+    TEST_ASSERT_FALSE(pixel_stream_take(0, 0, &px, &n, NULL));
+    TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_sync(7), 0));
+    TEST_ASSERT_TRUE(pixel_stream_take(0, 0, &px, &n, NULL));
+    TEST_ASSERT_EQUAL_UINT8(pattern(1, 0, 0), px[0].r);
+
+    // Art-Net: once ArtSync is seen, the last universe no longer latches.
+    TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, artsync_packet(), 1000));
+    for (uint16_t u = 5; u <= 8; u++) {
+        TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, artnet_packet(2, u), 1010));
+    }
+    TEST_ASSERT_FALSE(pixel_stream_take(1, 1020, &px, &n, NULL));
+    TEST_ASSERT_TRUE(pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, artsync_packet(), 1020));
+    TEST_ASSERT_TRUE(pixel_stream_take(1, 1020, &px, &n, NULL));
+    TEST_ASSERT_EQUAL_UINT8(pattern(2, 1, 509), px[169].b);
+    // ...and after 4 s without ArtSync it does again.
+    for (uint16_t u = 5; u <= 8; u++) {
+        pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, artnet_packet(3, u), 6000);
+    }
+    TEST_ASSERT_TRUE(pixel_stream_take(1, 6000, &px, &n, NULL));
+
+    // DDP without PUSH waits; a data-less PUSH latches.
+    pixel_stream_handle(PIXEL_STREAM_DDP, s_pkt, ddp_packet(4, 0, DDP_CHUNK, false), 0);
+    TEST_ASSERT_FALSE(pixel_stream_take(0, 0, &px, &n, NULL));
+    pixel_stream_handle(PIXEL_STREAM_DDP, s_pkt, ddp_packet(4, 0, 0, true), 0);
+    TEST_ASSERT_TRUE(pixel_stream_take(0, 0, &px, &n, NULL));
+    TEST_ASSERT_EQUAL_UINT8(pattern(4, 0, 3), px[1].r);
+
+    // Garbage is counted, not decoded.
+    pixel_stream_stats_t st;
+    pixel_stream_get_stats(&st);
+    memset(s_pkt, 0xAB, 64);
+    TEST_ASSERT_FALSE(pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, 64, 0));
+    TEST_ASSERT_FALSE(pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, 64, 0));
+    pixel_stream_stats_t st2;
+    pixel_stream_get_stats(&st2);
+    TEST_ASSERT_EQUAL_UINT32(st.bad + 2, st2.bad);
+    unmap_all();
+}
+
+static uint16_t s_dmx_universe, s_dmx_n;
+static int      s_dmx_calls;
+
+static void count_dmx(uint16_t universe, const uint8_t *slots, uint16_t n) {
+    s_dmx_calls++;
+    s_dmx_universe = universe;
+    s_dmx_n = n;
+    dmx_personality_apply(universe, slots, n);
+}
+
+TEST_CASE("pixel stream hands unmapped universes to the DMX personality", "[stream][dmx]") {
+    map_all();   // universes 1..32 are pixels
+    dmx_slot_map_t m = { .universe = 31, .slot = 2, .field = DMX_FIELD_LEVEL8, .ch = 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, dmx_personality_set(&m, 1));
+    pixel_stream_set_dmx(count_dmx, 31, 4);
+    dmx_personality_stats_t before, after;
+    dmx_personality_get_stats(&before);
+
+    s_dmx_calls = 0;
+    pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_packet(0, 31, 0), 0);   // pixels win
+    pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_packet(0, 40, 0), 0);   // out of range
+    TEST_ASSERT_EQUAL(0, s_dmx_calls);
+
+    pixel_stream_map_t off = {0};
+    pixel_stream_set_map(7, &off);   // frees universes 29..32
+    pixel_stream_handle(PIXEL_STREAM_E131, s_pkt, e131_packet(0, 31, 0), 0);
+    pixel_stream_handle(PIXEL_STREAM_ARTNET, s_pkt, artnet_packet(0, 31), 0);
+    TEST_ASSERT_EQUAL(2, s_dmx_calls);
+    TEST_ASSERT_EQUAL(31, s_dmx_universe);
+    TEST_ASSERT_EQUAL(510, s_dmx_n);
+    dmx_personality_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT32(1, after.pwm_writes - before.pwm_writes);
+    TEST_ASSERT_EQUAL_UINT32(1, after.unchanged - before.unchanged);
+
+    pixel_stream_set_dmx(NULL, 0, 0);
+    dmx_personality_set(NULL, 0);
+    unmap_all();
+}
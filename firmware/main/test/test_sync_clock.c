@@ -0,0 +1,120 @@
+#include "unity.h"
+#include "sync_clock.h"
+#include "sync_protocol.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TICK_US      50000          // master tick interval
+#define RUN_US       60000000LL
+#define SETTLE_US    2000000LL      // acquisition, excluded from the slip bound
+
+static uint32_t s_rng = 12345;
+
+static float rnd01(void) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return (s_rng >> 8) / 16777216.0f;
+}
+
+// One-way Wi-Fi delay: a floor, an exponential tail and occasional
+// retransmission spikes of tens of ms.
+static int64_t wifi_delay_us(void) {
+    float d = 300.0f - 1500.0f * logf(1.0f - rnd01());
+    if (rnd01() < 0.03f) d += 20000.0f + 60000.0f * rnd01();
+    return (int64_t)d;
+}
+
+typedef struct {
+    sync_clock_t clock;
+    double rate;          // local us per master us
+    int64_t offset_us;    // local clock at master 0
+} slave_t;
+
+static int64_t local_at(const slave_t *s, int64_t master_us) {
+    return s->offset_us + (int64_t)(master_us * s->rate);
+}
+
+// Feeds a master tick stamped with its send time.
+static void deliver(slave_t *s, int64_t master_us) {
+    if (rnd01() < 0.05f) return;   // lost
+    int64_t local_us = local_at(s, master_us + wifi_delay_us());
+    sync_clock_update(&s->clock, master_us, local_us);
+}
+
+TEST_CASE("sync clock holds < 5 ms slip over 60 s at 1% drift", "[sync]") {
+    slave_t fast = { .rate = 1.01, .offset_us = 987654321LL };
+    slave_t slow = { .rate = 0.99, .offset_us = 12345LL };
+    sync_clock_reset(&fast.clock);
+    sync_clock_reset(&slow.clock);
+
+    int64_t worst = 0, worst_pair = 0;
+    for (int64_t t = 0; t <= RUN_US; t += TICK_US) {
+        deliver(&fast, t);
+        deliver(&slow, t);
+        if (t < SETTLE_US) continue;
+        // Sample between ticks too, where only the skew estimate holds it.
+        for (int64_t probe = t; probe < t + TICK_US; probe += TICK_US / 5) {
+            int64_t a = sync_clock_map(&fast.clock, local_at(&fast, probe));
+            int64_t b = sync_clock_map(&slow.clock, local_at(&slow, probe));
+            int64_t ea = llabs(a - probe), eb = llabs(b - probe);
+            if (ea > worst) worst = ea;
+            if (eb > worst) worst = eb;
+            if (llabs(a - b) > worst_pair) worst_pair = llabs(a - b);
+        }
+    }
+    printf("sync clock: worst slip %lld us vs master, %lld us between slaves; skew %.0f / %.0f ppm, %u / %u outliers\n",
+           (long long)worst, (long long)worst_pair, fast.clock.skew * 1e6f, slow.clock.skew * 1e6f,
+           (unsigned)fast.clock.rejected, (unsigned)slow.clock.rejected);
+    TEST_ASSERT_TRUE(fast.clock.locked && slow.clock.locked);
+    TEST_ASSERT_TRUE(worst < 5000);
+    TEST_ASSERT_TRUE(worst_pair < 5000);
+    TEST_ASSERT_TRUE(fabsf(fast.clock.skew - (1.0f / 1.01f - 1.0f)) < 0.0005f);
+    TEST_ASSERT_TRUE(fast.clock.rejected > 0);   // the spikes were gated, not followed
+    TEST_ASSERT_EQUAL_UINT32(0, fast.clock.steps);
+}
+
+TEST_CASE("sync clock steps when the master jumps", "[sync]") {
+    slave_t s = { .rate = 1.0, .offset_us = 5000 };
+    sync_clock_reset(&s.clock);
+    for (int64_t t = 0; t < 5000000; t += TICK_US) {
+        sync_clock_update(&s.clock, t, local_at(&s, t) + 500);
+    }
+    TEST_ASSERT_TRUE(s.clock.locked);
+
+    // Master rebooted: its clock restarts near zero. Ten ticks in a row
+    // disagree, so this is not jitter.
+    int64_t t = 5000000;
+    for (int i = 0; i < 10; i++, t += TICK_US) {
+        sync_clock_update(&s.clock, t - 4000000, local_at(&s, t) + 500);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, s.clock.steps);
+    int64_t now = sync_clock_map(&s.clock, local_at(&s, t));
+    TEST_ASSERT_TRUE(llabs(now - (t - 4000000)) < 2000);
+}
+
+TEST_CASE("sync roles parse by name and a standalone node runs on local time", "[sync]") {
+    sync_role_t role;
+    TEST_ASSERT_TRUE(sync_role_parse("slave", &role));
+    TEST_ASSERT_EQUAL(SYNC_ROLE_SLAVE, role);
+    TEST_ASSERT_TRUE(sync_role_parse("Master", &role));
+    TEST_ASSERT_EQUAL(SYNC_ROLE_MASTER, role);
+    TEST_ASSERT_FALSE(sync_role_parse("boss", &role));
+    TEST_ASSERT_EQUAL_STRING("Standalone", sync_role_name(SYNC_ROLE_STANDALONE));
+
+    TEST_ASSERT_EQUAL(ESP_OK, sync_protocol_set_role(SYNC_ROLE_MASTER));
+    TEST_ASSERT_EQUAL(SYNC_ROLE_MASTER, sync_protocol_get_role());
+    // A master publishes an external beat as its show state.
+    float phase = 0.f;
+    TEST_ASSERT_TRUE(sync_protocol_follow_beat(1.25f, 120.f));
+    TEST_ASSERT_TRUE(sync_protocol_beat_phase(sync_now_us(), &phase));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.25f, phase);
+    TEST_ASSERT_TRUE(sync_protocol_beat_phase(sync_now_us() + 250000, &phase));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.75f, phase);
+    TEST_ASSERT_EQUAL(ESP_OK, sync_protocol_set_role(SYNC_ROLE_STANDALONE));
+    TEST_ASSERT_FALSE(sync_protocol_follow_beat(0.5f, 90.f));
+    TEST_ASSERT_EQUAL(SYNC_ROLE_STANDALONE, sync_protocol_get_role());
+    TEST_ASSERT_TRUE(llabs(sync_now_us() - esp_timer_get_time()) < 1000);
+}
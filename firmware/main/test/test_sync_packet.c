@@ -0,0 +1,133 @@
+#include "unity.h"
+#include "sync_packet.h"
+#include <math.h>
+#include <string.h>
+
+TEST_CASE("sync tick packet round-trips header and show state", "[sync]") {
+    sync_show_t show = { .ref_us = 1000000, .beat_phase = 0.25f, .tempo_bpm = 128.0f, .scene_gen = 7 };
+    sync_tick_packet_t pkt;
+    size_t len = sync_packet_encode_tick(&pkt, 0xFFFFFFF0u, 1000000, &show);
+    TEST_ASSERT_EQUAL(28, len);
+    TEST_ASSERT_EQUAL(sizeof(sync_tick_packet_t), len);
+
+    uint8_t wire[sizeof(pkt)];
+    memcpy(wire, &pkt, len);
+    sync_header_t hdr;
+    TEST_ASSERT_EQUAL(SYNC_PACKET_TICK, sync_packet_decode(wire, len, &hdr));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0u, hdr.seq);
+    TEST_ASSERT_EQUAL_INT64(1000000, hdr.master_us);
+
+    sync_show_t out;
+    sync_packet_tick_show((const sync_tick_packet_t *)wire, &out);
+    TEST_ASSERT_EQUAL_INT64(1000000, out.ref_us);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 65536, 0.25f, out.beat_phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 128.0f, out.tempo_bpm);
+    TEST_ASSERT_EQUAL_UINT32(7, out.scene_gen);
+}
+
+TEST_CASE("sync decode drops foreign, old-version and short packets", "[sync]") {
+    sync_tick_packet_t pkt;
+    sync_packet_encode_tick(&pkt, 1, 0, NULL);
+    sync_header_t hdr;
+
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&pkt, sizeof(pkt) - 1, &hdr));
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&pkt, 4, &hdr));
+
+    sync_tick_packet_t bad = pkt;
+    bad.hdr.version = 1;
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&bad, sizeof(bad), &hdr));
+    bad = pkt;
+    bad.hdr.magic = 0x7B22;   // '{"', the old JSON packets
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&bad, sizeof(bad), &hdr));
+    bad = pkt;
+    bad.hdr.type = 9;
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&bad, sizeof(bad), &hdr));
+}
+
+TEST_CASE("sync beat phase extrapolates identically from any tick", "[sync]") {
+    // 120 BPM: half a second per beat.
+    sync_show_t master = { .ref_us = 0, .beat_phase = 0.1f, .tempo_bpm = 120.0f };
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.1f, sync_show_phase(&master, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.6f, sync_show_phase(&master, 250000));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.1f, sync_show_phase(&master, 500000));
+
+    // A slave that took a tick an hour in must agree with the master.
+    const int64_t hour = 3600LL * 1000000;
+    sync_tick_packet_t pkt;
+    sync_packet_encode_tick(&pkt, 1, hour + 12345, &master);
+    sync_show_t slave;
+    sync_packet_tick_show(&pkt, &slave);
+    for (int64_t t = hour + 12345; t < hour + 2000000; t += 16667) {
+        float d = fabsf(sync_show_phase(&slave, t) - sync_show_phase(&master, t));
+        if (d > 0.5f) d = 1.0f - d;
+        TEST_ASSERT_TRUE(d < 1e-3f);
+    }
+
+    // Without tempo the phase holds.
+    sync_show_t still = { .ref_us = 0, .beat_phase = 0.75f };
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.75f, sync_show_phase(&still, 10000000));
+}
+
+TEST_CASE("sync peer stats count loss, reorder, duplicates and restarts", "[sync]") {
+    sync_peer_stats_t p;
+    memset(&p, 0, sizeof(p));
+    const int64_t tick = 16667;
+
+    // 0..9 with 3 and 4 lost, 6 arriving after 7, 8 twice.
+    const uint32_t seqs[] = {0, 1, 2, 5, 7, 6, 8, 8, 9};
+    int fresh = 0;
+    for (size_t i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+        int64_t master = 5000000 + seqs[i] * tick;
+        fresh += sync_peer_update(&p, seqs[i], master, master + 40000);
+    }
+    TEST_ASSERT_EQUAL(8, fresh);
+    TEST_ASSERT_EQUAL_UINT32(8, p.received);
+    TEST_ASSERT_EQUAL_UINT32(2, p.lost);
+    TEST_ASSERT_EQUAL_UINT32(1, p.reordered);
+    TEST_ASSERT_EQUAL_UINT32(1, p.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(9, p.max_seq);
+    // Constant transit: no jitter.
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, p.jitter_us);
+
+    // Transit alternating by 2 ms converges on ~2 ms of jitter.
+    for (uint32_t s = 10; s < 400; s++) {
+        int64_t master = 5000000 + s * tick;
+        sync_peer_update(&p, s, master, master + 40000 + (s & 1) * 2000);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(100.0f, 2000.0f, p.jitter_us);
+
+    // Master reboots: sequence restarts at 0, counters start over.
+    TEST_ASSERT_TRUE(sync_peer_update(&p, 0, 100, 20000000));
+    TEST_ASSERT_EQUAL_UINT32(1, p.restarts);
+    TEST_ASSERT_EQUAL_UINT32(1, p.received);
+    TEST_ASSERT_EQUAL_UINT32(0, p.lost);
+}
+
+TEST_CASE("sync cue packet carries target, preset, CRC and t0", "[sync]") {
+    sync_cue_t cue = {
+        .cue_id = 0xC0FFEE,
+        .t0_us = 86400LL * 1000000 + 250000,
+        .fade_ms = 500,
+        .preset_crc = 0x12345678
+    };
+    strcpy(cue.target, "group:stage_left");
+    strcpy(cue.preset, "ocean");
+
+    sync_cue_packet_t pkt;
+    size_t len = sync_packet_encode_cue(&pkt, 42, 86400LL * 1000000, &cue);
+    sync_header_t hdr;
+    TEST_ASSERT_EQUAL(SYNC_PACKET_CUE, sync_packet_decode(&pkt, len, &hdr));
+    TEST_ASSERT_EQUAL_UINT32(42, hdr.seq);
+    TEST_ASSERT_EQUAL(0, sync_packet_decode(&pkt, sizeof(sync_tick_packet_t), &hdr));
+
+    // Unterminated names from the wire come out terminated.
+    memset(pkt.preset, 'x', sizeof(pkt.preset));
+    sync_cue_t out;
+    sync_packet_cue(&pkt, &out);
+    TEST_ASSERT_EQUAL_UINT32(0xC0FFEE, out.cue_id);
+    TEST_ASSERT_EQUAL_INT64(cue.t0_us, out.t0_us);
+    TEST_ASSERT_EQUAL_UINT32(500, out.fade_ms);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, out.preset_crc);
+    TEST_ASSERT_EQUAL_STRING("group:stage_left", out.target);
+    TEST_ASSERT_EQUAL(SYNC_CUE_NAME_LEN - 1, strlen(out.preset));
+}
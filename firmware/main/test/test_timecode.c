@@ -0,0 +1,369 @@
+#include "unity.h"
+#include "timecode.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN_US      20000000LL
+#define SETTLE_US   2000000LL      // acquisition, excluded from the error bound
+
+static uint32_t s_rng = 4242;
+
+static float rnd01(void) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return (s_rng >> 8) / 16777216.0f;
+}
+
+// Network delay: a floor, an exponential tail and occasional spikes of
+// tens of ms. Packets stay in order, so a spike holds up the ones behind.
+static int64_t net_delay_us(void) {
+    float d = 300.0f - 1500.0f * logf(1.0f - rnd01());
+    if (rnd01() < 0.03f) d += 20000.0f + 40000.0f * rnd01();
+    return (int64_t)d;
+}
+
+// A timecode source sending quarter frames at a steady cadence: number q
+// leaves at local q * frame / 4 / speed, when the source is at base +
+// q * frame / 4. Each pair of frames carries the label of its first.
+typedef struct {
+    tc_fps_t      fps;
+    double        speed;         // source us per local us
+    int64_t       base_us;       // source position at local 0
+    int64_t       q;
+    int64_t       last_rx_us;
+    float         loss;
+    mtc_decoder_t dec;
+    tc_chase_t    chase;
+} mtc_gen_t;
+
+static double frame_us(tc_fps_t fps) {
+    return fps == TC_FPS_2997DF ? 1001000.0 / 30 : 1e6 / tc_fps_base(fps);
+}
+
+static int64_t gen_local_us(const mtc_gen_t *g, int64_t q) {
+    return llround(q * frame_us(g->fps) / 4 / g->speed);
+}
+
+static int64_t gen_truth_us(const mtc_gen_t *g, int64_t local_us) {
+    return g->base_us + llround(local_us * g->speed);
+}
+
+static void gen_init(mtc_gen_t *g, tc_fps_t fps, double speed, const tc_label_t *start) {
+    memset(g, 0, sizeof(*g));
+    g->fps = fps;
+    g->speed = speed;
+    g->base_us = tc_label_to_us(start, fps);
+    g->loss = 0.02f;
+    tc_chase_reset(&g->chase, TC_FREEWHEEL_MS);
+}
+
+static void qf_msg(const tc_label_t *l, tc_fps_t fps, int piece, uint8_t msg[2]) {
+    const uint8_t v[8] = {
+        l->f & 0x0F, l->f >> 4, l->s & 0x0F, l->s >> 4,
+        l->m & 0x0F, l->m >> 4, l->h & 0x0F, (uint8_t)(l->h >> 4 | fps << 1)
+    };
+    msg[0] = 0xF1;
+    msg[1] = (uint8_t)(piece << 4 | v[piece]);
+}
+
+// Sends until local until_us (dropping everything if lost); returns the
+// worst playhead error seen at arrivals from check_us on.
+static int64_t gen_run(mtc_gen_t *g, int64_t until_us, bool lost, int64_t check_us) {
+    int64_t worst = 0;
+    for (; gen_local_us(g, g->q) < until_us; g->q++) {
+        int piece = (int)(g->q % 8);
+        int64_t pair_q = g->q - piece;
+        tc_label_t label;
+        tc_us_to_label(g->base_us + llround(pair_q * frame_us(g->fps) / 4), g->fps, &label);
+        uint8_t msg[2];
+        qf_msg(&label, g->fps, piece, msg);
+        if (lost || rnd01() < g->loss) continue;
+
+        int64_t rx = gen_local_us(g, g->q) + net_delay_us();
+        if (rx < g->last_rx_us) rx = g->last_rx_us;
+        g->last_rx_us = rx;
+        int64_t pos;
+        if (rx >= check_us && tc_chase_playhead(&g->chase, rx, &pos) != TC_STOPPED) {
+            int64_t err = llabs(pos - gen_truth_us(g, rx));
+            if (err > worst) worst = err;
+        }
+        mtc_event_t ev;
+        if (mtc_decode(&g->dec, msg, 2, &ev)) {
+            TEST_ASSERT_EQUAL(MTC_RUNNING, ev.kind);
+            TEST_ASSERT_EQUAL(g->fps, ev.fps);
+            tc_chase_feed(&g->chase, ev.pos_us, rx);
+        }
+    }
+    return worst;
+}
+
+TEST_CASE("timecode chase locks to jittered MTC at 25, 29.97df and 30 fps", "[timecode]") {
+    static const struct {
+        tc_fps_t fps;
+        double   speed;
+    } runs[] = {
+        { TC_FPS_25, 1.0 },
+        { TC_FPS_2997DF, 1.0 },
+        { TC_FPS_30, 1.0 },
+        { TC_FPS_30, 0.999 },        // 29.97 non-drop video labelled 30
+    };
+    const tc_label_t start = { 1, 9, 50, 0 };   // crosses drop-frame minutes
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        mtc_gen_t g;
+        gen_init(&g, runs[i].fps, runs[i].speed, &start);
+        int64_t worst = gen_run(&g, RUN_US, false, SETTLE_US);
+        printf("timecode chase %s x%.3f: worst %lld us, speed %.5f, jitter %.0f us, %u outliers\n",
+               tc_fps_name(g.fps), g.speed, (long long)worst, 1.0 + g.chase.skew,
+               g.chase.jitter_us, (unsigned)g.chase.outliers);
+        TEST_ASSERT_TRUE(g.chase.state != TC_STOPPED);
+        TEST_ASSERT_TRUE(worst < 8000);              // inside a quarter frame
+        TEST_ASSERT_TRUE(fabs(1.0 + g.chase.skew - g.speed) < 0.0005);
+        TEST_ASSERT_TRUE(g.chase.outliers > 0);   // spikes were gated, not followed
+        TEST_ASSERT_EQUAL_UINT32(0, g.chase.jumps);
+    }
+}
+
+TEST_CASE("timecode chase freewheels through dropouts, resyncs on jumps, parks on locate", "[timecode]") {
+    const tc_label_t start = { 0, 0, 0, 0 };
+    mtc_gen_t g;
+    gen_init(&g, TC_FPS_25, 1.0, &start);
+    gen_run(&g, 10000000, false, 0);
+    TEST_ASSERT_EQUAL(TC_LOCKED, g.chase.state);
+
+    // A second without timecode: freewheel, close to the source throughout.
+    gen_run(&g, 11000000, true, 0);
+    int64_t pos;
+    TEST_ASSERT_EQUAL(TC_FREEWHEEL, tc_chase_playhead(&g.chase, 10900000, &pos));
+    TEST_ASSERT_TRUE(llabs(pos - gen_truth_us(&g, 10900000)) < 5000);
+    int64_t worst = gen_run(&g, 13000000, false, 11000000);
+    TEST_ASSERT_TRUE(g.chase.dropouts >= 1);
+    TEST_ASSERT_TRUE(worst < 8000);
+
+    // The source jumps a minute ahead on a pair boundary: a few samples in
+    // a row agree on it, so the playhead follows.
+    while (g.q % 8) g.q++;
+    g.base_us += 60000000;
+    gen_run(&g, 14000000, false, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, g.chase.jumps);
+    worst = gen_run(&g, 16000000, false, 15000000);
+    TEST_ASSERT_TRUE(worst < 8000);
+
+    // Gone for good: freewheel, then stop where freewheeling got to.
+    int64_t last = g.chase.last_rx_us;
+    int64_t stop_at = last + TC_DROPOUT_US + TC_FREEWHEEL_MS * 1000LL;
+    int64_t parked, later;
+    TEST_ASSERT_EQUAL(TC_STOPPED, tc_chase_playhead(&g.chase, stop_at + 5000000, &parked));
+    TEST_ASSERT_EQUAL(TC_STOPPED, tc_chase_playhead(&g.chase, stop_at + 9000000, &later));
+    TEST_ASSERT_EQUAL_INT64(parked, later);
+    TEST_ASSERT_TRUE(llabs(parked - gen_truth_us(&g, stop_at)) < 10000);
+
+    // A full-frame locate parks the playhead on its label.
+    const uint8_t full[] = { 0xF0, 0x7F, 0x7F, 0x01, 0x01, 0x20 | 2, 30, 15, 12, 0xF7 };
+    mtc_event_t ev;
+    TEST_ASSERT_TRUE(mtc_decode(&g.dec, full, sizeof(full), &ev));
+    TEST_ASSERT_EQUAL(MTC_LOCATE, ev.kind);
+    TEST_ASSERT_EQUAL(TC_FPS_25, ev.fps);
+    tc_chase_locate(&g.chase, ev.pos_us, 30000000);
+    TEST_ASSERT_EQUAL(TC_STOPPED, tc_chase_playhead(&g.chase, 31000000, &pos));
+    tc_label_t l = { 2, 30, 15, 12 };
+    TEST_ASSERT_EQUAL_INT64(tc_label_to_us(&l, TC_FPS_25), pos);
+}
+
+TEST_CASE("timecode labels round-trip and OSC label rates are detected", "[timecode]") {
+    // Every drop-frame label over 20 minutes, and none of the skipped ones.
+    tc_label_t prev = { 0, 0, 0, 0 };
+    for (int64_t n = 0; n < 2 * 17982; n++) {
+        int64_t us = llround(n * 1001000.0 / 30);
+        tc_label_t l;
+        tc_us_to_label(us, TC_FPS_2997DF, &l);
+        TEST_ASSERT_EQUAL_INT64(us, tc_label_to_us(&l, TC_FPS_2997DF));
+        if (l.s == 0 && l.m % 10) TEST_ASSERT_TRUE(l.f >= 2);
+        if (n) TEST_ASSERT_TRUE(memcmp(&l, &prev, sizeof(l)) != 0);
+        prev = l;
+    }
+
+    static const tc_fps_t rates[] = { TC_FPS_24, TC_FPS_25, TC_FPS_2997DF, TC_FPS_30 };
+    for (size_t i = 0; i < 4; i++) {
+        tc_rate_detect_t d;
+        tc_rate_reset(&d);
+        const tc_label_t start = { 0, 4, 58, 0 };
+        int64_t at = tc_label_to_us(&start, rates[i]);
+        // Every frame across two minute boundaries, a few lost on the way.
+        for (int n = 0; n < 65 * 30; n++) {
+            tc_label_t l;
+            tc_us_to_label(at + llround(n * frame_us(rates[i])), rates[i], &l);
+            if (rnd01() < 0.05f) continue;
+            tc_rate_observe(&d, &l);
+        }
+        TEST_ASSERT_EQUAL(rates[i], d.fps);
+    }
+}
+
+static void rec_midi(const uint8_t *msg, size_t len, void *ctx) {
+    uint8_t *log = ctx;
+    log[0]++;
+    memcpy(log + 1 + 16 * (log[0] - 1), msg, len < 16 ? len : 16);
+}
+
+TEST_CASE("timecode takes RTP-MIDI command lists and answers AppleMIDI sessions", "[timecode]") {
+    // RTP header, then a short command list: QF, (delta) note on, (delta)
+    // running-status note, (delta) full-frame SysEx.
+    const uint8_t pkt[] = {
+        0x80, 0x61, 0x00, 0x01, 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78,
+        15,
+        0xF1, 0x25,
+        0x00, 0x90, 60, 100,
+        0x81, 0x00, 62, 90,
+        0x00, 0xF0, 0x7F, 0x7F, 0x01, 0x01, 0x61, 0x02, 0x03
+    };
+    // 15 bytes of list end inside the SysEx: malformed.
+    uint8_t log[1 + 16 * 4] = {0};
+    TEST_ASSERT_FALSE(rtp_midi_parse(pkt, sizeof(pkt), rec_midi, log));
+
+    uint8_t full[sizeof(pkt) + 3];
+    memcpy(full, pkt, sizeof(pkt));
+    full[12] = 0x80;                 // long header: B set, 12-bit length
+    memmove(full + 14, pkt + 13, sizeof(pkt) - 13);
+    full[sizeof(full) - 2] = 0x04;
+    full[sizeof(full) - 1] = 0xF7;
+    full[13] = (uint8_t)(sizeof(full) - 14);
+    memset(log, 0, sizeof(log));
+    TEST_ASSERT_TRUE(rtp_midi_parse(full, sizeof(full), rec_midi, log));
+    TEST_ASSERT_EQUAL_UINT8(4, log[0]);
+    const uint8_t qf[] = { 0xF1, 0x25 }, on[] = { 0x90, 60, 100 }, run[] = { 0x90, 62, 90 };
+    TEST_ASSERT_EQUAL_MEMORY(qf, log + 1, 2);
+    TEST_ASSERT_EQUAL_MEMORY(on, log + 17, 3);
+    TEST_ASSERT_EQUAL_MEMORY(run, log + 33, 3);
+    const uint8_t sysex[] = { 0xF0, 0x7F, 0x7F, 0x01, 0x01, 0x61, 0x02, 0x03, 0x04, 0xF7 };
+    TEST_ASSERT_EQUAL_MEMORY(sysex, log + 49, sizeof(sysex));
+
+    mtc_decoder_t dec = {0};
+    mtc_event_t ev;
+    TEST_ASSERT_TRUE(mtc_decode(&dec, log + 49, sizeof(sysex), &ev));
+    TEST_ASSERT_EQUAL(TC_FPS_30, ev.fps);
+    TEST_ASSERT_EQUAL_UINT8(1, ev.label.h);
+    TEST_ASSERT_EQUAL_UINT8(4, ev.label.f);
+    TEST_ASSERT_FALSE(rtp_midi_parse(full, 11, rec_midi, log));   // short header
+
+    // Invitation: OK with the initiator's token and our SSRC and name.
+    const uint8_t in[] = {
+        0xFF, 0xFF, 'I', 'N', 0, 0, 0, 2, 0xAA, 0xBB, 0xCC, 0xDD, 1, 2, 3, 4, 'd', 'a', 'w', 0
+    };
+    uint8_t out[64];
+    TEST_ASSERT_TRUE(applemidi_is_command(in, sizeof(in)));
+    size_t n = applemidi_reply(in, sizeof(in), 0x11223344, "node", 0, out, sizeof(out));
+    TEST_ASSERT_EQUAL(21, n);
+    const uint8_t ok[] = {
+        0xFF, 0xFF, 'O', 'K', 0, 0, 0, 2, 0xAA, 0xBB, 0xCC, 0xDD, 0x11, 0x22, 0x33, 0x44, 'n', 'o', 'd', 'e', 0
+    };
+    TEST_ASSERT_EQUAL_MEMORY(ok, out, sizeof(ok));
+
+    // Clock sync: count 0 in, count 1 out with our time as ts2.
+    uint8_t ck[36] = { 0xFF, 0xFF, 'C', 'K', 1, 2, 3, 4, 0 };
+    ck[19] = 0x77;
+    n = applemidi_reply(ck, sizeof(ck), 0x11223344, "node", 0x0102030405060708ULL, out, sizeof(out));
+    TEST_ASSERT_EQUAL(36, n);
+    TEST_ASSERT_EQUAL_UINT8(1, out[8]);
+    TEST_ASSERT_EQUAL_UINT8(0x77, out[19]);
+    const uint8_t ts2[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    TEST_ASSERT_EQUAL_MEMORY(ts2, out + 20, 8);
+    ck[8] = 2;
+    TEST_ASSERT_EQUAL(0, applemidi_reply(ck, sizeof(ck), 1, "node", 0, out, sizeof(out)));
+}
+
+typedef struct {
+    int     n;
+    char    preset[8][TIMECODE_NAME_LEN];
+    int32_t lead[8];
+    int     listed;                    // cue count the handler could read
+} cue_log_t;
+
+static cue_log_t s_cues;
+
+static void on_cue(const timecode_cue_t *cue, int32_t lead_ms) {
+    // The timeline lock is free while cues fire: this would deadlock.
+    timecode_cue_t list[4];
+    s_cues.listed = timecode_get_cues(list, 4);
+    if (s_cues.n < 8) {
+        strcpy(s_cues.preset[s_cues.n], cue->preset);
+        s_cues.lead[s_cues.n] = lead_ms;
+    }
+    s_cues.n++;
+}
+
+// OSC-style labels every frame at 25 fps from show time from_ms, local
+// time base_us on, stepping the timeline at its own cadence; returns the
+// local time it got to, where the next play carries on.
+static int64_t play(int64_t base_us, uint32_t from_ms, uint32_t for_ms) {
+    int64_t next_run = base_us;
+    for (uint32_t t = 0; t < for_ms; t += 40) {
+        int64_t local = base_us + t * 1000LL;
+        while (next_run <= local) next_run = timecode_run(next_run);
+        tc_label_t l;
+        tc_us_to_label((from_ms + t) * 1000LL, TC_FPS_25, &l);
+        TEST_ASSERT_TRUE(timecode_feed_label(&l, 25.f, false, local));
+    }
+    return base_us + for_ms * 1000LL;
+}
+
+TEST_CASE("timecode timeline preloads cues and chases into the show after a jump", "[timecode]") {
+    const timecode_cue_t cues[] = {
+        { .at_ms = 10000, .target = "ALEDch1", .preset = "c" },
+        { .at_ms = 2000,  .target = "ALEDch1", .preset = "a" },
+        { .at_ms = 5000,  .target = "ALEDch1", .preset = "b" },
+    };
+    timecode_reset();
+    timecode_set_cue_handler(on_cue);
+    TEST_ASSERT_EQUAL(ESP_OK, timecode_set_cues(cues, 3));
+    timecode_cue_t back[4];
+    TEST_ASSERT_EQUAL(3, timecode_get_cues(back, 4));
+    TEST_ASSERT_EQUAL_STRING("a", back[0].preset);
+    TEST_ASSERT_EQUAL_STRING("c", back[2].preset);
+
+    // From 1 s: nothing passed yet, "a" fires ahead of 2 s.
+    memset(&s_cues, 0, sizeof(s_cues));
+    int64_t now = play(1000000000LL, 1000, 3000);
+    TEST_ASSERT_EQUAL(1, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("a", s_cues.preset[0]);
+    TEST_ASSERT_TRUE(s_cues.lead[0] > 0 && s_cues.lead[0] <= TIMECODE_PRELOAD_MS);
+    TEST_ASSERT_EQUAL(3, s_cues.listed);
+
+    // Jump to 7 s: "b" (already passed) sets the look at once.
+    now = play(now, 7000, 1000);
+    TEST_ASSERT_EQUAL(2, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("b", s_cues.preset[1]);
+    TEST_ASSERT_TRUE(s_cues.lead[1] <= 0);
+
+    // A new list leaves what was passed alone.
+    TEST_ASSERT_EQUAL(ESP_OK, timecode_set_cues(cues, 3));
+    now = play(now, 8000, 2500);
+    TEST_ASSERT_EQUAL(3, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("c", s_cues.preset[2]);
+
+    // Stopped: nothing runs, and the next start chases in again.
+    timecode_run(now + 10000000);
+    TEST_ASSERT_EQUAL(3, s_cues.n);
+    now = play(now + 10000000, 6000, 200);
+    TEST_ASSERT_EQUAL(4, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("b", s_cues.preset[3]);
+
+    // Jumps before the chase has settled chase in all the same: to 9 s
+    // ("b" again), then back to 1 s, where "a" comes round again.
+    now = play(now, 9000, 200);
+    TEST_ASSERT_EQUAL(5, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("b", s_cues.preset[4]);
+    now = play(now, 1000, 1200);
+    TEST_ASSERT_EQUAL(6, s_cues.n);
+    TEST_ASSERT_EQUAL_STRING("a", s_cues.preset[5]);
+
+    const timecode_cue_t bad = { .at_ms = 1, .target = "", .preset = "x" };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, timecode_set_cues(&bad, 1));
+    TEST_ASSERT_FALSE(timecode_feed_label(&(tc_label_t){ 0, 0, 0, 25 }, 25.f, false, now));
+    TEST_ASSERT_FALSE(timecode_feed_label(&(tc_label_t){ 0, 0, 0, 0 }, 23.f, false, now));
+    timecode_set_cue_handler(NULL);
+    timecode_set_cues(NULL, 0);
+    timecode_reset();
+}
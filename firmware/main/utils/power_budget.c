@@ -1,18 +1,96 @@
 #include "power_budget.h"
-#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define WINDOW_SLOTS      16
+#define ATTACK_PER_S      8.0f   // scale may drop by this much per second
+#define RELEASE_PER_S     1.0f   // and recover by this much; slow enough not to pump
+
+typedef struct {
+  uint16_t uA_full[4];   // r,g,b,w at code 255
+  uint16_t uA_idle;      // per pixel, LEDs off
+} led_model_t;
+
+// Typical 5 V 5050 parts at 25 C; mA_per_led rescales the color terms.
+static const led_model_t TYPE_MODELS[] = {
+  [LED_WS2812B]     = { {12500, 12000, 12000, 0}, 700 },
+  [LED_SK6812_RGBW] = { {12000, 12000, 12000, 18000}, 1000 },
+};
+
+typedef struct {
+  uint32_t   coef_q8[4];   // uA per code, Q8
+  uint32_t   idle_uA;      // whole channel
+  float      led_mA;       // configured mA_per_led, 0 = type default
+  led_type_t type;
+  uint16_t   n_pixels;
+} chan_model_t;
 
 static power_cfg_t s_cfg = {
-    .per_led_mA = 60.0f,
-    .limit_mA = 8000.0f
+    .limit_mA = 8000.0f,
+    .psu_mA = 10000.0f,
+    .burst_mA = 0.0f,
+    .burst_window_ms = 2000
 };
 
+// Demand, scales and the window are written by the render task only; models,
+// weights and the PWM figure are small values updated by other tasks on
+// config changes and read once per request.
+static chan_model_t s_model[POWER_ALED_CHANNELS];
+static float    s_demand[POWER_ALED_CHANNELS];
+static float    s_target[POWER_ALED_CHANNELS];
+static float    s_hard[POWER_ALED_CHANNELS];
+static float    s_scale[POWER_ALED_CHANNELS] = {1.f,1.f,1.f,1.f,1.f,1.f,1.f,1.f};
+static uint32_t s_last_ms[POWER_ALED_CHANNELS];
+static float    s_weight[POWER_ALED_CHANNELS] = {1.f,1.f,1.f,1.f,1.f,1.f,1.f,1.f};
+static float    s_pwm_mA;
+
+static float    s_slot_mAms[WINDOW_SLOTS];
+static int      s_slot;
+static uint32_t s_slot_start_ms;
+static uint32_t s_window_last_ms;
+static bool     s_window_started;
+
+static const led_model_t* type_model(led_type_t type){
+  return &TYPE_MODELS[type == LED_SK6812_RGBW ? LED_SK6812_RGBW : LED_WS2812B];
+}
+
+static void rebuild_model(chan_model_t *m){
+  const led_model_t *base = type_model(m->type);
+  uint32_t full = base->uA_full[0] + base->uA_full[1] + base->uA_full[2] + base->uA_full[3];
+  uint32_t num = full;
+  if (m->led_mA > 0.f){
+    float colors_uA = m->led_mA * 1000.f - base->uA_idle;
+    num = colors_uA > 0.f ? (uint32_t)colors_uA : 0;
+  }
+  for (int k = 0; k < 4; ++k){
+    uint64_t uA = (uint64_t)base->uA_full[k] * num / full;
+    m->coef_q8[k] = (uint32_t)((uA * 256u + 127u) / 255u);
+  }
+  m->idle_uA = (uint32_t)base->uA_idle * m->n_pixels;
+}
+
+static void window_reset(void){
+  memset(s_slot_mAms, 0, sizeof(s_slot_mAms));
+  s_slot = 0;
+  s_window_started = false;
+}
+
 void power_set_cfg(power_cfg_t cfg){
-    if (cfg.per_led_mA <= 0.f){
-        cfg.per_led_mA = s_cfg.per_led_mA;
-    }
     if (cfg.limit_mA <= 0.f){
         cfg.limit_mA = s_cfg.limit_mA;
     }
+    if (cfg.psu_mA <= 0.f){
+        cfg.psu_mA = s_cfg.psu_mA;
+    }
+    if (cfg.burst_mA < 0.f){
+        cfg.burst_mA = s_cfg.burst_mA;
+    }
+    if (cfg.burst_window_ms < WINDOW_SLOTS){
+        cfg.burst_window_ms = s_cfg.burst_window_ms;
+    }
+    if (cfg.burst_window_ms != s_cfg.burst_window_ms){
+        window_reset();
+    }
     s_cfg = cfg;
 }
 
@@ -20,18 +98,212 @@ const power_cfg_t* power_get_cfg(void){
     return &s_cfg;
 }
 
-float power_scale_for_frame(px_rgba_t* fb,int n,const power_cfg_t* c){
-  if (!fb || n <= 0){
-    return 1.f;
+void power_set_channel_model(int ch, led_type_t type, uint16_t n_pixels){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return;
+  }
+  s_model[ch].type = type;
+  s_model[ch].n_pixels = n_pixels;
+  rebuild_model(&s_model[ch]);
+}
+
+void power_set_led_mA(int ch, float mA_per_led){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return;
+  }
+  s_model[ch].led_mA = mA_per_led > 0.f ? mA_per_led : 0.f;
+  rebuild_model(&s_model[ch]);
+}
+
+float power_get_led_mA(int ch){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return 0.f;
+  }
+  if (s_model[ch].led_mA > 0.f){
+    return s_model[ch].led_mA;
+  }
+  const led_model_t *base = type_model(s_model[ch].type);
+  return (base->uA_full[0] + base->uA_full[1] + base->uA_full[2] + base->uA_full[3] + base->uA_idle) / 1000.f;
+}
+
+float power_model_mA(int ch, const uint32_t sums[4]){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS || !sums){
+    return 0.f;
+  }
+  uint64_t uA_q8 = 0;
+  for (int k = 0; k < 4; ++k){
+    uA_q8 += (uint64_t)sums[k] * s_model[ch].coef_q8[k];
+  }
+  return (uint32_t)(uA_q8 >> 8) / 1000.f;
+}
+
+float power_model_mA_per_code(int ch){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return 0.f;
   }
-  const power_cfg_t* cfg = c ? c : &s_cfg;
-  uint32_t sum = 0;
-  for (int i=0;i<n;i++){
-    sum += fb[i].r + fb[i].g + fb[i].b + fb[i].w;
+  uint32_t worst = 0;
+  for (int k = 0; k < 4; ++k){
+    if (s_model[ch].coef_q8[k] > worst) worst = s_model[ch].coef_q8[k];
   }
-  float est_mA = (sum / 255.f) * (cfg->per_led_mA / 4.f);
-  if (est_mA <= 0.f){
+  return worst / 256000.f;
+}
+
+void power_set_weight(int ch, float weight){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return;
+  }
+  s_weight[ch] = weight > 0.f ? weight : 1.f;
+}
+
+float power_get_weight(int ch){
+  return (ch >= 0 && ch < POWER_ALED_CHANNELS) ? s_weight[ch] : 1.f;
+}
+
+void power_report_pwm_mA(float mA){
+  s_pwm_mA = mA > 0.f ? mA : 0.f;
+}
+
+// Weighted water-fill: scale_i = min(1, k * w_i) with sum(d_i * scale_i) ==
+// budget. Channels that would be boosted past 1 are pinned and the remainder
+// redistributed; at most one round per channel.
+static void allocate(float budget, float *scale){
+  float total = 0.f;
+  for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+    total += s_demand[i];
+  }
+  if (total <= budget){
+    for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+      scale[i] = 1.f;
+    }
+    return;
+  }
+
+  bool pinned[POWER_ALED_CHANNELS] = {0};
+  float remaining = budget > 0.f ? budget : 0.f;
+  for (int round = 0; round < POWER_ALED_CHANNELS; ++round){
+    float wd = 0.f;
+    for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+      if (!pinned[i]) wd += s_demand[i] * s_weight[i];
+    }
+    if (wd <= 0.f){
+      break;
+    }
+    float k = remaining / wd;
+    bool changed = false;
+    for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+      if (!pinned[i] && s_demand[i] > 0.f && k * s_weight[i] >= 1.f){
+        pinned[i] = true;
+        scale[i] = 1.f;
+        remaining -= s_demand[i];
+        changed = true;
+      }
+    }
+    if (!changed){
+      for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+        if (!pinned[i]) scale[i] = k * s_weight[i];
+      }
+      break;
+    }
+  }
+}
+
+static float idle_mA(void){
+  uint32_t uA = 0;
+  for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+    uA += s_model[i].idle_uA;
+  }
+  return uA / 1000.f;
+}
+
+static float aled_draw_mA(void){
+  float draw = idle_mA();
+  for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+    draw += s_demand[i] * s_scale[i];
+  }
+  return draw;
+}
+
+// Integrates the ALED draw at the scales currently applied into WINDOW_SLOTS
+// slots spanning burst_window_ms.
+static void window_advance(uint32_t now_ms){
+  uint32_t slot_ms = s_cfg.burst_window_ms / WINDOW_SLOTS;
+  if (!s_window_started || now_ms - s_window_last_ms > s_cfg.burst_window_ms){
+    window_reset();
+    s_slot_start_ms = now_ms;
+    s_window_last_ms = now_ms;
+    s_window_started = true;
+    return;
+  }
+  float draw = aled_draw_mA();
+  while (now_ms - s_slot_start_ms >= slot_ms){
+    uint32_t end = s_slot_start_ms + slot_ms;
+    s_slot_mAms[s_slot] += draw * (float)(end - s_window_last_ms);
+    s_window_last_ms = end;
+    s_slot_start_ms = end;
+    s_slot = (s_slot + 1) % WINDOW_SLOTS;
+    s_slot_mAms[s_slot] = 0.f;
+  }
+  s_slot_mAms[s_slot] += draw * (float)(now_ms - s_window_last_ms);
+  s_window_last_ms = now_ms;
+}
+
+static float clampf(float v, float lo, float hi){
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+float power_request(int ch, float demand_mA, uint32_t now_ms){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
     return 1.f;
   }
-  return est_mA > cfg->limit_mA ? (cfg->limit_mA / est_mA) : 1.f;
+  window_advance(now_ms);
+  s_demand[ch] = demand_mA > 0.f ? demand_mA : 0.f;
+
+  float steady = s_cfg.limit_mA;
+  float peak = s_cfg.burst_mA > steady ? s_cfg.burst_mA : steady;
+  float supply = s_cfg.psu_mA - s_pwm_mA;
+  if (peak > supply) peak = supply;
+  if (steady > peak) steady = peak;
+
+  // Spend below-average headroom as burst and pay it back afterwards:
+  // allowing 2*steady - avg drives the window average towards steady.
+  float allowed = clampf(2.f * steady - power_window_mA(), 2.f * steady - peak, peak);
+  float idle = idle_mA();
+  allocate(allowed - idle, s_target);
+  allocate(peak - idle, s_hard);
+
+  uint32_t dt = s_last_ms[ch] ? now_ms - s_last_ms[ch] : 0;
+  s_last_ms[ch] = now_ms;
+  float cur = s_scale[ch];
+  float next = clampf(s_target[ch], cur - ATTACK_PER_S * dt / 1000.f, cur + RELEASE_PER_S * dt / 1000.f);
+  // Slewing never holds a channel above what the hard ceiling allows, nor
+  // above what is left of it next to what the other channels output now
+  // (their demand may have risen since they were last allocated).
+  float others = idle;
+  for (int i = 0; i < POWER_ALED_CHANNELS; ++i){
+    if (i != ch) others += s_demand[i] * s_scale[i];
+  }
+  float left = s_demand[ch] > 0.f ? (peak - others) / s_demand[ch] : 1.f;
+  if (next > s_hard[ch]) next = s_hard[ch];
+  if (next > left) next = left;
+  s_scale[ch] = clampf(next, 0.f, 1.f);
+  return s_scale[ch];
+}
+
+float power_channel_mA(int ch){
+  if (ch < 0 || ch >= POWER_ALED_CHANNELS){
+    return 0.f;
+  }
+  return s_demand[ch] * s_scale[ch] + s_model[ch].idle_uA / 1000.f;
+}
+
+float power_total_mA(void){
+  return s_pwm_mA + aled_draw_mA();
+}
+
+float power_window_mA(void){
+  float mAms = 0.f;
+  for (int i = 0; i < WINDOW_SLOTS; ++i){
+    mAms += s_slot_mAms[i];
+  }
+  return mAms / s_cfg.burst_window_ms;
 }
@@ -1,10 +1,44 @@
 #pragma once
 #include "effects.h"
+
+#define POWER_ALED_CHANNELS 8
+
 typedef struct {
-  float per_led_mA;
-  float limit_mA;
+  float    limit_mA;        // steady ALED share of the supply (power_limits.aled_global_mA)
+  float    psu_mA;          // supply rating shared by ALED and PWM loads (v5_max_A)
+  float    burst_mA;        // short-term ALED ceiling; <= limit_mA disables bursting
+  uint32_t burst_window_ms; // rolling window the steady limit is averaged over
 } power_cfg_t;
 
 void               power_set_cfg(power_cfg_t cfg);
 const power_cfg_t* power_get_cfg(void);
-float              power_scale_for_frame(px_rgba_t* fb, int n, const power_cfg_t* cfg);
+
+// Per-channel current model: per-type defaults (per-color full-on current and
+// idle current per pixel), optionally rescaled so one pixel at full on draws
+// mA_per_led. Fixed point; evaluated once per frame from component totals.
+void               power_set_channel_model(int ch, led_type_t type, uint16_t n_pixels);
+void               power_set_led_mA(int ch, float mA_per_led);
+float              power_get_led_mA(int ch);
+// Unscaled LED current for r,g,b,w totals in 8-bit units (idle excluded).
+float              power_model_mA(int ch, const uint32_t sums[4]);
+// Worst-case mA per 8-bit component code, for estimates before any frame.
+float              power_model_mA_per_code(int ch);
+
+// Relative priority when the budget is exceeded; channels with a higher
+// weight are dimmed less. 1.0 for all channels is a plain proportional cut.
+void               power_set_weight(int ch, float weight);
+float              power_get_weight(int ch);
+
+// Current drawn by the PWM outputs; subtracted from the supply before the
+// ALED channels are allocated.
+void               power_report_pwm_mA(float mA);
+
+// Records ch's unlimited (scalable) demand for the coming frame and returns
+// the scale it may output at. Called from the render task only.
+float              power_request(int ch, float demand_mA, uint32_t now_ms);
+
+// Telemetry: estimated draw per channel including idle, total, and the
+// rolling-window average the burst budget is checked against.
+float              power_channel_mA(int ch);
+float              power_total_mA(void);
+float              power_window_mA(void);